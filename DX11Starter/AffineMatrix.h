@@ -0,0 +1,40 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// A world (or other affine) matrix without its constant
+// (0, 0, 0, 1) column, in 48 bytes instead of 64.
+//
+// Stored transposed: each row is one column of the
+// original, translation in w. That's what a column_major
+// float4x3 in a cbuffer and a float3x4 vertex input (read
+// a row per element) both expect, so shaders use it as is:
+//
+//   cbuffer:      mul(float4(p, 1), m)  or  (float3x3)m
+//   vertex input: mul(m, float4(p, 1))  or  (float3x3)m
+// --------------------------------------------------------
+struct AffineMatrix
+{
+	DirectX::XMFLOAT4 r[3];
+};
+
+// Packs an untransposed matrix; its fourth column is dropped
+inline void XM_CALLCONV StoreAffineMatrix(AffineMatrix* destination, DirectX::FXMMATRIX matrix)
+{
+	DirectX::XMMATRIX transposed = DirectX::XMMatrixTranspose(matrix);
+	DirectX::XMStoreFloat4(&destination->r[0], transposed.r[0]);
+	DirectX::XMStoreFloat4(&destination->r[1], transposed.r[1]);
+	DirectX::XMStoreFloat4(&destination->r[2], transposed.r[2]);
+}
+
+// Unpacks to an untransposed matrix, restoring (0, 0, 0, 1)
+inline DirectX::XMMATRIX XM_CALLCONV LoadAffineMatrix(const AffineMatrix* source)
+{
+	DirectX::XMMATRIX transposed(
+		DirectX::XMLoadFloat4(&source->r[0]),
+		DirectX::XMLoadFloat4(&source->r[1]),
+		DirectX::XMLoadFloat4(&source->r[2]),
+		DirectX::XMVectorSet(0, 0, 0, 1));
+	return DirectX::XMMatrixTranspose(transposed);
+}
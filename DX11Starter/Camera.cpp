@@ -10,6 +10,8 @@ Camera::Camera(float aspectRatio)
 	transform->SetPosition(0, 0, -8);
 	transform->SetRotation(0, 0, 1);
 	this->aspectRatio = aspectRatio;
+	nearPlane = 0.1f;
+	farPlane = 100.0f;
 	UpdateViewMatrix();
 }
 
@@ -23,8 +25,8 @@ void Camera::SetAspectRatio(float aspectRatio)
 	XMMATRIX P = XMMatrixPerspectiveFovLH(
 		0.25f * 3.1415926535f,	// Field of View Angle
 		aspectRatio,			// Aspect ratio
-		0.1f,				  	// Near clip plane distance
-		100.0f);			  	// Far clip plane distance
+		nearPlane,			  	// Near clip plane distance
+		farPlane);			  	// Far clip plane distance
 	XMStoreFloat4x4(&projectionMatrix, XMMatrixTranspose(P)); // Transpose for HLSL!
 }
 
@@ -119,4 +121,23 @@ void Camera::Rotate(float x, float y)
 	XMFLOAT3 rotation = transform->GetRotation();
 	float FOUR_PI = 12.56f; //I'm not sure why a full rotation is 4*PI instead of 2*PI...
 	transform->SetRotation(fmod(rotation.x + x, FOUR_PI), fmod(rotation.y + y, FOUR_PI), 0);
-}
\ No newline at end of file
+}
+
+void Camera::GetPickRay(int x, int y, int screenWidth, int screenHeight, XMFLOAT3& origin, XMFLOAT3& direction)
+{
+	// Pixel to normalized device coordinates (y points up)
+	float ndcX = (2.0f * (x + 0.5f) / screenWidth) - 1.0f;
+	float ndcY = 1.0f - (2.0f * (y + 0.5f) / screenHeight);
+
+	// Our matrices are stored transposed for HLSL
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix));
+	XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&projectionMatrix));
+	XMMATRIX inverseViewProjection = XMMatrixInverse(nullptr, XMMatrixMultiply(view, projection));
+
+	// Unproject points on the near and far planes
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0, 1), inverseViewProjection);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1, 1), inverseViewProjection);
+
+	XMStoreFloat3(&origin, nearPoint);
+	XMStoreFloat3(&direction, XMVector3Normalize(farPoint - nearPoint));
+}
@@ -6,6 +6,8 @@
 class Camera
 {
 	float aspectRatio;
+	float nearPlane;
+	float farPlane;
 	Transform* transform;
 
 	DirectX::XMFLOAT4X4 viewMatrix;
@@ -28,6 +30,9 @@ public:
 
 	void Rotate(float x, float y);
 
+	// Builds a world space ray through the given pixel
+	void GetPickRay(int x, int y, int screenWidth, int screenHeight, DirectX::XMFLOAT3& origin, DirectX::XMFLOAT3& direction);
+
 	DirectX::XMFLOAT4X4 getViewMatrix() {
 		return viewMatrix;
 	}
@@ -35,5 +40,13 @@ public:
 	DirectX::XMFLOAT4X4 getProjectionMatrix() {
 		return projectionMatrix;
 	}
+
+	float GetNearPlane() {
+		return nearPlane;
+	}
+
+	float GetFarPlane() {
+		return farPlane;
+	}
 };
 
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ConstantBufferLayout.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Writes a whole constant buffer from a C++ struct in one
+// copy, instead of setting its variables one at a time.
+//
+// T mirrors the cbuffer and lists its fields through a
+// static GetFields(count). Validate() compares them with
+// the shader's reflection data once, at load; Write() does
+// nothing unless that passed, so callers can fall back to
+// setting variables by name.
+// --------------------------------------------------------
+template <typename T>
+class ConstantBlock
+{
+public:
+	ConstantBlock()
+	{
+		shader = nullptr;
+		bufferIndex = 0;
+	}
+
+	// Every field must be in the named buffer at the same offset
+	// and size, and the buffer can't have any fields T lacks
+	bool Validate(ISimpleShader* shader, const std::string& bufferName)
+	{
+		this->shader = nullptr;
+		if (!shader->IsShaderValid()) {
+			return false;
+		}
+
+		const SimpleConstantBuffer* buffer = shader->GetBufferInfo(bufferName);
+		if (buffer == nullptr || sizeof(T) > buffer->Size) {
+			return false;
+		}
+
+		unsigned int index = 0;
+		while (shader->GetBufferInfo(index) != buffer) {
+			index++;
+		}
+
+		unsigned int fieldCount = 0;
+		const ConstantFieldInfo* fields = T::GetFields(fieldCount);
+		if (fieldCount != buffer->Variables.size()) {
+			return false;
+		}
+
+		for (unsigned int i = 0; i < fieldCount; i++) {
+			const SimpleShaderVariable* variable = shader->GetVariableInfo(fields[i].Name);
+			if (variable == nullptr
+				|| variable->ConstantBufferIndex != index
+				|| variable->ByteOffset != fields[i].Offset
+				|| variable->Size != fields[i].Size) {
+				return false;
+			}
+		}
+
+		this->shader = shader;
+		bufferIndex = index;
+		return true;
+	}
+
+	bool IsValid() const { return shader != nullptr; }
+	ISimpleShader* GetShader() const { return shader; }
+
+	bool Write(const T& data)
+	{
+		if (shader == nullptr) {
+			return false;
+		}
+
+		return shader->SetBufferData(bufferIndex, &data, sizeof(T));
+	}
+
+private:
+	ISimpleShader* shader;
+	unsigned int bufferIndex;
+};
+
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// HLSL constant buffer packing rules.
+//
+// Constant buffers are made of 16 byte registers:
+//  - A field that would straddle a register boundary starts
+//    at the next register instead
+//  - Structs and arrays always start a new register
+//  - Every array element but the last is padded out to a
+//    whole register
+//  - The buffer as a whole is rounded up to a register
+//
+// Everything here is constexpr, so C++ structs can be
+// checked against the rules with static_assert.
+// --------------------------------------------------------
+namespace HlslPacking
+{
+	static const unsigned int RegisterSize = 16;
+
+	constexpr unsigned int AlignToRegister(unsigned int offset)
+	{
+		return (offset + RegisterSize - 1) / RegisterSize * RegisterSize;
+	}
+
+	// Where a scalar, vector or matrix of size bytes lands when
+	// declared after the first end bytes of the buffer
+	constexpr unsigned int PlaceField(unsigned int end, unsigned int size)
+	{
+		return (end % RegisterSize != 0 && end % RegisterSize + size > RegisterSize) ? AlignToRegister(end) : end;
+	}
+
+	// Where a struct or array lands
+	constexpr unsigned int PlaceAggregate(unsigned int end)
+	{
+		return AlignToRegister(end);
+	}
+
+	// Bytes taken by an array, which has no padding after the last element
+	constexpr unsigned int ArraySize(unsigned int elementSize, unsigned int count)
+	{
+		return count == 0 ? 0 : (count - 1) * AlignToRegister(elementSize) + elementSize;
+	}
+
+	constexpr unsigned int BufferSize(unsigned int end)
+	{
+		return AlignToRegister(end);
+	}
+
+	// --------------------------------------------------------
+	// One field of a cbuffer, as declared in HLSL
+	// --------------------------------------------------------
+	struct FieldDesc
+	{
+		unsigned int Size;			// Of one element
+		unsigned int ArrayCount;	// 0 if not an array
+		bool IsStruct;
+	};
+
+	// --------------------------------------------------------
+	// Lays out the fields in order, writing each one's offset.
+	// Returns the size of the whole buffer.
+	// --------------------------------------------------------
+	inline unsigned int Layout(const FieldDesc* fields, unsigned int fieldCount, unsigned int* offsets)
+	{
+		unsigned int end = 0;
+		for (unsigned int i = 0; i < fieldCount; i++) {
+			const FieldDesc& field = fields[i];
+			if (field.ArrayCount > 0) {
+				offsets[i] = PlaceAggregate(end);
+				end = offsets[i] + ArraySize(field.Size, field.ArrayCount);
+			}
+			else if (field.IsStruct) {
+				offsets[i] = PlaceAggregate(end);
+				end = offsets[i] + field.Size;
+			}
+			else {
+				offsets[i] = PlaceField(end, field.Size);
+				end = offsets[i] + field.Size;
+			}
+		}
+
+		return BufferSize(end);
+	}
+}
+
+// --------------------------------------------------------
+// A field of a C++ mirror of a cbuffer, by HLSL name
+// --------------------------------------------------------
+struct ConstantFieldInfo
+{
+	const char* Name;
+	unsigned int Offset;
+	unsigned int Size;
+};
+
+#define CBUFFER_FIELD_SIZE(Type, Field) sizeof(((Type*)0)->Field)
+
+// Describes a field for ConstantBlock<Type> to check against reflection
+#define CBUFFER_FIELD(Type, Field) { #Field, (unsigned int)offsetof(Type, Field), (unsigned int)CBUFFER_FIELD_SIZE(Type, Field) }
+
+// Asserts that a C++ field sits where HLSL would put it. Fields
+// are checked against the one declared before them in HLSL, so
+// any padding members in between are skipped over.
+#define CBUFFER_CHECK_FIRST(Type, Field) \
+	static_assert(offsetof(Type, Field) == 0, #Type "::" #Field " must start the buffer")
+
+#define CBUFFER_CHECK_NEXT(Type, Field, Previous) \
+	static_assert(offsetof(Type, Field) == HlslPacking::PlaceField( \
+		offsetof(Type, Previous) + CBUFFER_FIELD_SIZE(Type, Previous), CBUFFER_FIELD_SIZE(Type, Field)), \
+		#Type "::" #Field " doesn't match HLSL packing")
+
+// For struct and array fields. Array elements also need
+// to be a whole number of registers in C++.
+#define CBUFFER_CHECK_NEXT_AGGREGATE(Type, Field, Previous) \
+	static_assert(offsetof(Type, Field) == HlslPacking::PlaceAggregate( \
+		offsetof(Type, Previous) + CBUFFER_FIELD_SIZE(Type, Previous)), \
+		#Type "::" #Field " doesn't match HLSL packing")
+
+#define CBUFFER_CHECK_ARRAY_STRIDE(Type, Field) \
+	static_assert(sizeof(((Type*)0)->Field[0]) % HlslPacking::RegisterSize == 0, \
+		#Type "::" #Field " elements must be padded to 16 bytes")
+
+#define CBUFFER_CHECK_SIZE(Type) \
+	static_assert(sizeof(Type) % HlslPacking::RegisterSize == 0, #Type " must be padded to 16 bytes")
+
@@ -0,0 +1,73 @@
+#include "ConstantRing.h"
+
+ConstantRing::ConstantRing(size_t capacity, size_t alignment)
+{
+	this->capacity = capacity & ~(alignment - 1);
+	this->alignment = alignment;
+	wrapCount = 0;
+	Reset();
+}
+
+ConstantRing::~ConstantRing()
+{
+}
+
+size_t ConstantRing::Allocate(size_t size)
+{
+	size_t alignedSize = (size + alignment - 1) & ~(alignment - 1);
+	size_t available = capacity - used;
+
+	// Not enough room before the end; skip what's left there
+	size_t skipped = 0;
+	if (head + alignedSize > capacity) {
+		skipped = capacity - head;
+	}
+
+	if (alignedSize == 0 || skipped + alignedSize > available) {
+		return InvalidOffset;
+	}
+
+	if (skipped > 0) {
+		head = 0;
+		wrapCount++;
+	}
+
+	size_t offset = head;
+	head += alignedSize;
+	if (head == capacity) {
+		head = 0;
+		wrapCount++;
+	}
+
+	used += skipped + alignedSize;
+	frameBytes += skipped + alignedSize;
+	return offset;
+}
+
+void ConstantRing::EndFrame(uint64_t fence)
+{
+	// Frames with nothing allocated have nothing to free
+	if (frameBytes > 0) {
+		Frame frame = { fence, frameBytes };
+		frames.push_back(frame);
+	}
+
+	frameBytes = 0;
+}
+
+void ConstantRing::Retire(uint64_t completedFence)
+{
+	while (!frames.empty() && frames.front().fence <= completedFence) {
+		used -= frames.front().size;
+		frames.pop_front();
+	}
+}
+
+void ConstantRing::Reset()
+{
+	head = 0;
+	used = 0;
+	frameBytes = 0;
+	frames.clear();
+}
+
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// --------------------------------------------------------
+// Hands out space in a ring of memory for constants written
+// linearly over a frame.
+//
+// Each frame's allocations stay in use until the fence passed
+// to EndFrame() for that frame is retired, so the GPU never
+// reads space that has been handed out again. Allocations
+// never straddle the end of the ring; whatever is left there
+// is skipped and counted as used until its frame retires.
+//
+// Only does the bookkeeping; it owns no memory and knows
+// nothing about D3D.
+// --------------------------------------------------------
+class ConstantRing
+{
+public:
+	static const size_t InvalidOffset = (size_t)-1;
+
+	// alignment must be a power of two
+	ConstantRing(size_t capacity, size_t alignment);
+	~ConstantRing();
+
+	// Returns the offset of the allocation, or InvalidOffset
+	// if it won't fit without overwriting space still in use
+	size_t Allocate(size_t size);
+
+	// Everything allocated since the last EndFrame() belongs to this fence
+	void EndFrame(uint64_t fence);
+
+	// Frees every frame with a fence up to and including this one
+	void Retire(uint64_t completedFence);
+
+	// Frees everything at once, in flight or not
+	void Reset();
+
+	size_t GetCapacity() { return capacity; }
+	size_t GetAlignment() { return alignment; }
+	size_t GetUsedBytes() { return used; }
+
+	// Bytes allocated since the last EndFrame(), including padding
+	size_t GetFrameBytes() { return frameBytes; }
+
+	// Frames ended but not retired yet
+	unsigned int GetPendingFrameCount() { return (unsigned int)frames.size(); }
+
+	// Times an allocation went back to the start of the ring
+	unsigned int GetWrapCount() { return wrapCount; }
+
+private:
+	struct Frame
+	{
+		uint64_t fence;
+		size_t size;
+	};
+
+	size_t capacity;
+	size_t alignment;
+
+	// The next allocation starts at head; the oldest space in
+	// use starts used bytes before it, wrapping around
+	size_t head;
+	size_t used;
+	size_t frameBytes;
+	unsigned int wrapCount;
+
+	std::deque<Frame> frames;
+};
+
@@ -0,0 +1,202 @@
+#include "ConstantUploader.h"
+#include <cstring>
+
+ConstantUploader::ConstantUploader(ID3D11Device* device, ID3D11DeviceContext* context, size_t capacity)
+{
+	this->device = device;
+	this->context = context;
+
+	buffer = nullptr;
+	ring = nullptr;
+	CreateBuffer(capacity);
+
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	for (unsigned int i = 0; i < MaxFramesInFlight; i++) {
+		fences[i] = nullptr;
+		device->CreateQuery(&queryDesc, &fences[i]);
+	}
+
+	nextFence = 1;
+	retiredFence = 0;
+	bytesUploaded = 0;
+	bytesAllocated = 0;
+	discardCount = 0;
+}
+
+ConstantUploader::~ConstantUploader()
+{
+	for (unsigned int i = 0; i < MaxFramesInFlight; i++) {
+		if (fences[i]) { fences[i]->Release(); }
+	}
+
+	if (buffer) { buffer->Release(); }
+	delete ring;
+}
+
+bool ConstantUploader::IsSupported(ID3D11Device* device)
+{
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))) {
+		return false;
+	}
+
+	return options.ConstantBufferOffsetting == TRUE && options.MapNoOverwriteOnDynamicConstantBuffer == TRUE;
+}
+
+void ConstantUploader::CreateBuffer(size_t capacity)
+{
+	if (buffer) { buffer->Release(); }
+	delete ring;
+
+	capacity = (capacity + Alignment - 1) & ~(Alignment - 1);
+
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = (UINT)capacity;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	buffer = nullptr;
+	device->CreateBuffer(&bufferDesc, 0, &buffer);
+	ring = new ConstantRing(capacity, Alignment);
+
+	// A new buffer has to be mapped with discard first
+	needsDiscard = true;
+}
+
+// --------------------------------------------------------
+// Frees the ring space of every frame the GPU has finished
+// --------------------------------------------------------
+void ConstantUploader::RetireFences()
+{
+	while (retiredFence + 1 < nextFence) {
+		ID3D11Query* fence = fences[(retiredFence + 1) % MaxFramesInFlight];
+		if (context->GetData(fence, nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+			break;
+		}
+
+		retiredFence++;
+	}
+
+	ring->Retire(retiredFence);
+}
+
+// --------------------------------------------------------
+// Gives every SetConstants command its own range of the ring.
+// Returns false, with the ring's frame half allocated, if
+// there wasn't room for all of them.
+// --------------------------------------------------------
+bool ConstantUploader::Allocate(RenderCommandBuffer* lists, unsigned int listCount)
+{
+	for (unsigned int i = 0; i < listCount; i++) {
+		RenderCommandBuffer& commands = lists[i];
+		for (size_t offset = 0; offset < commands.GetSize(); offset += commands.GetCommand(offset)->size) {
+			RenderCommand* command = commands.GetCommand(offset);
+			if (command->type != CommandSetConstants) {
+				continue;
+			}
+
+			SetConstantsCommand* constants = (SetConstantsCommand*)command;
+			size_t ringOffset = ring->Allocate(constants->dataSize);
+			if (ringOffset == ConstantRing::InvalidOffset) {
+				return false;
+			}
+
+			constants->ringBuffer = buffer;
+			constants->firstConstant = (unsigned int)(ringOffset / 16);
+			constants->constantCount = (unsigned int)(((constants->dataSize + Alignment - 1) & ~(Alignment - 1)) / 16);
+		}
+	}
+
+	return true;
+}
+
+void ConstantUploader::Upload(RenderCommandBuffer* lists, unsigned int listCount)
+{
+	bytesUploaded = 0;
+	bytesAllocated = 0;
+
+	size_t frameSize = 0;
+	for (unsigned int i = 0; i < listCount; i++) {
+		RenderCommandBuffer& commands = lists[i];
+		for (size_t offset = 0; offset < commands.GetSize(); offset += commands.GetCommand(offset)->size) {
+			const RenderCommand* command = commands.GetCommand(offset);
+			if (command->type == CommandSetConstants) {
+				unsigned int dataSize = ((const SetConstantsCommand*)command)->dataSize;
+				frameSize += (dataSize + Alignment - 1) & ~(Alignment - 1);
+				bytesUploaded += dataSize;
+			}
+		}
+	}
+
+	if (frameSize == 0) {
+		return;
+	}
+
+	// A frame always fits in an empty ring; grow with room
+	// for a few of them to be in flight at once
+	if (frameSize > ring->GetCapacity()) {
+		CreateBuffer(frameSize * MaxFramesInFlight);
+	}
+
+	RetireFences();
+
+	// Every fence is still pending, so this frame couldn't be fenced
+	if (nextFence - retiredFence > MaxFramesInFlight) {
+		needsDiscard = true;
+	}
+
+	if (!needsDiscard && !Allocate(lists, listCount)) {
+		needsDiscard = true;
+	}
+
+	// The driver renames the buffer on a discard, so everything
+	// still in flight keeps its old memory
+	if (needsDiscard) {
+		ring->Reset();
+		retiredFence = nextFence - 1;
+		Allocate(lists, listCount);
+		discardCount++;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	D3D11_MAP mapType = needsDiscard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (FAILED(context->Map(buffer, 0, mapType, 0, &mapped))) {
+		// Nothing was written, so fall back to updating each buffer
+		for (unsigned int i = 0; i < listCount; i++) {
+			RenderCommandBuffer& commands = lists[i];
+			for (size_t offset = 0; offset < commands.GetSize(); offset += commands.GetCommand(offset)->size) {
+				RenderCommand* command = commands.GetCommand(offset);
+				if (command->type == CommandSetConstants) {
+					((SetConstantsCommand*)command)->ringBuffer = nullptr;
+				}
+			}
+		}
+
+		ring->Reset();
+		needsDiscard = true;
+		return;
+	}
+
+	unsigned char* ringData = (unsigned char*)mapped.pData;
+	for (unsigned int i = 0; i < listCount; i++) {
+		RenderCommandBuffer& commands = lists[i];
+		for (size_t offset = 0; offset < commands.GetSize(); offset += commands.GetCommand(offset)->size) {
+			const RenderCommand* command = commands.GetCommand(offset);
+			if (command->type == CommandSetConstants) {
+				const SetConstantsCommand* constants = (const SetConstantsCommand*)command;
+				memcpy(ringData + constants->firstConstant * 16, constants->GetData(), constants->dataSize);
+			}
+		}
+	}
+
+	context->Unmap(buffer, 0);
+
+	bytesAllocated = ring->GetFrameBytes();
+	context->End(fences[nextFence % MaxFramesInFlight]);
+	ring->EndFrame(nextFence);
+	nextFence++;
+	needsDiscard = false;
+}
+
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ConstantRing.h"
+#include "RenderCommandBuffer.h"
+#include <d3d11_1.h>
+#include <cstdint>
+
+// --------------------------------------------------------
+// Copies every frame's constants into one large dynamic
+// buffer instead of updating each shader's own buffers draw
+// by draw.
+//
+// Upload() writes the data of every SetConstants command in
+// the lists into a ConstantRing with a single Map, and points
+// the commands at their range of it. Executors then bind that
+// range (VSSetConstantBuffers1 and friends) in place of an
+// UpdateSubresource.
+//
+// Frames are fenced with event queries. If the GPU falls too
+// far behind to make room, the buffer is discarded and the
+// driver hands back fresh memory instead of stalling.
+//
+// Needs D3D11.1 constant buffer offsets; check IsSupported()
+// and leave the commands alone otherwise, which makes the
+// executors fall back to UpdateSubresource.
+// --------------------------------------------------------
+class ConstantUploader
+{
+public:
+	// Offsets and sizes of bound ranges must be multiples of 16 constants
+	static const size_t Alignment = 256;
+
+	ConstantUploader(ID3D11Device* device, ID3D11DeviceContext* context, size_t capacity);
+	~ConstantUploader();
+
+	static bool IsSupported(ID3D11Device* device);
+
+	void Upload(RenderCommandBuffer* lists, unsigned int listCount);
+
+	// Constant data copied by the last Upload(), and the ring
+	// space it took up including alignment
+	size_t GetBytesUploaded() { return bytesUploaded; }
+	size_t GetBytesAllocated() { return bytesAllocated; }
+
+	// Times the buffer was discarded because the ring was full
+	unsigned int GetDiscardCount() { return discardCount; }
+
+private:
+	// Frames the GPU may be behind before the buffer is discarded
+	static const unsigned int MaxFramesInFlight = 3;
+
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+
+	ID3D11Buffer* buffer;
+	ConstantRing* ring;
+
+	// One event query per frame in flight, used round robin
+	ID3D11Query* fences[MaxFramesInFlight];
+	uint64_t nextFence;
+	uint64_t retiredFence;
+	bool needsDiscard;
+
+	size_t bytesUploaded;
+	size_t bytesAllocated;
+	unsigned int discardCount;
+
+	void CreateBuffer(size_t capacity);
+	void RetireFences();
+	bool Allocate(RenderCommandBuffer* lists, unsigned int listCount);
+};
+
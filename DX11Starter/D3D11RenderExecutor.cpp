@@ -0,0 +1,155 @@
+#include "D3D11RenderExecutor.h"
+#include "SimpleShader.h"
+
+D3D11RenderExecutor::D3D11RenderExecutor(ID3D11DeviceContext* context, StateCache* stateCache)
+{
+	this->context = context;
+	this->stateCache = stateCache;
+}
+
+void D3D11RenderExecutor::Execute(const RenderCommandBuffer& commands)
+{
+	for (size_t offset = 0; offset < commands.GetSize(); offset += commands.GetCommand(offset)->size) {
+		const RenderCommand* command = commands.GetCommand(offset);
+
+		switch (command->type) {
+		case CommandBindPipeline: {
+			const BindPipelineCommand* bind = (const BindPipelineCommand*)command;
+			BindShader(stateCache, bind->vertexShader);
+			BindShader(stateCache, bind->pixelShader);
+			break;
+		}
+		case CommandSetConstants: {
+			const SetConstantsCommand* constants = (const SetConstantsCommand*)command;
+			if (constants->ringBuffer) {
+				stateCache->SetConstantBufferRange(constants->stage, constants->slot,
+					constants->ringBuffer, constants->firstConstant, constants->constantCount);
+			}
+			else {
+				context->UpdateSubresource(static_cast<ID3D11Buffer*>(constants->buffer), 0, 0, constants->GetData(), 0, 0);
+				stateCache->SetConstantBuffer(constants->stage, constants->slot, constants->buffer);
+			}
+			break;
+		}
+		case CommandBindTexture: {
+			const BindTextureCommand* bind = (const BindTextureCommand*)command;
+			stateCache->SetShaderResource(bind->stage, bind->slot, bind->srv);
+			break;
+		}
+		case CommandBindSampler: {
+			const BindSamplerCommand* bind = (const BindSamplerCommand*)command;
+			stateCache->SetSampler(bind->stage, bind->slot, bind->sampler);
+			break;
+		}
+		case CommandBindGeometry: {
+			const BindGeometryCommand* bind = (const BindGeometryCommand*)command;
+			stateCache->SetVertexBuffer(0, bind->vertexBuffer, bind->stride, 0);
+			stateCache->SetIndexBuffer(bind->indexBuffer, bind->indexFormat, 0);
+			break;
+		}
+		case CommandDrawIndexed: {
+			const DrawIndexedCommand* draw = (const DrawIndexedCommand*)command;
+			context->DrawIndexed(draw->indexCount, draw->startIndex, draw->baseVertex);
+			break;
+		}
+		case CommandBindInstances: {
+			const BindInstancesCommand* bind = (const BindInstancesCommand*)command;
+			stateCache->SetVertexBuffer(1, bind->instanceBuffer, bind->stride, 0);
+			break;
+		}
+		case CommandDrawIndexedInstanced: {
+			const DrawIndexedInstancedCommand* draw = (const DrawIndexedInstancedCommand*)command;
+			context->DrawIndexedInstanced(draw->indexCount, draw->instanceCount, draw->startIndex, draw->baseVertex, draw->startInstance);
+			break;
+		}
+		}
+	}
+}
+
+D3D11DeferredRenderExecutor::D3D11DeferredRenderExecutor(ID3D11Device* device, ID3D11DeviceContext* immediateContext,
+	StateCache* immediateStateCache, ThreadPool* threadPool, unsigned int contextCount)
+{
+	this->immediateContext = immediateContext;
+	this->threadPool = threadPool;
+	immediateExecutor = new D3D11RenderExecutor(immediateContext, immediateStateCache);
+
+	for (unsigned int i = 0; i < contextCount; i++) {
+		DeferredContext deferred = {};
+		if (FAILED(device->CreateDeferredContext(0, &deferred.context))) {
+			break;
+		}
+
+		deferred.stateTarget = new DeviceContextStateTarget(deferred.context);
+		deferred.stateCache = new StateCache(deferred.stateTarget);
+		deferred.executor = new D3D11RenderExecutor(deferred.context, deferred.stateCache);
+		deferredContexts.push_back(deferred);
+	}
+}
+
+D3D11DeferredRenderExecutor::~D3D11DeferredRenderExecutor()
+{
+	for (unsigned int i = 0; i < deferredContexts.size(); i++) {
+		delete deferredContexts[i].executor;
+		delete deferredContexts[i].stateCache;
+		delete deferredContexts[i].stateTarget;
+		deferredContexts[i].context->Release();
+	}
+
+	delete immediateExecutor;
+}
+
+bool D3D11DeferredRenderExecutor::IsSupported(ID3D11Device* device)
+{
+	D3D11_FEATURE_DATA_THREADING threading = {};
+	if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading)))) {
+		return false;
+	}
+
+	return threading.DriverCommandLists == TRUE;
+}
+
+void D3D11DeferredRenderExecutor::Execute(const RenderCommandBuffer& commands)
+{
+	immediateExecutor->Execute(commands);
+}
+
+void D3D11DeferredRenderExecutor::ExecuteLists(const RenderCommandBuffer* lists, unsigned int listCount)
+{
+	// Not worth a deferred context, or more lists than contexts
+	if (listCount < 2 || listCount > deferredContexts.size()) {
+		IRenderExecutor::ExecuteLists(lists, listCount);
+		return;
+	}
+
+	// Deferred contexts start out with no state at all,
+	// so they need the immediate context's targets
+	ID3D11RenderTargetView* renderTarget = nullptr;
+	ID3D11DepthStencilView* depthStencil = nullptr;
+	immediateContext->OMGetRenderTargets(1, &renderTarget, &depthStencil);
+
+	D3D11_VIEWPORT viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+	UINT viewportCount = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+	immediateContext->RSGetViewports(&viewportCount, viewports);
+
+	threadPool->ParallelFor(listCount, [&](unsigned int i) {
+		DeferredContext& deferred = deferredContexts[i];
+		deferred.context->OMSetRenderTargets(1, &renderTarget, depthStencil);
+		deferred.context->RSSetViewports(viewportCount, viewports);
+		deferred.context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		// Finishing a command list clears the context's state
+		deferred.stateCache->Invalidate();
+		deferred.executor->Execute(lists[i]);
+		deferred.context->FinishCommandList(FALSE, &deferred.commandList);
+	});
+
+	// Submission order is list order, whichever thread finished first
+	for (unsigned int i = 0; i < listCount; i++) {
+		immediateContext->ExecuteCommandList(deferredContexts[i].commandList, TRUE);
+		deferredContexts[i].commandList->Release();
+		deferredContexts[i].commandList = nullptr;
+	}
+
+	if (renderTarget) { renderTarget->Release(); }
+	if (depthStencil) { depthStencil->Release(); }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "RenderExecutor.h"
+#include "DeviceContextStateTarget.h"
+#include "ThreadPool.h"
+#include <vector>
+
+// --------------------------------------------------------
+// Submits commands to a D3D11 device context, with all
+// bindings going through the state cache
+// --------------------------------------------------------
+class D3D11RenderExecutor : public IRenderExecutor
+{
+	ID3D11DeviceContext* context;
+	StateCache* stateCache;
+
+public:
+	D3D11RenderExecutor(ID3D11DeviceContext* context, StateCache* stateCache);
+
+	void Execute(const RenderCommandBuffer& commands);
+};
+
+// --------------------------------------------------------
+// Plays lists back in parallel, each on its own deferred
+// context, then runs the resulting D3D11 command lists on
+// the immediate context in list order.
+//
+// Only worth it when the driver builds command lists
+// natively; otherwise the runtime emulates them.
+// --------------------------------------------------------
+class D3D11DeferredRenderExecutor : public IRenderExecutor
+{
+	struct DeferredContext
+	{
+		ID3D11DeviceContext* context;
+		DeviceContextStateTarget* stateTarget;
+		StateCache* stateCache;
+		D3D11RenderExecutor* executor;
+		ID3D11CommandList* commandList;
+	};
+
+	ID3D11DeviceContext* immediateContext;
+	D3D11RenderExecutor* immediateExecutor;
+	ThreadPool* threadPool;
+	std::vector<DeferredContext> deferredContexts;
+
+public:
+	D3D11DeferredRenderExecutor(ID3D11Device* device, ID3D11DeviceContext* immediateContext,
+		StateCache* immediateStateCache, ThreadPool* threadPool, unsigned int contextCount);
+	~D3D11DeferredRenderExecutor();
+
+	// Does the driver support command lists natively?
+	static bool IsSupported(ID3D11Device* device);
+
+	void Execute(const RenderCommandBuffer& commands);
+	void ExecuteLists(const RenderCommandBuffer* lists, unsigned int listCount);
+};
+
@@ -0,0 +1,85 @@
+#include "D3DShaderCompiler.h"
+#include <fstream>
+#include <iterator>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+D3DShaderCompiler::D3DShaderCompiler()
+{
+	flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined(DEBUG) || defined(_DEBUG)
+	flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+}
+
+D3DShaderCompiler::~D3DShaderCompiler()
+{
+}
+
+static void CopyErrors(ID3DBlob* errorBlob, std::string& errors)
+{
+	if (errorBlob) {
+		errors.assign((const char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize());
+		errorBlob->Release();
+	}
+}
+
+bool D3DShaderCompiler::Preprocess(const ShaderBuildJob& job, std::string& output, std::string& errors)
+{
+	std::ifstream file(job.SourceFile.c_str(), std::ios::binary);
+	if (!file) {
+		errors = "Can't open " + job.SourceFile;
+		return false;
+	}
+	std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	// Null terminated, as d3dcompiler expects
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (unsigned int i = 0; i < job.Defines.size(); i++) {
+		D3D_SHADER_MACRO macro = { job.Defines[i].Name.c_str(), job.Defines[i].Value.c_str() };
+		macros.push_back(macro);
+	}
+	D3D_SHADER_MACRO terminator = { nullptr, nullptr };
+	macros.push_back(terminator);
+
+	ID3DBlob* text = nullptr;
+	ID3DBlob* errorBlob = nullptr;
+	HRESULT hr = D3DPreprocess(source.c_str(), source.size(), job.SourceFile.c_str(),
+		&macros[0], D3D_COMPILE_STANDARD_FILE_INCLUDE, &text, &errorBlob);
+	CopyErrors(errorBlob, errors);
+	if (FAILED(hr)) {
+		return false;
+	}
+
+	// The blob's size includes the terminator
+	output.assign((const char*)text->GetBufferPointer());
+	text->Release();
+	return true;
+}
+
+// --------------------------------------------------------
+// The source is already preprocessed, so it needs neither
+// the defines nor an include handler
+// --------------------------------------------------------
+bool D3DShaderCompiler::Compile(const ShaderBuildJob& job, const std::string& preprocessed, std::vector<unsigned char>& bytecode, std::string& errors)
+{
+	ID3DBlob* code = nullptr;
+	ID3DBlob* errorBlob = nullptr;
+	HRESULT hr = D3DCompile(preprocessed.c_str(), preprocessed.size(), job.SourceFile.c_str(),
+		nullptr, nullptr, job.EntryPoint.c_str(), job.Profile.c_str(), flags, 0, &code, &errorBlob);
+	CopyErrors(errorBlob, errors);
+	if (FAILED(hr)) {
+		return false;
+	}
+
+	const unsigned char* data = (const unsigned char*)code->GetBufferPointer();
+	bytecode.assign(data, data + code->GetBufferSize());
+	code->Release();
+	return true;
+}
+
+std::string D3DShaderCompiler::GetVersion()
+{
+	return "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION) + " flags " + std::to_string(flags);
+}
+
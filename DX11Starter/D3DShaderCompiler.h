@@ -0,0 +1,24 @@
+#pragma once
+
+#include "ShaderBuilder.h"
+#include <d3dcompiler.h>
+
+// --------------------------------------------------------
+// Compiles shaders with d3dcompiler (FXC), the compiler
+// behind the project's own FxCompile step, using the same
+// flags: debug info and no optimization in debug builds
+// --------------------------------------------------------
+class D3DShaderCompiler : public IShaderCompiler
+{
+public:
+	D3DShaderCompiler();
+	~D3DShaderCompiler();
+
+	bool Preprocess(const ShaderBuildJob& job, std::string& output, std::string& errors);
+	bool Compile(const ShaderBuildJob& job, const std::string& preprocessed, std::vector<unsigned char>& bytecode, std::string& errors);
+	std::string GetVersion();
+
+private:
+	UINT flags;
+};
+
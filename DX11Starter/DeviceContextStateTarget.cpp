@@ -0,0 +1,165 @@
+#include "DeviceContextStateTarget.h"
+#include "SimpleShader.h"
+
+DeviceContextStateTarget::DeviceContextStateTarget(ID3D11DeviceContext* context)
+{
+	this->context = context;
+
+	context1 = nullptr;
+	context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&context1);
+}
+
+DeviceContextStateTarget::~DeviceContextStateTarget()
+{
+	if (context1) { context1->Release(); }
+}
+
+void DeviceContextStateTarget::BindShader(ShaderStage stage, StateObject shader)
+{
+	switch (stage) {
+	case StageVertex: context->VSSetShader(static_cast<ID3D11VertexShader*>(shader), 0, 0); break;
+	case StageHull: context->HSSetShader(static_cast<ID3D11HullShader*>(shader), 0, 0); break;
+	case StageDomain: context->DSSetShader(static_cast<ID3D11DomainShader*>(shader), 0, 0); break;
+	case StageGeometry: context->GSSetShader(static_cast<ID3D11GeometryShader*>(shader), 0, 0); break;
+	case StagePixel: context->PSSetShader(static_cast<ID3D11PixelShader*>(shader), 0, 0); break;
+	case StageCompute: context->CSSetShader(static_cast<ID3D11ComputeShader*>(shader), 0, 0); break;
+	default: break;
+	}
+}
+
+void DeviceContextStateTarget::BindConstantBuffer(ShaderStage stage, unsigned int slot, StateObject constantBuffer)
+{
+	ID3D11Buffer* buffer = static_cast<ID3D11Buffer*>(constantBuffer);
+	switch (stage) {
+	case StageVertex: context->VSSetConstantBuffers(slot, 1, &buffer); break;
+	case StageHull: context->HSSetConstantBuffers(slot, 1, &buffer); break;
+	case StageDomain: context->DSSetConstantBuffers(slot, 1, &buffer); break;
+	case StageGeometry: context->GSSetConstantBuffers(slot, 1, &buffer); break;
+	case StagePixel: context->PSSetConstantBuffers(slot, 1, &buffer); break;
+	case StageCompute: context->CSSetConstantBuffers(slot, 1, &buffer); break;
+	default: break;
+	}
+}
+
+void DeviceContextStateTarget::BindConstantBufferRange(ShaderStage stage, unsigned int slot, StateObject constantBuffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (context1 == nullptr) {
+		BindConstantBuffer(stage, slot, constantBuffer);
+		return;
+	}
+
+	ID3D11Buffer* buffer = static_cast<ID3D11Buffer*>(constantBuffer);
+	UINT first = firstConstant;
+	UINT count = constantCount;
+	switch (stage) {
+	case StageVertex: context1->VSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+	case StageHull: context1->HSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+	case StageDomain: context1->DSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+	case StageGeometry: context1->GSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+	case StagePixel: context1->PSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+	case StageCompute: context1->CSSetConstantBuffers1(slot, 1, &buffer, &first, &count); break;
+	default: break;
+	}
+}
+
+void DeviceContextStateTarget::BindShaderResource(ShaderStage stage, unsigned int slot, StateObject shaderResource)
+{
+	ID3D11ShaderResourceView* srv = static_cast<ID3D11ShaderResourceView*>(shaderResource);
+	switch (stage) {
+	case StageVertex: context->VSSetShaderResources(slot, 1, &srv); break;
+	case StageHull: context->HSSetShaderResources(slot, 1, &srv); break;
+	case StageDomain: context->DSSetShaderResources(slot, 1, &srv); break;
+	case StageGeometry: context->GSSetShaderResources(slot, 1, &srv); break;
+	case StagePixel: context->PSSetShaderResources(slot, 1, &srv); break;
+	case StageCompute: context->CSSetShaderResources(slot, 1, &srv); break;
+	default: break;
+	}
+}
+
+void DeviceContextStateTarget::BindSampler(ShaderStage stage, unsigned int slot, StateObject samplerState)
+{
+	ID3D11SamplerState* sampler = static_cast<ID3D11SamplerState*>(samplerState);
+	switch (stage) {
+	case StageVertex: context->VSSetSamplers(slot, 1, &sampler); break;
+	case StageHull: context->HSSetSamplers(slot, 1, &sampler); break;
+	case StageDomain: context->DSSetSamplers(slot, 1, &sampler); break;
+	case StageGeometry: context->GSSetSamplers(slot, 1, &sampler); break;
+	case StagePixel: context->PSSetSamplers(slot, 1, &sampler); break;
+	case StageCompute: context->CSSetSamplers(slot, 1, &sampler); break;
+	default: break;
+	}
+}
+
+void DeviceContextStateTarget::BindInputLayout(StateObject inputLayout)
+{
+	context->IASetInputLayout(static_cast<ID3D11InputLayout*>(inputLayout));
+}
+
+void DeviceContextStateTarget::BindVertexBuffer(unsigned int slot, StateObject vertexBuffer, unsigned int stride, unsigned int offset)
+{
+	ID3D11Buffer* buffer = static_cast<ID3D11Buffer*>(vertexBuffer);
+	context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+}
+
+void DeviceContextStateTarget::BindIndexBuffer(StateObject indexBuffer, unsigned int format, unsigned int offset)
+{
+	context->IASetIndexBuffer(static_cast<ID3D11Buffer*>(indexBuffer), (DXGI_FORMAT)format, offset);
+}
+
+static void BindConstantBuffers(StateCache* cache, ShaderStage stage, ISimpleShader* shader)
+{
+	unsigned int bufferCount = shader->GetBufferCount();
+	for (unsigned int i = 0; i < bufferCount; i++) {
+		const SimpleConstantBuffer* buffer = shader->GetBufferInfo(i);
+		cache->SetConstantBuffer(stage, buffer->BindIndex, buffer->ConstantBuffer);
+	}
+}
+
+// --------------------------------------------------------
+// Mirrors SimpleVertexShader::SetShaderAndCBs()
+// --------------------------------------------------------
+void BindShader(StateCache* cache, SimpleVertexShader* shader)
+{
+	if (!shader->IsShaderValid()) return;
+
+	cache->SetInputLayout(shader->GetInputLayout());
+	cache->SetShader(StageVertex, shader->GetDirectXShader());
+	BindConstantBuffers(cache, StageVertex, shader);
+}
+
+// --------------------------------------------------------
+// Mirrors SimplePixelShader::SetShaderAndCBs()
+// --------------------------------------------------------
+void BindShader(StateCache* cache, SimplePixelShader* shader)
+{
+	if (!shader->IsShaderValid()) return;
+
+	cache->SetShader(StagePixel, shader->GetDirectXShader());
+	BindConstantBuffers(cache, StagePixel, shader);
+}
+
+// --------------------------------------------------------
+// Returns false if the shader has no texture of that name
+// --------------------------------------------------------
+bool SetShaderResourceView(StateCache* cache, ShaderStage stage, ISimpleShader* shader, const char* name, ID3D11ShaderResourceView* srv)
+{
+	const SimpleSRV* srvInfo = shader->GetShaderResourceViewInfo(name);
+	if (srvInfo == 0)
+		return false;
+
+	cache->SetShaderResource(stage, srvInfo->BindIndex, srv);
+	return true;
+}
+
+// --------------------------------------------------------
+// Returns false if the shader has no sampler of that name
+// --------------------------------------------------------
+bool SetSamplerState(StateCache* cache, ShaderStage stage, ISimpleShader* shader, const char* name, ID3D11SamplerState* sampler)
+{
+	const SimpleSampler* samplerInfo = shader->GetSamplerInfo(name);
+	if (samplerInfo == 0)
+		return false;
+
+	cache->SetSampler(stage, samplerInfo->BindIndex, sampler);
+	return true;
+}
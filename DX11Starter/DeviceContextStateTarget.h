@@ -0,0 +1,41 @@
+#pragma once
+
+#include "StateCache.h"
+#include <d3d11_1.h>
+
+class ISimpleShader;
+class SimpleVertexShader;
+class SimplePixelShader;
+
+// --------------------------------------------------------
+// Forwards the state cache's bindings to a D3D11 device
+// context.
+//
+// Constant buffer ranges need a D3D11.1 context; without
+// one the whole buffer is bound instead.
+// --------------------------------------------------------
+class DeviceContextStateTarget : public IStateTarget
+{
+	ID3D11DeviceContext* context;
+	ID3D11DeviceContext1* context1;
+
+public:
+	DeviceContextStateTarget(ID3D11DeviceContext* context);
+	~DeviceContextStateTarget();
+
+	void BindShader(ShaderStage stage, StateObject shader);
+	void BindConstantBuffer(ShaderStage stage, unsigned int slot, StateObject constantBuffer);
+	void BindConstantBufferRange(ShaderStage stage, unsigned int slot, StateObject constantBuffer, unsigned int firstConstant, unsigned int constantCount);
+	void BindShaderResource(ShaderStage stage, unsigned int slot, StateObject shaderResource);
+	void BindSampler(ShaderStage stage, unsigned int slot, StateObject samplerState);
+	void BindInputLayout(StateObject inputLayout);
+	void BindVertexBuffer(unsigned int slot, StateObject vertexBuffer, unsigned int stride, unsigned int offset);
+	void BindIndexBuffer(StateObject indexBuffer, unsigned int format, unsigned int offset);
+};
+
+// SimpleShader equivalents of SetShaderAndCBs(), SetShaderResourceView()
+// and SetSamplerState() that go through a state cache
+void BindShader(StateCache* cache, SimpleVertexShader* shader);
+void BindShader(StateCache* cache, SimplePixelShader* shader);
+bool SetShaderResourceView(StateCache* cache, ShaderStage stage, ISimpleShader* shader, const char* name, ID3D11ShaderResourceView* srv);
+bool SetSamplerState(StateCache* cache, ShaderStage stage, ISimpleShader* shader, const char* name, ID3D11SamplerState* sampler);
@@ -0,0 +1,122 @@
+#include "DrawKeys.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace DrawKeys;
+
+// The radix sort works on one byte of the key per pass
+static const unsigned int RadixBits = 8;
+static const unsigned int RadixBuckets = 1 << RadixBits;
+static const unsigned int RadixPasses = 64 / RadixBits;
+
+// Shader, material and mesh, packed the same way in either pass
+static const unsigned int MeshShift = 0;
+static const unsigned int MaterialShift = MeshShift + MeshBits;
+static const unsigned int ShaderShift = MaterialShift + MaterialBits;
+static const unsigned int StateBits = ShaderShift + ShaderBits;
+
+// Opaque keys put the state above the depth, transparent ones below it
+static const unsigned int OpaqueStateShift = DepthBits;
+static const unsigned int TransparentDepthShift = StateBits;
+static const unsigned int PassShift = StateBits + DepthBits;
+
+static_assert(PassShift + PassBits == 64, "Key fields must fill 64 bits");
+
+static uint64_t Field(uint64_t key, unsigned int shift, unsigned int bits)
+{
+	return (key >> shift) & ((1ull << bits) - 1);
+}
+
+static uint64_t GetState(uint64_t key)
+{
+	unsigned int shift = GetPass(key) == PassTransparent ? 0 : OpaqueStateShift;
+	return Field(key, shift, StateBits);
+}
+
+uint64_t DrawKeys::MakeKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth)
+{
+	depth = std::min(std::max(depth, 0.0f), 1.0f);
+	uint64_t quantizedDepth = (uint64_t)(depth * ((1 << DepthBits) - 1));
+
+	pass &= (1u << PassBits) - 1;
+	uint64_t state = ((uint64_t)(shader & ((1u << ShaderBits) - 1)) << ShaderShift)
+		| ((uint64_t)(material & ((1u << MaterialBits) - 1)) << MaterialShift)
+		| ((uint64_t)(mesh & ((1u << MeshBits) - 1)) << MeshShift);
+
+	if (pass == PassTransparent) {
+		return ((uint64_t)pass << PassShift) | (quantizedDepth << TransparentDepthShift) | state;
+	}
+	return ((uint64_t)pass << PassShift) | (state << OpaqueStateShift) | quantizedDepth;
+}
+
+unsigned int DrawKeys::GetPass(uint64_t key)
+{
+	return (unsigned int)Field(key, PassShift, PassBits);
+}
+
+unsigned int DrawKeys::GetShader(uint64_t key)
+{
+	return (unsigned int)Field(GetState(key), ShaderShift, ShaderBits);
+}
+
+unsigned int DrawKeys::GetMaterial(uint64_t key)
+{
+	return (unsigned int)Field(GetState(key), MaterialShift, MaterialBits);
+}
+
+unsigned int DrawKeys::GetMesh(uint64_t key)
+{
+	return (unsigned int)Field(GetState(key), MeshShift, MeshBits);
+}
+
+// --------------------------------------------------------
+// Stable LSD radix sort, one byte per pass. All histograms
+// are gathered in a single read up front, and passes where
+// every key shares the same byte are skipped entirely.
+// --------------------------------------------------------
+void DrawKeys::RadixSort(DrawItem* items, DrawItem* scratch, size_t count)
+{
+	if (count < 2) {
+		return;
+	}
+
+	size_t histograms[RadixPasses][RadixBuckets];
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++) {
+		uint64_t key = items[i].key;
+		for (unsigned int pass = 0; pass < RadixPasses; pass++) {
+			histograms[pass][(key >> (pass * RadixBits)) & (RadixBuckets - 1)]++;
+		}
+	}
+
+	DrawItem* source = items;
+	DrawItem* destination = scratch;
+	for (unsigned int pass = 0; pass < RadixPasses; pass++) {
+		size_t* histogram = histograms[pass];
+		unsigned int shift = pass * RadixBits;
+
+		// Nothing to do if every key lands in the same bucket
+		if (histogram[(source[0].key >> shift) & (RadixBuckets - 1)] == count) {
+			continue;
+		}
+
+		// Turn counts into starting offsets
+		size_t offset = 0;
+		for (unsigned int b = 0; b < RadixBuckets; b++) {
+			size_t bucketCount = histogram[b];
+			histogram[b] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			destination[histogram[(source[i].key >> shift) & (RadixBuckets - 1)]++] = source[i];
+		}
+
+		std::swap(source, destination);
+	}
+
+	// An odd number of passes leaves the result in the scratch buffer
+	if (source != items) {
+		memcpy(items, source, count * sizeof(DrawItem));
+	}
+}
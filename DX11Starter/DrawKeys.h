@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class Entity;
+
+// --------------------------------------------------------
+// A single draw waiting to be submitted
+// --------------------------------------------------------
+struct DrawItem
+{
+	uint64_t key;
+	Entity* entity;
+};
+
+// --------------------------------------------------------
+// Packed 64-bit sort keys for draws. The draw's state, the
+// shader (10 bits), material (16) and mesh (16) ids, is
+// placed by pass, most significant bits first:
+//
+//   opaque:      pass (2) | shader | material | mesh | depth (20)
+//   transparent: pass (2) | depth (20) | shader | material | mesh
+//
+// Opaque draws are grouped by state and go front to back
+// within it. Transparent draws have to blend in order, so
+// depth comes first: callers pass it inverted, and they sort
+// back to front across the whole scene, with state only
+// breaking ties.
+// --------------------------------------------------------
+namespace DrawKeys
+{
+	static const unsigned int PassBits = 2;
+	static const unsigned int ShaderBits = 10;
+	static const unsigned int MaterialBits = 16;
+	static const unsigned int MeshBits = 16;
+	static const unsigned int DepthBits = 20;
+
+	enum RenderPass
+	{
+		PassOpaque = 0,
+		PassTransparent = 1
+	};
+
+	// Packs a key; depth is expected to be normalized to [0, 1]
+	uint64_t MakeKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth);
+
+	// Unpacks a key's fields, wherever its pass put them
+	unsigned int GetPass(uint64_t key);
+	unsigned int GetShader(uint64_t key);
+	unsigned int GetMaterial(uint64_t key);
+	unsigned int GetMesh(uint64_t key);
+
+	// Sorts items by key using a least significant digit radix sort.
+	// scratch must hold at least count items.
+	void RadixSort(DrawItem* items, DrawItem* scratch, size_t count);
+}
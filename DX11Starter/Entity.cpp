@@ -1,4 +1,5 @@
 #include "Entity.h"
+#include <cmath>
 
 
 
@@ -7,6 +8,13 @@ Entity::Entity(Mesh* mesh, Material* material)
 	this->mesh = mesh;
 	this->material = material;
 	transform = new Transform();
+	isStatic = false;
+
+	lodMeshes[0] = mesh;
+	lodChain = {};
+	lodChain.Count = 1;
+	lod = 0;
+	fade = 1;
 }
 
 
@@ -20,7 +28,12 @@ Entity::~Entity()
 
 Mesh * Entity::GetMesh()
 {
-	return mesh;
+	return lodMeshes[lod];
+}
+
+Material * Entity::GetMaterial()
+{
+	return material;
 }
 
 Transform * Entity::GetTransform()
@@ -28,6 +41,56 @@ Transform * Entity::GetTransform()
 	return transform;
 }
 
+bool Entity::IsStatic()
+{
+	return isStatic;
+}
+
+void Entity::SetStatic(bool isStatic)
+{
+	this->isStatic = isStatic;
+}
+
+// Errors are kept as shares of the full detail mesh's bounding
+// radius, so they don't need rescaling as the entity is
+void Entity::SetLods(Mesh** meshes, const float* errors, unsigned int count)
+{
+	mesh = meshes[0];
+
+	DirectX::XMFLOAT3 extents = mesh->GetBounds().Extents;
+	float radius = sqrtf(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z);
+
+	lodChain = {};
+	lodChain.Count = count < MaxLods ? count : MaxLods;
+	for (unsigned int i = 0; i < lodChain.Count; i++) {
+		lodMeshes[i] = meshes[i];
+		lodChain.Errors[i] = radius > 0 ? errors[i] / radius : 0;
+	}
+
+	lod = 0;
+}
+
+const LodChain& Entity::GetLodChain()
+{
+	return lodChain;
+}
+
+unsigned int Entity::GetLod()
+{
+	return lod;
+}
+
+float Entity::GetFade()
+{
+	return fade;
+}
+
+void Entity::SetLod(unsigned int lod, float fade)
+{
+	this->lod = lod < lodChain.Count ? lod : lodChain.Count - 1;
+	this->fade = fade;
+}
+
 DirectX::XMFLOAT4X4 Entity::GetDrawMatrix()
 {
 	DirectX::XMMATRIX W = DirectX::XMLoadFloat4x4(&transform->GetMatrix());
@@ -36,33 +99,10 @@ DirectX::XMFLOAT4X4 Entity::GetDrawMatrix()
 	return matrix;
 }
 
-void Entity::PrepareMaterial(DirectX::XMFLOAT4X4 viewMatrix, DirectX::XMFLOAT4X4 projectionMatrix, ID3D11SamplerState* sampler)
+DirectX::BoundingBox Entity::GetWorldBounds()
 {
-	// Send data to shader variables
-	//  - Do this ONCE PER OBJECT you're drawing
-	//  - This is actually a complex process of copying data to a local buffer
-	//    and then copying that entire buffer to the GPU.  
-	//  - The "SimpleShader" class handles all of that for you.
-	material->GetVertexShader()->SetMatrix4x4("world", GetDrawMatrix());
-	material->GetVertexShader()->SetMatrix4x4("view", viewMatrix);
-	material->GetVertexShader()->SetMatrix4x4("projection", projectionMatrix);
-
-	material->GetPixelShader()->SetData("Color", &material->GetColor(), sizeof(DirectX::XMFLOAT4));
-
-	material->GetPixelShader()->SetSamplerState("Sampler", sampler);
-	material->GetPixelShader()->SetShaderResourceView("Texture", material->GetTexture());
-
-	// Once you've set all of the data you care to change for
-	// the next draw call, you need to actually send it to the GPU
-	//  - If you skip this, the "SetMatrix" calls above won't make it to the GPU!
-	material->GetVertexShader()->CopyAllBufferData();
-	material->GetPixelShader()->CopyAllBufferData();
-
-	// Set the vertex and pixel shaders to use for the next Draw() command
-	//  - These don't technically need to be set every frame...YET
-	//  - Once you start applying different shaders to different objects,
-	//    you'll need to swap the current shaders before each draw
-	material->GetVertexShader()->SetShader();
-	material->GetPixelShader()->SetShader();
-
-}
\ No newline at end of file
+	DirectX::XMFLOAT4X4 world = transform->GetMatrix();
+	DirectX::BoundingBox worldBounds;
+	mesh->GetBounds().Transform(worldBounds, DirectX::XMLoadFloat4x4(&world));
+	return worldBounds;
+}
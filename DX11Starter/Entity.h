@@ -3,7 +3,9 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "Transform.h"
+#include "LodChain.h"
 #include <DirectXMath.h>
+#include <DirectXCollision.h>
 
 class Entity
 {
@@ -11,14 +13,43 @@ class Entity
 	Material* material;
 	Transform* transform;
 
+	// Static entities never move after placement and may be merged
+	// into a combined mesh by the renderer
+	bool isStatic;
+
+	// Detail levels, finest first, and the one drawn this frame.
+	// Entities without a chain have just their mesh.
+	Mesh* lodMeshes[MaxLods];
+	LodChain lodChain;
+	unsigned int lod;
+	float fade;
+
 public:
 	Entity(Mesh* mesh, Material* material);
 	virtual ~Entity();
 
+	// The mesh for the current detail level
 	Mesh* GetMesh();
+	Material* GetMaterial();
 	Transform* GetTransform();
-	void PrepareMaterial(DirectX::XMFLOAT4X4 viewMatrix, DirectX::XMFLOAT4X4 projectionMatrix, ID3D11SamplerState* sampler);
+
+	bool IsStatic();
+	void SetStatic(bool isStatic);
+
+	// Gives the entity coarser meshes to draw when it's small on
+	// screen. meshes[0] replaces its mesh; errors are in its units,
+	// how far each mesh strays from meshes[0], and only grow.
+	void SetLods(Mesh** meshes, const float* errors, unsigned int count);
+	const LodChain& GetLodChain();
+
+	// Detail level picked for this frame, and how faded out the entity is
+	unsigned int GetLod();
+	float GetFade();
+	void SetLod(unsigned int lod, float fade);
 
 	DirectX::XMFLOAT4X4 GetDrawMatrix();
+
+	// Bounds of the full detail mesh transformed into world space
+	DirectX::BoundingBox GetWorldBounds();
 };
 
@@ -1,6 +1,7 @@
 #include "Game.h"
 #include "Vertex.h"
 #include "WICTextureLoader.h"
+#include <chrono>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -22,10 +23,13 @@ Game::Game(HINSTANCE hInstance)
 		true)			   // Show extra stats (fps) in title bar?
 {
 	// Initialize fields
-	vertexShader = 0;
-	pixelShader = 0;
+	renderer = nullptr;
 	mouseDragging = false;
 	camera = new Camera((float)width / height);
+	threadPool = nullptr;
+	occlusionCuller = nullptr;
+	picker = new Picker();
+	selectedEntity = nullptr;
 
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -55,21 +59,18 @@ Game::~Game()
 		delete meshes;
 	}
 
-	// Delete our simple shader objects, which
-	// will clean up their own internal DirectX stuff
-	delete baseMaterial;
+	// The renderer owns the shaders, sampler and default material
 	delete crate;
 	delete blue;
-	delete lights;
+	delete renderer;
 
-	delete vertexShader;
-	delete pixelShader;
 	delete camera;
 
-	sampler->Release();
-	defaultSrv->Release();
+	delete occlusionCuller;
+	delete threadPool;
+	delete picker;
+
 	crateSrv->Release();
-	defaultTexture->Release();
 }
 
 // --------------------------------------------------------
@@ -79,7 +80,9 @@ Game::~Game()
 void Game::Init()
 {
 
-	renderer = new Renderer(device, context);
+	threadPool = new ThreadPool();
+	renderer = new Renderer(device, context, threadPool);
+	occlusionCuller = new OcclusionCuller(threadPool);
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
@@ -93,8 +96,8 @@ void Game::Init()
 		0, //we don't actually need the texture reference
 		&crateSrv);
 
-	crate = new Material(vertexShader, pixelShader, crateSrv);
-	blue = new Material(vertexShader, pixelShader, XMFLOAT4(0.15f, 0.15f, 1, 1), defaultSrv);
+	crate = new Material(renderer->GetVertexShader(), renderer->GetPixelShader(KeywordClustered), crateSrv);
+	blue = new Material(renderer->GetVertexShader(), renderer->GetPixelShader(KeywordOneLight | KeywordUntextured | KeywordObjectLights), XMFLOAT4(0.15f, 0.15f, 1, 1), renderer->GetDefaultTexture());
 
 	CreateBasicGeometry();
 
@@ -174,18 +177,20 @@ void Game::CreateBasicGeometry()
 		new Mesh("Debug/Assets/Models/torus.obj", device),
 	};
 
-	DirectionalLight light = {};
-	light.AmbientColor = DirectX::XMFLOAT4(0.1f, 0.1f, 0.1f, 1.0f);
-	light.DiffuseColor = DirectX::XMFLOAT4(1.0f, 1.0f, 0.75f, 1.0f);
-	light.Direction = DirectX::XMFLOAT3(1, -1, 0);
+	lights.AddDirectional(XMFLOAT3(1, -1, 0), XMFLOAT3(1.0f, 1.0f, 0.75f), XMFLOAT3(0.1f, 0.1f, 0.1f));
+	lights.AddDirectional(XMFLOAT3(-1, 1, 0), XMFLOAT3(1.0f, 0, 0), XMFLOAT3(0, 0, 0));
 
-	DirectionalLight light2 = {};
-	light2.AmbientColor = DirectX::XMFLOAT4(0, 0, 0, 1.0f);
-	light2.DiffuseColor = DirectX::XMFLOAT4(1.0f, 0, 0, 1.0f);
-	light2.Direction = DirectX::XMFLOAT3(-1, 1, 0);
+	// A ring of colored point lights around the scene, and a spot
+	// shining down on the middle of it
+	for (unsigned int i = 0; i < 12; i++) {
+		float angle = XM_2PI * i / 12;
+		lights.AddPoint(XMFLOAT3(cosf(angle) * 5, 1.5f, sinf(angle) * 5), 4,
+			XMFLOAT3(0.5f + 0.5f * cosf(angle), 0.5f + 0.5f * cosf(angle + XM_2PI / 3), 0.5f + 0.5f * cosf(angle - XM_2PI / 3)));
+	}
 
-	lights = new DirectionalLight[2] { light, light2 };
+	lights.AddSpot(XMFLOAT3(0, 6, 0), XMFLOAT3(0, -1, 0), 10, cosf(XM_PIDIV4 / 2), XMFLOAT3(1, 1, 1));
 
+	Material* baseMaterial = renderer->GetDefaultMaterial();
 	entities.push_back(new Entity(meshes[0], baseMaterial));
 	entities.push_back(new Entity(meshes[1], baseMaterial)); //cube
 	entities.push_back(new Entity(meshes[2], baseMaterial));
@@ -198,6 +203,46 @@ void Game::CreateBasicGeometry()
 
 	entities[0]->GetTransform()->SetPosition(1.5f, 0, 0);
 
+	// These never move, so they can be merged into static batches
+	entities[5]->GetTransform()->SetPosition(-2, 0, 0);
+	entities[6]->GetTransform()->SetPosition(-4, 0, 0);
+	entities[7]->GetTransform()->SetPosition(4, 0, 0); //sphere
+	entities[5]->SetStatic(true);
+	entities[6]->SetStatic(true);
+	entities[7]->SetStatic(true);
+
+	renderer->BuildHlodClusters(entities);
+	renderer->BuildStaticBatches(entities);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	HlodClusters* hlodClusters = renderer->GetHlodClusters();
+	printf("\nHLOD: %u entities in %u clusters, %u triangles simplified to %u",
+		hlodClusters->GetEntityCount(), (unsigned int)hlodClusters->GetClusters().size(),
+		hlodClusters->GetSourceTriangleCount(), hlodClusters->GetProxyTriangleCount());
+	StaticBatcher* staticBatcher = renderer->GetStaticBatcher();
+	printf("\nStatic batching: %u entities in %u draws, %u KB merged vs %u KB shared",
+		staticBatcher->GetEntityCount(), staticBatcher->GetBatchCount(),
+		(unsigned int)(staticBatcher->GetMergedBytes() / 1024), (unsigned int)(staticBatcher->GetSourceBytes() / 1024));
+	PixelShaderPermutations* pixelShaders = renderer->GetPixelShaderPermutations();
+	printf("\nShaders loaded in %.2f ms (%u from reflection sidecars), %u of %u pixel shader variants built",
+		renderer->GetShaderLoadSeconds() * 1000.0f, renderer->GetShadersLoadedFromSidecar(),
+		pixelShaders->GetVariantCount(), (unsigned int)ShaderVariantCount);
+
+	ShaderBuilder* shaderBuilder = renderer->GetShaderBuilder();
+	if (shaderBuilder != nullptr) {
+		printf("\nShader build: %u compiled, %u cached, %u failed in %.2f ms",
+			shaderBuilder->GetCompiledCount(), shaderBuilder->GetCachedCount(), shaderBuilder->GetFailedCount(),
+			shaderBuilder->GetBuildSeconds() * 1000.0f);
+
+		const std::vector<ShaderBuildResult>& results = shaderBuilder->GetResults();
+		for (unsigned int i = 0; i < results.size(); i++) {
+			if (results[i].Status == ShaderBuildFailed) {
+				printf("\n%s", results[i].Errors.c_str());
+			}
+		}
+	}
+#endif
+
 
 }
 
@@ -240,22 +285,61 @@ void Game::Update(float deltaTime, float totalTime)
 	entities[4]->GetTransform()->SetPosition(0, sin(totalTime), -2);
 	entities[4]->GetTransform()->SetRotation(sin(totalTime) * 3.14f, sin(totalTime) * 3.14f, sin(totalTime) * 3.14f);
 
-	//Move stuff out of the way
-	entities[5]->GetTransform()->SetPosition(-2, 0, 0);
-	entities[6]->GetTransform()->SetPosition(-4, 0, 0);
-	entities[7]->GetTransform()->SetPosition(4, 0, 0); //sphere
-
 	//Make the Torus spin
 	entities[8]->GetTransform()->SetPosition(4, 0, 0);
 	entities[8]->GetTransform()->SetRotation(totalTime * 3, 0, totalTime * 3);
 	entities[8]->GetTransform()->SetScale(2, 2, 2);
 }
 
+// --------------------------------------------------------
+// Hands the culler each entity's bounds, transform and mesh,
+// and keeps the ones it reports visible
+// --------------------------------------------------------
+void Game::CullEntities()
+{
+	unsigned int count = (unsigned int)entities.size();
+	cullBounds.resize(count);
+	cullWorlds.resize(count);
+	cullMeshes.resize(count);
+	for (unsigned int i = 0; i < count; i++) {
+		Mesh* mesh = entities[i]->GetMesh();
+		cullBounds[i] = entities[i]->GetWorldBounds();
+		cullWorlds[i] = entities[i]->GetTransform()->GetMatrix();
+
+		// Meshes without CPU side geometry are left with no indices, so never occlude
+		OccluderMesh occluder = {};
+		if (mesh->HasGeometry()) {
+			occluder.positions = &mesh->GetVertices()[0].Position;
+			occluder.positionStride = sizeof(Vertex);
+			occluder.vertexCount = (unsigned int)mesh->GetVertices().size();
+			occluder.indices = &mesh->GetIndices()[0];
+			occluder.indexCount = (unsigned int)mesh->GetIndices().size();
+		}
+		cullMeshes[i] = occluder;
+	}
+
+	// Camera matrices are stored transposed for HLSL
+	XMFLOAT4X4 viewMatrix = camera->getViewMatrix();
+	XMFLOAT4X4 projectionMatrix = camera->getProjectionMatrix();
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix));
+	XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&projectionMatrix));
+
+	visibleEntities.clear();
+	if (count > 0) {
+		occlusionCuller->Cull(view, projection, &cullBounds[0], &cullWorlds[0], &cullMeshes[0], count, visibleIndices);
+		for (unsigned int i = 0; i < visibleIndices.size(); i++) {
+			visibleEntities.push_back(entities[visibleIndices[i]]);
+		}
+	}
+}
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = {0.4f, 0.6f, 0.75f, 0.0f};
 
@@ -269,35 +353,17 @@ void Game::Draw(float deltaTime, float totalTime)
 		1.0f,
 		0);
 
-	std::vector<Entity*>::iterator it;
-	for (it = entities.begin(); it < entities.end(); it++) {
+	// Only draw what the camera can actually see
+	CullEntities();
 
-		baseMaterial->GetPixelShader()->SetData("light", &lights[0], sizeof(DirectionalLight));
-		baseMaterial->GetPixelShader()->SetData("light2", &lights[1], sizeof(DirectionalLight));
-		(*it)->PrepareMaterial(camera->getViewMatrix(), camera->getProjectionMatrix(), sampler);
-
-		// Set buffers in the input assembler
-		//  - Do this ONCE PER OBJECT you're drawing, since each object might
-		//    have different geometry.
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-
-		Mesh* mesh = (*it)->GetMesh();
-		ID3D11Buffer* vertexBuffer = mesh->GetVertexBuffer();
-		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-		context->IASetIndexBuffer(mesh->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
-
-		// Finally do the actual drawing
-		//  - Do this ONCE PER OBJECT you intend to draw
-		//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
-		//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
-		//     vertices in the currently set VERTEX BUFFER
-		context->DrawIndexed(
-			mesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-			0,     // Offset to the first index we want to use
-			0);    // Offset to add to each index when looking up vertices
+	// Coarser meshes for whatever's small on screen
+	renderer->SelectLods(visibleEntities, camera, drawnEntities);
 
-	}
+	// Draws are sorted by shader, material and mesh before submission
+	renderer->Render(drawnEntities, camera, &lights);
+
+	// Detail for the next frame follows how this one went
+	renderer->UpdateBudget(std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count());
 
 	// Present the back buffer to the user
 	//  - Puts the final frame we're drawing into the window so the user can see it
@@ -320,6 +386,20 @@ void Game::OnMouseDown(WPARAM buttonState, int x, int y)
 		mouseDragging = true;
 	}
 
+	// Right click selects whatever is under the cursor
+	if (buttonState & 0x0002) {
+		picker->Build(entities);
+
+		RaycastHit hit;
+		selectedEntity = picker->Pick(camera, x, y, width, height, hit) ? hit.entity : nullptr;
+
+#if defined(DEBUG) || defined(_DEBUG)
+		if (selectedEntity != nullptr) {
+			printf("\nPicked entity at distance %f (triangle %d)", hit.distance, (int)hit.triangleIndex);
+		}
+#endif
+	}
+
 	// Save the previous mouse position, so we have it for the future
 	prevMousePos.x = x;
 	prevMousePos.y = y;
@@ -6,8 +6,11 @@
 #include "Mesh.h"
 #include "Entity.h"
 #include "Camera.h"
-#include "Lights.h"
+#include "LightManager.h"
 #include "Renderer.h"
+#include "ThreadPool.h"
+#include "OcclusionCuller.h"
+#include "Picker.h"
 
 class Game 
 	: public DXCore
@@ -33,30 +36,37 @@ private:
 
 	// Initialization helper methods - feel free to customize, combine, etc.
 	void CreateBasicGeometry();
+	void CullEntities();
 
 	std::vector<Entity*> entities;
 	Renderer* renderer;
 
+	//Culling
+	ThreadPool* threadPool;
+	OcclusionCuller* occlusionCuller;
+	std::vector<DirectX::BoundingBox> cullBounds;
+	std::vector<DirectX::XMFLOAT4X4> cullWorlds;
+	std::vector<OccluderMesh> cullMeshes;
+	std::vector<unsigned int> visibleIndices;
+	std::vector<Entity*> visibleEntities;
+	std::vector<Entity*> drawnEntities;
+
+	//Mouse picking
+	Picker* picker;
+	Entity* selectedEntity;
+
 	//Meshes
 	const int meshCount = 9;
 	Mesh** meshes;
 
 	//Textures
-	ID3D11ShaderResourceView* defaultSrv;
 	ID3D11ShaderResourceView* crateSrv;
-	ID3D11SamplerState* sampler;
-
-	// Wrappers for DirectX shaders to provide simplified functionality
-	SimpleVertexShader* vertexShader;
-	SimplePixelShader* pixelShader;
 
 	//Rendering Data
-	ID3D11Texture2D* defaultTexture;
-	Material* baseMaterial;
 	Material* crate;
 	Material* blue;
 	Camera* camera;
-	DirectionalLight* lights;
+	LightManager lights;
 
 	// Keeps track of the old mouse position.  Useful for 
 	// determining how far the mouse moved in a single frame.
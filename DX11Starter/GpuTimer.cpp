@@ -0,0 +1,83 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	this->context = context;
+
+	D3D11_QUERY_DESC disjointDesc = {};
+	disjointDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+	D3D11_QUERY_DESC timestampDesc = {};
+	timestampDesc.Query = D3D11_QUERY_TIMESTAMP;
+	for (unsigned int i = 0; i < MaxFramesInFlight; i++) {
+		frames[i] = {};
+		device->CreateQuery(&disjointDesc, &frames[i].disjoint);
+		device->CreateQuery(&timestampDesc, &frames[i].begin);
+		device->CreateQuery(&timestampDesc, &frames[i].end);
+	}
+
+	nextFrame = 0;
+	readFrame = 0;
+	timing = false;
+	seconds = 0;
+}
+
+GpuTimer::~GpuTimer()
+{
+	for (unsigned int i = 0; i < MaxFramesInFlight; i++) {
+		if (frames[i].disjoint) { frames[i].disjoint->Release(); }
+		if (frames[i].begin) { frames[i].begin->Release(); }
+		if (frames[i].end) { frames[i].end->Release(); }
+	}
+}
+
+void GpuTimer::Begin()
+{
+	ReadResults();
+
+	Frame& frame = frames[nextFrame % MaxFramesInFlight];
+	timing = nextFrame - readFrame < MaxFramesInFlight && frame.disjoint && frame.begin && frame.end;
+	if (!timing) {
+		return;
+	}
+
+	context->Begin(frame.disjoint);
+	context->End(frame.begin);
+}
+
+void GpuTimer::End()
+{
+	if (!timing) {
+		return;
+	}
+
+	Frame& frame = frames[nextFrame % MaxFramesInFlight];
+	context->End(frame.end);
+	context->End(frame.disjoint);
+	nextFrame++;
+	timing = false;
+}
+
+// --------------------------------------------------------
+// Takes the results of every frame the GPU has finished,
+// oldest first, keeping the newest
+// --------------------------------------------------------
+void GpuTimer::ReadResults()
+{
+	while (readFrame < nextFrame) {
+		Frame& frame = frames[readFrame % MaxFramesInFlight];
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		UINT64 begin, end;
+		if (context->GetData(frame.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			context->GetData(frame.begin, &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			context->GetData(frame.end, &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+			break;
+		}
+
+		if (!disjoint.Disjoint && disjoint.Frequency > 0 && end >= begin) {
+			seconds = (float)((double)(end - begin) / disjoint.Frequency);
+		}
+
+		readFrame++;
+	}
+}
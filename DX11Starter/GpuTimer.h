@@ -0,0 +1,47 @@
+#pragma once
+
+#include <d3d11.h>
+#include <cstdint>
+
+// --------------------------------------------------------
+// Times each frame's GPU work with timestamp queries.
+//
+// Results come back a few frames late, and are only read
+// once they're ready, so timing never stalls the CPU; if
+// the GPU falls too far behind, frames go untimed until it
+// catches up. Frames the GPU's clock was disjoint over,
+// as when it changed speed, are thrown out.
+// --------------------------------------------------------
+class GpuTimer
+{
+public:
+	GpuTimer(ID3D11Device* device, ID3D11DeviceContext* context);
+	~GpuTimer();
+
+	// Around the work to time, once each per frame
+	void Begin();
+	void End();
+
+	// Latest frame the GPU finished, or 0 before any has
+	float GetSeconds() { return seconds; }
+
+private:
+	static const unsigned int MaxFramesInFlight = 4;
+
+	ID3D11DeviceContext* context;
+
+	struct Frame
+	{
+		ID3D11Query* disjoint;
+		ID3D11Query* begin;
+		ID3D11Query* end;
+	};
+
+	Frame frames[MaxFramesInFlight];
+	uint64_t nextFrame;
+	uint64_t readFrame;
+	bool timing;
+	float seconds;
+
+	void ReadResults();
+};
@@ -0,0 +1,292 @@
+#include "HlodClusters.h"
+#include "WorldGeometry.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <unordered_set>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Bits of each grid coordinate in a cell's key; cells past the
+// end of the range share the last one
+static const unsigned int CellBits = 20;
+static const uint64_t MaxCell = (1u << CellBits) - 1;
+
+HlodClusters::HlodClusters()
+{
+	proxyResolution = 64;
+
+	sourceTriangles = 0;
+	proxyTriangles = 0;
+}
+
+HlodClusters::~HlodClusters()
+{
+	Clear();
+}
+
+void HlodClusters::Clear()
+{
+	for (unsigned int i = 0; i < clusters.size(); i++) {
+		delete clusters[i].proxy;
+	}
+	for (unsigned int i = 0; i < proxyMeshes.size(); i++) {
+		delete proxyMeshes[i];
+	}
+
+	grouping.Clear();
+	clusters.clear();
+	locations.clear();
+	proxyMeshes.clear();
+	sourceTriangles = 0;
+	proxyTriangles = 0;
+}
+
+// --------------------------------------------------------
+// Keys the static entities by material, in the order the
+// materials are first seen, as StaticBatcher does, so the
+// grouping splits each material up by position
+// --------------------------------------------------------
+void HlodClusters::Build(const std::vector<Entity*>& entities, ID3D11Device* device)
+{
+	Clear();
+
+	std::unordered_map<Material*, unsigned int> materialKeys;
+	std::vector<Entity*> candidates;
+	std::vector<BoundingBox> bounds;
+	std::vector<unsigned int> keys;
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		Entity* entity = entities[i];
+		Material* material = entity->GetMaterial();
+		if (!entity->IsStatic() || !entity->GetMesh()->HasGeometry() || material->GetColor().w < 1.0f) {
+			continue;
+		}
+
+		std::unordered_map<Material*, unsigned int>::iterator it = materialKeys.find(material);
+		if (it == materialKeys.end()) {
+			it = materialKeys.insert(std::make_pair(material, (unsigned int)materialKeys.size())).first;
+		}
+		candidates.push_back(entity);
+		bounds.push_back(entity->GetWorldBounds());
+		keys.push_back(it->second);
+	}
+
+	grouping.Build(bounds.empty() ? nullptr : &bounds[0], keys.empty() ? nullptr : &keys[0], (unsigned int)candidates.size());
+
+	std::vector<HlodGroup>& groups = grouping.GetGroups();
+	const std::vector<unsigned int>& members = grouping.GetMembers();
+	for (unsigned int g = 0; g < groups.size(); g++) {
+		HlodCluster cluster = {};
+		for (unsigned int i = groups[g].first; i < groups[g].first + groups[g].count; i++) {
+			cluster.members.push_back(candidates[members[i]]);
+			locations[candidates[members[i]]] = g;
+		}
+		cluster.material = cluster.members[0]->GetMaterial();
+
+		BuildProxy(cluster, groups[g], device);
+		clusters.push_back(cluster);
+	}
+}
+
+// --------------------------------------------------------
+// Merges the members into world space, the same way
+// StaticBatcher does, and simplifies the result on a grid
+// sized to the cluster
+// --------------------------------------------------------
+void HlodClusters::BuildProxy(HlodCluster& cluster, HlodGroup& group, ID3D11Device* device)
+{
+	std::vector<Vertex> vertices;
+	std::vector<UINT> indices;
+	for (unsigned int m = 0; m < cluster.members.size(); m++) {
+		Entity* entity = cluster.members[m];
+		Mesh* mesh = entity->GetMesh();
+		AppendWorldGeometry(mesh->GetVertices(), mesh->GetIndices(), entity->GetTransform()->GetMatrix(), vertices, indices);
+	}
+
+	std::vector<Vertex> simplifiedVertices;
+	std::vector<UINT> simplifiedIndices;
+	float cellSize = std::max(2 * group.bounds.w / proxyResolution, FLT_MIN);
+	float proxyError = Simplify(vertices, indices, cellSize, simplifiedVertices, simplifiedIndices);
+
+	cluster.sourceTriangles = (unsigned int)indices.size() / 3;
+	cluster.proxyTriangles = (unsigned int)simplifiedIndices.size() / 3;
+	sourceTriangles += cluster.sourceTriangles;
+	proxyTriangles += cluster.proxyTriangles;
+
+	// Everything collapsed away; the group keeps no error, so the
+	// members are drawn whatever the distance
+	if (simplifiedIndices.empty()) {
+		return;
+	}
+
+	// Kept on the CPU and flagged static, so the proxies can be merged too
+	Mesh* proxyMesh = new Mesh(&simplifiedIndices[0], &simplifiedVertices[0], (int)simplifiedIndices.size(), (int)simplifiedVertices.size(), device, true);
+	proxyMeshes.push_back(proxyMesh);
+	cluster.proxy = new Entity(proxyMesh, cluster.material);
+	cluster.proxy->SetStatic(true);
+	group.proxyError = proxyError;
+}
+
+bool HlodClusters::FindCluster(Entity* entity, unsigned int& cluster)
+{
+	std::unordered_map<Entity*, unsigned int>::iterator it = locations.find(entity);
+	if (it == locations.end()) {
+		return false;
+	}
+
+	cluster = it->second;
+	return true;
+}
+
+void HlodClusters::Select(FXMVECTOR eye, float pixelScale, float errorThreshold)
+{
+	grouping.Select(eye, pixelScale, errorThreshold);
+
+	std::vector<HlodGroup>& groups = grouping.GetGroups();
+	for (unsigned int i = 0; i < clusters.size(); i++) {
+		clusters[i].active = groups[i].active;
+		clusters[i].drawn = false;
+	}
+}
+
+static float GetAxis(const XMFLOAT3& point, unsigned int axis)
+{
+	return axis == 0 ? point.x : axis == 1 ? point.y : point.z;
+}
+
+// --------------------------------------------------------
+// A simplified triangle's corners, turned so the lowest
+// comes first without changing the winding
+// --------------------------------------------------------
+struct TriangleKey
+{
+	UINT a, b, c;
+
+	bool operator==(const TriangleKey& other) const { return a == other.a && b == other.b && c == other.c; }
+};
+
+struct TriangleKeyHash
+{
+	size_t operator()(const TriangleKey& key) const
+	{
+		return std::hash<uint64_t>()(((uint64_t)key.a * 0x9E3779B1u) ^ ((uint64_t)key.b << 21) ^ ((uint64_t)key.c << 42));
+	}
+};
+
+// --------------------------------------------------------
+// Vertices merge when they share a cell and the axis their
+// normal leans on most, so the sides of a thin wall don't
+// merge into one with a normal pointing nowhere. Each merged
+// vertex takes its sources' average position and UV, and
+// their summed normal, renormalized. New vertices are made
+// in the order their first source appears, so the output
+// doesn't depend on hashing.
+// --------------------------------------------------------
+float HlodClusters::Simplify(const std::vector<Vertex>& vertices, const std::vector<UINT>& indices, float cellSize,
+	std::vector<Vertex>& simplifiedVertices, std::vector<UINT>& simplifiedIndices)
+{
+	simplifiedVertices.clear();
+	simplifiedIndices.clear();
+	if (vertices.empty()) {
+		return 0;
+	}
+
+	XMFLOAT3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+	for (unsigned int v = 0; v < vertices.size(); v++) {
+		const XMFLOAT3& p = vertices[v].Position;
+		min = XMFLOAT3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+	}
+
+	float inverseCellSize = 1 / cellSize;
+	std::unordered_map<uint64_t, UINT> cells;
+	std::vector<UINT> remap(vertices.size());
+	std::vector<unsigned int> counts;
+	for (unsigned int v = 0; v < vertices.size(); v++) {
+		const Vertex& vertex = vertices[v];
+		uint64_t x = std::min((uint64_t)((vertex.Position.x - min.x) * inverseCellSize), MaxCell);
+		uint64_t y = std::min((uint64_t)((vertex.Position.y - min.y) * inverseCellSize), MaxCell);
+		uint64_t z = std::min((uint64_t)((vertex.Position.z - min.z) * inverseCellSize), MaxCell);
+
+		const XMFLOAT3& n = vertex.Normal;
+		unsigned int axis = 0;
+		if (fabsf(n.y) > fabsf(n.x)) axis = 1;
+		if (fabsf(n.z) > fabsf(GetAxis(n, axis))) axis = 2;
+		uint64_t facing = axis * 2 + (GetAxis(n, axis) < 0 ? 1 : 0);
+
+		uint64_t key = x | (y << CellBits) | (z << (2 * CellBits)) | (facing << (3 * CellBits));
+		std::unordered_map<uint64_t, UINT>::iterator it = cells.find(key);
+		if (it == cells.end()) {
+			it = cells.insert(std::make_pair(key, (UINT)simplifiedVertices.size())).first;
+			Vertex merged = { XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0), XMFLOAT2(0, 0) };
+			simplifiedVertices.push_back(merged);
+			counts.push_back(0);
+		}
+
+		UINT index = it->second;
+		Vertex& merged = simplifiedVertices[index];
+		merged.Position = XMFLOAT3(merged.Position.x + vertex.Position.x, merged.Position.y + vertex.Position.y, merged.Position.z + vertex.Position.z);
+		merged.Normal = XMFLOAT3(merged.Normal.x + n.x, merged.Normal.y + n.y, merged.Normal.z + n.z);
+		merged.UV = XMFLOAT2(merged.UV.x + vertex.UV.x, merged.UV.y + vertex.UV.y);
+		counts[index]++;
+		remap[v] = index;
+	}
+
+	for (unsigned int i = 0; i < simplifiedVertices.size(); i++) {
+		Vertex& merged = simplifiedVertices[i];
+		float scale = 1.0f / counts[i];
+		merged.Position = XMFLOAT3(merged.Position.x * scale, merged.Position.y * scale, merged.Position.z * scale);
+		merged.UV = XMFLOAT2(merged.UV.x * scale, merged.UV.y * scale);
+		XMStoreFloat3(&merged.Normal, XMVector3Normalize(XMLoadFloat3(&merged.Normal)));
+	}
+
+	float maxMove = 0;
+	for (unsigned int v = 0; v < vertices.size(); v++) {
+		XMVECTOR moved = XMVectorSubtract(XMLoadFloat3(&simplifiedVertices[remap[v]].Position), XMLoadFloat3(&vertices[v].Position));
+		maxMove = std::max(maxMove, XMVectorGetX(XMVector3Length(moved)));
+	}
+
+	// Collapsed triangles go, and so do copies of ones already kept
+	std::unordered_set<TriangleKey, TriangleKeyHash> kept;
+	for (unsigned int i = 0; i + 2 < indices.size(); i += 3) {
+		UINT a = remap[indices[i]];
+		UINT b = remap[indices[i + 1]];
+		UINT c = remap[indices[i + 2]];
+		if (a == b || b == c || c == a) {
+			continue;
+		}
+
+		TriangleKey key = { a, b, c };
+		if (b < a && b < c) key = { b, c, a };
+		else if (c < a && c < b) key = { c, a, b };
+		if (!kept.insert(key).second) {
+			continue;
+		}
+
+		simplifiedIndices.push_back(a);
+		simplifiedIndices.push_back(b);
+		simplifiedIndices.push_back(c);
+	}
+
+	// Drops vertices left with no triangles, keeping the rest in order
+	std::vector<UINT> compacted(simplifiedVertices.size(), UINT_MAX);
+	UINT usedCount = 0;
+	for (unsigned int i = 0; i < simplifiedIndices.size(); i++) {
+		UINT& index = simplifiedIndices[i];
+		if (compacted[index] == UINT_MAX) {
+			compacted[index] = usedCount++;
+		}
+		index = compacted[index];
+	}
+
+	std::vector<Vertex> usedVertices(usedCount);
+	for (unsigned int i = 0; i < compacted.size(); i++) {
+		if (compacted[i] != UINT_MAX) {
+			usedVertices[compacted[i]] = simplifiedVertices[i];
+		}
+	}
+	simplifiedVertices.swap(usedVertices);
+
+	return maxMove;
+}
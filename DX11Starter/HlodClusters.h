@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Entity.h"
+#include "HlodGrouping.h"
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Nearby static entities sharing a material, and the one
+// simplified mesh that stands in for all of them far away
+// --------------------------------------------------------
+struct HlodCluster
+{
+	Material* material;
+	std::vector<Entity*> members;
+	Entity* proxy;					// Draws the simplified mesh, already in world space; flagged static
+	unsigned int sourceTriangles;
+	unsigned int proxyTriangles;
+	bool active;					// Drawn as its proxy this frame; the grouping's flag, as of the last Select()
+	bool drawn;						// Active, and had a member in view
+};
+
+// --------------------------------------------------------
+// Hierarchical LOD: replaces far away groups of static
+// entities with one mesh each, trading hundreds of draws
+// for one.
+//
+// Which entities go together, and when each cluster switches,
+// is HlodGrouping's work, done on the entities' world bounds
+// with their material as the key. This adds the geometry:
+// each cluster's members are merged into world space and
+// simplified by vertex clustering. Vertices in the same grid
+// cell, facing the same way, become one, and triangles that
+// collapse are dropped. Cells are a fixed share of the
+// cluster's size.
+// --------------------------------------------------------
+class HlodClusters
+{
+public:
+	HlodClusters();
+	~HlodClusters();
+
+	// Settings for Build(): the most entities in a cluster, and
+	// how many grid cells span a cluster's proxy
+	void SetMaxMembers(unsigned int count) { grouping.SetMaxMembers(count); }
+	void SetProxyResolution(unsigned int cells) { proxyResolution = cells; }
+
+	// Share of the switch distance clusters have to go past it by
+	void SetHysteresis(float band) { grouping.SetHysteresis(band); }
+
+	void Build(const std::vector<Entity*>& entities, ID3D11Device* device);
+	void Clear();
+
+	// Which cluster the entity went into; false if it's in none
+	bool FindCluster(Entity* entity, unsigned int& cluster);
+
+	// Works out which clusters draw as proxies, for a camera at eye
+	// seeing pixelScale pixels across a unit at unit distance.
+	// Clears every cluster's drawn flag.
+	void Select(DirectX::FXMVECTOR eye, float pixelScale, float errorThreshold);
+
+	std::vector<HlodCluster>& GetClusters() { return clusters; }
+
+	// Entities clustered, and triangles in their meshes and the proxies
+	unsigned int GetEntityCount() { return (unsigned int)locations.size(); }
+	unsigned int GetSourceTriangleCount() { return sourceTriangles; }
+	unsigned int GetProxyTriangleCount() { return proxyTriangles; }
+
+	// Bounds, proxy errors and switch distances, one group per cluster
+	HlodGrouping& GetGrouping() { return grouping; }
+
+	// Vertex clusters the mesh on a grid of cellSize. Returns the
+	// furthest any vertex moved.
+	static float Simplify(const std::vector<Vertex>& vertices, const std::vector<UINT>& indices, float cellSize,
+		std::vector<Vertex>& simplifiedVertices, std::vector<UINT>& simplifiedIndices);
+
+private:
+	unsigned int proxyResolution;
+
+	HlodGrouping grouping;
+	std::vector<HlodCluster> clusters;
+	std::unordered_map<Entity*, unsigned int> locations;
+	std::vector<Mesh*> proxyMeshes;
+
+	unsigned int sourceTriangles;
+	unsigned int proxyTriangles;
+
+	void BuildProxy(HlodCluster& cluster, HlodGroup& group, ID3D11Device* device);
+};
@@ -0,0 +1,158 @@
+#include "HlodGrouping.h"
+#include <algorithm>
+#include <cfloat>
+#include <unordered_map>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Clusters of one object save nothing, so they're left alone
+static const unsigned int MinMembers = 2;
+
+HlodGrouping::HlodGrouping()
+{
+	maxMembers = 32;
+	hysteresis = 0.25f;
+}
+
+HlodGrouping::~HlodGrouping()
+{
+}
+
+void HlodGrouping::Clear()
+{
+	groups.clear();
+	members.clear();
+}
+
+void HlodGrouping::Build(const BoundingBox* bounds, const unsigned int* keys, unsigned int count)
+{
+	Clear();
+
+	std::unordered_map<unsigned int, unsigned int> keyIndices;
+	std::vector<std::vector<unsigned int>> byKey;
+	for (unsigned int i = 0; i < count; i++) {
+		std::unordered_map<unsigned int, unsigned int>::iterator it = keyIndices.find(keys[i]);
+		if (it == keyIndices.end()) {
+			it = keyIndices.insert(std::make_pair(keys[i], (unsigned int)byKey.size())).first;
+			byKey.push_back(std::vector<unsigned int>());
+		}
+		byKey[it->second].push_back(i);
+	}
+
+	std::vector<XMFLOAT3> centers;
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> starts;
+	for (unsigned int k = 0; k < byKey.size(); k++) {
+		const std::vector<unsigned int>& objects = byKey[k];
+		centers.resize(objects.size());
+		for (unsigned int i = 0; i < objects.size(); i++) {
+			centers[i] = bounds[objects[i]].Center;
+		}
+
+		Partition(&centers[0], (unsigned int)centers.size(), maxMembers, order, starts);
+
+		for (unsigned int run = 0; run + 1 < starts.size(); run++) {
+			if (starts[run + 1] - starts[run] < MinMembers) {
+				continue;
+			}
+
+			HlodGroup group = {};
+			group.first = (unsigned int)members.size();
+			group.count = starts[run + 1] - starts[run];
+			group.proxyError = -1;
+
+			XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+			for (unsigned int i = starts[run]; i < starts[run + 1]; i++) {
+				unsigned int object = objects[order[i]];
+				members.push_back(object);
+
+				XMVECTOR center = XMLoadFloat3(&bounds[object].Center);
+				XMVECTOR extents = XMLoadFloat3(&bounds[object].Extents);
+				boundsMin = XMVectorMin(boundsMin, XMVectorSubtract(center, extents));
+				boundsMax = XMVectorMax(boundsMax, XMVectorAdd(center, extents));
+			}
+
+			XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+			XMStoreFloat4(&group.bounds, center);
+			group.bounds.w = XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, center)));
+			groups.push_back(group);
+		}
+	}
+}
+
+void HlodGrouping::Select(FXMVECTOR eye, float pixelScale, float errorThreshold)
+{
+	for (unsigned int i = 0; i < groups.size(); i++) {
+		HlodGroup& group = groups[i];
+		if (group.proxyError < 0) {
+			group.active = false;
+			continue;
+		}
+
+		group.switchDistance = group.proxyError * pixelScale / errorThreshold;
+
+		XMVECTOR center = XMLoadFloat4(&group.bounds);
+		float nearest = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, eye))) - group.bounds.w;
+		group.active = group.active
+			? nearest > group.switchDistance * (1 - hysteresis)
+			: nearest >= group.switchDistance * (1 + hysteresis);
+	}
+}
+
+void HlodGrouping::Partition(const XMFLOAT3* points, unsigned int count, unsigned int maxMembers,
+	std::vector<unsigned int>& order, std::vector<unsigned int>& starts)
+{
+	order.resize(count);
+	for (unsigned int i = 0; i < count; i++) {
+		order[i] = i;
+	}
+
+	starts.clear();
+	if (count > 0) {
+		PartitionRange(points, std::max(maxMembers, 1u), 0, count, order, starts);
+	}
+	starts.push_back(count);
+}
+
+static float GetAxis(const XMFLOAT3& point, unsigned int axis)
+{
+	return axis == 0 ? point.x : axis == 1 ? point.y : point.z;
+}
+
+// --------------------------------------------------------
+// Halves the range at the median along the axis it spans
+// furthest, until each piece is small enough. Ties go by
+// index, so the split doesn't depend on the sort.
+// --------------------------------------------------------
+void HlodGrouping::PartitionRange(const XMFLOAT3* points, unsigned int maxMembers, unsigned int first, unsigned int last,
+	std::vector<unsigned int>& order, std::vector<unsigned int>& starts)
+{
+	if (last - first <= maxMembers) {
+		starts.push_back(first);
+		return;
+	}
+
+	XMFLOAT3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (unsigned int i = first; i < last; i++) {
+		const XMFLOAT3& point = points[order[i]];
+		min = XMFLOAT3(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+		max = XMFLOAT3(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+	}
+
+	unsigned int axis = 0;
+	if (max.y - min.y > max.x - min.x) axis = 1;
+	if (max.z - min.z > GetAxis(max, axis) - GetAxis(min, axis)) axis = 2;
+
+	unsigned int middle = first + (last - first) / 2;
+	std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + last, [points, axis](unsigned int a, unsigned int b) {
+		float keyA = GetAxis(points[a], axis);
+		float keyB = GetAxis(points[b], axis);
+		return keyA < keyB || (keyA == keyB && a < b);
+	});
+
+	PartitionRange(points, maxMembers, first, middle, order, starts);
+	PartitionRange(points, maxMembers, middle, last, order, starts);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Objects that share one proxy, and whether it's drawn
+// --------------------------------------------------------
+struct HlodGroup
+{
+	unsigned int first;				// Into the members, which are object indices
+	unsigned int count;
+	DirectX::XMFLOAT4 bounds;		// World space sphere around every member, the radius in w
+	float proxyError;				// Furthest any vertex moved in simplifying, in world units; negative without a proxy
+	float switchDistance;			// Proxies are drawn from further than this, as of the last Select()
+	bool active;					// Drawn as its proxy this frame
+};
+
+// --------------------------------------------------------
+// The part of hierarchical LOD that only needs bounds: which
+// objects are clustered together, and from how far away each
+// cluster's proxy takes over.
+//
+// Objects only cluster with others of the same key, in the
+// order the keys are first seen. Each key's bounds centers
+// are split in half along their longest axis, over and over,
+// until no cluster has more than the maximum members.
+//
+// A cluster's switch distance is where its proxy's error
+// would look as big as the pixel threshold. The cluster
+// draws as its proxy once the nearest point of its sphere is
+// further than that, which puts every member below the
+// threshold too. A band around the distance keeps clusters
+// from flipping back and forth, as LodSelector's does for
+// levels.
+// --------------------------------------------------------
+class HlodGrouping
+{
+public:
+	HlodGrouping();
+	~HlodGrouping();
+
+	// The most objects in a cluster
+	void SetMaxMembers(unsigned int count) { maxMembers = count; }
+
+	// Share of the switch distance clusters have to go past it by
+	void SetHysteresis(float band) { hysteresis = band; }
+
+	// Clusters the objects by their world bounds. keys says which
+	// objects may share a cluster; objects that would be alone are
+	// left out. Every cluster starts without a proxy.
+	void Build(const DirectX::BoundingBox* bounds, const unsigned int* keys, unsigned int count);
+	void Clear();
+
+	// Sets how far the cluster's proxy strays from its members
+	void SetProxyError(unsigned int group, float error) { groups[group].proxyError = error; }
+
+	// Works out which clusters draw as proxies, for a camera at eye
+	// seeing pixelScale pixels across a unit at unit distance
+	void Select(DirectX::FXMVECTOR eye, float pixelScale, float errorThreshold);
+
+	std::vector<HlodGroup>& GetGroups() { return groups; }
+	const std::vector<unsigned int>& GetMembers() { return members; }
+
+	// Splits the points into runs of at most maxMembers, writing their
+	// indices to order, run by run, and where each run starts to starts,
+	// with one more for where the last ends
+	static void Partition(const DirectX::XMFLOAT3* points, unsigned int count, unsigned int maxMembers,
+		std::vector<unsigned int>& order, std::vector<unsigned int>& starts);
+
+private:
+	unsigned int maxMembers;
+	float hysteresis;
+
+	std::vector<HlodGroup> groups;
+	std::vector<unsigned int> members;
+
+	static void PartitionRange(const DirectX::XMFLOAT3* points, unsigned int maxMembers, unsigned int first, unsigned int last,
+		std::vector<unsigned int>& order, std::vector<unsigned int>& starts);
+};
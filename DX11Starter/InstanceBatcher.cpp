@@ -0,0 +1,29 @@
+#include "InstanceBatcher.h"
+
+// For the DirectX Math library
+using namespace DirectX;
+
+InstanceBatcher::InstanceBatcher()
+{
+}
+
+InstanceBatcher::~InstanceBatcher()
+{
+}
+
+void InstanceBatcher::Build(const std::vector<DrawItem>& items, const ObjectConstants* transforms)
+{
+	packer.Build(items.empty() ? nullptr : &items[0], transforms, (unsigned int)items.size());
+
+	const std::vector<InstanceRun>& runs = packer.GetRuns();
+	batches.resize(runs.size());
+	for (unsigned int r = 0; r < runs.size(); r++) {
+		Entity* entity = items[runs[r].first].entity;
+		InstanceBatch& batch = batches[r];
+		batch.mesh = entity->GetMesh();
+		batch.material = entity->GetMaterial();
+		batch.first = runs[r].first;
+		batch.instanceCount = runs[r].instanceCount;
+		packer.SetRunColor(r, batch.material->GetColor());
+	}
+}
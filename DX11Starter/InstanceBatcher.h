@@ -0,0 +1,49 @@
+#pragma once
+
+#include "RenderQueue.h"
+#include "InstancePacker.h"
+#include <vector>
+
+// --------------------------------------------------------
+// A run of consecutive draws sharing a mesh and a material
+// --------------------------------------------------------
+struct InstanceBatch
+{
+	Mesh* mesh;
+	Material* material;
+	unsigned int first;				// Into both the queue's items and the instance data
+	unsigned int instanceCount;
+};
+
+// --------------------------------------------------------
+// Groups sorted draws into instance batches and packs their
+// per-instance data in draw order, ready to be copied into
+// an instance buffer. The grouping and packing are done by
+// InstancePacker on the keys; this puts the meshes,
+// materials and colors back.
+//
+// Only neighbouring draws are grouped, so the queue's order
+// (including back to front for transparent draws) is kept.
+// --------------------------------------------------------
+class InstanceBatcher
+{
+public:
+	InstanceBatcher();
+	~InstanceBatcher();
+
+	// transforms holds each item's matrices, from ComputeObjectTransforms()
+	void Build(const std::vector<DrawItem>& items, const ObjectConstants* transforms);
+
+	const std::vector<InstanceBatch>& GetBatches() { return batches; }
+	const std::vector<InstanceData>& GetInstances() { return packer.GetInstances(); }
+
+	// Draw calls needed before and after batching
+	unsigned int GetUnbatchedDrawCount() { return (unsigned int)packer.GetInstances().size(); }
+	unsigned int GetBatchedDrawCount() { return (unsigned int)batches.size(); }
+	unsigned int GetDrawCallsSaved() { return GetUnbatchedDrawCount() - GetBatchedDrawCount(); }
+
+private:
+	InstancePacker packer;
+	std::vector<InstanceBatch> batches;
+};
+
@@ -0,0 +1,44 @@
+#include "InstancePacker.h"
+
+// For the DirectX Math library
+using namespace DirectX;
+
+InstancePacker::InstancePacker()
+{
+}
+
+InstancePacker::~InstancePacker()
+{
+}
+
+void InstancePacker::Build(const DrawItem* items, const ObjectConstants* transforms, unsigned int count)
+{
+	runs.clear();
+	instances.resize(count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		uint64_t key = items[i].key;
+		if (i == 0
+			|| DrawKeys::GetMaterial(key) != DrawKeys::GetMaterial(items[i - 1].key)
+			|| DrawKeys::GetMesh(key) != DrawKeys::GetMesh(items[i - 1].key)) {
+			InstanceRun run;
+			run.first = i;
+			run.instanceCount = 0;
+			runs.push_back(run);
+		}
+		runs.back().instanceCount++;
+
+		// Both matrices are already packed the way the shader reads them
+		InstanceData& instance = instances[i];
+		instance.World = transforms[i].objectToWorld;
+		instance.NormalMatrix = transforms[i].normalMatrix;
+	}
+}
+
+void InstancePacker::SetRunColor(unsigned int run, const XMFLOAT4& color)
+{
+	unsigned int end = runs[run].first + runs[run].instanceCount;
+	for (unsigned int i = runs[run].first; i < end; i++) {
+		instances[i].Color = color;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "AffineMatrix.h"
+#include "DrawKeys.h"
+#include "ShaderConstants.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Per-instance vertex data, read from input slot 1 by the
+// instanced vertex shader (WORLD_PER_INSTANCE,
+// NORMALMATRIX_PER_INSTANCE and COLOR_PER_INSTANCE)
+// --------------------------------------------------------
+struct InstanceData
+{
+	AffineMatrix World;			// One row per element
+	AffineMatrix NormalMatrix;	// Inverse transpose of World's upper 3x3
+	DirectX::XMFLOAT4 Color;
+};
+
+// --------------------------------------------------------
+// A run of neighbouring draws whose keys share a material
+// and a mesh
+// --------------------------------------------------------
+struct InstanceRun
+{
+	unsigned int first;				// Into both the draws and the instance data
+	unsigned int instanceCount;
+};
+
+// --------------------------------------------------------
+// The part of instancing that only needs the sorted draw
+// keys and each draw's transforms: splits the draws into
+// runs and packs their per-instance data in draw order.
+//
+// A material's id stands for its shaders and color, so draws
+// with the same material and mesh ids can share a draw call.
+// Only neighbours are grouped, so the queue's order is kept.
+// --------------------------------------------------------
+class InstancePacker
+{
+public:
+	InstancePacker();
+	~InstancePacker();
+
+	// Only each item's key is read. transforms holds each item's
+	// matrices, from ComputeObjectTransforms().
+	void Build(const DrawItem* items, const ObjectConstants* transforms, unsigned int count);
+
+	// Colors every instance in a run; each run's material has one
+	void SetRunColor(unsigned int run, const DirectX::XMFLOAT4& color);
+
+	const std::vector<InstanceRun>& GetRuns() { return runs; }
+	const std::vector<InstanceData>& GetInstances() { return instances; }
+
+private:
+	std::vector<InstanceRun> runs;
+	std::vector<InstanceData> instances;
+};
+
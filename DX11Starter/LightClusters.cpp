@@ -0,0 +1,293 @@
+#include "LightClusters.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Where padding lights sit, too far away to reach any cluster
+static const float FarAway = 1e18f;
+
+LightClusters::LightClusters(ThreadPool* threadPool)
+{
+	this->threadPool = threadPool;
+
+	projectionX = 0;
+	projectionY = 0;
+	nearPlane = 0;
+	farPlane = 0;
+	depthScale = 0;
+	depthBias = 0;
+	buildSeconds = 0;
+
+	clusters.resize(ClusterCount);
+	slices.resize(CountZ);
+}
+
+LightClusters::~LightClusters()
+{
+}
+
+void LightClusters::LightSet::Clear()
+{
+	x.clear(); y.clear(); z.clear(); radius.clear();
+	dirX.clear(); dirY.clear(); dirZ.clear(); cosAngle.clear(); sinAngle.clear();
+	index.clear();
+}
+
+void LightClusters::LightSet::Push(float px, float py, float pz, float r, float dx, float dy, float dz, float cosine, float sine, unsigned int i)
+{
+	x.push_back(px); y.push_back(py); z.push_back(pz); radius.push_back(r);
+	dirX.push_back(dx); dirY.push_back(dy); dirZ.push_back(dz); cosAngle.push_back(cosine); sinAngle.push_back(sine);
+	index.push_back(i);
+}
+
+void LightClusters::LightSet::Add(const LightSet& source, unsigned int i)
+{
+	Push(source.x[i], source.y[i], source.z[i], source.radius[i],
+		source.dirX[i], source.dirY[i], source.dirZ[i], source.cosAngle[i], source.sinAngle[i],
+		source.index[i]);
+}
+
+void LightClusters::LightSet::Pad()
+{
+	while (index.size() % 4 != 0) {
+		Push(FarAway, FarAway, FarAway, 0, 0, 0, 0, -1, 0, 0);
+	}
+}
+
+// --------------------------------------------------------
+// The view space box around the part of the frustum between
+// two depths and inside a rectangle of normalized device
+// coordinates
+// --------------------------------------------------------
+static void GetFroxelBox(float projectionX, float projectionY, float left, float right, float bottom, float top, float nearDepth, float farDepth, XMFLOAT3& min, XMFLOAT3& max)
+{
+	min.x = std::min(left * nearDepth, left * farDepth) / projectionX;
+	max.x = std::max(right * nearDepth, right * farDepth) / projectionX;
+	min.y = std::min(bottom * nearDepth, bottom * farDepth) / projectionY;
+	max.y = std::max(top * nearDepth, top * farDepth) / projectionY;
+	min.z = nearDepth;
+	max.z = farDepth;
+}
+
+void LightClusters::BuildBounds(float projectionX, float projectionY, float nearPlane, float farPlane)
+{
+	this->projectionX = projectionX;
+	this->projectionY = projectionY;
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+
+	clusterBoxes.resize(ClusterCount);
+	rowBoxes.resize(CountY * CountZ);
+	sliceBoxes.resize(CountZ);
+
+	float depthRatio = farPlane / nearPlane;
+	depthScale = CountZ / logf(depthRatio);
+	depthBias = -logf(nearPlane) * depthScale;
+
+	for (unsigned int z = 0; z < CountZ; z++) {
+		float nearDepth = nearPlane * powf(depthRatio, (float)z / CountZ);
+		float farDepth = nearPlane * powf(depthRatio, (float)(z + 1) / CountZ);
+
+		Box& slice = sliceBoxes[z];
+		GetFroxelBox(projectionX, projectionY, -1, 1, -1, 1, nearDepth, farDepth, slice.min, slice.max);
+
+		for (unsigned int y = 0; y < CountY; y++) {
+			// Rows go down the screen
+			float top = 1 - 2.0f * y / CountY;
+			float bottom = 1 - 2.0f * (y + 1) / CountY;
+
+			Box& row = rowBoxes[y + z * CountY];
+			GetFroxelBox(projectionX, projectionY, -1, 1, bottom, top, nearDepth, farDepth, row.min, row.max);
+
+			for (unsigned int x = 0; x < CountX; x++) {
+				float left = -1 + 2.0f * x / CountX;
+				float right = -1 + 2.0f * (x + 1) / CountX;
+
+				Box& cluster = clusterBoxes[x + (y + z * CountY) * CountX];
+				GetFroxelBox(projectionX, projectionY, left, right, bottom, top, nearDepth, farDepth, cluster.min, cluster.max);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Moves the lights into view space, assigns every slice in
+// parallel, then joins the slices' index lists in order
+// --------------------------------------------------------
+void LightClusters::Build(const Light* localLights, unsigned int lightCount, CXMMATRIX view, CXMMATRIX projection, float nearPlane, float farPlane)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	float x = XMVectorGetX(projection.r[0]);
+	float y = XMVectorGetY(projection.r[1]);
+	if (clusterBoxes.empty() || x != projectionX || y != projectionY || nearPlane != this->nearPlane || farPlane != this->farPlane) {
+		BuildBounds(x, y, nearPlane, farPlane);
+	}
+
+	lights.Clear();
+	for (unsigned int i = 0; i < lightCount; i++) {
+		const Light& light = localLights[i];
+		XMFLOAT3 position;
+		XMStoreFloat3(&position, XMVector3TransformCoord(XMLoadFloat3(&light.Position), view));
+
+		// Cones wider than a hemisphere are culled as spheres
+		XMFLOAT3 direction(0, 0, 0);
+		float cosine = -1;
+		float sine = 0;
+		if (light.SpotCosAngle > 0) {
+			XMStoreFloat3(&direction, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.Direction), view)));
+			cosine = light.SpotCosAngle;
+			sine = sqrtf(std::max(0.0f, 1 - cosine * cosine));
+		}
+
+		lights.Push(position.x, position.y, position.z, light.Range, direction.x, direction.y, direction.z, cosine, sine, i);
+	}
+	lights.Pad();
+
+	threadPool->ParallelFor(CountZ, [this](unsigned int z) {
+		AssignSlice(z);
+	});
+
+	// Offsets were relative to each slice's own list
+	lightIndices.clear();
+	for (unsigned int z = 0; z < CountZ; z++) {
+		unsigned int base = (unsigned int)lightIndices.size();
+		for (unsigned int c = z * CountX * CountY; c < (z + 1) * CountX * CountY; c++) {
+			clusters[c].Offset += base;
+		}
+
+		lightIndices.insert(lightIndices.end(), slices[z].indices.begin(), slices[z].indices.end());
+	}
+
+	buildSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void LightClusters::AssignSlice(unsigned int z)
+{
+	SliceScratch& scratch = slices[z];
+	scratch.indices.clear();
+
+	TestSpheres(lights, sliceBoxes[z], scratch.hits);
+	scratch.sliceLights.Clear();
+	for (unsigned int i = 0; i < scratch.hits.size(); i++) {
+		scratch.sliceLights.Add(lights, scratch.hits[i]);
+	}
+	scratch.sliceLights.Pad();
+
+	for (unsigned int y = 0; y < CountY; y++) {
+		TestSpheres(scratch.sliceLights, rowBoxes[y + z * CountY], scratch.hits);
+		scratch.rowLights.Clear();
+		for (unsigned int i = 0; i < scratch.hits.size(); i++) {
+			scratch.rowLights.Add(scratch.sliceLights, scratch.hits[i]);
+		}
+		scratch.rowLights.Pad();
+
+		for (unsigned int x = 0; x < CountX; x++) {
+			unsigned int c = x + (y + z * CountY) * CountX;
+			clusters[c].Offset = (unsigned int)scratch.indices.size();
+			TestCluster(scratch.rowLights, clusterBoxes[c], scratch.indices);
+			clusters[c].Count = (unsigned int)scratch.indices.size() - clusters[c].Offset;
+		}
+	}
+}
+
+// Squared distances from four spheres' centers to a box, as
+// splatted min and max vectors
+static XMVECTOR XM_CALLCONV BoxDistanceSq(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, const XMVECTOR min[3], const XMVECTOR max[3])
+{
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR dx = XMVectorMax(XMVectorMax(XMVectorSubtract(min[0], x), XMVectorSubtract(x, max[0])), zero);
+	XMVECTOR dy = XMVectorMax(XMVectorMax(XMVectorSubtract(min[1], y), XMVectorSubtract(y, max[1])), zero);
+	XMVECTOR dz = XMVectorMax(XMVectorMax(XMVectorSubtract(min[2], z), XMVectorSubtract(z, max[2])), zero);
+
+	XMVECTOR distanceSq = XMVectorMultiply(dx, dx);
+	distanceSq = XMVectorMultiplyAdd(dy, dy, distanceSq);
+	return XMVectorMultiplyAdd(dz, dz, distanceSq);
+}
+
+static XMVECTOR LoadLanes(const std::vector<float>& values, unsigned int i)
+{
+	return XMLoadFloat4((const XMFLOAT4*)&values[i]);
+}
+
+// --------------------------------------------------------
+// Writes the positions in the set of the spheres touching
+// the box
+// --------------------------------------------------------
+void LightClusters::TestSpheres(const LightSet& set, const Box& box, std::vector<unsigned int>& hits)
+{
+	hits.clear();
+
+	XMVECTOR min[3] = { XMVectorReplicate(box.min.x), XMVectorReplicate(box.min.y), XMVectorReplicate(box.min.z) };
+	XMVECTOR max[3] = { XMVectorReplicate(box.max.x), XMVectorReplicate(box.max.y), XMVectorReplicate(box.max.z) };
+
+	for (unsigned int i = 0; i < set.Size(); i += 4) {
+		XMVECTOR radius = LoadLanes(set.radius, i);
+		XMVECTOR distanceSq = BoxDistanceSq(LoadLanes(set.x, i), LoadLanes(set.y, i), LoadLanes(set.z, i), min, max);
+
+		uint32_t touching[4];
+		XMStoreInt4(touching, XMVectorLessOrEqual(distanceSq, XMVectorMultiply(radius, radius)));
+		for (unsigned int lane = 0; lane < 4; lane++) {
+			if (touching[lane]) {
+				hits.push_back(i + lane);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Appends the light indices of the set's lights touching
+// the cluster. Spheres are tested against the box; cones
+// against the box's bounding sphere, by the distance from
+// its center to the cone's surface.
+// --------------------------------------------------------
+void LightClusters::TestCluster(const LightSet& set, const Box& box, std::vector<unsigned int>& indices)
+{
+	XMVECTOR min[3] = { XMVectorReplicate(box.min.x), XMVectorReplicate(box.min.y), XMVectorReplicate(box.min.z) };
+	XMVECTOR max[3] = { XMVectorReplicate(box.max.x), XMVectorReplicate(box.max.y), XMVectorReplicate(box.max.z) };
+
+	XMVECTOR boxMin = XMLoadFloat3(&box.min);
+	XMVECTOR boxMax = XMLoadFloat3(&box.max);
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, XMVectorScale(XMVectorAdd(boxMin, boxMax), 0.5f));
+	XMVECTOR centerX = XMVectorReplicate(center.x);
+	XMVECTOR centerY = XMVectorReplicate(center.y);
+	XMVECTOR centerZ = XMVectorReplicate(center.z);
+	XMVECTOR boundingRadius = XMVectorReplicate(0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(boxMax, boxMin))));
+
+	for (unsigned int i = 0; i < set.Size(); i += 4) {
+		XMVECTOR x = LoadLanes(set.x, i);
+		XMVECTOR y = LoadLanes(set.y, i);
+		XMVECTOR z = LoadLanes(set.z, i);
+		XMVECTOR radius = LoadLanes(set.radius, i);
+
+		XMVECTOR touching = XMVectorLessOrEqual(BoxDistanceSq(x, y, z, min, max), XMVectorMultiply(radius, radius));
+
+		// From the light to the cluster, split along and across the cone's axis
+		XMVECTOR toX = XMVectorSubtract(centerX, x);
+		XMVECTOR toY = XMVectorSubtract(centerY, y);
+		XMVECTOR toZ = XMVectorSubtract(centerZ, z);
+		XMVECTOR lengthSq = XMVectorMultiply(toX, toX);
+		lengthSq = XMVectorMultiplyAdd(toY, toY, lengthSq);
+		lengthSq = XMVectorMultiplyAdd(toZ, toZ, lengthSq);
+		XMVECTOR along = XMVectorMultiply(toX, LoadLanes(set.dirX, i));
+		along = XMVectorMultiplyAdd(toY, LoadLanes(set.dirY, i), along);
+		along = XMVectorMultiplyAdd(toZ, LoadLanes(set.dirZ, i), along);
+		XMVECTOR across = XMVectorSqrt(XMVectorMax(XMVectorNegativeMultiplySubtract(along, along, lengthSq), XMVectorZero()));
+
+		// Past the side of the cone, or behind its tip
+		XMVECTOR coneDistance = XMVectorNegativeMultiplySubtract(along, LoadLanes(set.sinAngle, i), XMVectorMultiply(across, LoadLanes(set.cosAngle, i)));
+		XMVECTOR outsideCone = XMVectorOrInt(XMVectorGreater(coneDistance, boundingRadius), XMVectorLess(along, XMVectorNegate(boundingRadius)));
+
+		uint32_t hit[4];
+		XMStoreInt4(hit, XMVectorAndCInt(touching, outsideCone));
+		for (unsigned int lane = 0; lane < 4; lane++) {
+			if (hit[lane]) {
+				indices.push_back(set.index[i + lane]);
+			}
+		}
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Lights.h"
+#include "ThreadPool.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// The lights touching one cluster: a run of the light
+// index list, read by the shader as a uint2
+// --------------------------------------------------------
+struct LightCluster
+{
+	unsigned int Offset;
+	unsigned int Count;
+};
+
+// --------------------------------------------------------
+// Assigns point and spot lights to the clusters ("froxels")
+// of a grid dividing the camera frustum: evenly in screen
+// space, exponentially in depth so near clusters aren't
+// stretched out.
+//
+// Each depth slice is a job on the thread pool. A slice
+// narrows the lights down to the ones reaching it, then to
+// each row of clusters, then tests them against each cluster
+// four at a time: spheres against the cluster's box, cones
+// against its bounding sphere.
+//
+// The result is one list of light indices, cluster by
+// cluster, and an offset and count per cluster into it.
+// Lights are in index order within a cluster, and slices
+// are joined in order, so the output doesn't depend on how
+// the jobs were scheduled.
+// --------------------------------------------------------
+class LightClusters
+{
+public:
+	// Grid size; PixelShader.hlsl has the same numbers
+	static const unsigned int CountX = 16;
+	static const unsigned int CountY = 9;
+	static const unsigned int CountZ = 24;
+	static const unsigned int ClusterCount = CountX * CountY * CountZ;
+
+	LightClusters(ThreadPool* threadPool);
+	~LightClusters();
+
+	// view and projection are the camera's, not transposed
+	void Build(const Light* lights, unsigned int lightCount, DirectX::CXMMATRIX view, DirectX::CXMMATRIX projection, float nearPlane, float farPlane);
+
+	// Indexed by x + (y + z * CountY) * CountX, with y = 0 at
+	// the top of the screen and z = 0 at the near plane
+	const std::vector<LightCluster>& GetClusters() { return clusters; }
+	const std::vector<unsigned int>& GetLightIndices() { return lightIndices; }
+
+	// A pixel's slice is log(view depth) * scale + bias
+	float GetDepthScale() { return depthScale; }
+	float GetDepthBias() { return depthBias; }
+
+	float GetBuildSeconds() { return buildSeconds; }
+
+private:
+	// View space lights in SoA form, padded to a multiple of
+	// four with lights that reach nothing. Point lights (and
+	// spots too wide to cull as a cone) have no direction and
+	// a cosine of -1, which makes the cone test always pass.
+	struct LightSet
+	{
+		std::vector<float> x, y, z, radius;
+		std::vector<float> dirX, dirY, dirZ, cosAngle, sinAngle;
+		std::vector<unsigned int> index;
+
+		void Clear();
+		void Push(float x, float y, float z, float radius, float dirX, float dirY, float dirZ, float cosAngle, float sinAngle, unsigned int index);
+		void Add(const LightSet& source, unsigned int i);
+		void Pad();
+		unsigned int Size() const { return (unsigned int)index.size(); }
+	};
+
+	struct Box
+	{
+		DirectX::XMFLOAT3 min;
+		DirectX::XMFLOAT3 max;
+	};
+
+	// Scratch space for one slice's job
+	struct SliceScratch
+	{
+		LightSet sliceLights;
+		LightSet rowLights;
+		std::vector<unsigned int> hits;
+		std::vector<unsigned int> indices;
+	};
+
+	ThreadPool* threadPool;
+
+	LightSet lights;
+
+	// Cluster bounds in view space, rebuilt when the projection changes
+	std::vector<Box> clusterBoxes;
+	std::vector<Box> rowBoxes;
+	std::vector<Box> sliceBoxes;
+	float projectionX, projectionY, nearPlane, farPlane;
+
+	std::vector<SliceScratch> slices;
+	std::vector<LightCluster> clusters;
+	std::vector<unsigned int> lightIndices;
+
+	float depthScale;
+	float depthBias;
+	float buildSeconds;
+
+	void BuildBounds(float projectionX, float projectionY, float nearPlane, float farPlane);
+	void AssignSlice(unsigned int z);
+	static void TestSpheres(const LightSet& set, const Box& box, std::vector<unsigned int>& hits);
+	static void TestCluster(const LightSet& set, const Box& box, std::vector<unsigned int>& indices);
+};
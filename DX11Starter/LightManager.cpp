@@ -0,0 +1,245 @@
+#include "LightManager.h"
+
+// For the DirectX Math library
+using namespace DirectX;
+
+LightManager::LightManager()
+{
+	layoutChanged = false;
+	localCount = 0;
+	lastPackCount = 0;
+	lastPackFull = false;
+}
+
+LightManager::~LightManager()
+{
+}
+
+LightId LightManager::AddDirectional(const XMFLOAT3& direction, const XMFLOAT3& color, const XMFLOAT3& ambientColor)
+{
+	return Add(LightDirectional, XMFLOAT3(0, 0, 0), direction, 0, -1, color, ambientColor);
+}
+
+LightId LightManager::AddPoint(const XMFLOAT3& position, float range, const XMFLOAT3& color)
+{
+	return Add(LightPoint, position, XMFLOAT3(0, 0, 1), range, -1, color, XMFLOAT3(0, 0, 0));
+}
+
+LightId LightManager::AddSpot(const XMFLOAT3& position, const XMFLOAT3& direction, float range, float spotCosAngle, const XMFLOAT3& color)
+{
+	return Add(LightSpot, position, direction, range, spotCosAngle, color, XMFLOAT3(0, 0, 0));
+}
+
+LightId LightManager::Add(LightType type, const XMFLOAT3& position, const XMFLOAT3& direction, float range, float spotCosAngle, const XMFLOAT3& color, const XMFLOAT3& ambientColor)
+{
+	LightId id;
+	if (!freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = (LightId)indices.size();
+		indices.push_back(0);
+	}
+
+	indices[id] = (unsigned int)types.size();
+	types.push_back(type);
+	positions.push_back(position);
+	directions.push_back(direction);
+	colors.push_back(color);
+	ambientColors.push_back(ambientColor);
+	ranges.push_back(range);
+	spotCosAngles.push_back(spotCosAngle);
+	ids.push_back(id);
+	packedIndices.push_back(0);
+	changed.push_back(false);
+
+	layoutChanged = true;
+	return id;
+}
+
+// --------------------------------------------------------
+// Moves the last light into the removed one's place
+// --------------------------------------------------------
+void LightManager::Remove(LightId id)
+{
+	unsigned int index = indices[id];
+	unsigned int last = (unsigned int)types.size() - 1;
+
+	types[index] = types[last];
+	positions[index] = positions[last];
+	directions[index] = directions[last];
+	colors[index] = colors[last];
+	ambientColors[index] = ambientColors[last];
+	ranges[index] = ranges[last];
+	spotCosAngles[index] = spotCosAngles[last];
+	ids[index] = ids[last];
+	indices[ids[index]] = index;
+
+	types.pop_back();
+	positions.pop_back();
+	directions.pop_back();
+	colors.pop_back();
+	ambientColors.pop_back();
+	ranges.pop_back();
+	spotCosAngles.pop_back();
+	ids.pop_back();
+	packedIndices.pop_back();
+	changed.pop_back();
+
+	freeIds.push_back(id);
+	layoutChanged = true;
+}
+
+void LightManager::Clear()
+{
+	types.clear();
+	positions.clear();
+	directions.clear();
+	colors.clear();
+	ambientColors.clear();
+	ranges.clear();
+	spotCosAngles.clear();
+	ids.clear();
+	indices.clear();
+	freeIds.clear();
+	packedIndices.clear();
+	changed.clear();
+	changedIndices.clear();
+	layoutChanged = true;
+}
+
+static bool Equal(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+void LightManager::SetPosition(LightId id, const XMFLOAT3& position)
+{
+	unsigned int index = indices[id];
+	if (!Equal(positions[index], position)) {
+		positions[index] = position;
+		MarkChanged(index);
+	}
+}
+
+void LightManager::SetDirection(LightId id, const XMFLOAT3& direction)
+{
+	unsigned int index = indices[id];
+	if (!Equal(directions[index], direction)) {
+		directions[index] = direction;
+		MarkChanged(index);
+	}
+}
+
+void LightManager::SetColor(LightId id, const XMFLOAT3& color)
+{
+	unsigned int index = indices[id];
+	if (!Equal(colors[index], color)) {
+		colors[index] = color;
+		MarkChanged(index);
+	}
+}
+
+void LightManager::SetAmbientColor(LightId id, const XMFLOAT3& ambientColor)
+{
+	unsigned int index = indices[id];
+	if (!Equal(ambientColors[index], ambientColor)) {
+		ambientColors[index] = ambientColor;
+		MarkChanged(index);
+	}
+}
+
+void LightManager::SetRange(LightId id, float range)
+{
+	unsigned int index = indices[id];
+	if (ranges[index] != range) {
+		ranges[index] = range;
+		MarkChanged(index);
+	}
+}
+
+void LightManager::SetSpotCosAngle(LightId id, float spotCosAngle)
+{
+	unsigned int index = indices[id];
+	if (spotCosAngles[index] != spotCosAngle) {
+		spotCosAngles[index] = spotCosAngle;
+		MarkChanged(index);
+	}
+}
+
+void LightManager::MarkChanged(unsigned int index)
+{
+	if (!changed[index]) {
+		changed[index] = true;
+		changedIndices.push_back(index);
+	}
+}
+
+// --------------------------------------------------------
+// Repacks everything if lights were added or removed, or
+// just the changed ones in place otherwise
+// --------------------------------------------------------
+bool LightManager::Pack()
+{
+	lastPackFull = layoutChanged;
+
+	if (layoutChanged) {
+		packed.resize(types.size());
+		packedIds.resize(types.size());
+
+		unsigned int next = 0;
+		for (unsigned int i = 0; i < types.size(); i++) {
+			if (types[i] != LightDirectional) {
+				packedIndices[i] = next++;
+			}
+		}
+		localCount = next;
+
+		for (unsigned int i = 0; i < types.size(); i++) {
+			if (types[i] == LightDirectional) {
+				packedIndices[i] = next++;
+			}
+		}
+
+		for (unsigned int i = 0; i < types.size(); i++) {
+			PackLight(i, packed[packedIndices[i]]);
+			packedIds[packedIndices[i]] = ids[i];
+			changed[i] = false;
+		}
+
+		changedIndices.clear();
+		layoutChanged = false;
+		lastPackCount = (unsigned int)types.size();
+		return true;
+	}
+
+	for (unsigned int i = 0; i < changedIndices.size(); i++) {
+		unsigned int index = changedIndices[i];
+		PackLight(index, packed[packedIndices[index]]);
+		changed[index] = false;
+	}
+
+	lastPackCount = (unsigned int)changedIndices.size();
+	changedIndices.clear();
+	return lastPackCount > 0;
+}
+
+void LightManager::PackLight(unsigned int index, Light& light)
+{
+	LightType type = types[index];
+
+	// Zero directions would normalize to nothing, so they point down z
+	XMFLOAT3 direction(0, 0, 1);
+	const XMFLOAT3& given = directions[index];
+	if (type != LightPoint && (given.x != 0 || given.y != 0 || given.z != 0)) {
+		XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&given)));
+	}
+
+	light.Position = type == LightDirectional ? ambientColors[index] : positions[index];
+	light.Range = type == LightDirectional ? 0 : ranges[index];
+	light.Color = colors[index];
+	light.SpotCosAngle = type == LightSpot ? spotCosAngles[index] : -1;
+	light.Direction = direction;
+	light.Type = type;
+}
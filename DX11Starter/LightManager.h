@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Lights.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// Identifies a light for as long as it's in the manager
+typedef unsigned int LightId;
+
+// --------------------------------------------------------
+// Every light in the scene, point, spot and directional,
+// stored as one array per property.
+//
+// Pack() turns them into the single buffer the shaders
+// read: point and spot lights first, so clustering and
+// selection can index them directly, then directional ones.
+// Only the lights changed since the last call are packed
+// again, unless lights were added or removed, which moves
+// them around. A frame without changes packs nothing, and
+// Pack() says so, so the buffer needn't be uploaded either.
+//
+// Setters ignore values a light already has, so setting
+// lights every frame costs nothing until they move.
+// --------------------------------------------------------
+class LightManager
+{
+public:
+	LightManager();
+	~LightManager();
+
+	LightId AddDirectional(const DirectX::XMFLOAT3& direction, const DirectX::XMFLOAT3& color, const DirectX::XMFLOAT3& ambientColor);
+	LightId AddPoint(const DirectX::XMFLOAT3& position, float range, const DirectX::XMFLOAT3& color);
+	LightId AddSpot(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& direction, float range, float spotCosAngle, const DirectX::XMFLOAT3& color);
+	void Remove(LightId id);
+	void Clear();
+
+	void SetPosition(LightId id, const DirectX::XMFLOAT3& position);
+	void SetDirection(LightId id, const DirectX::XMFLOAT3& direction);
+	void SetColor(LightId id, const DirectX::XMFLOAT3& color);
+	void SetAmbientColor(LightId id, const DirectX::XMFLOAT3& ambientColor);
+	void SetRange(LightId id, float range);
+	void SetSpotCosAngle(LightId id, float spotCosAngle);
+
+	LightType GetType(LightId id) { return types[indices[id]]; }
+	const DirectX::XMFLOAT3& GetPosition(LightId id) { return positions[indices[id]]; }
+	const DirectX::XMFLOAT3& GetDirection(LightId id) { return directions[indices[id]]; }
+
+	// Brings the packed lights up to date; false if nothing changed
+	bool Pack();
+
+	// Point and spot lights, then directional ones, as of the last Pack()
+	const std::vector<Light>& GetPackedLights() { return packed; }
+	unsigned int GetLocalLightCount() { return localCount; }
+	unsigned int GetDirectionalLightCount() { return (unsigned int)packed.size() - localCount; }
+
+	// Where a light ended up in the packed lights
+	unsigned int GetPackedIndex(LightId id) { return packedIndices[indices[id]]; }
+
+	// The light packed at an index
+	LightId GetPackedId(unsigned int packedIndex) { return packedIds[packedIndex]; }
+
+	unsigned int GetLightCount() { return (unsigned int)types.size(); }
+
+	// Lights written by the last Pack(), which did a full repack if
+	// it had to move them around
+	unsigned int GetLastPackCount() { return lastPackCount; }
+	bool WasLastPackFull() { return lastPackFull; }
+
+private:
+	// Properties, by dense index
+	std::vector<LightType> types;
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> directions;
+	std::vector<DirectX::XMFLOAT3> colors;
+	std::vector<DirectX::XMFLOAT3> ambientColors;
+	std::vector<float> ranges;
+	std::vector<float> spotCosAngles;
+	std::vector<LightId> ids;
+
+	// Dense index of each id, and ids free for reuse
+	std::vector<unsigned int> indices;
+	std::vector<LightId> freeIds;
+
+	// Where each light is packed, and whether it changed since
+	std::vector<unsigned int> packedIndices;
+	std::vector<bool> changed;
+	std::vector<unsigned int> changedIndices;
+	bool layoutChanged;
+
+	std::vector<Light> packed;
+	std::vector<LightId> packedIds;
+	unsigned int localCount;
+	unsigned int lastPackCount;
+	bool lastPackFull;
+
+	LightId Add(LightType type, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& direction, float range, float spotCosAngle, const DirectX::XMFLOAT3& color, const DirectX::XMFLOAT3& ambientColor);
+	void MarkChanged(unsigned int index);
+	void PackLight(unsigned int index, Light& light);
+};
@@ -2,8 +2,30 @@
 
 #include <DirectXMath.h>
 
-struct DirectionalLight {
-	DirectX::XMFLOAT4 AmbientColor;
-	DirectX::XMFLOAT4 DiffuseColor;
-	DirectX::XMFLOAT3 Direction;
-};
\ No newline at end of file
+enum LightType
+{
+	LightDirectional = 0,
+	LightPoint = 1,
+	LightSpot = 2
+};
+
+// --------------------------------------------------------
+// A light of any type, laid out as the pixel shader reads
+// it from the light buffer. LightManager packs these.
+//
+// Fields a type doesn't use hold something harmless: point
+// and directional lights have a SpotCosAngle of -1, so every
+// direction is inside the cone. Directional lights have no
+// position, so their ambient color goes there instead.
+// --------------------------------------------------------
+struct Light {
+	DirectX::XMFLOAT3 Position;		// Ambient color for directional lights
+	float Range;					// Falls off to nothing here; 0 for directional
+	DirectX::XMFLOAT3 Color;
+	float SpotCosAngle;				// Cosine of the cone's half angle
+	DirectX::XMFLOAT3 Direction;	// Normalized; unused by point lights
+	unsigned int Type;				// A LightType
+};
+
+// Structured buffer elements are best kept to whole 16 byte registers
+static_assert(sizeof(Light) % 16 == 0, "Light must be padded to 16 bytes");
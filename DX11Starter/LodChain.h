@@ -0,0 +1,15 @@
+#pragma once
+
+// Most detail levels a mesh can have; LodSelector compares them four at a time
+static const unsigned int MaxLods = 4;
+
+// --------------------------------------------------------
+// How far each of a mesh's detail levels strays from the
+// full detail one, finest first. Errors are fractions of
+// the full detail mesh's bounding radius, so they hold
+// however the mesh is scaled, and only ever grow.
+// --------------------------------------------------------
+struct LodChain {
+	unsigned int Count;
+	float Errors[MaxLods];	// Errors[0] is normally 0
+};
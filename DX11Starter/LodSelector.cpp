@@ -0,0 +1,158 @@
+#include "LodSelector.h"
+#include <algorithm>
+#include <chrono>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Objects done by one job on the thread pool; a multiple of four
+static const unsigned int ObjectsPerJob = 4096;
+
+// Nearest a sphere's surface is taken to be, so the camera
+// can sit inside one without dividing by zero
+static const float MinDistance = 1e-4f;
+
+LodSelector::LodSelector(ThreadPool* threadPool)
+{
+	this->threadPool = threadPool;
+
+	errorThreshold = 1.0f;
+	hysteresis = 0.25f;
+	cullSize = 0;
+	fadeRange = 0;
+
+	switchCount = 0;
+	culledCount = 0;
+	selectSeconds = 0;
+}
+
+LodSelector::~LodSelector()
+{
+}
+
+void LodSelector::Select(CXMMATRIX view, CXMMATRIX projection, float screenHeight,
+	const XMFLOAT4* bounds, const LodChain* chains, unsigned int* lods, float* fades, unsigned int count)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	// Pixels across a unit at unit distance
+	XMVECTOR eye = XMMatrixInverse(nullptr, view).r[3];
+	float pixelScale = screenHeight * 0.5f * XMVectorGetY(projection.r[1]);
+
+	unsigned int jobCount = (count + ObjectsPerJob - 1) / ObjectsPerJob;
+	jobs.resize(jobCount);
+	threadPool->ParallelFor(jobCount, [&](unsigned int job) {
+		JobCounts& counts = jobs[job];
+		counts = {};
+
+		unsigned int first = job * ObjectsPerJob;
+		unsigned int last = std::min(count, first + ObjectsPerJob);
+		unsigned int i = first;
+		for (; i + 4 <= last; i += 4) {
+			SelectGroup(eye, pixelScale, &bounds[i], &chains[i], &lods[i], &fades[i], counts);
+		}
+
+		// The last few go through a group padded with copies of the first
+		if (i < last) {
+			XMFLOAT4 groupBounds[4];
+			LodChain groupChains[4];
+			unsigned int groupLods[4];
+			float groupFades[4];
+			for (unsigned int j = 0; j < 4; j++) {
+				unsigned int source = i + j < last ? i + j : i;
+				groupBounds[j] = bounds[source];
+				groupChains[j] = chains[source];
+				groupLods[j] = lods[source];
+			}
+
+			JobCounts groupCounts = {};
+			SelectGroup(eye, pixelScale, groupBounds, groupChains, groupLods, groupFades, groupCounts);
+
+			for (unsigned int j = 0; i + j < last; j++) {
+				counts.switches += groupLods[j] != lods[i + j];
+				counts.culled += groupFades[j] == 0;
+				lods[i + j] = groupLods[j];
+				fades[i + j] = groupFades[j];
+			}
+		}
+	});
+
+	switchCount = 0;
+	culledCount = 0;
+	for (unsigned int i = 0; i < jobCount; i++) {
+		switchCount += jobs[i].switches;
+		culledCount += jobs[i].culled;
+	}
+
+	selectSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Picks levels for four objects at once. Counting the levels
+// under an error limit gives the coarsest one under it, as
+// errors only grow along a chain; that's done for the limits
+// at both edges of the band, and the current level is kept
+// if it's between them.
+// --------------------------------------------------------
+void LodSelector::SelectGroup(FXMVECTOR eye, float pixelScale, const XMFLOAT4* bounds, const LodChain* chains,
+	unsigned int* lods, float* fades, JobCounts& counts)
+{
+	// One object per lane
+	XMMATRIX spheres = XMMatrixTranspose(XMMATRIX(
+		XMLoadFloat4(&bounds[0]), XMLoadFloat4(&bounds[1]), XMLoadFloat4(&bounds[2]), XMLoadFloat4(&bounds[3])));
+	XMMATRIX errors = XMMatrixTranspose(XMMATRIX(
+		XMLoadFloat4((const XMFLOAT4*)chains[0].Errors), XMLoadFloat4((const XMFLOAT4*)chains[1].Errors),
+		XMLoadFloat4((const XMFLOAT4*)chains[2].Errors), XMLoadFloat4((const XMFLOAT4*)chains[3].Errors)));
+	XMVECTOR levelCounts = XMVectorSet((float)chains[0].Count, (float)chains[1].Count, (float)chains[2].Count, (float)chains[3].Count);
+
+	XMVECTOR toX = XMVectorSubtract(spheres.r[0], XMVectorSplatX(eye));
+	XMVECTOR toY = XMVectorSubtract(spheres.r[1], XMVectorSplatY(eye));
+	XMVECTOR toZ = XMVectorSubtract(spheres.r[2], XMVectorSplatZ(eye));
+	XMVECTOR distance = XMVectorSqrt(XMVectorMultiplyAdd(toX, toX, XMVectorMultiplyAdd(toY, toY, XMVectorMultiply(toZ, toZ))));
+	XMVECTOR nearest = XMVectorMax(XMVectorSubtract(distance, spheres.r[3]), XMVectorReplicate(MinDistance));
+
+	// Error, as a share of the radius, per pixel
+	XMVECTOR errorPerPixel = XMVectorDivide(nearest, XMVectorMultiply(spheres.r[3], XMVectorReplicate(pixelScale)));
+	XMVECTOR coarserLimit = XMVectorMultiply(XMVectorReplicate(errorThreshold * (1 - hysteresis)), errorPerPixel);
+	XMVECTOR finerLimit = XMVectorMultiply(XMVectorReplicate(errorThreshold * (1 + hysteresis)), errorPerPixel);
+
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR coarserCount = zero;
+	XMVECTOR finerCount = zero;
+	for (unsigned int level = 0; level < MaxLods; level++) {
+		XMVECTOR inChain = XMVectorLess(XMVectorReplicate((float)level), levelCounts);
+		XMVECTOR error = errors.r[level];
+		coarserCount = XMVectorAdd(coarserCount, XMVectorSelect(zero, one, XMVectorAndInt(inChain, XMVectorLessOrEqual(error, coarserLimit))));
+		finerCount = XMVectorAdd(finerCount, XMVectorSelect(zero, one, XMVectorAndInt(inChain, XMVectorLessOrEqual(error, finerLimit))));
+	}
+
+	// Fades with the sphere's size on screen, from nothing at the cull size
+	XMVECTOR fade = one;
+	if (cullSize > 0) {
+		XMVECTOR size = XMVectorDivide(XMVectorReplicate(2), errorPerPixel);
+		XMVECTOR inverseRange = XMVectorReplicate(1 / std::max(fadeRange, MinDistance));
+		fade = XMVectorSaturate(XMVectorMultiply(XMVectorSubtract(size, XMVectorReplicate(cullSize)), inverseRange));
+	}
+
+	// Anything finer than the first limit's level is wasted detail,
+	// and anything coarser than the second's shows
+	XMVECTOR lowest = XMVectorMax(XMVectorSubtract(coarserCount, one), zero);
+	XMVECTOR highest = XMVectorMax(XMVectorSubtract(finerCount, one), zero);
+	XMVECTOR current = XMVectorSet((float)lods[0], (float)lods[1], (float)lods[2], (float)lods[3]);
+	current = XMVectorMin(current, XMVectorMax(XMVectorSubtract(levelCounts, one), zero));
+
+	XMFLOAT4 levels, visibility;
+	XMStoreFloat4(&levels, XMVectorMin(XMVectorMax(current, lowest), highest));
+	XMStoreFloat4(&visibility, fade);
+
+	const float* levelLanes = &levels.x;
+	const float* fadeLanes = &visibility.x;
+	for (unsigned int i = 0; i < 4; i++) {
+		unsigned int level = (unsigned int)levelLanes[i];
+		counts.switches += level != lods[i];
+		counts.culled += fadeLanes[i] == 0;
+		lods[i] = level;
+		fades[i] = fadeLanes[i];
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "LodChain.h"
+#include "ThreadPool.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Picks each object's detail level from how big its
+// geometric error looks on screen: the coarsest level whose
+// error, projected at the point of the object's bounding
+// sphere nearest the camera, stays under a pixel threshold.
+// That point's distance doesn't change as the camera turns,
+// so neither do the levels.
+//
+// Each object stays at its current level while that level's
+// error is inside a band around the threshold: it only gets
+// coarser once the coarser level is under the threshold less
+// the band, and only finer once its own level is over the
+// threshold plus the band. An object sitting right at a
+// switch distance doesn't pop back and forth.
+//
+// Objects whose spheres cover fewer pixels than the cull
+// size can be faded out over a range of sizes and then
+// culled, which is off until a cull size is set.
+//
+// Objects are done four at a time, their spheres and chains
+// turned so each lane is one object, and split into chunks
+// across the thread pool.
+// --------------------------------------------------------
+class LodSelector
+{
+public:
+	LodSelector(ThreadPool* threadPool);
+	~LodSelector();
+
+	// Settings, kept until changed. Sizes are in pixels, and the
+	// hysteresis is a share of the error threshold.
+	void SetErrorThreshold(float pixels) { errorThreshold = pixels; }
+	void SetHysteresis(float band) { hysteresis = band; }
+	void SetFadeCull(float cullSize, float fadeRange) { this->cullSize = cullSize; this->fadeRange = fadeRange; }
+
+	// Bounds are world space spheres, the radius in w. lods holds
+	// each object's level from last frame, and gets this frame's.
+	// fades gets how visible each object is, 0 once it's culled.
+	// view and projection are the camera's, not transposed.
+	void Select(DirectX::CXMMATRIX view, DirectX::CXMMATRIX projection, float screenHeight,
+		const DirectX::XMFLOAT4* bounds, const LodChain* chains, unsigned int* lods, float* fades, unsigned int count);
+
+	// Objects that changed level, and objects culled, in the last Select()
+	unsigned int GetSwitchCount() { return switchCount; }
+	unsigned int GetCulledCount() { return culledCount; }
+
+	float GetSelectSeconds() { return selectSeconds; }
+
+private:
+	ThreadPool* threadPool;
+
+	float errorThreshold;
+	float hysteresis;
+	float cullSize;
+	float fadeRange;
+
+	// Each job's switches and culls, summed once they're done
+	struct JobCounts
+	{
+		unsigned int switches;
+		unsigned int culled;
+	};
+
+	std::vector<JobCounts> jobs;
+	unsigned int switchCount;
+	unsigned int culledCount;
+	float selectSeconds;
+
+	void SelectGroup(DirectX::FXMVECTOR eye, float pixelScale, const DirectX::XMFLOAT4* bounds, const LodChain* chains,
+		unsigned int* lods, float* fades, JobCounts& counts);
+};
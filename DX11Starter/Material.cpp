@@ -1,5 +1,6 @@
 #include "Material.h"
 
+unsigned int Material::nextId = 0;
 
 Material::Material(SimpleVertexShader * vertexShader, SimplePixelShader * pixelShader, ID3D11ShaderResourceView* srv)
 {
@@ -8,6 +9,7 @@ Material::Material(SimpleVertexShader * vertexShader, SimplePixelShader * pixelS
 
 	this->color = DirectX::XMFLOAT4(1, 1, 1, 1);
 	this->textureSrv = srv;
+	this->id = nextId++;
 }
 
 Material::Material(SimpleVertexShader * vertexShader, SimplePixelShader * pixelShader, DirectX::XMFLOAT4 color, ID3D11ShaderResourceView* srv)
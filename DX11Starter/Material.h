@@ -3,7 +3,6 @@
 #include "DXCore.h"
 #include "SimpleShader.h"
 #include <DirectXMath.h>
-#include "Renderer.h"
 
 class Material
 {
@@ -14,6 +13,10 @@ class Material
 	ID3D11ShaderResourceView* textureSrv;
 	DirectX::XMFLOAT4 color;
 
+	// Unique, sequential identifier used for sorting draws
+	unsigned int id;
+	static unsigned int nextId;
+
 public:
 	Material(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader, ID3D11ShaderResourceView* srv);
 	Material(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader, DirectX::XMFLOAT4 color, ID3D11ShaderResourceView* srv);
@@ -35,5 +38,9 @@ public:
 	DirectX::XMFLOAT4 GetColor() {
 		return color;
 	}
+
+	unsigned int GetId() {
+		return id;
+	}
 };
 
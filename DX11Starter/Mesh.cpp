@@ -1,12 +1,26 @@
 #include "Mesh.h"
 
 using namespace DirectX;
-Mesh::Mesh(UINT indices[], Vertex vertices[], int indexCount, int vertexCount, ID3D11Device* device)
+
+unsigned int Mesh::nextId = 0;
+
+Mesh::Mesh(UINT indices[], Vertex vertices[], int indexCount, int vertexCount, ID3D11Device* device, bool retainGeometry)
 {
+	this->retainGeometry = retainGeometry;
+	this->id = nextId++;
+	bvh = nullptr;
 	this->InitBuffers(indices, vertices, indexCount, vertexCount, device);
 }
 
-Mesh::Mesh(char* objFile, ID3D11Device* device){
+Mesh::Mesh(char* objFile, ID3D11Device* device, bool retainGeometry){
+
+	this->retainGeometry = retainGeometry;
+	this->id = nextId++;
+	bvh = nullptr;
+	vertexBuffer = nullptr;
+	indexBuffer = nullptr;
+	indexCount = 0;
+	vertexCount = 0;
 
 	// File input object
 	std::ifstream obj(objFile);
@@ -154,6 +168,14 @@ Mesh::Mesh(char* objFile, ID3D11Device* device){
 
 void Mesh::InitBuffers(UINT* indices, Vertex* vertices, int indexCount, int vertexCount, ID3D11Device* device) {
 	this->indexCount = indexCount;
+	this->vertexCount = vertexCount;
+
+	DirectX::BoundingBox::CreateFromPoints(bounds, vertexCount, &vertices[0].Position, sizeof(Vertex));
+
+	if (retainGeometry) {
+		this->vertices.assign(vertices, vertices + vertexCount);
+		this->indices.assign(indices, indices + indexCount);
+	}
 
 	// Create the VERTEX BUFFER description -----------------------------------
 	// - The description is created on the stack because we only need
@@ -202,6 +224,11 @@ Mesh::~Mesh()
 	// we've made in the Game class
 	if (vertexBuffer) { vertexBuffer->Release(); }
 	if (indexBuffer) { indexBuffer->Release(); }
+
+	if (bvh != nullptr) {
+		delete bvh;
+		bvh = nullptr;
+	}
 }
 
 ID3D11Buffer * Mesh::GetVertexBuffer()
@@ -218,3 +245,41 @@ int Mesh::GetIndexCount()
 {
 	return indexCount;
 }
+
+int Mesh::GetVertexCount()
+{
+	return vertexCount;
+}
+
+unsigned int Mesh::GetId()
+{
+	return id;
+}
+
+DirectX::BoundingBox Mesh::GetBounds()
+{
+	return bounds;
+}
+
+bool Mesh::HasGeometry()
+{
+	return retainGeometry && !indices.empty();
+}
+
+const std::vector<Vertex>& Mesh::GetVertices()
+{
+	return vertices;
+}
+
+const std::vector<UINT>& Mesh::GetIndices()
+{
+	return indices;
+}
+
+MeshBVH * Mesh::GetBVH()
+{
+	if (bvh == nullptr && HasGeometry()) {
+		bvh = new MeshBVH(vertices, indices);
+	}
+	return bvh;
+}
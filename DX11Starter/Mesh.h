@@ -1,5 +1,7 @@
 #include "DXCore.h"
 #include "Vertex.h"
+#include "MeshBVH.h"
+#include <DirectXCollision.h>
 #include <fstream>
 #include <vector>
 
@@ -11,16 +13,44 @@ private:
 	ID3D11Buffer* vertexBuffer;
 	ID3D11Buffer* indexBuffer;
 	int indexCount;
+	int vertexCount;
+
+	// Unique, sequential identifier used for sorting draws
+	unsigned int id;
+	static unsigned int nextId;
+
+	// Object space bounds of the vertices
+	DirectX::BoundingBox bounds;
+
+	// CPU copies of the geometry, kept around for culling and picking
+	bool retainGeometry;
+	std::vector<Vertex> vertices;
+	std::vector<UINT> indices;
+
+	// Built the first time someone ray casts against the mesh
+	MeshBVH* bvh;
 
 public:
 
-	Mesh(UINT indices[], Vertex vertices[], int indexCount, int vertexCount, ID3D11Device* device);
-	Mesh(char* modelName, ID3D11Device* device);
+	Mesh(UINT indices[], Vertex vertices[], int indexCount, int vertexCount, ID3D11Device* device, bool retainGeometry = true);
+	Mesh(char* modelName, ID3D11Device* device, bool retainGeometry = true);
 	~Mesh();
 
 	void InitBuffers(UINT* indices, Vertex* verticies, int indexCount, int vertexCount, ID3D11Device* device);
 	ID3D11Buffer* GetVertexBuffer();
 	ID3D11Buffer* GetIndexBuffer();
 	int GetIndexCount();
+	int GetVertexCount();
+	unsigned int GetId();
+
+	DirectX::BoundingBox GetBounds();
+
+	// Whether the CPU side vertices/indices are available
+	bool HasGeometry();
+	const std::vector<Vertex>& GetVertices();
+	const std::vector<UINT>& GetIndices();
+
+	// Triangle BVH for ray casts, or null if the geometry wasn't retained
+	MeshBVH* GetBVH();
 };
 
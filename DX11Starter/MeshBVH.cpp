@@ -0,0 +1,343 @@
+#include "MeshBVH.h"
+#include <algorithm>
+#include <cfloat>
+#include <emmintrin.h>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Number of buckets used when evaluating split candidates
+static const unsigned int SplitBins = 12;
+
+// Traversal stack kept on the call stack; deeper trees use the heap
+static const unsigned int TraversalStackSize = 128;
+
+// Determinants smaller than this mean the ray is parallel to the triangle
+static const float ParallelEpsilon = 1e-10f;
+
+static float HalfArea(XMFLOAT3 boundsMin, XMFLOAT3 boundsMax)
+{
+	float x = boundsMax.x - boundsMin.x;
+	float y = boundsMax.y - boundsMin.y;
+	float z = boundsMax.z - boundsMin.z;
+	return x * y + y * z + z * x;
+}
+
+static void Grow(XMFLOAT3& boundsMin, XMFLOAT3& boundsMax, XMFLOAT3 pointMin, XMFLOAT3 pointMax)
+{
+	boundsMin.x = std::min(boundsMin.x, pointMin.x);
+	boundsMin.y = std::min(boundsMin.y, pointMin.y);
+	boundsMin.z = std::min(boundsMin.z, pointMin.z);
+	boundsMax.x = std::max(boundsMax.x, pointMax.x);
+	boundsMax.y = std::max(boundsMax.y, pointMax.y);
+	boundsMax.z = std::max(boundsMax.z, pointMax.z);
+}
+
+static float Component(XMFLOAT3 v, int axis)
+{
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+MeshBVH::MeshBVH(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	triangleCount = (unsigned int)indices.size() / 3;
+
+	std::vector<BuildTriangle> triangles(triangleCount);
+	for (unsigned int i = 0; i < triangleCount; i++) {
+		XMFLOAT3 a = vertices[indices[i * 3]].Position;
+		XMFLOAT3 b = vertices[indices[i * 3 + 1]].Position;
+		XMFLOAT3 c = vertices[indices[i * 3 + 2]].Position;
+
+		BuildTriangle& tri = triangles[i];
+		tri.boundsMin = a;
+		tri.boundsMax = a;
+		Grow(tri.boundsMin, tri.boundsMax, b, b);
+		Grow(tri.boundsMin, tri.boundsMax, c, c);
+		tri.centroid = XMFLOAT3((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f);
+		tri.index = i;
+	}
+
+	nodes.reserve(std::max(1u, 2 * triangleCount / PacketSize + 1));
+	packets.reserve(triangleCount / PacketSize + 1);
+	nodes.push_back(Node());
+	depth = 0;
+	Subdivide(0, 0, triangles, 0, triangleCount, vertices, indices);
+}
+
+MeshBVH::~MeshBVH()
+{
+}
+
+void MeshBVH::Subdivide(unsigned int nodeIndex, unsigned int nodeDepth, std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count,
+	const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	depth = std::max(depth, nodeDepth);
+
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX), boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	XMFLOAT3 centroidMin = boundsMin, centroidMax = boundsMax;
+	for (unsigned int i = first; i < first + count; i++) {
+		Grow(boundsMin, boundsMax, triangles[i].boundsMin, triangles[i].boundsMax);
+		Grow(centroidMin, centroidMax, triangles[i].centroid, triangles[i].centroid);
+	}
+	nodes[nodeIndex].boundsMin = boundsMin;
+	nodes[nodeIndex].boundsMax = boundsMax;
+
+	if (count <= PacketSize) {
+		MakeLeaf(nodes[nodeIndex], triangles, first, count, vertices, indices);
+		return;
+	}
+
+	unsigned int leftCount = Partition(triangles, first, count, centroidMin, centroidMax);
+
+	// Children are allocated as a pair so the right one is always left + 1
+	unsigned int leftIndex = (unsigned int)nodes.size();
+	nodes.push_back(Node());
+	nodes.push_back(Node());
+	nodes[nodeIndex].leftOrFirst = leftIndex;
+	nodes[nodeIndex].count = 0;
+
+	Subdivide(leftIndex, nodeDepth + 1, triangles, first, leftCount, vertices, indices);
+	Subdivide(leftIndex + 1, nodeDepth + 1, triangles, first + leftCount, count - leftCount, vertices, indices);
+}
+
+// --------------------------------------------------------
+// Splits the range using a binned surface area heuristic.
+// Returns the number of triangles in the left half, which
+// is always in [1, count - 1].
+// --------------------------------------------------------
+unsigned int MeshBVH::Partition(std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count,
+	XMFLOAT3 centroidMin, XMFLOAT3 centroidMax)
+{
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	unsigned int bestSplit = 0;
+
+	for (int axis = 0; axis < 3; axis++) {
+		float axisMin = Component(centroidMin, axis);
+		float extent = Component(centroidMax, axis) - axisMin;
+		if (extent <= 0) {
+			continue;
+		}
+
+		// Bin the triangles by centroid
+		unsigned int binCounts[SplitBins] = {};
+		XMFLOAT3 binMin[SplitBins], binMax[SplitBins];
+		for (unsigned int b = 0; b < SplitBins; b++) {
+			binMin[b] = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			binMax[b] = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		}
+
+		float scale = SplitBins / extent;
+		for (unsigned int i = first; i < first + count; i++) {
+			unsigned int bin = std::min(SplitBins - 1, (unsigned int)((Component(triangles[i].centroid, axis) - axisMin) * scale));
+			binCounts[bin]++;
+			Grow(binMin[bin], binMax[bin], triangles[i].boundsMin, triangles[i].boundsMax);
+		}
+
+		// Sweep from the right to get the cost of everything right of each plane
+		float rightArea[SplitBins];
+		unsigned int rightCount[SplitBins];
+		XMFLOAT3 sweepMin(FLT_MAX, FLT_MAX, FLT_MAX), sweepMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		unsigned int sweepCount = 0;
+		for (unsigned int b = SplitBins - 1; b > 0; b--) {
+			sweepCount += binCounts[b];
+			if (binCounts[b] > 0) {
+				Grow(sweepMin, sweepMax, binMin[b], binMax[b]);
+			}
+			rightCount[b] = sweepCount;
+			rightArea[b] = sweepCount > 0 ? HalfArea(sweepMin, sweepMax) : 0;
+		}
+
+		// Then sweep from the left and combine
+		sweepMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		sweepMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		sweepCount = 0;
+		for (unsigned int b = 1; b < SplitBins; b++) {
+			sweepCount += binCounts[b - 1];
+			if (binCounts[b - 1] > 0) {
+				Grow(sweepMin, sweepMax, binMin[b - 1], binMax[b - 1]);
+			}
+			if (sweepCount == 0 || rightCount[b] == 0) {
+				continue;
+			}
+
+			float cost = sweepCount * HalfArea(sweepMin, sweepMax) + rightCount[b] * rightArea[b];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	// Every centroid is in the same spot; any split is as good as another
+	if (bestAxis < 0) {
+		return count / 2;
+	}
+
+	float axisMin = Component(centroidMin, bestAxis);
+	float scale = SplitBins / (Component(centroidMax, bestAxis) - axisMin);
+	std::vector<BuildTriangle>::iterator middle = std::partition(
+		triangles.begin() + first,
+		triangles.begin() + first + count,
+		[&](const BuildTriangle& tri) {
+			unsigned int bin = std::min(SplitBins - 1, (unsigned int)((Component(tri.centroid, bestAxis) - axisMin) * scale));
+			return bin < bestSplit;
+		});
+
+	return (unsigned int)(middle - (triangles.begin() + first));
+}
+
+void MeshBVH::MakeLeaf(Node& node, std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count,
+	const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	// Unused lanes stay zeroed, which makes them degenerate and never hit
+	TrianglePacket packet = {};
+	for (unsigned int lane = 0; lane < count; lane++) {
+		unsigned int tri = triangles[first + lane].index;
+		XMFLOAT3 a = vertices[indices[tri * 3]].Position;
+		XMFLOAT3 b = vertices[indices[tri * 3 + 1]].Position;
+		XMFLOAT3 c = vertices[indices[tri * 3 + 2]].Position;
+
+		packet.v0[0][lane] = a.x;
+		packet.v0[1][lane] = a.y;
+		packet.v0[2][lane] = a.z;
+		packet.edge1[0][lane] = b.x - a.x;
+		packet.edge1[1][lane] = b.y - a.y;
+		packet.edge1[2][lane] = b.z - a.z;
+		packet.edge2[0][lane] = c.x - a.x;
+		packet.edge2[1][lane] = c.y - a.y;
+		packet.edge2[2][lane] = c.z - a.z;
+		packet.triangleIndex[lane] = tri;
+	}
+
+	node.leftOrFirst = (unsigned int)packets.size();
+	node.count = 1;
+	packets.push_back(packet);
+}
+
+// --------------------------------------------------------
+// Slab test; returns the entry distance or FLT_MAX on a miss
+// --------------------------------------------------------
+float MeshBVH::IntersectBounds(XMFLOAT3 boundsMin, XMFLOAT3 boundsMax, XMFLOAT3 origin, XMFLOAT3 inverseDirection, float maxDistance)
+{
+	float tx1 = (boundsMin.x - origin.x) * inverseDirection.x, tx2 = (boundsMax.x - origin.x) * inverseDirection.x;
+	float ty1 = (boundsMin.y - origin.y) * inverseDirection.y, ty2 = (boundsMax.y - origin.y) * inverseDirection.y;
+	float tz1 = (boundsMin.z - origin.z) * inverseDirection.z, tz2 = (boundsMax.z - origin.z) * inverseDirection.z;
+
+	float tEnter = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::max(std::min(tz1, tz2), 0.0f));
+	float tExit = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::min(std::max(tz1, tz2), maxDistance));
+	return tEnter <= tExit ? tEnter : FLT_MAX;
+}
+
+bool MeshBVH::Intersect(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance,
+	float& distance, unsigned int& triangleIndex, XMFLOAT2& barycentrics)
+{
+	if (nodes.empty() || triangleCount == 0) {
+		return false;
+	}
+
+	XMFLOAT3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float closest = maxDistance;
+	bool hit = false;
+
+	const __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+	const __m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 epsilon = _mm_set1_ps(ParallelEpsilon);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	// Holds at most one deferred sibling per level, plus the pair just pushed
+	unsigned int localStack[TraversalStackSize];
+	std::vector<unsigned int> heapStack;
+	unsigned int* stack = localStack;
+	if (depth + 1 > TraversalStackSize) {
+		heapStack.resize(depth + 1);
+		stack = &heapStack[0];
+	}
+
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+		if (IntersectBounds(node.boundsMin, node.boundsMax, origin, inverseDirection, closest) == FLT_MAX) {
+			continue;
+		}
+
+		if (node.count == 0) {
+			// Visit the nearer child first so the far one can be rejected by distance
+			const Node& left = nodes[node.leftOrFirst];
+			const Node& right = nodes[node.leftOrFirst + 1];
+			float leftDistance = IntersectBounds(left.boundsMin, left.boundsMax, origin, inverseDirection, closest);
+			float rightDistance = IntersectBounds(right.boundsMin, right.boundsMax, origin, inverseDirection, closest);
+			unsigned int nearIndex = node.leftOrFirst, farIndex = node.leftOrFirst + 1;
+			if (rightDistance < leftDistance) {
+				std::swap(leftDistance, rightDistance);
+				std::swap(nearIndex, farIndex);
+			}
+
+			if (rightDistance != FLT_MAX) stack[stackSize++] = farIndex;
+			if (leftDistance != FLT_MAX) stack[stackSize++] = nearIndex;
+			continue;
+		}
+
+		// Moller-Trumbore against four triangles at once
+		for (unsigned int p = node.leftOrFirst; p < node.leftOrFirst + node.count; p++) {
+			const TrianglePacket& packet = packets[p];
+			__m128 e1x = _mm_loadu_ps(packet.edge1[0]), e1y = _mm_loadu_ps(packet.edge1[1]), e1z = _mm_loadu_ps(packet.edge1[2]);
+			__m128 e2x = _mm_loadu_ps(packet.edge2[0]), e2y = _mm_loadu_ps(packet.edge2[1]), e2z = _mm_loadu_ps(packet.edge2[2]);
+
+			__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+			__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+			__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+			__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+			__m128 valid = _mm_cmpgt_ps(_mm_andnot_ps(signMask, det), epsilon);
+			if (_mm_movemask_ps(valid) == 0) {
+				continue;
+			}
+			__m128 inverseDet = _mm_div_ps(one, det);
+
+			__m128 tx = _mm_sub_ps(ox, _mm_loadu_ps(packet.v0[0]));
+			__m128 ty = _mm_sub_ps(oy, _mm_loadu_ps(packet.v0[1]));
+			__m128 tz = _mm_sub_ps(oz, _mm_loadu_ps(packet.v0[2]));
+			__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverseDet);
+
+			__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+			__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+			__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+			__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDet);
+			__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+			valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+			valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+			valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+			valid = _mm_and_ps(valid, _mm_cmpgt_ps(t, zero));
+			valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(closest)));
+
+			int mask = _mm_movemask_ps(valid);
+			if (mask == 0) {
+				continue;
+			}
+
+			float laneT[PacketSize], laneU[PacketSize], laneV[PacketSize];
+			_mm_storeu_ps(laneT, t);
+			_mm_storeu_ps(laneU, u);
+			_mm_storeu_ps(laneV, v);
+			for (unsigned int lane = 0; lane < PacketSize; lane++) {
+				if ((mask & (1 << lane)) && laneT[lane] < closest) {
+					closest = laneT[lane];
+					triangleIndex = packet.triangleIndex[lane];
+					barycentrics = XMFLOAT2(laneU[lane], laneV[lane]);
+					hit = true;
+				}
+			}
+		}
+	}
+
+	if (hit) {
+		distance = closest;
+	}
+	return hit;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Bounding volume hierarchy over a mesh's triangles, used
+// for exact ray casts against CPU side geometry.
+//
+// Leaves hold a single packet of up to four triangles laid
+// out SoA, so each leaf is one 4-wide SIMD ray/triangle test.
+// --------------------------------------------------------
+class MeshBVH
+{
+public:
+	static const unsigned int PacketSize = 4;
+
+	MeshBVH(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+	~MeshBVH();
+
+	// Finds the closest triangle hit along the ray with t < maxDistance.
+	// The ray is in the mesh's object space and does not need to be normalized.
+	bool Intersect(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance,
+		float& distance, unsigned int& triangleIndex, DirectX::XMFLOAT2& barycentrics);
+
+	// Ray/box slab test; returns the entry distance, or FLT_MAX on a miss
+	static float IntersectBounds(DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax,
+		DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 inverseDirection, float maxDistance);
+
+	unsigned int GetNodeCount() { return (unsigned int)nodes.size(); }
+	unsigned int GetTriangleCount() { return triangleCount; }
+
+	// Levels below the root; traversal needs one stack entry per level, plus one
+	unsigned int GetDepth() { return depth; }
+
+private:
+	// Leaves have count > 0 and index their packets through leftOrFirst,
+	// inner nodes keep their children at leftOrFirst and leftOrFirst + 1
+	struct Node
+	{
+		DirectX::XMFLOAT3 boundsMin;
+		unsigned int leftOrFirst;
+		DirectX::XMFLOAT3 boundsMax;
+		unsigned int count;
+	};
+
+	// Four triangles stored as a vertex plus two edges per lane
+	struct TrianglePacket
+	{
+		float v0[3][PacketSize];
+		float edge1[3][PacketSize];
+		float edge2[3][PacketSize];
+		unsigned int triangleIndex[PacketSize];
+	};
+
+	struct BuildTriangle
+	{
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+		DirectX::XMFLOAT3 centroid;
+		unsigned int index;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<TrianglePacket> packets;
+	unsigned int triangleCount;
+	unsigned int depth;
+
+	void Subdivide(unsigned int nodeIndex, unsigned int nodeDepth, std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count,
+		const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+	unsigned int Partition(std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count,
+		DirectX::XMFLOAT3 centroidMin, DirectX::XMFLOAT3 centroidMax);
+	void MakeLeaf(Node& node, std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count,
+		const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+};
+
@@ -0,0 +1,247 @@
+#include "ObjectLightSelector.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Objects scored by one job on the thread pool
+static const unsigned int ObjectsPerJob = 256;
+
+// Where padding lights sit, past every sort key
+static const float FarAway = 1e18f;
+
+ObjectLightSelector::ObjectLightSelector(ThreadPool* threadPool)
+{
+	this->threadPool = threadPool;
+
+	sortedCount = 0;
+	sortAxis = 0;
+	maxRange = 0;
+	selectSeconds = 0;
+}
+
+ObjectLightSelector::~ObjectLightSelector()
+{
+}
+
+static float GetAxis(const XMFLOAT3& position, unsigned int axis)
+{
+	return axis == 0 ? position.x : axis == 1 ? position.y : position.z;
+}
+
+// --------------------------------------------------------
+// Sorts the lights that can light anything along the axis
+// their positions spread furthest on, and lays them out for
+// scoring four at a time
+// --------------------------------------------------------
+void ObjectLightSelector::SortLights(const Light* lights, unsigned int lightCount)
+{
+	order.clear();
+	maxRange = 0;
+
+	XMFLOAT3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (unsigned int i = 0; i < lightCount; i++) {
+		const Light& light = lights[i];
+		if (light.Range <= 0 || (light.Color.x <= 0 && light.Color.y <= 0 && light.Color.z <= 0)) {
+			continue;
+		}
+
+		order.push_back(i);
+		min = XMFLOAT3(std::min(min.x, light.Position.x), std::min(min.y, light.Position.y), std::min(min.z, light.Position.z));
+		max = XMFLOAT3(std::max(max.x, light.Position.x), std::max(max.y, light.Position.y), std::max(max.z, light.Position.z));
+		maxRange = std::max(maxRange, light.Range);
+	}
+
+	sortAxis = 0;
+	if (max.y - min.y > max.x - min.x) sortAxis = 1;
+	if (max.z - min.z > GetAxis(max, sortAxis) - GetAxis(min, sortAxis)) sortAxis = 2;
+
+	unsigned int axis = sortAxis;
+	std::sort(order.begin(), order.end(), [lights, axis](unsigned int a, unsigned int b) {
+		float keyA = GetAxis(lights[a].Position, axis);
+		float keyB = GetAxis(lights[b].Position, axis);
+		return keyA < keyB || (keyA == keyB && a < b);
+	});
+
+	x.clear(); y.clear(); z.clear(); range.clear(); inverseRange.clear(); intensity.clear();
+	dirX.clear(); dirY.clear(); dirZ.clear(); cosAngle.clear(); sinAngle.clear();
+	index.clear();
+	sortKeys.clear();
+
+	for (unsigned int i = 0; i < order.size(); i++) {
+		const Light& light = lights[order[i]];
+		x.push_back(light.Position.x);
+		y.push_back(light.Position.y);
+		z.push_back(light.Position.z);
+		range.push_back(light.Range);
+		inverseRange.push_back(1 / light.Range);
+
+		// Perceived brightness, so a dim blue doesn't beat a bright yellow
+		intensity.push_back(0.2126f * light.Color.x + 0.7152f * light.Color.y + 0.0722f * light.Color.z);
+
+		// Cones wider than a hemisphere are scored as spheres
+		XMFLOAT3 direction(0, 0, 0);
+		float cosine = -1;
+		if (light.SpotCosAngle > 0) {
+			XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&light.Direction)));
+			cosine = light.SpotCosAngle;
+		}
+		dirX.push_back(direction.x);
+		dirY.push_back(direction.y);
+		dirZ.push_back(direction.z);
+		cosAngle.push_back(cosine);
+		sinAngle.push_back(sqrtf(std::max(0.0f, 1 - cosine * cosine)));
+
+		index.push_back(order[i]);
+		sortKeys.push_back(GetAxis(light.Position, sortAxis));
+	}
+
+	sortedCount = (unsigned int)sortKeys.size();
+
+	// Padding is out of reach of everything, and has no intensity
+	while (index.size() % 4 != 0) {
+		x.push_back(FarAway); y.push_back(FarAway); z.push_back(FarAway);
+		range.push_back(0); inverseRange.push_back(0); intensity.push_back(0);
+		dirX.push_back(0); dirY.push_back(0); dirZ.push_back(0);
+		cosAngle.push_back(-1); sinAngle.push_back(0);
+		index.push_back(0);
+		sortKeys.push_back(FarAway);
+	}
+}
+
+void ObjectLightSelector::Select(const Light* lights, unsigned int lightCount, const XMFLOAT4* bounds, unsigned int objectCount)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	SortLights(lights, lightCount);
+
+	selections.resize(objectCount);
+	unsigned int jobCount = (objectCount + ObjectsPerJob - 1) / ObjectsPerJob;
+	threadPool->ParallelFor(jobCount, [this, bounds, objectCount](unsigned int job) {
+		unsigned int last = std::min(objectCount, (job + 1) * ObjectsPerJob);
+		for (unsigned int i = job * ObjectsPerJob; i < last; i++) {
+			SelectObject(bounds[i], selections[i]);
+		}
+	});
+
+	selectSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Adds a light to the set if it beats one already there,
+// keeping the set sorted by score, then by light index
+// --------------------------------------------------------
+static void InsertLight(ObjectLightSet& selection, float* scores, float score, unsigned int light)
+{
+	unsigned int slot = selection.Count;
+	while (slot > 0 && (score > scores[slot - 1] || (score == scores[slot - 1] && light < selection.Indices[slot - 1]))) {
+		slot--;
+	}
+
+	if (slot >= MaxObjectLights) {
+		return;
+	}
+
+	unsigned int end = std::min(selection.Count, MaxObjectLights - 1);
+	for (unsigned int i = end; i > slot; i--) {
+		scores[i] = scores[i - 1];
+		selection.Indices[i] = selection.Indices[i - 1];
+	}
+
+	scores[slot] = score;
+	selection.Indices[slot] = light;
+	selection.Count = std::min(selection.Count + 1, MaxObjectLights);
+}
+
+static XMVECTOR LoadLanes(const std::vector<float>& values, unsigned int i)
+{
+	return XMLoadFloat4((const XMFLOAT4*)&values[i]);
+}
+
+
+// --------------------------------------------------------
+// Scores the lights within reach along the sorted axis,
+// four at a time. Only lanes that could make the set are
+// looked at one by one.
+// --------------------------------------------------------
+void ObjectLightSelector::SelectObject(const XMFLOAT4& bounds, ObjectLightSet& selection)
+{
+	selection.Count = 0;
+	float scores[MaxObjectLights];
+
+	XMFLOAT3 center(bounds.x, bounds.y, bounds.z);
+	float reach = bounds.w + maxRange;
+	float key = GetAxis(center, sortAxis);
+	unsigned int first = (unsigned int)(std::lower_bound(sortKeys.begin(), sortKeys.begin() + sortedCount, key - reach) - sortKeys.begin());
+	unsigned int last = (unsigned int)(std::upper_bound(sortKeys.begin(), sortKeys.begin() + sortedCount, key + reach) - sortKeys.begin());
+
+	// Whole groups of four; the padding makes room to round up
+	first &= ~3u;
+	last = (last + 3) & ~3u;
+
+	XMVECTOR centerX = XMVectorReplicate(center.x);
+	XMVECTOR centerY = XMVectorReplicate(center.y);
+	XMVECTOR centerZ = XMVectorReplicate(center.z);
+	XMVECTOR radius = XMVectorReplicate(bounds.w);
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR one = XMVectorSplatOne();
+
+	// The score to match once the set is full
+	XMVECTOR threshold = zero;
+
+	for (unsigned int i = first; i < last; i += 4) {
+		// From the light to the sphere's center
+		XMVECTOR toX = XMVectorSubtract(centerX, LoadLanes(x, i));
+		XMVECTOR toY = XMVectorSubtract(centerY, LoadLanes(y, i));
+		XMVECTOR toZ = XMVectorSubtract(centerZ, LoadLanes(z, i));
+		XMVECTOR lengthSq = XMVectorMultiply(toX, toX);
+		lengthSq = XMVectorMultiplyAdd(toY, toY, lengthSq);
+		lengthSq = XMVectorMultiplyAdd(toZ, toZ, lengthSq);
+
+		// Most groups are still out of reach along the other axes
+		XMVECTOR reachLanes = XMVectorAdd(LoadLanes(range, i), radius);
+		uint32_t reached[4];
+		XMStoreInt4(reached, XMVectorLess(lengthSq, XMVectorMultiply(reachLanes, reachLanes)));
+		if (!(reached[0] | reached[1] | reached[2] | reached[3])) {
+			continue;
+		}
+
+		// The shader's falloff, at the nearest point of the sphere
+		XMVECTOR gap = XMVectorMax(XMVectorSubtract(XMVectorSqrt(lengthSq), radius), zero);
+		XMVECTOR falloff = XMVectorMax(XMVectorNegativeMultiplySubtract(gap, LoadLanes(inverseRange, i), one), zero);
+		XMVECTOR score = XMVectorMultiply(LoadLanes(intensity, i), XMVectorMultiply(falloff, falloff));
+
+		// Spots score nothing past the side of their cone, or behind their tip
+		XMVECTOR along = XMVectorMultiply(toX, LoadLanes(dirX, i));
+		along = XMVectorMultiplyAdd(toY, LoadLanes(dirY, i), along);
+		along = XMVectorMultiplyAdd(toZ, LoadLanes(dirZ, i), along);
+		XMVECTOR across = XMVectorSqrt(XMVectorMax(XMVectorNegativeMultiplySubtract(along, along, lengthSq), zero));
+		XMVECTOR coneDistance = XMVectorNegativeMultiplySubtract(along, LoadLanes(sinAngle, i), XMVectorMultiply(across, LoadLanes(cosAngle, i)));
+		XMVECTOR outsideCone = XMVectorOrInt(XMVectorGreater(coneDistance, radius), XMVectorLess(along, XMVectorNegate(radius)));
+		score = XMVectorSelect(score, zero, outsideCone);
+
+		XMVECTOR candidate = XMVectorAndInt(XMVectorGreaterOrEqual(score, threshold), XMVectorGreater(score, zero));
+		uint32_t candidates[4];
+		XMStoreInt4(candidates, candidate);
+		if (!(candidates[0] | candidates[1] | candidates[2] | candidates[3])) {
+			continue;
+		}
+
+		XMFLOAT4 laneScores;
+		XMStoreFloat4(&laneScores, score);
+		const float* lanes = &laneScores.x;
+		for (unsigned int lane = 0; lane < 4; lane++) {
+			if (candidates[lane]) {
+				InsertLight(selection, scores, lanes[lane], index[i + lane]);
+			}
+		}
+
+		if (selection.Count == MaxObjectLights) {
+			threshold = XMVectorReplicate(scores[MaxObjectLights - 1]);
+		}
+	}
+}
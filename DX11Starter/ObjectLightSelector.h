@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Lights.h"
+#include "ThreadPool.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// Lights per object; PixelShader.hlsl has the same number
+static const unsigned int MaxObjectLights = 4;
+
+// --------------------------------------------------------
+// The local lights picked for one object, most influential
+// first
+// --------------------------------------------------------
+struct ObjectLightSet
+{
+	unsigned int Count;
+	unsigned int Indices[MaxObjectLights];
+};
+
+// --------------------------------------------------------
+// Picks the few point and spot lights that matter most to
+// each object, for shading paths that can't afford to look
+// lights up per pixel.
+//
+// A light's score is its brightness, attenuated as the
+// shader would at the point of the object's bounding sphere
+// nearest to it. Lights that can't reach the sphere, or
+// whose cone misses it, score nothing and are never picked.
+// Equal scores go to the lower light index.
+//
+// Lights are sorted along the axis they're most spread out
+// on, so each object only scores the ones whose position on
+// that axis is within reach, four at a time, and skips
+// groups of four that are all out of reach. Objects are
+// split into chunks across the thread pool.
+// --------------------------------------------------------
+class ObjectLightSelector
+{
+public:
+	ObjectLightSelector(ThreadPool* threadPool);
+	~ObjectLightSelector();
+
+	// Bounds are world space spheres, the radius in w
+	void Select(const Light* lights, unsigned int lightCount, const DirectX::XMFLOAT4* bounds, unsigned int objectCount);
+
+	// One set per object, in the order they were given
+	const std::vector<ObjectLightSet>& GetSelections() { return selections; }
+
+	float GetSelectSeconds() { return selectSeconds; }
+
+private:
+	ThreadPool* threadPool;
+
+	// Lights in SoA form, sorted along one axis and padded to a
+	// multiple of four with lights that score nothing
+	std::vector<float> x, y, z, range, inverseRange, intensity;
+	std::vector<float> dirX, dirY, dirZ, cosAngle, sinAngle;
+	std::vector<unsigned int> index;
+	std::vector<unsigned int> order;
+
+	// Light positions along the sorted axis, how many aren't
+	// padding, and the reach of the longest ranged light
+	std::vector<float> sortKeys;
+	unsigned int sortedCount;
+	unsigned int sortAxis;
+	float maxRange;
+
+	std::vector<ObjectLightSet> selections;
+	float selectSeconds;
+
+	void SortLights(const Light* lights, unsigned int lightCount);
+	void SelectObject(const DirectX::XMFLOAT4& bounds, ObjectLightSet& selection);
+};
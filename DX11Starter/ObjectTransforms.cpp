@@ -0,0 +1,125 @@
+#include "ObjectTransforms.h"
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Below this the world counts as singular
+static const float MinDeterminant = 1e-12f;
+
+// Turns vectors holding one element of four matrices each
+// back into the four matrices, transposed: element (r, c)
+// of matrix e is lane e of elements[r][c]
+static void TransposeGroup(const XMVECTOR elements[4][4], XMMATRIX transposed[4])
+{
+	for (unsigned int c = 0; c < 4; c++) {
+		// Row c of each transposed matrix is column c of the original
+		XMMATRIX column = XMMatrixTranspose(XMMATRIX(elements[0][c], elements[1][c], elements[2][c], elements[3][c]));
+		for (unsigned int e = 0; e < 4; e++) {
+			transposed[e].r[c] = column.r[e];
+		}
+	}
+}
+
+static void ComputeGroup(const XMFLOAT4X4* worlds[4], const XMVECTOR viewProjection[4][4], ObjectConstants* transforms[4])
+{
+	// w[r][c] holds element (r, c) of all four worlds
+	XMVECTOR w[4][4];
+	XMMATRIX loaded[4];
+	for (unsigned int e = 0; e < 4; e++) {
+		loaded[e] = XMLoadFloat4x4(worlds[e]);
+	}
+	for (unsigned int r = 0; r < 4; r++) {
+		XMMATRIX row = XMMatrixTranspose(XMMATRIX(loaded[0].r[r], loaded[1].r[r], loaded[2].r[r], loaded[3].r[r]));
+		for (unsigned int c = 0; c < 4; c++) {
+			w[r][c] = row.r[c];
+		}
+	}
+
+	XMVECTOR wvp[4][4];
+	for (unsigned int r = 0; r < 4; r++) {
+		for (unsigned int c = 0; c < 4; c++) {
+			XMVECTOR sum = XMVectorMultiply(w[r][0], viewProjection[0][c]);
+			sum = XMVectorMultiplyAdd(w[r][1], viewProjection[1][c], sum);
+			sum = XMVectorMultiplyAdd(w[r][2], viewProjection[2][c], sum);
+			wvp[r][c] = XMVectorMultiplyAdd(w[r][3], viewProjection[3][c], sum);
+		}
+	}
+
+	// Cofactors of the upper 3x3
+	XMVECTOR normal[4][4];
+	for (unsigned int r = 0; r < 3; r++) {
+		unsigned int r1 = (r + 1) % 3;
+		unsigned int r2 = (r + 2) % 3;
+		for (unsigned int c = 0; c < 3; c++) {
+			unsigned int c1 = (c + 1) % 3;
+			unsigned int c2 = (c + 2) % 3;
+			normal[r][c] = XMVectorNegativeMultiplySubtract(w[r1][c2], w[r2][c1], XMVectorMultiply(w[r1][c1], w[r2][c2]));
+		}
+	}
+
+	XMVECTOR determinant = XMVectorMultiply(w[0][0], normal[0][0]);
+	determinant = XMVectorMultiplyAdd(w[0][1], normal[0][1], determinant);
+	determinant = XMVectorMultiplyAdd(w[0][2], normal[0][2], determinant);
+
+	XMVECTOR invertible = XMVectorGreater(XMVectorAbs(determinant), XMVectorReplicate(MinDeterminant));
+	XMVECTOR scale = XMVectorSelect(XMVectorSplatOne(), XMVectorReciprocal(determinant), invertible);
+
+	// The fourth row and column are dropped when packed
+	XMVECTOR zero = XMVectorZero();
+	for (unsigned int r = 0; r < 3; r++) {
+		for (unsigned int c = 0; c < 3; c++) {
+			normal[r][c] = XMVectorMultiply(normal[r][c], scale);
+		}
+		normal[r][3] = zero;
+		normal[3][r] = zero;
+	}
+	normal[3][3] = zero;
+
+	XMMATRIX wvpMatrices[4];
+	XMMATRIX normalMatrices[4];
+	TransposeGroup(wvp, wvpMatrices);
+	TransposeGroup(normal, normalMatrices);
+
+	// The normal matrices are already transposed, so their first
+	// three rows are the packed form
+	for (unsigned int e = 0; e < 4; e++) {
+		XMStoreFloat4x4(&transforms[e]->worldViewProj, wvpMatrices[e]);
+		StoreAffineMatrix(&transforms[e]->objectToWorld, loaded[e]);
+		for (unsigned int r = 0; r < 3; r++) {
+			XMStoreFloat4(&transforms[e]->normalMatrix.r[r], normalMatrices[e].r[r]);
+		}
+	}
+}
+
+void ComputeObjectTransforms(const XMFLOAT4X4* worlds, unsigned int count, FXMMATRIX viewProjection, ObjectConstants* transforms)
+{
+	// Every element of the view-projection, in every lane
+	XMFLOAT4X4 viewProjectionElements;
+	XMStoreFloat4x4(&viewProjectionElements, viewProjection);
+
+	XMVECTOR vp[4][4];
+	for (unsigned int r = 0; r < 4; r++) {
+		for (unsigned int c = 0; c < 4; c++) {
+			vp[r][c] = XMVectorReplicate(viewProjectionElements.m[r][c]);
+		}
+	}
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	ObjectConstants discarded;
+
+	for (unsigned int first = 0; first < count; first += 4) {
+		const XMFLOAT4X4* groupWorlds[4];
+		ObjectConstants* groupTransforms[4];
+
+		// Lanes past the end work on an identity and write nowhere useful
+		for (unsigned int e = 0; e < 4; e++) {
+			bool inRange = first + e < count;
+			groupWorlds[e] = inRange ? &worlds[first + e] : &identity;
+			groupTransforms[e] = inRange ? &transforms[first + e] : &discarded;
+		}
+
+		ComputeGroup(groupWorlds, vp, groupTransforms);
+	}
+}
+
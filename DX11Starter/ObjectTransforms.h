@@ -0,0 +1,24 @@
+#pragma once
+
+#include "ShaderConstants.h"
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// Fills in each object's combined world-view-projection and
+// normal matrices from its world matrix, plus the world
+// matrix itself, all transposed for HLSL. The normal and
+// world matrices are packed without their unused fourth
+// column.
+//
+// Objects are done four at a time, each matrix element held
+// in one vector across all four, so the 3x3 inverse needs
+// no shuffling or branching. A remainder is padded out to a
+// full group.
+//
+// The normal matrix is the cofactor matrix of the world's
+// upper 3x3 over its determinant. A singular world (scaled
+// to nothing along an axis) keeps the cofactors unscaled,
+// which still point normals the right way once normalized.
+// --------------------------------------------------------
+void ComputeObjectTransforms(const DirectX::XMFLOAT4X4* worlds, unsigned int count, DirectX::FXMMATRIX viewProjection, ObjectConstants* transforms);
+
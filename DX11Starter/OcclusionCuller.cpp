@@ -0,0 +1,422 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Anything closer than this (in clip space w) is treated as
+// crossing the near plane
+static const float NearW = 1e-3f;
+
+// Skip triangles that cover (almost) no area
+static const float MinTriangleArea = 1e-6f;
+
+// --------------------------------------------------------
+// Whether the CPU has AVX2 and the OS saves the AVX
+// registers on a context switch
+// --------------------------------------------------------
+static bool HasAvx2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+
+	// OSXSAVE and AVX, then the OS enabling the XMM and YMM state
+	__cpuid(info, 1);
+	const int osxsaveAndAvx = (1 << 27) | (1 << 28);
+	if ((info[2] & osxsaveAndAvx) != osxsaveAndAvx || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	return false;
+#endif
+}
+
+OcclusionCuller::OcclusionCuller(ThreadPool* threadPool)
+{
+	this->threadPool = threadPool;
+	useAvx2 = HasAvx2();
+
+	depth.resize(BufferWidth * BufferHeight, 1.0f);
+	tileMaxDepth.resize(TilesX * TilesY, 1.0f);
+
+	maxOccluders = 16;
+	maxOccluderTriangles = 4096;
+	minOccluderSize = 0.1f;
+
+	occluderTriangleCount = 0;
+	frustumCulledCount = 0;
+	occlusionCulledCount = 0;
+
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+}
+
+void OcclusionCuller::Cull(CXMMATRIX view, CXMMATRIX projection, const BoundingBox* bounds,
+	const XMFLOAT4X4* worlds, const OccluderMesh* meshes, unsigned int count, std::vector<unsigned int>& visible)
+{
+	visible.clear();
+	candidates.clear();
+	frustumCulledCount = 0;
+	occlusionCulledCount = 0;
+
+	XMMATRIX inverseView = XMMatrixInverse(nullptr, view);
+
+	XMFLOAT4X4 vp;
+	XMStoreFloat4x4(&vp, XMMatrixMultiply(view, projection));
+	BeginFrame(vp);
+
+	BoundingFrustum viewFrustum(projection);
+	BoundingFrustum frustum;
+	viewFrustum.Transform(frustum, inverseView);
+	XMVECTOR cameraPosition = inverseView.r[3];
+
+	// Frustum cull and rate everything that's left as a potential occluder
+	for (unsigned int i = 0; i < count; i++) {
+		Candidate candidate;
+		candidate.index = i;
+		candidate.bounds = bounds[i];
+		candidate.occluder = false;
+
+		if (!frustum.Intersects(candidate.bounds)) {
+			frustumCulledCount++;
+			continue;
+		}
+
+		// Rough angular size: bounding radius over distance
+		float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&candidate.bounds.Extents)));
+		float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&candidate.bounds.Center) - cameraPosition));
+		candidate.screenSize = distance > radius ? radius / distance : FLT_MAX;
+
+		candidates.push_back(candidate);
+	}
+
+	SelectOccluders(worlds, meshes);
+	RasterizeOccluders();
+
+	// Test everything that isn't an occluder itself, in batches
+	const unsigned int batchSize = 64;
+	unsigned int batchCount = (unsigned int)(candidates.size() + batchSize - 1) / batchSize;
+	visibility.assign(candidates.size(), 1);
+	threadPool->ParallelFor(batchCount, [&](unsigned int batch) {
+		unsigned int end = std::min((batch + 1) * batchSize, (unsigned int)candidates.size());
+		for (unsigned int i = batch * batchSize; i < end; i++) {
+			if (!candidates[i].occluder) {
+				visibility[i] = IsVisible(candidates[i].bounds) ? 1 : 0;
+			}
+		}
+	});
+
+	// Compact in the original order so draw order stays stable
+	for (unsigned int i = 0; i < candidates.size(); i++) {
+		if (visibility[i]) {
+			visible.push_back(candidates[i].index);
+		}
+		else {
+			occlusionCulledCount++;
+		}
+	}
+}
+
+void OcclusionCuller::BeginFrame(XMFLOAT4X4 viewProjection)
+{
+	this->viewProjection = viewProjection;
+	occluders.clear();
+	occluderTriangleCount = 0;
+}
+
+void OcclusionCuller::AddOccluder(const OccluderMesh& mesh, XMFLOAT4X4 world)
+{
+	if (mesh.indexCount == 0) {
+		return;
+	}
+
+	Occluder occluder;
+	occluder.mesh = mesh;
+	occluder.world = world;
+	occluders.push_back(occluder);
+}
+
+// --------------------------------------------------------
+// Picks the candidates with the largest angular size (and a
+// small enough triangle count) as occluders
+// --------------------------------------------------------
+void OcclusionCuller::SelectOccluders(const XMFLOAT4X4* worlds, const OccluderMesh* meshes)
+{
+	occluderOrder.clear();
+	for (unsigned int i = 0; i < candidates.size(); i++) {
+		const OccluderMesh& mesh = meshes[candidates[i].index];
+		if (candidates[i].screenSize >= minOccluderSize
+			&& mesh.indexCount > 0
+			&& mesh.indexCount / 3 <= maxOccluderTriangles) {
+			occluderOrder.push_back(i);
+		}
+	}
+
+	unsigned int count = std::min(maxOccluders, (unsigned int)occluderOrder.size());
+	std::partial_sort(occluderOrder.begin(), occluderOrder.begin() + count, occluderOrder.end(),
+		[&](unsigned int a, unsigned int b) { return candidates[a].screenSize > candidates[b].screenSize; });
+
+	for (unsigned int i = 0; i < count; i++) {
+		Candidate& candidate = candidates[occluderOrder[i]];
+		candidate.occluder = true;
+		AddOccluder(meshes[candidate.index], worlds[candidate.index]);
+	}
+}
+
+// --------------------------------------------------------
+// Transforms an occluder's triangles to screen space and
+// sets up their edge functions. Triangles that cross the
+// near plane are dropped, which only makes culling less
+// aggressive, never wrong.
+// --------------------------------------------------------
+void OcclusionCuller::SetupOccluder(Occluder& occluder)
+{
+	const OccluderMesh& mesh = occluder.mesh;
+	const unsigned int* indices = mesh.indices;
+
+	XMMATRIX worldViewProjection = XMMatrixMultiply(XMLoadFloat4x4(&occluder.world), XMLoadFloat4x4(&viewProjection));
+
+	// Project every vertex once; w <= 0 marks vertices behind the near plane
+	std::vector<XMFLOAT4> screen(mesh.vertexCount);
+	for (unsigned int v = 0; v < mesh.vertexCount; v++) {
+		const XMFLOAT3* position = (const XMFLOAT3*)((const char*)mesh.positions + (size_t)v * mesh.positionStride);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(position), worldViewProjection));
+		if (clip.w < NearW || clip.z < 0) {
+			screen[v] = XMFLOAT4(0, 0, 0, 0);
+			continue;
+		}
+
+		float invW = 1.0f / clip.w;
+		screen[v] = XMFLOAT4(
+			(clip.x * invW * 0.5f + 0.5f) * BufferWidth,
+			(0.5f - clip.y * invW * 0.5f) * BufferHeight,
+			clip.z * invW,
+			1.0f);
+	}
+
+	occluder.triangles.clear();
+	for (unsigned int i = 0; i + 2 < mesh.indexCount; i += 3) {
+		const XMFLOAT4* a = &screen[indices[i]];
+		const XMFLOAT4* b = &screen[indices[i + 1]];
+		const XMFLOAT4* c = &screen[indices[i + 2]];
+		if (a->w == 0 || b->w == 0 || c->w == 0) {
+			continue;
+		}
+
+		// Both windings get rasterized; flip to keep the area positive
+		float area = (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+		if (area < 0) {
+			std::swap(b, c);
+			area = -area;
+		}
+		if (area < MinTriangleArea) {
+			continue;
+		}
+
+		OcclusionTriangle tri;
+		tri.minX = std::max(0, (int)floorf(std::min(a->x, std::min(b->x, c->x))));
+		tri.maxX = std::min(BufferWidth - 1, (int)floorf(std::max(a->x, std::max(b->x, c->x))));
+		tri.minY = std::max(0, (int)floorf(std::min(a->y, std::min(b->y, c->y))));
+		tri.maxY = std::min(BufferHeight - 1, (int)floorf(std::max(a->y, std::max(b->y, c->y))));
+		if (tri.minX > tri.maxX || tri.minY > tri.maxY) {
+			continue;
+		}
+
+		// Edge i is opposite vertex i, so it doubles as that vertex's barycentric weight
+		const XMFLOAT4* from[3] = { b, c, a };
+		const XMFLOAT4* to[3] = { c, a, b };
+		for (int e = 0; e < 3; e++) {
+			tri.edgeA[e] = from[e]->y - to[e]->y;
+			tri.edgeB[e] = to[e]->x - from[e]->x;
+			tri.edgeC[e] = -tri.edgeA[e] * from[e]->x - tri.edgeB[e] * from[e]->y;
+		}
+
+		float invArea = 1.0f / area;
+		tri.depthA = (tri.edgeA[0] * a->z + tri.edgeA[1] * b->z + tri.edgeA[2] * c->z) * invArea;
+		tri.depthB = (tri.edgeB[0] * a->z + tri.edgeB[1] * b->z + tri.edgeB[2] * c->z) * invArea;
+		tri.depthC = (tri.edgeC[0] * a->z + tri.edgeC[1] * b->z + tri.edgeC[2] * c->z) * invArea;
+
+		occluder.triangles.push_back(tri);
+	}
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+	threadPool->ParallelFor((unsigned int)occluders.size(), [&](unsigned int i) {
+		SetupOccluder(occluders[i]);
+	});
+
+	occluderTriangleCount = 0;
+	for (unsigned int i = 0; i < occluders.size(); i++) {
+		occluderTriangleCount += (unsigned int)occluders[i].triangles.size();
+	}
+
+	// Each tile row is owned by exactly one job, so no locking is needed
+	threadPool->ParallelFor(TilesY, [&](unsigned int tileRow) {
+		RasterizeTileRow(tileRow);
+	});
+}
+
+void OcclusionCuller::RasterizeTileRow(int tileRow)
+{
+	int firstRow = tileRow * TileSize;
+	int lastRow = firstRow + TileSize - 1;
+
+	std::fill(depth.begin() + firstRow * BufferWidth, depth.begin() + (lastRow + 1) * BufferWidth, 1.0f);
+
+	for (unsigned int o = 0; o < occluders.size(); o++) {
+		const std::vector<OcclusionTriangle>& triangles = occluders[o].triangles;
+		for (unsigned int t = 0; t < triangles.size(); t++) {
+			const OcclusionTriangle& tri = triangles[t];
+			if (tri.maxY < firstRow || tri.minY > lastRow) {
+				continue;
+			}
+			RasterizeTriangleRows(tri, std::max(firstRow, tri.minY), std::min(lastRow, tri.maxY));
+		}
+	}
+
+	// Build the coarse level: the farthest occluder depth in each tile
+	for (int tx = 0; tx < TilesX; tx++) {
+		const float* tile = &depth[firstRow * BufferWidth + tx * TileSize];
+		if (useAvx2) {
+			tileMaxDepth[tileRow * TilesX + tx] = GetTileMaxDepthAvx2(tile, BufferWidth, TileSize);
+			continue;
+		}
+
+		float tileMax = 0;
+		for (int y = 0; y < TileSize; y++) {
+			for (int x = 0; x < TileSize; x++) {
+				tileMax = std::max(tileMax, tile[y * BufferWidth + x]);
+			}
+		}
+		tileMaxDepth[tileRow * TilesX + tx] = tileMax;
+	}
+}
+
+// --------------------------------------------------------
+// Rasterizes rows [firstRow, lastRow] of a triangle, keeping
+// the nearest depth. Pixels are sampled at their centers.
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeTriangleRows(const OcclusionTriangle& tri, int firstRow, int lastRow)
+{
+	if (useAvx2) {
+		RasterizeTriangleRowsAvx2(tri, &depth[0], BufferWidth, firstRow, lastRow);
+		return;
+	}
+
+	for (int y = firstRow; y <= lastRow; y++) {
+		float py = y + 0.5f;
+		float* row = &depth[y * BufferWidth];
+		for (int x = tri.minX; x <= tri.maxX; x++) {
+			float px = x + 0.5f;
+			float e0 = tri.edgeA[0] * px + tri.edgeB[0] * py + tri.edgeC[0];
+			float e1 = tri.edgeA[1] * px + tri.edgeB[1] * py + tri.edgeC[1];
+			float e2 = tri.edgeA[2] * px + tri.edgeB[2] * py + tri.edgeC[2];
+			if (e0 < 0 || e1 < 0 || e2 < 0) {
+				continue;
+			}
+
+			float z = tri.depthA * px + tri.depthB * py + tri.depthC;
+			row[x] = std::min(row[x], z);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Tests world space bounds against the rasterized occluders.
+// Anything touching the near plane is reported visible.
+// --------------------------------------------------------
+bool OcclusionCuller::IsVisible(const BoundingBox& worldBounds)
+{
+	XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+	worldBounds.GetCorners(corners);
+
+	XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+	float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+	for (int i = 0; i < BoundingBox::CORNER_COUNT; i++) {
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&corners[i]), vp));
+		if (clip.w < NearW || clip.z < 0) {
+			return true;
+		}
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * BufferWidth;
+		float y = (0.5f - clip.y * invW * 0.5f) * BufferHeight;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip.z * invW);
+	}
+
+	int rectMinX = std::max(0, (int)floorf(minX));
+	int rectMaxX = std::min(BufferWidth - 1, (int)floorf(maxX));
+	int rectMinY = std::max(0, (int)floorf(minY));
+	int rectMaxY = std::min(BufferHeight - 1, (int)floorf(maxY));
+	if (rectMinX > rectMaxX || rectMinY > rectMaxY) {
+		return false;
+	}
+
+	return TestRect(rectMinX, rectMaxX, rectMinY, rectMaxY, minZ);
+}
+
+// --------------------------------------------------------
+// True if any pixel in the rect is farther away than the
+// given depth, i.e. not covered by an occluder
+// --------------------------------------------------------
+bool OcclusionCuller::TestRect(int minX, int maxX, int minY, int maxY, float nearestDepth)
+{
+	for (int ty = minY / TileSize; ty <= maxY / TileSize; ty++) {
+		for (int tx = minX / TileSize; tx <= maxX / TileSize; tx++) {
+			// The whole tile is in front of the object
+			if (tileMaxDepth[ty * TilesX + tx] < nearestDepth) {
+				continue;
+			}
+
+			int x0 = std::max(minX, tx * TileSize);
+			int x1 = std::min(maxX, tx * TileSize + TileSize - 1);
+			int y0 = std::max(minY, ty * TileSize);
+			int y1 = std::min(maxY, ty * TileSize + TileSize - 1);
+
+			if (useAvx2) {
+				// Tiles are 8 wide and aligned, so one tile row is one vector
+				int laneMask = ((1 << (x1 - x0 + 1)) - 1) << (x0 - tx * TileSize);
+				if (IsTileFartherAvx2(&depth[y0 * BufferWidth + tx * TileSize], BufferWidth, y1 - y0 + 1, laneMask, nearestDepth)) {
+					return true;
+				}
+				continue;
+			}
+
+			for (int y = y0; y <= y1; y++) {
+				for (int x = x0; x <= x1; x++) {
+					if (depth[y * BufferWidth + x] >= nearestDepth) {
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	return false;
+}
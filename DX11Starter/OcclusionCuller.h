@@ -0,0 +1,121 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include "OcclusionCullerAvx2.h"
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+
+// --------------------------------------------------------
+// An occluder's triangles. Positions are positionStride bytes
+// apart, so they can point straight into a vertex array.
+// --------------------------------------------------------
+struct OccluderMesh
+{
+	const DirectX::XMFLOAT3* positions;
+	unsigned int positionStride;
+	unsigned int vertexCount;
+	const unsigned int* indices;
+	unsigned int indexCount;
+};
+
+// --------------------------------------------------------
+// CPU software occlusion culler
+//
+// Objects are first culled against the camera frustum.
+// The largest survivors on screen are picked as occluders
+// and their triangles are rasterized into a small depth
+// buffer (nearest depth wins). Every other object's bounds
+// are then tested against the per-tile max depth, and only
+// against individual pixels where a tile is inconclusive.
+//
+// Rasterization is split into horizontal tile rows so each
+// worker thread owns its own slice of the buffer. The inner
+// loops run 8 pixels at a time on CPUs with AVX2, checked
+// once at startup, and one at a time everywhere else.
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	static const int BufferWidth = 256;
+	static const int BufferHeight = 128;
+	static const int TileSize = 8;
+	static const int TilesX = BufferWidth / TileSize;
+	static const int TilesY = BufferHeight / TileSize;
+
+	OcclusionCuller(ThreadPool* threadPool);
+	~OcclusionCuller();
+
+	// Writes the indices of the objects that survive frustum and occlusion
+	// culling into visible, in increasing order. bounds, worlds and meshes
+	// hold count objects each; a mesh with no indices never occludes.
+	// view and projection are the camera's, not transposed.
+	void Cull(DirectX::CXMMATRIX view, DirectX::CXMMATRIX projection, const DirectX::BoundingBox* bounds,
+		const DirectX::XMFLOAT4X4* worlds, const OccluderMesh* meshes, unsigned int count, std::vector<unsigned int>& visible);
+
+	// Lower level steps, used by Cull() but also usable on their own
+	void BeginFrame(DirectX::XMFLOAT4X4 viewProjection);
+	void AddOccluder(const OccluderMesh& mesh, DirectX::XMFLOAT4X4 world);
+	void RasterizeOccluders();
+	bool IsVisible(const DirectX::BoundingBox& worldBounds);
+
+	// Tuning
+	void SetMaxOccluders(unsigned int count) { maxOccluders = count; }
+	void SetMaxOccluderTriangles(unsigned int count) { maxOccluderTriangles = count; }
+	void SetMinOccluderSize(float size) { minOccluderSize = size; }
+
+	// Statistics for the last frame
+	unsigned int GetOccluderCount() { return (unsigned int)occluders.size(); }
+	unsigned int GetOccluderTriangleCount() { return occluderTriangleCount; }
+	unsigned int GetFrustumCulledCount() { return frustumCulledCount; }
+	unsigned int GetOcclusionCulledCount() { return occlusionCulledCount; }
+
+	// Depth buffer (BufferWidth x BufferHeight, row major), for debugging
+	const float* GetDepthBuffer() { return &depth[0]; }
+
+	// Whether the AVX2 loops are in use on this CPU
+	bool IsUsingAvx2() { return useAvx2; }
+
+private:
+	struct Occluder
+	{
+		OccluderMesh mesh;
+		DirectX::XMFLOAT4X4 world;
+		std::vector<OcclusionTriangle> triangles;
+	};
+
+	struct Candidate
+	{
+		unsigned int index;
+		DirectX::BoundingBox bounds;
+		float screenSize;
+		bool occluder;
+	};
+
+	ThreadPool* threadPool;
+	bool useAvx2;
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	std::vector<float> depth;
+	std::vector<float> tileMaxDepth;
+
+	std::vector<Occluder> occluders;
+	std::vector<Candidate> candidates;
+	std::vector<unsigned int> occluderOrder;
+	std::vector<unsigned char> visibility;
+
+	unsigned int maxOccluders;
+	unsigned int maxOccluderTriangles;
+	float minOccluderSize;
+
+	unsigned int occluderTriangleCount;
+	unsigned int frustumCulledCount;
+	unsigned int occlusionCulledCount;
+
+	void SelectOccluders(const DirectX::XMFLOAT4X4* worlds, const OccluderMesh* meshes);
+	void SetupOccluder(Occluder& occluder);
+	void RasterizeTileRow(int tileRow);
+	void RasterizeTriangleRows(const OcclusionTriangle& tri, int firstRow, int lastRow);
+	bool TestRect(int minX, int maxX, int minY, int maxY, float nearestDepth);
+};
+
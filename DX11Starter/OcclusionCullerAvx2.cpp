@@ -0,0 +1,68 @@
+#include "OcclusionCullerAvx2.h"
+#include <immintrin.h>
+
+float GetTileMaxDepthAvx2(const float* tile, int rowPitch, int rows)
+{
+	__m256 tileMax = _mm256_loadu_ps(tile);
+	for (int y = 1; y < rows; y++) {
+		tileMax = _mm256_max_ps(tileMax, _mm256_loadu_ps(tile + y * rowPitch));
+	}
+	__m128 halfMax = _mm_max_ps(_mm256_castps256_ps128(tileMax), _mm256_extractf128_ps(tileMax, 1));
+	halfMax = _mm_max_ps(halfMax, _mm_movehl_ps(halfMax, halfMax));
+	halfMax = _mm_max_ss(halfMax, _mm_shuffle_ps(halfMax, halfMax, 1));
+	return _mm_cvtss_f32(halfMax);
+}
+
+// --------------------------------------------------------
+// Eight pixels at a time, starting from the 8 aligned block
+// holding the triangle's left edge. Pixels are sampled at
+// their centers.
+// --------------------------------------------------------
+void RasterizeTriangleRowsAvx2(const OcclusionTriangle& tri, float* depth, int rowPitch, int firstRow, int lastRow)
+{
+	const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 a0 = _mm256_set1_ps(tri.edgeA[0]);
+	const __m256 a1 = _mm256_set1_ps(tri.edgeA[1]);
+	const __m256 a2 = _mm256_set1_ps(tri.edgeA[2]);
+	const __m256 depthA = _mm256_set1_ps(tri.depthA);
+
+	int startX = tri.minX & ~7;
+	for (int y = firstRow; y <= lastRow; y++) {
+		float py = y + 0.5f;
+		__m256 rowE0 = _mm256_set1_ps(tri.edgeB[0] * py + tri.edgeC[0]);
+		__m256 rowE1 = _mm256_set1_ps(tri.edgeB[1] * py + tri.edgeC[1]);
+		__m256 rowE2 = _mm256_set1_ps(tri.edgeB[2] * py + tri.edgeC[2]);
+		__m256 rowDepth = _mm256_set1_ps(tri.depthB * py + tri.depthC);
+		float* row = depth + y * rowPitch;
+
+		for (int x = startX; x <= tri.maxX; x += 8) {
+			__m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+			__m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, px), rowE0);
+			__m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, px), rowE1);
+			__m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, px), rowE2);
+			__m256 inside = _mm256_and_ps(
+				_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+				_mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+			if (_mm256_movemask_ps(inside) == 0) {
+				continue;
+			}
+
+			__m256 z = _mm256_add_ps(_mm256_mul_ps(depthA, px), rowDepth);
+			__m256 current = _mm256_loadu_ps(row + x);
+			_mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+		}
+	}
+}
+
+bool IsTileFartherAvx2(const float* tile, int rowPitch, int rows, int laneMask, float nearestDepth)
+{
+	__m256 nearest = _mm256_set1_ps(nearestDepth);
+	for (int y = 0; y < rows; y++) {
+		__m256 row = _mm256_loadu_ps(tile + y * rowPitch);
+		if (_mm256_movemask_ps(_mm256_cmp_ps(row, nearest, _CMP_GE_OQ)) & laneMask) {
+			return true;
+		}
+	}
+	return false;
+}
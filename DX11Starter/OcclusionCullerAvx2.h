@@ -0,0 +1,38 @@
+#pragma once
+
+// --------------------------------------------------------
+// A triangle set up for rasterization: three edge functions and
+// a depth plane, all linear in screen x/y
+// --------------------------------------------------------
+struct OcclusionTriangle
+{
+	float edgeA[3];
+	float edgeB[3];
+	float edgeC[3];
+	float depthA;
+	float depthB;
+	float depthC;
+	int minX, maxX;
+	int minY, maxY;
+};
+
+// --------------------------------------------------------
+// OcclusionCuller's AVX2 loops, in a file of their own so
+// only it is built for AVX2 and the rest of the program
+// runs on any x64 CPU. This header stays free of anything
+// with inline code, which the linker could otherwise pick
+// up from the AVX2 build.
+//
+// Only call these once the CPU is known to support AVX2.
+// Rows are rowPitch floats apart; tiles are 8 floats wide.
+// --------------------------------------------------------
+
+// Farthest depth in an 8 wide tile
+float GetTileMaxDepthAvx2(const float* tile, int rowPitch, int rows);
+
+// Rasterizes rows [firstRow, lastRow] of the triangle, keeping the nearest depth
+void RasterizeTriangleRowsAvx2(const OcclusionTriangle& tri, float* depth, int rowPitch, int firstRow, int lastRow);
+
+// True if a lane in laneMask of any of the tile's rows is at
+// or past nearestDepth
+bool IsTileFartherAvx2(const float* tile, int rowPitch, int rows, int laneMask, float nearestDepth);
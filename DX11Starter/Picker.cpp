@@ -0,0 +1,203 @@
+#include "Picker.h"
+#include "MeshBVH.h"
+#include <algorithm>
+#include <cfloat>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Entities per leaf of the scene BVH
+static const unsigned int MaxLeafItems = 2;
+
+// Traversal stack kept on the call stack; deeper trees use the heap
+static const unsigned int TraversalStackSize = 64;
+
+Picker::Picker()
+{
+	depth = 0;
+	lastTestedCount = 0;
+}
+
+Picker::~Picker()
+{
+}
+
+void Picker::Build(const std::vector<Entity*>& entities)
+{
+	nodes.clear();
+	depth = 0;
+	items.resize(entities.size());
+
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		BoundingBox bounds = entities[i]->GetWorldBounds();
+		Item& item = items[i];
+		item.entity = entities[i];
+		item.centroid = bounds.Center;
+		item.boundsMin = XMFLOAT3(bounds.Center.x - bounds.Extents.x, bounds.Center.y - bounds.Extents.y, bounds.Center.z - bounds.Extents.z);
+		item.boundsMax = XMFLOAT3(bounds.Center.x + bounds.Extents.x, bounds.Center.y + bounds.Extents.y, bounds.Center.z + bounds.Extents.z);
+	}
+
+	if (items.empty()) {
+		return;
+	}
+
+	nodes.reserve(2 * items.size());
+	nodes.push_back(Node());
+	Subdivide(0, 0, 0, (unsigned int)items.size());
+}
+
+// --------------------------------------------------------
+// Median split along the widest axis of the centroids. The
+// scene is rebuilt often, so build speed beats tree quality.
+// --------------------------------------------------------
+void Picker::Subdivide(unsigned int nodeIndex, unsigned int nodeDepth, unsigned int first, unsigned int count)
+{
+	depth = std::max(depth, nodeDepth);
+
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX), boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	XMFLOAT3 centroidMin = boundsMin, centroidMax = boundsMax;
+	for (unsigned int i = first; i < first + count; i++) {
+		XMStoreFloat3(&boundsMin, XMVectorMin(XMLoadFloat3(&boundsMin), XMLoadFloat3(&items[i].boundsMin)));
+		XMStoreFloat3(&boundsMax, XMVectorMax(XMLoadFloat3(&boundsMax), XMLoadFloat3(&items[i].boundsMax)));
+		XMStoreFloat3(&centroidMin, XMVectorMin(XMLoadFloat3(&centroidMin), XMLoadFloat3(&items[i].centroid)));
+		XMStoreFloat3(&centroidMax, XMVectorMax(XMLoadFloat3(&centroidMax), XMLoadFloat3(&items[i].centroid)));
+	}
+	nodes[nodeIndex].boundsMin = boundsMin;
+	nodes[nodeIndex].boundsMax = boundsMax;
+
+	if (count <= MaxLeafItems) {
+		nodes[nodeIndex].leftOrFirst = first;
+		nodes[nodeIndex].count = count;
+		return;
+	}
+
+	XMFLOAT3 extent(centroidMax.x - centroidMin.x, centroidMax.y - centroidMin.y, centroidMax.z - centroidMin.z);
+	int axis = 0;
+	if (extent.y > extent.x) axis = 1;
+	if (extent.z > (axis == 0 ? extent.x : extent.y)) axis = 2;
+
+	unsigned int half = count / 2;
+	std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+		[axis](const Item& a, const Item& b) {
+			return axis == 0 ? a.centroid.x < b.centroid.x : (axis == 1 ? a.centroid.y < b.centroid.y : a.centroid.z < b.centroid.z);
+		});
+
+	unsigned int leftIndex = (unsigned int)nodes.size();
+	nodes.push_back(Node());
+	nodes.push_back(Node());
+	nodes[nodeIndex].leftOrFirst = leftIndex;
+	nodes[nodeIndex].count = 0;
+
+	Subdivide(leftIndex, nodeDepth + 1, first, half);
+	Subdivide(leftIndex + 1, nodeDepth + 1, first + half, count - half);
+}
+
+bool Picker::Raycast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RaycastHit& hit)
+{
+	lastTestedCount = 0;
+	if (nodes.empty()) {
+		return false;
+	}
+
+	XMFLOAT3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float closest = maxDistance;
+	bool found = false;
+
+	// Holds at most one deferred sibling per level, plus the pair just pushed
+	unsigned int localStack[TraversalStackSize];
+	std::vector<unsigned int> heapStack;
+	unsigned int* stack = localStack;
+	if (depth + 1 > TraversalStackSize) {
+		heapStack.resize(depth + 1);
+		stack = &heapStack[0];
+	}
+
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+		if (MeshBVH::IntersectBounds(node.boundsMin, node.boundsMax, origin, inverseDirection, closest) == FLT_MAX) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (unsigned int i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+				if (IntersectItem(items[i], origin, direction, inverseDirection, closest, hit)) {
+					closest = hit.distance;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		// Nearer child goes on top of the stack
+		unsigned int nearIndex = node.leftOrFirst, farIndex = node.leftOrFirst + 1;
+		float nearDistance = MeshBVH::IntersectBounds(nodes[nearIndex].boundsMin, nodes[nearIndex].boundsMax, origin, inverseDirection, closest);
+		float farDistance = MeshBVH::IntersectBounds(nodes[farIndex].boundsMin, nodes[farIndex].boundsMax, origin, inverseDirection, closest);
+		if (farDistance < nearDistance) {
+			std::swap(nearDistance, farDistance);
+			std::swap(nearIndex, farIndex);
+		}
+
+		if (farDistance != FLT_MAX) stack[stackSize++] = farIndex;
+		if (nearDistance != FLT_MAX) stack[stackSize++] = nearIndex;
+	}
+
+	return found;
+}
+
+// --------------------------------------------------------
+// Exact test against one entity. The ray is moved into the
+// mesh's object space; since the direction isn't renormalized
+// there, hit distances stay in world units.
+// --------------------------------------------------------
+bool Picker::IntersectItem(const Item& item, XMFLOAT3 origin, XMFLOAT3 direction, XMFLOAT3 inverseDirection, float maxDistance, RaycastHit& hit)
+{
+	float boundsDistance = MeshBVH::IntersectBounds(item.boundsMin, item.boundsMax, origin, inverseDirection, maxDistance);
+	if (boundsDistance == FLT_MAX) {
+		return false;
+	}
+
+	Mesh* mesh = item.entity->GetMesh();
+	MeshBVH* bvh = mesh->GetBVH();
+
+	// Without CPU geometry the bounds are the best we can do
+	if (bvh == nullptr) {
+		hit.entity = item.entity;
+		hit.distance = boundsDistance;
+		hit.triangleIndex = (unsigned int)-1;
+		hit.barycentrics = XMFLOAT2(0, 0);
+		XMStoreFloat3(&hit.position, XMLoadFloat3(&origin) + XMLoadFloat3(&direction) * boundsDistance);
+		return true;
+	}
+
+	lastTestedCount++;
+
+	XMFLOAT4X4 world = item.entity->GetTransform()->GetMatrix();
+	XMMATRIX inverseWorld = XMMatrixInverse(nullptr, XMLoadFloat4x4(&world));
+	XMFLOAT3 localOrigin, localDirection;
+	XMStoreFloat3(&localOrigin, XMVector3TransformCoord(XMLoadFloat3(&origin), inverseWorld));
+	XMStoreFloat3(&localDirection, XMVector3TransformNormal(XMLoadFloat3(&direction), inverseWorld));
+
+	float distance;
+	unsigned int triangleIndex;
+	XMFLOAT2 barycentrics;
+	if (!bvh->Intersect(localOrigin, localDirection, maxDistance, distance, triangleIndex, barycentrics)) {
+		return false;
+	}
+
+	hit.entity = item.entity;
+	hit.distance = distance;
+	hit.triangleIndex = triangleIndex;
+	hit.barycentrics = barycentrics;
+	XMStoreFloat3(&hit.position, XMLoadFloat3(&origin) + XMLoadFloat3(&direction) * distance);
+	return true;
+}
+
+bool Picker::Pick(Camera* camera, int x, int y, int screenWidth, int screenHeight, RaycastHit& hit)
+{
+	XMFLOAT3 origin, direction;
+	camera->GetPickRay(x, y, screenWidth, screenHeight, origin, direction);
+	return Raycast(origin, direction, FLT_MAX, hit);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Entity.h"
+#include "Camera.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Result of a ray cast against the scene
+// --------------------------------------------------------
+struct RaycastHit
+{
+	Entity* entity;
+	float distance;
+	unsigned int triangleIndex;			// -1 if the mesh has no CPU geometry
+	DirectX::XMFLOAT3 position;			// World space hit point
+	DirectX::XMFLOAT2 barycentrics;		// Of the hit triangle's 2nd and 3rd vertices
+};
+
+// --------------------------------------------------------
+// Ray casts against entities.
+//
+// A BVH over entity world bounds narrows things down to a
+// few candidates, which are then tested exactly through
+// their mesh's triangle BVH in object space.
+// --------------------------------------------------------
+class Picker
+{
+public:
+	Picker();
+	~Picker();
+
+	// Rebuilds the index over the entities' current world bounds
+	void Build(const std::vector<Entity*>& entities);
+
+	// Finds the closest entity hit along a world space ray (direction normalized)
+	bool Raycast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RaycastHit& hit);
+
+	// Ray casts from the camera through a pixel
+	bool Pick(Camera* camera, int x, int y, int screenWidth, int screenHeight, RaycastHit& hit);
+
+	// Number of entities whose triangles were tested by the last ray cast
+	unsigned int GetLastTestedCount() { return lastTestedCount; }
+
+private:
+	// Same layout as the mesh BVH: leaves have count > 0
+	struct Node
+	{
+		DirectX::XMFLOAT3 boundsMin;
+		unsigned int leftOrFirst;
+		DirectX::XMFLOAT3 boundsMax;
+		unsigned int count;
+	};
+
+	struct Item
+	{
+		Entity* entity;
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+		DirectX::XMFLOAT3 centroid;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<Item> items;
+	unsigned int depth;
+	unsigned int lastTestedCount;
+
+	void Subdivide(unsigned int nodeIndex, unsigned int nodeDepth, unsigned int first, unsigned int count);
+	bool IntersectItem(const Item& item, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction,
+		DirectX::XMFLOAT3 inverseDirection, float maxDistance, RaycastHit& hit);
+};
+
@@ -1,6 +1,39 @@
+// Feature keywords, set by the variant files that include
+// this one (PixelShaderOneLight.hlsl and so on); compiled
+// on its own, this is the two light, textured shader
+// - LIGHT_COUNT: most directional lights evaluated, 1 or 2
+// - TEXTURED: 0 to skip sampling and use the color alone
+// - INSTANCED: 1 if the color arrives per instance from the
+//    vertex shader instead of from a constant
+// - CLUSTERED: 1 to add the point and spot lights binned
+//    into the cluster grid by LightClusters
+// - OBJECT_LIGHTS: 1 to add the few point and spot lights
+//    ObjectLightSelector picked for the object, a cheaper
+//    stand-in for CLUSTERED
+//
+// Every variant reads its lights from the one buffer
+// LightManager packs, so one set of constants suits all of
+// them. The local light ones add cbuffers (and buffers) of
+// their own.
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 2
+#endif
 
+#ifndef TEXTURED
+#define TEXTURED 1
+#endif
 
+#ifndef INSTANCED
+#define INSTANCED 0
+#endif
 
+#ifndef CLUSTERED
+#define CLUSTERED 0
+#endif
+
+#ifndef OBJECT_LIGHTS
+#define OBJECT_LIGHTS 0
+#endif
 
 // Struct representing the data we expect to receive from earlier pipeline stages
 // - Should match the output of our corresponding vertex shader
@@ -17,28 +50,99 @@ struct VertexToPixel
 	float4 position		: SV_POSITION;
 	float3 normal		: NORMAL;
 	float2 uv			: TEXCOORD;
+	float3 worldPosition	: POSITION;
+#if INSTANCED
+	float4 color		: COLOR;
+#endif
 };
 
-struct DirectionalLight
+// Must match Light in Lights.h; directional lights keep
+// their ambient color in position
+struct Light
 {
-	float4 ambientColor;
-	float4 diffuseColor;
+	float3 position;
+	float range;
+	float3 color;
+	float spotCosAngle;
 	float3 direction;
+	uint type;
 };
 
+#if TEXTURED
 Texture2D Texture : register(t0);
 SamplerState Sampler : register(s0);
-DirectionalLight light : register(b0);
-DirectionalLight light2 : register(b1);
-float4 Color: register(b2);
+#endif
+#if !INSTANCED
+float4 Color;
+#endif
 
-float4 getLightColor(DirectionalLight light, float3 normal) {
-	float3 lightDir = normalize(-light.direction);
-	float lightAmount = saturate(dot(lightDir, normal));
+// Point and spot lights, then directional ones
+StructuredBuffer<Light> Lights : register(t1);
 
-	return lightAmount * light.diffuseColor;
+cbuffer lightData : register(b1)
+{
+	uint directionalLightStart;
+	uint directionalLightCount;
+};
+
+float3 getLightColor(Light light, float3 normal) {
+	float lightAmount = saturate(dot(-light.direction, normal));
+
+	return lightAmount * light.color;
 }
 
+#if CLUSTERED || OBJECT_LIGHTS
+float3 getLocalLightColor(Light light, float3 position, float3 normal) {
+	float3 toLight = light.position - position;
+	float distance = length(toLight);
+	float3 lightDir = toLight / max(distance, 0.0001f);
+
+	// Fades out smoothly, reaching nothing at the light's range
+	float attenuation = saturate(1 - distance / light.range);
+	attenuation *= attenuation;
+
+	// Spots soften over the outer quarter of their cone
+	float spot = 1;
+	if (light.spotCosAngle > -1) {
+		float cosAngle = dot(-lightDir, light.direction);
+		spot = saturate((cosAngle - light.spotCosAngle) / ((1 - light.spotCosAngle) * 0.25f));
+	}
+
+	float lightAmount = saturate(dot(lightDir, normal));
+	return light.color * (lightAmount * attenuation * spot);
+}
+#endif
+
+#if CLUSTERED
+// Must match LightClusters.h
+#define CLUSTER_COUNT_X 16
+#define CLUSTER_COUNT_Y 9
+#define CLUSTER_COUNT_Z 24
+
+StructuredBuffer<uint2> LightClusters : register(t2);	// Offset and count into LightIndices
+StructuredBuffer<uint> LightIndices : register(t3);
+
+cbuffer clusterData : register(b2)
+{
+	float4 depthPlane;		// View space depth of a world position
+	float2 clusterScale;	// Clusters per pixel
+	float depthScale;		// Slice = log(depth) * depthScale + depthBias
+	float depthBias;
+};
+#endif
+
+#if OBJECT_LIGHTS
+// Must match MaxObjectLights in ObjectLightSelector.h
+#define OBJECT_LIGHT_COUNT 4
+
+// Indices into Lights, of which the first objectLightCount are used
+cbuffer objectLightData : register(b3)
+{
+	uint4 objectLightIndices;
+	uint objectLightCount;
+};
+#endif
+
 // --------------------------------------------------------
 // The entry point (main method) for our pixel shader
 // 
@@ -50,12 +154,51 @@ float4 getLightColor(DirectionalLight light, float3 normal) {
 // --------------------------------------------------------
 float4 main(VertexToPixel input) : SV_TARGET
 {
+#if INSTANCED
+	float4 color = input.color;
+#else
+	float4 color = Color;
+#endif
 
 	//Sample the texure and use material color
-	float4 textureColor = Texture.Sample(Sampler, input.uv) * Color;
+#if TEXTURED
+	float4 textureColor = Texture.Sample(Sampler, input.uv) * color;
+#else
+	float4 textureColor = color;
+#endif
+
+	float3 result = 0;
+	uint directionalCount = min(directionalLightCount, LIGHT_COUNT);
+	for (uint d = 0; d < directionalCount; d++) {
+		Light light = Lights[directionalLightStart + d];
+		result += (getLightColor(light, input.normal) + light.position) * textureColor.rgb;
+	}
+
+#if CLUSTERED
+	// The pixel's cluster, from its position on screen and depth
+	uint3 cluster;
+	cluster.xy = min(uint2(input.position.xy * clusterScale), uint2(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1));
+	float depth = dot(float4(input.worldPosition, 1), depthPlane);
+	cluster.z = (uint)clamp(log(depth) * depthScale + depthBias, 0, CLUSTER_COUNT_Z - 1);
 
-	return (getLightColor(light, input.normal) * textureColor) 
-		+ (getLightColor(light2, input.normal) * textureColor)
-		+ (light.ambientColor * textureColor)
-		+ (light2.ambientColor * textureColor);
-}
\ No newline at end of file
+	uint2 lights = LightClusters[cluster.x + (cluster.y + cluster.z * CLUSTER_COUNT_Y) * CLUSTER_COUNT_X];
+	float3 normal = normalize(input.normal);
+	for (uint i = 0; i < lights.y; i++) {
+		Light localLight = Lights[LightIndices[lights.x + i]];
+		result += getLocalLightColor(localLight, input.worldPosition, normal) * textureColor.rgb;
+	}
+#endif
+
+#if OBJECT_LIGHTS
+	float3 objectNormal = normalize(input.normal);
+	[unroll]
+	for (uint j = 0; j < OBJECT_LIGHT_COUNT; j++) {
+		if (j < objectLightCount) {
+			Light objectLight = Lights[objectLightIndices[j]];
+			result += getLocalLightColor(objectLight, input.worldPosition, objectNormal) * textureColor.rgb;
+		}
+	}
+#endif
+
+	return float4(result, textureColor.a);
+}
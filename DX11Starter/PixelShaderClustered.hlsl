@@ -0,0 +1,4 @@
+// Clustered variant of PixelShader.hlsl
+// - Adds the point and spot lights of the pixel's cluster
+#define CLUSTERED 1
+#include "PixelShader.hlsl"
@@ -0,0 +1,4 @@
+// Clustered, instanced variant of PixelShader.hlsl
+#define CLUSTERED 1
+#define INSTANCED 1
+#include "PixelShader.hlsl"
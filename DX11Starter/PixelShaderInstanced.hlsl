@@ -0,0 +1,5 @@
+// Instanced variant of PixelShader.hlsl
+// - Identical, except the material color arrives per instance
+//    from the vertex shader instead of from a constant
+#define INSTANCED 1
+#include "PixelShader.hlsl"
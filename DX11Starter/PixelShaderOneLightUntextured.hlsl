@@ -0,0 +1,5 @@
+// Untextured variant of PixelShader.hlsl that only
+// evaluates the first light
+#define LIGHT_COUNT 1
+#define TEXTURED 0
+#include "PixelShader.hlsl"
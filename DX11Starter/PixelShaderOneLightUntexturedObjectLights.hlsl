@@ -0,0 +1,7 @@
+// Untextured variant of PixelShader.hlsl that only
+// evaluates the first directional light, plus the few
+// local lights picked for each object
+#define LIGHT_COUNT 1
+#define TEXTURED 0
+#define OBJECT_LIGHTS 1
+#include "PixelShader.hlsl"
@@ -0,0 +1,5 @@
+// Untextured variant of PixelShader.hlsl
+// - Lit by the material color alone, for materials that
+//    would otherwise sample the blank default texture
+#define TEXTURED 0
+#include "PixelShader.hlsl"
@@ -0,0 +1,4 @@
+// Untextured, clustered variant of PixelShader.hlsl
+#define TEXTURED 0
+#define CLUSTERED 1
+#include "PixelShader.hlsl"
@@ -0,0 +1,5 @@
+// Untextured, clustered, instanced variant of PixelShader.hlsl
+#define TEXTURED 0
+#define CLUSTERED 1
+#define INSTANCED 1
+#include "PixelShader.hlsl"
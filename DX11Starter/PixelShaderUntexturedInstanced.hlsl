@@ -0,0 +1,4 @@
+// Untextured, instanced variant of PixelShader.hlsl
+#define TEXTURED 0
+#define INSTANCED 1
+#include "PixelShader.hlsl"
@@ -0,0 +1,198 @@
+#include "RenderCommandBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+// Commands hold pointers, so keep every command pointer aligned
+static const size_t CommandAlignment = sizeof(void*);
+
+static const size_t NoCommand = (size_t)-1;
+
+RenderCommandBuffer::RenderCommandBuffer()
+{
+	size = 0;
+	commandCount = 0;
+	drawCount = 0;
+	constantBytes = 0;
+	skippedUploadCount = 0;
+	bytesSaved = 0;
+	ForgetConstants();
+}
+
+RenderCommandBuffer::~RenderCommandBuffer()
+{
+}
+
+void RenderCommandBuffer::Reset()
+{
+	size = 0;
+	commandCount = 0;
+	drawCount = 0;
+	constantBytes = 0;
+	skippedUploadCount = 0;
+	bytesSaved = 0;
+	ForgetConstants();
+}
+
+void RenderCommandBuffer::ForgetConstants()
+{
+	for (unsigned int stage = 0; stage < StageCount; stage++) {
+		for (unsigned int slot = 0; slot < StateCache::MaxConstantBuffers; slot++) {
+			lastConstants[stage][slot] = NoCommand;
+		}
+	}
+
+	pendingConstants = NoCommand;
+	replacedConstants = NoCommand;
+}
+
+// --------------------------------------------------------
+// Reserves space for a command plus any trailing data. The
+// returned pointer is only good until the next allocation,
+// since the storage may move.
+// --------------------------------------------------------
+void* RenderCommandBuffer::Allocate(RenderCommandType type, size_t commandSize, size_t extraSize)
+{
+	size_t totalSize = (commandSize + extraSize + CommandAlignment - 1) & ~(CommandAlignment - 1);
+	if (size + totalSize > data.size()) {
+		data.resize(std::max(data.size() * 2, size + totalSize));
+	}
+
+	// Whatever was recorded before can no longer be patched
+	pendingConstants = NoCommand;
+
+	RenderCommand* command = (RenderCommand*)&data[size];
+	command->type = type;
+	command->size = (unsigned int)totalSize;
+
+	size += totalSize;
+	commandCount++;
+	return command;
+}
+
+// --------------------------------------------------------
+// Playing this back binds each shader's own constant buffers
+// over whatever the list bound before, including ranges of
+// the constant ring, so earlier SetConstants no longer count
+// as bound
+// --------------------------------------------------------
+void RenderCommandBuffer::BindPipeline(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader)
+{
+	BindPipelineCommand* command = Allocate<BindPipelineCommand>(CommandBindPipeline);
+	command->vertexShader = vertexShader;
+	command->pixelShader = pixelShader;
+
+	ForgetConstants();
+}
+
+void* RenderCommandBuffer::SetConstants(ShaderStage stage, unsigned int slot, StateObject buffer, const void* data, unsigned int dataSize)
+{
+	SetConstantsCommand* command = Allocate<SetConstantsCommand>(CommandSetConstants, dataSize);
+	command->stage = stage;
+	command->slot = slot;
+	command->buffer = buffer;
+	command->dataSize = dataSize;
+	command->ringBuffer = nullptr;
+	command->firstConstant = 0;
+	command->constantCount = 0;
+	memcpy(command + 1, data, dataSize);
+	constantBytes += dataSize;
+
+	// Slots past the tracked range are never compared
+	if (slot < StateCache::MaxConstantBuffers) {
+		pendingConstants = size - command->size;
+		replacedConstants = lastConstants[stage][slot];
+		lastConstants[stage][slot] = pendingConstants;
+	}
+
+	return command + 1;
+}
+
+// --------------------------------------------------------
+// Compares the pending command with the last one this list
+// sent to the same stage and slot. The executor binds each
+// SetConstants in order, so if both hold the same buffer and
+// bytes, the earlier one is still bound and still correct.
+// --------------------------------------------------------
+bool RenderCommandBuffer::DropRepeatedConstants()
+{
+	if (pendingConstants == NoCommand) {
+		return false;
+	}
+
+	size_t offset = pendingConstants;
+	size_t replaced = replacedConstants;
+	pendingConstants = NoCommand;
+
+	if (replaced == NoCommand) {
+		return false;
+	}
+
+	const SetConstantsCommand* command = (const SetConstantsCommand*)&data[offset];
+	const SetConstantsCommand* previous = (const SetConstantsCommand*)&data[replaced];
+	if (previous->buffer != command->buffer
+		|| previous->dataSize != command->dataSize
+		|| memcmp(previous->GetData(), command->GetData(), command->dataSize) != 0) {
+		return false;
+	}
+
+	lastConstants[command->stage][command->slot] = replaced;
+	constantBytes -= command->dataSize;
+	bytesSaved += command->dataSize;
+	skippedUploadCount++;
+
+	size = offset;
+	commandCount--;
+	return true;
+}
+
+void RenderCommandBuffer::BindTexture(ShaderStage stage, unsigned int slot, StateObject srv)
+{
+	BindTextureCommand* command = Allocate<BindTextureCommand>(CommandBindTexture);
+	command->stage = stage;
+	command->slot = slot;
+	command->srv = srv;
+}
+
+void RenderCommandBuffer::BindSampler(ShaderStage stage, unsigned int slot, StateObject sampler)
+{
+	BindSamplerCommand* command = Allocate<BindSamplerCommand>(CommandBindSampler);
+	command->stage = stage;
+	command->slot = slot;
+	command->sampler = sampler;
+}
+
+void RenderCommandBuffer::BindGeometry(StateObject vertexBuffer, StateObject indexBuffer, unsigned int stride, unsigned int indexFormat)
+{
+	BindGeometryCommand* command = Allocate<BindGeometryCommand>(CommandBindGeometry);
+	command->vertexBuffer = vertexBuffer;
+	command->indexBuffer = indexBuffer;
+	command->stride = stride;
+	command->indexFormat = indexFormat;
+}
+
+void RenderCommandBuffer::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	DrawIndexedCommand* command = Allocate<DrawIndexedCommand>(CommandDrawIndexed);
+	command->indexCount = indexCount;
+	command->startIndex = startIndex;
+	command->baseVertex = baseVertex;
+	drawCount++;
+}
+
+void RenderCommandBuffer::BindInstances(StateObject instanceBuffer, unsigned int stride)
+{
+	BindInstancesCommand* command = Allocate<BindInstancesCommand>(CommandBindInstances);
+	command->instanceBuffer = instanceBuffer;
+	command->stride = stride;
+}
+
+void RenderCommandBuffer::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	DrawIndexedInstancedCommand* command = Allocate<DrawIndexedInstancedCommand>(CommandDrawIndexedInstanced);
+	command->indexCount = indexCount;
+	command->instanceCount = instanceCount;
+	command->startIndex = startIndex;
+	command->baseVertex = baseVertex;
+	command->startInstance = startInstance;
+	drawCount++;
+}
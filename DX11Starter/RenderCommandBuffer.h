@@ -0,0 +1,176 @@
+#pragma once
+
+#include "StateCache.h"
+#include <cstddef>
+#include <vector>
+
+class SimpleVertexShader;
+class SimplePixelShader;
+
+enum RenderCommandType
+{
+	CommandBindPipeline = 0,
+	CommandSetConstants,
+	CommandBindTexture,
+	CommandBindSampler,
+	CommandBindGeometry,
+	CommandDrawIndexed,
+	CommandBindInstances,
+	CommandDrawIndexedInstanced
+};
+
+// --------------------------------------------------------
+// Every command starts with this header. size covers the
+// header, the command's fields and any trailing data.
+// --------------------------------------------------------
+struct RenderCommand
+{
+	unsigned int type;
+	unsigned int size;
+};
+
+struct BindPipelineCommand : RenderCommand
+{
+	SimpleVertexShader* vertexShader;
+	SimplePixelShader* pixelShader;
+};
+
+// The new contents of the buffer follow the command.
+//
+// If the data has been copied into a constant ring, the
+// ring's range is bound to the slot in place of the buffer.
+struct SetConstantsCommand : RenderCommand
+{
+	ShaderStage stage;
+	unsigned int slot;
+	StateObject buffer;
+	unsigned int dataSize;
+
+	StateObject ringBuffer;			// nullptr if not uploaded
+	unsigned int firstConstant;		// In 16 byte constants
+	unsigned int constantCount;
+
+	const void* GetData() const { return this + 1; }
+};
+
+struct BindTextureCommand : RenderCommand
+{
+	ShaderStage stage;
+	unsigned int slot;
+	StateObject srv;
+};
+
+struct BindSamplerCommand : RenderCommand
+{
+	ShaderStage stage;
+	unsigned int slot;
+	StateObject sampler;
+};
+
+struct BindGeometryCommand : RenderCommand
+{
+	StateObject vertexBuffer;
+	StateObject indexBuffer;
+	unsigned int stride;
+	unsigned int indexFormat;		// A DXGI_FORMAT value
+};
+
+struct DrawIndexedCommand : RenderCommand
+{
+	unsigned int indexCount;
+	unsigned int startIndex;
+	int baseVertex;
+};
+
+// Per-instance data goes in vertex buffer slot 1
+struct BindInstancesCommand : RenderCommand
+{
+	StateObject instanceBuffer;
+	unsigned int stride;
+};
+
+struct DrawIndexedInstancedCommand : RenderCommand
+{
+	unsigned int indexCount;
+	unsigned int instanceCount;
+	unsigned int startIndex;
+	int baseVertex;
+	unsigned int startInstance;
+};
+
+// --------------------------------------------------------
+// A flat, API independent list of rendering commands.
+//
+// The renderer records a frame into one of these and an
+// executor plays it back, either against D3D11 or without
+// a GPU at all. Like the state cache, it holds Direct3D
+// objects as opaque pointers and builds without the headers.
+// --------------------------------------------------------
+class RenderCommandBuffer
+{
+public:
+	RenderCommandBuffer();
+	~RenderCommandBuffer();
+
+	// Empties the buffer, keeping its memory
+	void Reset();
+
+	void BindPipeline(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader);
+
+	// Returns the buffer's copy of the data, which may be patched
+	// until the next command is recorded
+	void* SetConstants(ShaderStage stage, unsigned int slot, StateObject buffer, const void* data, unsigned int dataSize);
+
+	// Takes back the SetConstants() just recorded if the same buffer
+	// with the same bytes is already bound to its stage and slot
+	// by this list since the last BindPipeline(). Call it once the
+	// data has been patched.
+	bool DropRepeatedConstants();
+
+	void BindTexture(ShaderStage stage, unsigned int slot, StateObject srv);
+	void BindSampler(ShaderStage stage, unsigned int slot, StateObject sampler);
+	void BindGeometry(StateObject vertexBuffer, StateObject indexBuffer, unsigned int stride, unsigned int indexFormat);
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void BindInstances(StateObject instanceBuffer, unsigned int stride);
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance);
+
+	// Walking the buffer: start at offset 0 and advance by each command's size
+	const RenderCommand* GetCommand(size_t offset) const { return (const RenderCommand*)&data[offset]; }
+	RenderCommand* GetCommand(size_t offset) { return (RenderCommand*)&data[offset]; }
+	size_t GetSize() const { return size; }
+
+	unsigned int GetCommandCount() const { return commandCount; }
+	// Instanced draws count once
+	unsigned int GetDrawCount() const { return drawCount; }
+	// Constant data to be uploaded when the buffer is played back
+	size_t GetConstantBytes() const { return constantBytes; }
+
+	// SetConstants() commands dropped as repeats, and the bytes they held
+	unsigned int GetSkippedUploadCount() const { return skippedUploadCount; }
+	size_t GetBytesSaved() const { return bytesSaved; }
+
+private:
+	std::vector<unsigned char> data;
+	size_t size;
+	unsigned int commandCount;
+	unsigned int drawCount;
+	size_t constantBytes;
+	unsigned int skippedUploadCount;
+	size_t bytesSaved;
+
+	// Offsets of the last SetConstants() on each stage and slot, and
+	// of the one just recorded along with the one it replaced there
+	size_t lastConstants[StageCount][StateCache::MaxConstantBuffers];
+	size_t pendingConstants;
+	size_t replacedConstants;
+
+	void ForgetConstants();
+	void* Allocate(RenderCommandType type, size_t commandSize, size_t extraSize);
+
+	template <typename T>
+	T* Allocate(RenderCommandType type, size_t extraSize = 0)
+	{
+		return (T*)Allocate(type, sizeof(T), extraSize);
+	}
+};
+
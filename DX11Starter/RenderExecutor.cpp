@@ -0,0 +1,119 @@
+#include "RenderExecutor.h"
+#include <sstream>
+
+void IRenderExecutor::ExecuteLists(const RenderCommandBuffer* lists, unsigned int listCount)
+{
+	for (unsigned int i = 0; i < listCount; i++) {
+		Execute(lists[i]);
+	}
+}
+
+RecordingRenderExecutor::RecordingRenderExecutor()
+{
+}
+
+unsigned int RecordingRenderExecutor::GetHandle(const void* pointer)
+{
+	if (pointer == nullptr) {
+		return 0;
+	}
+
+	std::unordered_map<const void*, unsigned int>::iterator it = handles.find(pointer);
+	if (it != handles.end()) {
+		return it->second;
+	}
+
+	// 0 is reserved for nullptr
+	unsigned int handle = (unsigned int)handles.size() + 1;
+	handles[pointer] = handle;
+	return handle;
+}
+
+void RecordingRenderExecutor::Execute(const RenderCommandBuffer& commands)
+{
+	std::ostringstream output;
+
+	for (size_t offset = 0; offset < commands.GetSize(); offset += commands.GetCommand(offset)->size) {
+		const RenderCommand* command = commands.GetCommand(offset);
+
+		switch (command->type) {
+		case CommandBindPipeline: {
+			const BindPipelineCommand* bind = (const BindPipelineCommand*)command;
+			output << "BindPipeline vs=" << GetHandle(bind->vertexShader) << " ps=" << GetHandle(bind->pixelShader) << "\n";
+			break;
+		}
+		case CommandSetConstants: {
+			// The data is hashed rather than written out in full
+			const SetConstantsCommand* constants = (const SetConstantsCommand*)command;
+			output << "SetConstants stage=" << constants->stage << " slot=" << constants->slot
+				<< " buffer=" << GetHandle(constants->buffer) << " size=" << constants->dataSize
+				<< " data=" << std::hex << Hash(constants->GetData(), constants->dataSize) << std::dec;
+			if (constants->ringBuffer) {
+				output << " ring=" << GetHandle(constants->ringBuffer) << " first=" << constants->firstConstant
+					<< " count=" << constants->constantCount;
+			}
+			output << "\n";
+			break;
+		}
+		case CommandBindTexture: {
+			const BindTextureCommand* bind = (const BindTextureCommand*)command;
+			output << "BindTexture stage=" << bind->stage << " slot=" << bind->slot << " srv=" << GetHandle(bind->srv) << "\n";
+			break;
+		}
+		case CommandBindSampler: {
+			const BindSamplerCommand* bind = (const BindSamplerCommand*)command;
+			output << "BindSampler stage=" << bind->stage << " slot=" << bind->slot << " sampler=" << GetHandle(bind->sampler) << "\n";
+			break;
+		}
+		case CommandBindGeometry: {
+			const BindGeometryCommand* bind = (const BindGeometryCommand*)command;
+			output << "BindGeometry vb=" << GetHandle(bind->vertexBuffer) << " ib=" << GetHandle(bind->indexBuffer)
+				<< " stride=" << bind->stride << " format=" << bind->indexFormat << "\n";
+			break;
+		}
+		case CommandDrawIndexed: {
+			const DrawIndexedCommand* draw = (const DrawIndexedCommand*)command;
+			output << "DrawIndexed count=" << draw->indexCount << " start=" << draw->startIndex << " base=" << draw->baseVertex << "\n";
+			break;
+		}
+		case CommandBindInstances: {
+			const BindInstancesCommand* bind = (const BindInstancesCommand*)command;
+			output << "BindInstances buffer=" << GetHandle(bind->instanceBuffer) << " stride=" << bind->stride << "\n";
+			break;
+		}
+		case CommandDrawIndexedInstanced: {
+			const DrawIndexedInstancedCommand* draw = (const DrawIndexedInstancedCommand*)command;
+			output << "DrawIndexedInstanced count=" << draw->indexCount << " instances=" << draw->instanceCount << " start=" << draw->startIndex
+				<< " base=" << draw->baseVertex << " startInstance=" << draw->startInstance << "\n";
+			break;
+		}
+		default:
+			output << "Unknown type=" << command->type << " size=" << command->size << "\n";
+			break;
+		}
+	}
+
+	log += output.str();
+}
+
+void RecordingRenderExecutor::Reset()
+{
+	handles.clear();
+	log.clear();
+}
+
+uint64_t RecordingRenderExecutor::GetHash()
+{
+	return Hash(log.data(), log.size());
+}
+
+uint64_t RecordingRenderExecutor::Hash(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
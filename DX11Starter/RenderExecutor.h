@@ -0,0 +1,56 @@
+#pragma once
+
+#include "RenderCommandBuffer.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// Plays back a recorded command buffer. The D3D11 executors
+// are in D3D11RenderExecutor.h; the recording one here needs
+// no device, so it builds and runs anywhere.
+// --------------------------------------------------------
+class IRenderExecutor
+{
+public:
+	virtual ~IRenderExecutor() {}
+
+	virtual void Execute(const RenderCommandBuffer& commands) = 0;
+
+	// Plays back lists recorded in parallel. Their effect is always
+	// the same as executing them one after the other, in order.
+	virtual void ExecuteLists(const RenderCommandBuffer* lists, unsigned int listCount);
+};
+
+// --------------------------------------------------------
+// Executes nothing, but writes each command out as a line
+// of text and hashes the result.
+//
+// Pointers are replaced with handles numbered in the order
+// they are first seen, so the same frame produces the same
+// log and hash from run to run.
+// --------------------------------------------------------
+class RecordingRenderExecutor : public IRenderExecutor
+{
+	std::unordered_map<const void*, unsigned int> handles;
+	std::string log;
+
+	unsigned int GetHandle(const void* pointer);
+
+public:
+	RecordingRenderExecutor();
+
+	// Appends the commands to the log
+	void Execute(const RenderCommandBuffer& commands);
+
+	// Clears the log and forgets all handles
+	void Reset();
+
+	const std::string& GetLog() { return log; }
+
+	// FNV-1a hash of the log
+	uint64_t GetHash();
+
+	static uint64_t Hash(const void* data, size_t size);
+};
+
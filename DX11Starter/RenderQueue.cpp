@@ -0,0 +1,89 @@
+#include "RenderQueue.h"
+
+// For the DirectX Math library
+using namespace DirectX;
+
+RenderQueue::RenderQueue()
+{
+	unsortedStateChanges = 0;
+	sortedStateChanges = 0;
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Build(const std::vector<Entity*>& entities, Camera* camera)
+{
+	items.clear();
+
+	XMFLOAT4X4 viewMatrix = camera->getViewMatrix();
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix)); // Stored transposed for HLSL
+	float nearPlane = camera->GetNearPlane();
+	float depthScale = 1.0f / (camera->GetFarPlane() - nearPlane);
+
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		Entity* entity = entities[i];
+		Material* material = entity->GetMaterial();
+
+		// Sort by the view space depth of the bounds' center
+		BoundingBox bounds = entity->GetWorldBounds();
+		float viewDepth = XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&bounds.Center), view));
+		float depth = (viewDepth - nearPlane) * depthScale;
+
+		unsigned int pass = DrawKeys::PassOpaque;
+		if (material->GetColor().w < 1.0f) {
+			pass = DrawKeys::PassTransparent;
+			depth = 1.0f - depth;
+		}
+
+		DrawItem item;
+		item.key = DrawKeys::MakeKey(pass, GetShaderId(material), material->GetId(), entity->GetMesh()->GetId(), depth);
+		item.entity = entity;
+		items.push_back(item);
+	}
+
+	unsortedStateChanges = CountStateChanges();
+
+	scratch.resize(items.size());
+	if (!items.empty()) {
+		DrawKeys::RadixSort(&items[0], &scratch[0], items.size());
+	}
+
+	sortedStateChanges = CountStateChanges();
+}
+
+unsigned int RenderQueue::GetShaderId(Material* material)
+{
+	std::pair<SimpleVertexShader*, SimplePixelShader*> shaders(material->GetVertexShader(), material->GetPixelShader());
+	std::map<std::pair<SimpleVertexShader*, SimplePixelShader*>, unsigned int>::iterator it = shaderIds.find(shaders);
+	if (it != shaderIds.end()) {
+		return it->second;
+	}
+
+	unsigned int id = (unsigned int)shaderIds.size();
+	shaderIds[shaders] = id;
+	return id;
+}
+
+// --------------------------------------------------------
+// Counts shader, material and mesh switches when walking the
+// queue in its current order
+// --------------------------------------------------------
+unsigned int RenderQueue::CountStateChanges()
+{
+	unsigned int changes = 0;
+	for (unsigned int i = 0; i < items.size(); i++) {
+		uint64_t key = items[i].key;
+		if (i == 0) {
+			changes += 3;
+			continue;
+		}
+
+		uint64_t previous = items[i - 1].key;
+		if (DrawKeys::GetShader(key) != DrawKeys::GetShader(previous)) changes++;
+		if (DrawKeys::GetMaterial(key) != DrawKeys::GetMaterial(previous)) changes++;
+		if (DrawKeys::GetMesh(key) != DrawKeys::GetMesh(previous)) changes++;
+	}
+	return changes;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Entity.h"
+#include "Camera.h"
+#include "SimpleShader.h"
+#include "DrawKeys.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// --------------------------------------------------------
+// Collects the visible draws for a frame and sorts them by
+// their packed 64-bit keys (see DrawKeys.h) so submission
+// touches as little GPU state as possible, while keeping
+// transparent draws back to front.
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	// Fills the queue with one draw per entity, then sorts it
+	void Build(const std::vector<Entity*>& entities, Camera* camera);
+
+	const std::vector<DrawItem>& GetItems() { return items; }
+
+	// Shader/material/mesh switches needed to walk the queue
+	// before and after sorting
+	unsigned int GetUnsortedStateChanges() { return unsortedStateChanges; }
+	unsigned int GetSortedStateChanges() { return sortedStateChanges; }
+	unsigned int GetStateChangesAvoided() { return unsortedStateChanges - sortedStateChanges; }
+
+private:
+	std::vector<DrawItem> items;
+	std::vector<DrawItem> scratch;
+
+	// Shader pairs are numbered the first time they're seen
+	std::map<std::pair<SimpleVertexShader*, SimplePixelShader*>, unsigned int> shaderIds;
+
+	unsigned int unsortedStateChanges;
+	unsigned int sortedStateChanges;
+
+	unsigned int GetShaderId(Material* material);
+	unsigned int CountStateChanges();
+};
+
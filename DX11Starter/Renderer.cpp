@@ -1,6 +1,40 @@
 #include "Renderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 
+// Fewest draws worth handing to a thread of their own
+static const unsigned int MinDrawsPerList = 64;
 
+// Smaller batches are drawn one entity at a time
+static const unsigned int MinInstanceCount = 2;
+
+// Starting size of the constant ring; it grows to fit bigger frames
+static const size_t ConstantRingSize = 1024 * 1024;
+
+// Pixel error every detail level is allowed before any bias, and
+// the range of sizes, past the cull size, objects fade out over
+static const float LodPixelError = 1.0f;
+static const float LodFadeRange = 2.0f;
+
+// Shader names, hashed at compile time so lookups skip std::string
+static constexpr ShaderNameId ViewName = ShaderName("view");
+static constexpr ShaderNameId ProjectionName = ShaderName("projection");
+static constexpr ShaderNameId WorldName = ShaderName("world");
+static constexpr ShaderNameId WorldViewProjName = ShaderName("worldViewProj");
+static constexpr ShaderNameId NormalMatrixName = ShaderName("normalMatrix");
+static constexpr ShaderNameId ObjectToWorldName = ShaderName("objectToWorld");
+static constexpr ShaderNameId ColorName = ShaderName("Color");
+static constexpr ShaderNameId SamplerName = ShaderName("Sampler");
+static constexpr ShaderNameId TextureName = ShaderName("Texture");
+static constexpr ShaderNameId LightsName = ShaderName("Lights");
+static constexpr ShaderNameId DirectionalLightStartName = ShaderName("directionalLightStart");
+static constexpr ShaderNameId DirectionalLightCountName = ShaderName("directionalLightCount");
+static constexpr ShaderNameId LightClustersName = ShaderName("LightClusters");
+static constexpr ShaderNameId LightIndicesName = ShaderName("LightIndices");
+static constexpr ShaderNameId ObjectLightIndicesName = ShaderName("objectLightIndices");
+static constexpr ShaderNameId ObjectLightCountName = ShaderName("objectLightCount");
 
 void Renderer::CreateDefaultMaterial()
 {
@@ -32,7 +66,56 @@ void Renderer::CreateDefaultMaterial()
 	device->CreateTexture2D(&defaultTextureDesc, &defaultTextureInitData, &defaultTexture);
 	device->CreateShaderResourceView(defaultTexture, NULL, &defaultSrv);
 
-	baseMaterial = new Material(vertexShader, pixelShader, defaultSrv);
+	// The default texture is blank, so there's nothing to sample
+	baseMaterial = new Material(vertexShader, GetPixelShader(KeywordUntextured | KeywordClustered), defaultSrv);
+}
+
+// --------------------------------------------------------
+// Compiles every .hlsl in the working directory that changed
+// since it was last built straight into Debug/, so shader
+// edits show up without rebuilding the project. Only finds
+// anything when run from the project folder, as Visual
+// Studio does when debugging.
+//
+// Bytecode is cached in Debug/ShaderCache by content hash,
+// so unchanged shaders cost a preprocess and a file read.
+// --------------------------------------------------------
+void Renderer::BuildShaders()
+{
+	std::vector<ShaderBuildJob> jobs;
+
+	WIN32_FIND_DATAA found;
+	HANDLE find = FindFirstFileA("*.hlsl", &found);
+	if (find == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	do {
+		std::string source = found.cFileName;
+		std::string name = source.substr(0, source.size() - 5);
+
+		// The stage comes from the file name, as in the project
+		ShaderBuildJob job;
+		if (name.compare(0, 6, "Vertex") == 0) {
+			job.Profile = "vs_5_0";
+		}
+		else if (name.compare(0, 5, "Pixel") == 0) {
+			job.Profile = "ps_5_0";
+		}
+		else {
+			continue;
+		}
+
+		job.SourceFile = source;
+		job.EntryPoint = "main";
+		job.OutputFile = "Debug/" + name + ".cso";
+		jobs.push_back(job);
+	} while (FindNextFileA(find, &found));
+	FindClose(find);
+
+	CreateDirectoryA("Debug/ShaderCache", nullptr);
+	shaderBuilder = new ShaderBuilder(&shaderCompiler, threadPool, "Debug/ShaderCache");
+	shaderBuilder->Build(jobs);
 }
 
 // --------------------------------------------------------
@@ -43,13 +126,50 @@ void Renderer::CreateDefaultMaterial()
 // --------------------------------------------------------
 void Renderer::LoadShaders()
 {
+#if defined(DEBUG) || defined(_DEBUG)
+	BuildShaders();
+#endif
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
 	vertexShader = new SimpleVertexShader(device, context);
 	if (!vertexShader->LoadShaderFile(L"Debug/VertexShader.cso"))
 		vertexShader->LoadShaderFile(L"VertexShader.cso");
 
-	pixelShader = new SimplePixelShader(device, context);
-	if (!pixelShader->LoadShaderFile(L"Debug/PixelShader.cso"))
-		pixelShader->LoadShaderFile(L"PixelShader.cso");
+	// Every built variant of the pixel shader, instanced ones included
+	pixelShaders = new PixelShaderPermutations(device, context);
+	pixelShaders->Load(L"PixelShader");
+	pixelShader = pixelShaders->Get(0);
+
+	instancedVertexShader = new SimpleVertexShader(device, context);
+	if (!instancedVertexShader->LoadShaderFile(L"Debug/VertexShaderInstanced.cso"))
+		instancedVertexShader->LoadShaderFile(L"VertexShaderInstanced.cso");
+
+
+	shaderLoadSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+	shadersFromSidecar = vertexShader->WasLoadedFromSidecar() + instancedVertexShader->WasLoadedFromSidecar();
+
+	// Check the engine shaders' buffers against their C++ mirrors
+	objectConstants.Validate(vertexShader, "externalData");
+	frameConstants.Validate(instancedVertexShader, "externalData");
+
+	for (unsigned int keywords = 0; keywords < ShaderVariantCount; keywords++) {
+		SimplePixelShader* ps = pixelShaders->Get(keywords);
+		if (ps == nullptr) {
+			continue;
+		}
+
+		shadersFromSidecar += ps->WasLoadedFromSidecar();
+		lightConstants[keywords].Validate(ps, "lightData");
+
+		if (keywords & KeywordClustered) {
+			clusterConstants[keywords].Validate(ps, "clusterData");
+		}
+
+		if (keywords & KeywordObjectLights) {
+			objectLightConstants[keywords].Validate(ps, "objectLightData");
+		}
+	}
 
 	// You'll notice that the code above attempts to load each
 	// compiled shader file (.cso) from two different relative paths.
@@ -77,10 +197,48 @@ void Renderer::CreateSampler()
 	device->CreateSamplerState(&samplerDesc, &sampler);
 }
 
-Renderer::Renderer(ID3D11Device* device, ID3D11DeviceContext* context)
+Renderer::Renderer(ID3D11Device* device, ID3D11DeviceContext* context, ThreadPool* threadPool)
 {
 	this->device = device;
 	this->context = context;
+	this->threadPool = threadPool;
+
+	stateTarget = new DeviceContextStateTarget(context);
+	stateCache = new StateCache(stateTarget);
+
+	// One list per thread that can record, plus one for static batches
+	unsigned int threadCount = threadPool->GetThreadCount();
+	commandLists.resize(threadCount + 1);
+	commandListCount = 0;
+	recordSeconds = 0;
+	shaderBuilder = nullptr;
+	instanceBuffer = nullptr;
+	instanceCapacity = 0;
+
+	lightBuffer = {};
+	lightsChanged = false;
+	lightsUploaded = false;
+	lightClusters = new LightClusters(threadPool);
+	clusterBuffer = {};
+	lightIndexBuffer = {};
+	viewportSize = XMFLOAT2(1, 1);
+	lightSelector = new ObjectLightSelector(threadPool);
+	lodSelector = new LodSelector(threadPool);
+	triangleBudget = new TriangleBudget();
+	gpuTimer = new GpuTimer(device, context);
+	submittedTriangles = 0;
+
+	if (threadCount > 1 && D3D11DeferredRenderExecutor::IsSupported(device)) {
+		executor = new D3D11DeferredRenderExecutor(device, context, stateCache, threadPool, (unsigned int)commandLists.size());
+	}
+	else {
+		executor = new D3D11RenderExecutor(context, stateCache);
+	}
+
+	constantUploader = nullptr;
+	if (ConstantUploader::IsSupported(device)) {
+		constantUploader = new ConstantUploader(device, context, ConstantRingSize);
+	}
 
 	LoadShaders();
 	CreateSampler();
@@ -91,8 +249,961 @@ Renderer::Renderer(ID3D11Device* device, ID3D11DeviceContext* context)
 
 Renderer::~Renderer()
 {
+	delete baseMaterial;
+	delete vertexShader;
+	delete pixelShaders;
+	delete instancedVertexShader;
+	delete executor;
+	delete constantUploader;
+	delete shaderBuilder;
+	delete lightClusters;
+	delete lightSelector;
+	delete lodSelector;
+	delete triangleBudget;
+	delete gpuTimer;
+	delete stateCache;
+	delete stateTarget;
+
+	if (sampler) { sampler->Release(); }
+	if (defaultSrv) { defaultSrv->Release(); }
+	if (defaultTexture) { defaultTexture->Release(); }
+	if (instanceBuffer) { instanceBuffer->Release(); }
+
+	ReleaseShaderBuffer(lightBuffer);
+	ReleaseShaderBuffer(clusterBuffer);
+	ReleaseShaderBuffer(lightIndexBuffer);
+}
+
+// --------------------------------------------------------
+// Records the frame, then plays it back on the device context
+// --------------------------------------------------------
+void Renderer::Render(const std::vector<Entity*>& entities, Camera * camera, LightManager* lights)
+{
+	// Pixels map to clusters by their position in the viewport
+	UpdateViewportSize();
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	commandListCount = Record(entities, camera, lights, commandLists);
+	recordSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+
+	gpuTimer->Begin();
+	UploadInstances();
+	UploadLights(lights);
+	if (constantUploader) {
+		constantUploader->Upload(&commandLists[0], commandListCount);
+	}
+
+	stateCache->BeginFrame();
+	executor->ExecuteLists(&commandLists[0], commandListCount);
+	gpuTimer->End();
+}
+
+void Renderer::UpdateViewportSize()
+{
+	D3D11_VIEWPORT viewport;
+	UINT viewportCount = 1;
+	context->RSGetViewports(&viewportCount, &viewport);
+	if (viewportCount > 0) {
+		viewportSize = XMFLOAT2(viewport.Width, viewport.Height);
+	}
+}
+
+float Renderer::GetRecordedDrawsPerSecond()
+{
+	unsigned int drawCount = 0;
+	for (unsigned int i = 0; i < commandListCount; i++) {
+		drawCount += commandLists[i].GetDrawCount();
+	}
+
+	return recordSeconds > 0 ? drawCount / recordSeconds : 0;
+}
+
+size_t Renderer::GetConstantBytesUploaded()
+{
+	size_t constantBytes = 0;
+	for (unsigned int i = 0; i < commandListCount; i++) {
+		constantBytes += commandLists[i].GetConstantBytes();
+	}
+
+	return constantBytes;
+}
+
+unsigned int Renderer::GetSkippedUploadCount()
+{
+	unsigned int skippedCount = 0;
+	for (unsigned int i = 0; i < commandListCount; i++) {
+		skippedCount += commandLists[i].GetSkippedUploadCount();
+	}
+
+	return skippedCount;
+}
+
+size_t Renderer::GetConstantBytesSaved()
+{
+	size_t bytesSaved = 0;
+	for (unsigned int i = 0; i < commandListCount; i++) {
+		bytesSaved += commandLists[i].GetBytesSaved();
+	}
+
+	return bytesSaved;
+}
+
+// --------------------------------------------------------
+// Hands the batcher each cluster's members together, then
+// the proxies in the same order, so nearby clusters on the
+// same side of their switch distances draw as one run
+// --------------------------------------------------------
+void Renderer::BuildStaticBatches(const std::vector<Entity*>& entities)
+{
+	std::vector<HlodCluster>& clusters = hlodClusters.GetClusters();
+	if (clusters.empty()) {
+		staticBatcher.Build(entities, device);
+		return;
+	}
+
+	std::vector<Entity*> ordered;
+	ordered.reserve(entities.size());
+	for (unsigned int i = 0; i < clusters.size(); i++) {
+		ordered.insert(ordered.end(), clusters[i].members.begin(), clusters[i].members.end());
+	}
+	for (unsigned int i = 0; i < clusters.size(); i++) {
+		if (clusters[i].proxy != nullptr) {
+			ordered.push_back(clusters[i].proxy);
+		}
+	}
+
+	unsigned int cluster;
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		if (!hlodClusters.FindCluster(entities[i], cluster)) {
+			ordered.push_back(entities[i]);
+		}
+	}
+
+	staticBatcher.Build(ordered, device);
+}
+
+void Renderer::BuildHlodClusters(const std::vector<Entity*>& entities)
+{
+	hlodClusters.Build(entities, device);
 }
 
-void Renderer::Render(Entity * entity, Camera * camera)
+// --------------------------------------------------------
+// Draws visible static entities from their merged meshes,
+// then sorts and batches the rest, recording contiguous
+// runs of batches on the thread pool, one list per run.
+// Lists are numbered in draw order, so playing them back in
+// order gives the same frame however the threads were
+// scheduled.
+// --------------------------------------------------------
+unsigned int Renderer::Record(const std::vector<Entity*>& entities, Camera * camera, LightManager* lights, std::vector<RenderCommandBuffer>& lists)
+{
+	PackLights(lights);
+
+	staticBatcher.BeginFrame();
+	dynamicEntities.clear();
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		if (!staticBatcher.MarkVisible(entities[i])) {
+			dynamicEntities.push_back(entities[i]);
+		}
+	}
+
+	// Sorting reads every entity's world bounds, which also leaves
+	// their transforms clean for the recording threads
+	renderQueue.Build(dynamicEntities, camera);
+	ComputeTransforms(camera);
+
+	instanceBatcher.Build(renderQueue.GetItems(), objectTransforms.empty() ? nullptr : &objectTransforms[0]);
+	const std::vector<InstanceBatch>& batches = instanceBatcher.GetBatches();
+
+	AssignLights(lights, camera);
+	SelectLights(lights);
+
+	// The buffer may be recreated, so it has to exist before its
+	// pointer is recorded; the data itself goes in at playback
+	ReserveInstances((unsigned int)instanceBatcher.GetInstances().size());
+
+	SetFrameConstants(batches, camera, lights);
+
+	// Static geometry is opaque, so it goes first
+	RecordStatic(lists[0]);
+
+	// Small frames aren't worth splitting up
+	unsigned int batchCount = (unsigned int)batches.size();
+	unsigned int listCount = (batchCount + MinDrawsPerList - 1) / MinDrawsPerList;
+	listCount = std::max(1u, std::min(listCount, (unsigned int)lists.size() - 1));
+
+	threadPool->ParallelFor(listCount, [&](unsigned int list) {
+		unsigned int first = (unsigned int)((uint64_t)batchCount * list / listCount);
+		unsigned int last = (unsigned int)((uint64_t)batchCount * (list + 1) / listCount);
+		RecordRange(batches, first, last, lists[list + 1]);
+	});
+
+	return listCount + 1;
+}
+
+// --------------------------------------------------------
+// Writes the values shared by every draw into each shader's
+// local constant data. After this the recording threads only
+// ever read from the shaders.
+// --------------------------------------------------------
+void Renderer::SetFrameConstants(const std::vector<InstanceBatch>& batches, Camera* camera, LightManager* lights)
+{
+	XMFLOAT4X4 viewMatrix = camera->getViewMatrix();
+	XMFLOAT4X4 projectionMatrix = camera->getProjectionMatrix();
+
+	// The engine's own shaders take each buffer in a single copy.
+	// Zeroed first so the padding never reads as a change.
+	FrameConstants frame = {};
+	frame.view = viewMatrix;
+	frame.projection = projectionMatrix;
+
+	// The lights themselves are in the light buffer
+	LightConstants lighting = {};
+	lighting.directionalLightStart = lights->GetLocalLightCount();
+	lighting.directionalLightCount = lights->GetDirectionalLightCount();
+
+	// The view matrix is transposed, so its third row gives view depth
+	ClusterConstants cluster = {};
+	cluster.depthPlane = XMFLOAT4(viewMatrix._31, viewMatrix._32, viewMatrix._33, viewMatrix._34);
+	cluster.clusterScale = XMFLOAT2(LightClusters::CountX / viewportSize.x, LightClusters::CountY / viewportSize.y);
+	cluster.depthScale = lightClusters->GetDepthScale();
+	cluster.depthBias = lightClusters->GetDepthBias();
+
+	for (unsigned int keywords = KeywordClustered; keywords < ShaderVariantCount; keywords = (keywords + 1) | KeywordClustered) {
+		clusterConstants[keywords].Write(cluster);
+	}
+
+	if (!frameConstants.Write(frame)) {
+		SetViewConstants(instancedVertexShader, viewMatrix, projectionMatrix);
+	}
+
+	for (unsigned int keywords = KeywordInstanced; keywords < ShaderVariantCount; keywords = (keywords + 1) | KeywordInstanced) {
+		SimplePixelShader* ps = pixelShaders->Get(keywords);
+		if (ps == nullptr) {
+			continue;
+		}
+
+		if (!lightConstants[keywords].Write(lighting)) {
+			SetLightConstants(ps, lighting);
+		}
+	}
+
+	// Every material that might be drawn this frame
+	std::vector<Material*> materials;
+	for (unsigned int i = 0; i < batches.size(); i++) {
+		materials.push_back(batches[i].material);
+	}
+
+	std::vector<StaticBatch>& staticBatches = staticBatcher.GetBatches();
+	for (unsigned int i = 0; i < staticBatches.size(); i++) {
+		materials.push_back(staticBatches[i].material);
+	}
+
+	SimpleVertexShader* currentVertexShader = nullptr;
+	SimplePixelShader* currentPixelShader = nullptr;
+
+	for (unsigned int i = 0; i < materials.size(); i++) {
+		Material* material = materials[i];
+		SimpleVertexShader* vs = material->GetVertexShader();
+		SimplePixelShader* ps = material->GetPixelShader();
+
+		if (vs != currentVertexShader) {
+			if (vs != objectConstants.GetShader() || !objectConstants.Write(staticTransform)) {
+				SetViewConstants(vs, viewMatrix, projectionMatrix);
+			}
+			currentVertexShader = vs;
+		}
+
+		if (ps != currentPixelShader) {
+			int keywords = pixelShaders->GetKeywords(ps);
+			if (keywords < 0 || !lightConstants[keywords].Write(lighting)) {
+				SetLightConstants(ps, lighting);
+			}
+			currentPixelShader = ps;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Variable by variable fallbacks for shaders without a
+// matching constant block, such as custom material shaders
+// --------------------------------------------------------
+void Renderer::SetViewConstants(SimpleVertexShader* vs, const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	vs->SetMatrix4x4(vs->GetVariableHandle(ViewName), view);
+	vs->SetMatrix4x4(vs->GetVariableHandle(ProjectionName), projection);
+}
+
+void Renderer::SetLightConstants(SimplePixelShader* ps, const LightConstants& lighting)
+{
+	ps->SetData(ps->GetVariableHandle(DirectionalLightStartName), &lighting.directionalLightStart, sizeof(unsigned int));
+	ps->SetData(ps->GetVariableHandle(DirectionalLightCountName), &lighting.directionalLightCount, sizeof(unsigned int));
+}
+
+// --------------------------------------------------------
+// Combines the view and projection with the world matrix of
+// every queued draw, in queue order, and of the static
+// batches, whose vertices are already in world space
+// --------------------------------------------------------
+void Renderer::ComputeTransforms(Camera* camera)
+{
+	// The camera's matrices are stored transposed for HLSL
+	XMFLOAT4X4 viewMatrix = camera->getViewMatrix();
+	XMFLOAT4X4 projectionMatrix = camera->getProjectionMatrix();
+	XMMATRIX viewProjection = XMMatrixMultiply(
+		XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix)),
+		XMMatrixTranspose(XMLoadFloat4x4(&projectionMatrix)));
+
+	const std::vector<DrawItem>& items = renderQueue.GetItems();
+	objectWorlds.resize(items.size());
+	objectTransforms.resize(items.size());
+	for (unsigned int i = 0; i < items.size(); i++) {
+		objectWorlds[i] = items[i].entity->GetTransform()->GetMatrix();
+	}
+
+	if (!items.empty()) {
+		ComputeObjectTransforms(&objectWorlds[0], (unsigned int)items.size(), viewProjection, &objectTransforms[0]);
+	}
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	ComputeObjectTransforms(&identity, 1, viewProjection, &staticTransform);
+}
+
+// --------------------------------------------------------
+// Copies the light buffer indices picked for an object into
+// its constants; the unused ones are left at zero
+// --------------------------------------------------------
+static void PackObjectLights(const ObjectLightSet& selection, ObjectLightConstants& constants)
 {
+	unsigned int* indices = &constants.objectLightIndices.x;
+	for (unsigned int i = 0; i < MaxObjectLights; i++) {
+		indices[i] = i < selection.Count ? selection.Indices[i] : 0;
+	}
+	constants.objectLightCount = selection.Count;
+}
+
+// --------------------------------------------------------
+// Records the static batches with any visible entities.
+// Neighbouring visible ranges share a draw call, and the
+// vertices are already in world space.
+// --------------------------------------------------------
+void Renderer::RecordStatic(RenderCommandBuffer& commands)
+{
+	commands.Reset();
+
+	// Static batches come after the queued draws in the light selections
+	unsigned int firstSelection = (unsigned int)renderQueue.GetItems().size();
+
+	SimpleVertexShader* currentVertexShader = nullptr;
+	SimplePixelShader* currentPixelShader = nullptr;
+
+	ShaderVarHandle worldVariable = {};
+	ShaderVarHandle worldViewProjVariable = {};
+	ShaderVarHandle normalMatrixVariable = {};
+	ShaderVarHandle objectToWorldVariable = {};
+	ShaderVarHandle colorVariable = {};
+	ShaderVarHandle objectLightIndicesVariable = {};
+	ShaderVarHandle objectLightCountVariable = {};
+	bool objectLights = false;
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	std::vector<StaticBatch>& batches = staticBatcher.GetBatches();
+	for (unsigned int b = 0; b < batches.size(); b++) {
+		StaticBatch& batch = batches[b];
+		Material* material = batch.material;
+
+		bool anyVisible = false;
+		for (unsigned int r = 0; r < batch.ranges.size() && !anyVisible; r++) {
+			anyVisible = batch.ranges[r].visible;
+		}
+		if (!anyVisible) {
+			continue;
+		}
+
+		SimpleVertexShader* vs = material->GetVertexShader();
+		SimplePixelShader* ps = material->GetPixelShader();
+		if (vs != currentVertexShader || ps != currentPixelShader) {
+			commands.BindPipeline(vs, ps);
+			BindLightBuffers(ps, commands);
+			worldVariable = vs->GetVariableHandle(WorldName);
+			worldViewProjVariable = vs->GetVariableHandle(WorldViewProjName);
+			normalMatrixVariable = vs->GetVariableHandle(NormalMatrixName);
+			objectToWorldVariable = vs->GetVariableHandle(ObjectToWorldName);
+			colorVariable = ps->GetVariableHandle(ColorName);
+			objectLightIndicesVariable = ps->GetVariableHandle(ObjectLightIndicesName);
+			objectLightCountVariable = ps->GetVariableHandle(ObjectLightCountName);
+			objectLights = UsesObjectLights(ps);
+			currentVertexShader = vs;
+			currentPixelShader = ps;
+		}
+
+		// Each batch is its own material, so these always change
+		const SimpleSampler* samplerInfo = ps->GetSamplerInfo(SamplerName);
+		if (samplerInfo) {
+			commands.BindSampler(StagePixel, samplerInfo->BindIndex, sampler);
+		}
+
+		const SimpleSRV* textureInfo = ps->GetShaderResourceViewInfo(TextureName);
+		if (textureInfo) {
+			commands.BindTexture(StagePixel, textureInfo->BindIndex, material->GetTexture());
+		}
+
+		// The whole batch is lit as one object
+		XMFLOAT4 color = material->GetColor();
+		ObjectLightConstants lighting = {};
+		if (objectLights) {
+			PackObjectLights(lightSelector->GetSelections()[firstSelection + b], lighting);
+		}
+
+		ConstantPatch pixelPatches[] = {
+			{ colorVariable, &color, sizeof(XMFLOAT4) },
+			{ objectLightIndicesVariable, &lighting.objectLightIndices, sizeof(XMUINT4) },
+			{ objectLightCountVariable, &lighting.objectLightCount, sizeof(unsigned int) }
+		};
+		RecordConstants(StagePixel, ps, pixelPatches, objectLights ? 3 : 1, commands);
+
+		// Only one of these sets exists in any given shader
+		ConstantPatch transformPatches[] = {
+			{ worldVariable, &identity, sizeof(XMFLOAT4X4) },
+			{ worldViewProjVariable, &staticTransform.worldViewProj, sizeof(XMFLOAT4X4) },
+			{ normalMatrixVariable, &staticTransform.normalMatrix, sizeof(AffineMatrix) },
+			{ objectToWorldVariable, &staticTransform.objectToWorld, sizeof(AffineMatrix) }
+		};
+		RecordConstants(StageVertex, vs, transformPatches, 4, commands);
+
+		commands.BindGeometry(batch.mesh->GetVertexBuffer(), batch.mesh->GetIndexBuffer(), sizeof(Vertex), DXGI_FORMAT_R32_UINT);
+
+		// Ranges are laid out back to back, so visible neighbours join up
+		unsigned int r = 0;
+		while (r < batch.ranges.size()) {
+			if (!batch.ranges[r].visible) {
+				r++;
+				continue;
+			}
+
+			unsigned int startIndex = batch.ranges[r].startIndex;
+			unsigned int indexCount = 0;
+			while (r < batch.ranges.size() && batch.ranges[r].visible) {
+				indexCount += batch.ranges[r].indexCount;
+				r++;
+			}
+
+			commands.DrawIndexed(indexCount, startIndex, 0);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Records batches [first, last) into a single list. Each list
+// starts from scratch, so it can be played back on its own.
+// Per-material and per-draw values are patched into the
+// recorded constants instead of being set on the shared
+// shaders, which keeps this safe to run on several threads.
+// --------------------------------------------------------
+void Renderer::RecordRange(const std::vector<InstanceBatch>& batches, unsigned int first, unsigned int last, RenderCommandBuffer& commands)
+{
+	commands.Reset();
+
+	const std::vector<DrawItem>& items = renderQueue.GetItems();
+
+	SimpleVertexShader* currentVertexShader = nullptr;
+	SimplePixelShader* currentPixelShader = nullptr;
+	Material* currentMaterial = nullptr;
+	XMFLOAT4 materialColor = {};
+
+	ShaderVarHandle worldVariable = {};
+	ShaderVarHandle worldViewProjVariable = {};
+	ShaderVarHandle normalMatrixVariable = {};
+	ShaderVarHandle objectToWorldVariable = {};
+	ShaderVarHandle colorVariable = {};
+	ShaderVarHandle objectLightIndicesVariable = {};
+	ShaderVarHandle objectLightCountVariable = {};
+	bool objectLights = false;
+
+	for (unsigned int b = first; b < last; b++) {
+		const InstanceBatch& batch = batches[b];
+		Material* material = batch.material;
+		Mesh* mesh = batch.mesh;
+
+		bool instanced = CanInstance(batch);
+		SimpleVertexShader* vs = instanced ? instancedVertexShader : material->GetVertexShader();
+		SimplePixelShader* ps = instanced ? GetInstancedPixelShader(material) : material->GetPixelShader();
+
+		if (vs != currentVertexShader || ps != currentPixelShader) {
+			commands.BindPipeline(vs, ps);
+			BindLightBuffers(ps, commands);
+			worldVariable = vs->GetVariableHandle(WorldName);
+			worldViewProjVariable = vs->GetVariableHandle(WorldViewProjName);
+			normalMatrixVariable = vs->GetVariableHandle(NormalMatrixName);
+			objectToWorldVariable = vs->GetVariableHandle(ObjectToWorldName);
+			colorVariable = ps->GetVariableHandle(ColorName);
+			objectLightIndicesVariable = ps->GetVariableHandle(ObjectLightIndicesName);
+			objectLightCountVariable = ps->GetVariableHandle(ObjectLightCountName);
+			objectLights = UsesObjectLights(ps);
+
+			// Instanced shaders only hold per-frame constants
+			if (instanced) {
+				RecordConstants(StageVertex, vs, nullptr, 0, commands);
+				RecordConstants(StagePixel, ps, nullptr, 0, commands);
+			}
+
+			currentVertexShader = vs;
+			currentPixelShader = ps;
+			currentMaterial = nullptr;
+		}
+
+		if (material != currentMaterial) {
+			const SimpleSampler* samplerInfo = ps->GetSamplerInfo(SamplerName);
+			if (samplerInfo) {
+				commands.BindSampler(StagePixel, samplerInfo->BindIndex, sampler);
+			}
+
+			const SimpleSRV* textureInfo = ps->GetShaderResourceViewInfo(TextureName);
+			if (textureInfo) {
+				commands.BindTexture(StagePixel, textureInfo->BindIndex, material->GetTexture());
+			}
+
+			// Per object lights go in with the color at each draw instead
+			materialColor = material->GetColor();
+			if (!instanced && !objectLights) {
+				ConstantPatch colorPatch = { colorVariable, &materialColor, sizeof(XMFLOAT4) };
+				RecordConstants(StagePixel, ps, &colorPatch, 1, commands);
+			}
+			currentMaterial = material;
+		}
+
+		commands.BindGeometry(mesh->GetVertexBuffer(), mesh->GetIndexBuffer(), sizeof(Vertex), DXGI_FORMAT_R32_UINT);
+
+		if (instanced) {
+			commands.BindInstances(instanceBuffer, sizeof(InstanceData));
+			commands.DrawIndexedInstanced(mesh->GetIndexCount(), batch.instanceCount, 0, 0, batch.first);
+			continue;
+		}
+
+		// The transforms change every draw. The engine's vertex shader
+		// takes the ones computed up front; custom ones may still want
+		// the bare world matrix.
+		for (unsigned int i = batch.first; i < batch.first + batch.instanceCount; i++) {
+			XMFLOAT4X4 world = {};
+			if (worldVariable.IsValid()) {
+				world = items[i].entity->GetDrawMatrix();
+			}
+
+			ConstantPatch transformPatches[] = {
+				{ worldVariable, &world, sizeof(XMFLOAT4X4) },
+				{ worldViewProjVariable, &objectTransforms[i].worldViewProj, sizeof(XMFLOAT4X4) },
+				{ normalMatrixVariable, &objectTransforms[i].normalMatrix, sizeof(AffineMatrix) },
+				{ objectToWorldVariable, &objectTransforms[i].objectToWorld, sizeof(AffineMatrix) }
+			};
+			RecordConstants(StageVertex, vs, transformPatches, 4, commands);
+
+			if (objectLights) {
+				ObjectLightConstants lighting;
+				PackObjectLights(lightSelector->GetSelections()[i], lighting);
+
+				ConstantPatch pixelPatches[] = {
+					{ colorVariable, &materialColor, sizeof(XMFLOAT4) },
+					{ objectLightIndicesVariable, &lighting.objectLightIndices, sizeof(XMUINT4) },
+					{ objectLightCountVariable, &lighting.objectLightCount, sizeof(unsigned int) }
+				};
+				RecordConstants(StagePixel, ps, pixelPatches, 3, commands);
+			}
+
+			commands.DrawIndexed(mesh->GetIndexCount(), 0, 0);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// The instanced shaders stand in for the default vertex
+// shader and a pixel shader variant, so only batches using
+// those, whose variant was also built instanced, qualify
+// --------------------------------------------------------
+bool Renderer::CanInstance(const InstanceBatch& batch)
+{
+	SimplePixelShader* ps = GetInstancedPixelShader(batch.material);
+
+	return batch.instanceCount >= MinInstanceCount
+		&& instanceBuffer != nullptr
+		&& instancedVertexShader->IsShaderValid()
+		&& ps != nullptr && ps->IsShaderValid()
+		&& batch.material->GetVertexShader() == vertexShader;
+}
+
+// --------------------------------------------------------
+// The instanced variant of the material's pixel shader, or
+// nullptr if it isn't a variant or that one wasn't built
+// --------------------------------------------------------
+SimplePixelShader* Renderer::GetInstancedPixelShader(Material* material)
+{
+	int keywords = pixelShaders->GetKeywords(material->GetPixelShader());
+	if (keywords < 0) {
+		return nullptr;
+	}
+
+	return pixelShaders->Get(keywords | KeywordInstanced);
+}
+
+// --------------------------------------------------------
+// Makes sure the instance buffer can hold count instances,
+// growing it by at least half again each time
+// --------------------------------------------------------
+void Renderer::ReserveInstances(unsigned int count)
+{
+	if (count <= instanceCapacity) {
+		return;
+	}
+
+	if (instanceBuffer) { instanceBuffer->Release(); instanceBuffer = nullptr; }
+	instanceCapacity = std::max(count, instanceCapacity + instanceCapacity / 2);
+
+	D3D11_BUFFER_DESC ibd;
+	ibd.Usage = D3D11_USAGE_DYNAMIC;
+	ibd.ByteWidth = sizeof(InstanceData) * instanceCapacity;
+	ibd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+
+	if (FAILED(device->CreateBuffer(&ibd, 0, &instanceBuffer))) {
+		instanceBuffer = nullptr;
+		instanceCapacity = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Copies this frame's packed instance data to the GPU
+// --------------------------------------------------------
+void Renderer::UploadInstances()
+{
+	const std::vector<InstanceData>& instances = instanceBatcher.GetInstances();
+	if (instances.empty() || instanceBuffer == nullptr) {
+		return;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (SUCCEEDED(context->Map(instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+		memcpy(mapped.pData, &instances[0], sizeof(InstanceData) * instances.size());
+		context->Unmap(instanceBuffer, 0);
+	}
+}
+
+// --------------------------------------------------------
+// Packs the lights changed since they were last packed. The
+// buffer is uploaded if that happened at any point since the
+// last upload, however many times this was called.
+// --------------------------------------------------------
+void Renderer::PackLights(LightManager* lights)
+{
+	if (lights->Pack()) {
+		lightsChanged = true;
+	}
+}
+
+// --------------------------------------------------------
+// Bins the local lights into clusters for this frame's view,
+// and makes room for them in the buffers, which have to exist
+// before they're recorded. A new light buffer starts empty,
+// so it always gets uploaded.
+// --------------------------------------------------------
+void Renderer::AssignLights(LightManager* lights, Camera* camera)
+{
+	XMFLOAT4X4 viewMatrix = camera->getViewMatrix();
+	XMFLOAT4X4 projectionMatrix = camera->getProjectionMatrix();
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix));
+	XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&projectionMatrix));
+
+	// Point and spot lights come first, so cluster indices are buffer indices
+	const std::vector<Light>& packed = lights->GetPackedLights();
+	unsigned int lightCount = lights->GetLocalLightCount();
+	lightClusters->Build(lightCount > 0 ? &packed[0] : nullptr, lightCount, view, projection, camera->GetNearPlane(), camera->GetFarPlane());
+
+	// Never empty, so the shaders always have something bound
+	if (ReserveShaderBuffer(lightBuffer, std::max((unsigned int)packed.size(), 1u), sizeof(Light))) {
+		lightsChanged = true;
+	}
+	ReserveShaderBuffer(clusterBuffer, LightClusters::ClusterCount, sizeof(LightCluster));
+	ReserveShaderBuffer(lightIndexBuffer, std::max((unsigned int)lightClusters->GetLightIndices().size(), 1u), sizeof(unsigned int));
+}
+
+void Renderer::UploadLights(LightManager* lights)
+{
+	const std::vector<Light>& packed = lights->GetPackedLights();
+	const std::vector<LightCluster>& clusters = lightClusters->GetClusters();
+	const std::vector<unsigned int>& indices = lightClusters->GetLightIndices();
+
+	lightsUploaded = lightsChanged && !packed.empty();
+	if (lightsUploaded) {
+		UploadShaderBuffer(lightBuffer, &packed[0], (unsigned int)(sizeof(Light) * packed.size()));
+	}
+	lightsChanged = false;
+	UploadShaderBuffer(clusterBuffer, &clusters[0], (unsigned int)(sizeof(LightCluster) * clusters.size()));
+	if (!indices.empty()) {
+		UploadShaderBuffer(lightIndexBuffer, &indices[0], (unsigned int)(sizeof(unsigned int) * indices.size()));
+	}
+}
+
+// A sphere around a box, as the light selector takes it
+static XMFLOAT4 GetBoundingSphere(const BoundingBox& box)
+{
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+	return XMFLOAT4(box.Center.x, box.Center.y, box.Center.z, XMVectorGetX(XMVector3Length(extents)));
+}
+
+// --------------------------------------------------------
+// Picks the local lights for every queued draw, then every
+// static batch, if any of their materials light per object.
+// A merged batch is lit as one object, around whichever of
+// its entities are visible.
+// --------------------------------------------------------
+void Renderer::SelectLights(LightManager* lights)
+{
+	const std::vector<DrawItem>& items = renderQueue.GetItems();
+	const std::vector<InstanceBatch>& batches = instanceBatcher.GetBatches();
+	std::vector<StaticBatch>& staticBatches = staticBatcher.GetBatches();
+
+	bool needed = false;
+	for (unsigned int i = 0; i < batches.size() && !needed; i++) {
+		needed = UsesObjectLights(batches[i].material->GetPixelShader());
+	}
+	for (unsigned int i = 0; i < staticBatches.size() && !needed; i++) {
+		needed = UsesObjectLights(staticBatches[i].material->GetPixelShader());
+	}
+	if (!needed) {
+		return;
+	}
+
+	objectBounds.resize(items.size() + staticBatches.size());
+	for (unsigned int i = 0; i < items.size(); i++) {
+		objectBounds[i] = GetBoundingSphere(items[i].entity->GetWorldBounds());
+	}
+
+	for (unsigned int b = 0; b < staticBatches.size(); b++) {
+		BoundingBox bounds;
+		bool anyVisible = false;
+		for (unsigned int r = 0; r < staticBatches[b].ranges.size(); r++) {
+			const StaticRange& range = staticBatches[b].ranges[r];
+			if (!range.visible) {
+				continue;
+			}
+
+			BoundingBox entityBounds = range.entity->GetWorldBounds();
+			if (anyVisible) {
+				BoundingBox::CreateMerged(bounds, bounds, entityBounds);
+			}
+			else {
+				bounds = entityBounds;
+			}
+			anyVisible = true;
+		}
+
+		objectBounds[items.size() + b] = anyVisible ? GetBoundingSphere(bounds) : XMFLOAT4(0, 0, 0, 0);
+	}
+
+	// Point and spot lights come first, so the selections are buffer indices
+	const std::vector<Light>& packed = lights->GetPackedLights();
+	unsigned int lightCount = lights->GetLocalLightCount();
+	lightSelector->Select(lightCount > 0 ? &packed[0] : nullptr, lightCount, &objectBounds[0], (unsigned int)objectBounds.size());
+}
+
+// --------------------------------------------------------
+// Gathers every entity's bounding sphere, chain and last
+// level for the selector, then hands back the levels it
+// picked. Levels are kept by the entities, so the order
+// the entities come in can change from frame to frame.
+// --------------------------------------------------------
+void Renderer::SelectLods(const std::vector<Entity*>& entities, Camera* camera, std::vector<Entity*>& drawn)
+{
+	UpdateViewportSize();
+
+	drawn.clear();
+	submittedTriangles = 0;
+
+	// Bias doubles the allowed error per step
+	float errorThreshold = LodPixelError * exp2f(triangleBudget->GetLodBias());
+	lodSelector->SetErrorThreshold(errorThreshold);
+	lodSelector->SetFadeCull(triangleBudget->GetCullSize(), LodFadeRange);
+
+	XMFLOAT4X4 viewMatrix = camera->getViewMatrix();
+	XMFLOAT4X4 projectionMatrix = camera->getProjectionMatrix();
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&viewMatrix));
+	XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&projectionMatrix));
+
+	// Proxies are held to the same error as the levels they replace
+	XMVECTOR eye = XMMatrixInverse(nullptr, view).r[3];
+	hlodClusters.Select(eye, viewportSize.y * 0.5f * XMVectorGetY(projection.r[1]), errorThreshold);
+
+	// Merged meshes are drawn at full detail whatever level is picked,
+	// so batched entities skip selection and count what they draw
+	std::vector<HlodCluster>& clusters = hlodClusters.GetClusters();
+	lodEntities.clear();
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		unsigned int cluster;
+		if (hlodClusters.FindCluster(entities[i], cluster) && clusters[cluster].active) {
+			clusters[cluster].drawn = true;
+			continue;
+		}
+
+		unsigned int batchedTriangles = staticBatcher.GetTriangleCount(entities[i]);
+		if (batchedTriangles > 0) {
+			drawn.push_back(entities[i]);
+			submittedTriangles += batchedTriangles;
+		}
+		else {
+			lodEntities.push_back(entities[i]);
+		}
+	}
+
+	unsigned int count = (unsigned int)lodEntities.size();
+	lodBounds.resize(count);
+	lodChains.resize(count);
+	lodLevels.resize(count);
+	lodFades.resize(count);
+	for (unsigned int i = 0; i < count; i++) {
+		lodBounds[i] = GetBoundingSphere(lodEntities[i]->GetWorldBounds());
+		lodChains[i] = lodEntities[i]->GetLodChain();
+		lodLevels[i] = lodEntities[i]->GetLod();
+	}
+
+	if (count > 0) {
+		lodSelector->Select(view, projection, viewportSize.y, &lodBounds[0], &lodChains[0], &lodLevels[0], &lodFades[0], count);
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		lodEntities[i]->SetLod(lodLevels[i], lodFades[i]);
+		if (lodFades[i] > 0) {
+			drawn.push_back(lodEntities[i]);
+			submittedTriangles += lodEntities[i]->GetMesh()->GetIndexCount() / 3;
+		}
+	}
+
+	// One proxy for every cluster with a member in view
+	for (unsigned int i = 0; i < clusters.size(); i++) {
+		if (clusters[i].drawn) {
+			drawn.push_back(clusters[i].proxy);
+			submittedTriangles += clusters[i].proxyTriangles;
+		}
+	}
+}
+
+void Renderer::UpdateBudget(float cpuSeconds)
+{
+	triangleBudget->Update(submittedTriangles, cpuSeconds, gpuTimer->GetSeconds());
+}
+
+// Whether the shader is an object light variant whose
+// constants matched, so the selections can be patched in
+bool Renderer::UsesObjectLights(SimplePixelShader* ps)
+{
+	int keywords = pixelShaders->GetKeywords(ps);
+	return keywords >= 0 && objectLightConstants[keywords].IsValid();
+}
+
+// --------------------------------------------------------
+// Binds whichever light buffers the pixel shader declares
+// to the slots it declares them at; every variant reads the
+// lights, only clustered ones the clusters
+// --------------------------------------------------------
+void Renderer::BindLightBuffers(SimplePixelShader* ps, RenderCommandBuffer& commands)
+{
+	const SimpleSRV* lightsInfo = ps->GetShaderResourceViewInfo(LightsName);
+	if (lightsInfo) {
+		commands.BindTexture(StagePixel, lightsInfo->BindIndex, lightBuffer.srv);
+	}
+
+	const SimpleSRV* clustersInfo = ps->GetShaderResourceViewInfo(LightClustersName);
+	const SimpleSRV* indicesInfo = ps->GetShaderResourceViewInfo(LightIndicesName);
+	if (clustersInfo && indicesInfo) {
+		commands.BindTexture(StagePixel, clustersInfo->BindIndex, clusterBuffer.srv);
+		commands.BindTexture(StagePixel, indicesInfo->BindIndex, lightIndexBuffer.srv);
+	}
+}
+
+// --------------------------------------------------------
+// Makes sure the structured buffer can hold count elements,
+// growing it by at least half again each time. True if the
+// buffer was recreated, and so lost its contents.
+// --------------------------------------------------------
+bool Renderer::ReserveShaderBuffer(ShaderBuffer& buffer, unsigned int count, unsigned int stride)
+{
+	if (count <= buffer.capacity) {
+		return false;
+	}
+
+	unsigned int capacity = std::max(count, buffer.capacity + buffer.capacity / 2);
+	ReleaseShaderBuffer(buffer);
+	buffer.capacity = capacity;
+
+	D3D11_BUFFER_DESC desc;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = stride * capacity;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = stride;
+
+	if (FAILED(device->CreateBuffer(&desc, 0, &buffer.buffer))) {
+		buffer = {};
+		return true;
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = buffer.capacity;
+
+	if (FAILED(device->CreateShaderResourceView(buffer.buffer, &srvDesc, &buffer.srv))) {
+		ReleaseShaderBuffer(buffer);
+	}
+	return true;
+}
+
+void Renderer::UploadShaderBuffer(ShaderBuffer& buffer, const void* data, unsigned int size)
+{
+	if (buffer.buffer == nullptr) {
+		return;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (SUCCEEDED(context->Map(buffer.buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+		memcpy(mapped.pData, data, size);
+		context->Unmap(buffer.buffer, 0);
+	}
+}
+
+void Renderer::ReleaseShaderBuffer(ShaderBuffer& buffer)
+{
+	if (buffer.srv) { buffer.srv->Release(); }
+	if (buffer.buffer) { buffer.buffer->Release(); }
+	buffer = {};
+}
+
+// --------------------------------------------------------
+// Snapshots the shader's local constant buffer data into
+// the command list, in place of CopyAllBufferData(), then
+// applies the patches to the copy. Snapshots identical to
+// what the list already bound to the slot are dropped.
+// --------------------------------------------------------
+void Renderer::RecordConstants(ShaderStage stage, ISimpleShader* shader, const ConstantPatch* patches, unsigned int patchCount, RenderCommandBuffer& commands)
+{
+	if (!shader->IsShaderValid()) return;
+
+	unsigned int bufferCount = shader->GetBufferCount();
+	for (unsigned int i = 0; i < bufferCount; i++) {
+		const SimpleConstantBuffer* buffer = shader->GetBufferInfo(i);
+		unsigned char* data = (unsigned char*)commands.SetConstants(stage, buffer->BindIndex, buffer->ConstantBuffer, buffer->LocalDataBuffer, buffer->Size);
+
+		for (unsigned int p = 0; p < patchCount; p++) {
+			const ShaderVarHandle& variable = patches[p].variable;
+			if (variable.IsValid() && variable.ConstantBufferIndex == i) {
+				memcpy(data + variable.ByteOffset, patches[p].data, std::min(patches[p].size, variable.Size));
+			}
+		}
+
+		commands.DropRepeatedConstants();
+	}
 }
@@ -5,6 +5,27 @@
 #include "Material.h"
 #include "Entity.h"
 #include "Camera.h"
+#include "LightManager.h"
+#include "RenderQueue.h"
+#include "InstanceBatcher.h"
+#include "StaticBatcher.h"
+#include "HlodClusters.h"
+#include "LightClusters.h"
+#include "ObjectLightSelector.h"
+#include "LodSelector.h"
+#include "TriangleBudget.h"
+#include "GpuTimer.h"
+#include "ShaderConstants.h"
+#include "ConstantBlock.h"
+#include "ObjectTransforms.h"
+#include "ShaderPermutations.h"
+#include "ShaderBuilder.h"
+#include "D3DShaderCompiler.h"
+#include "DeviceContextStateTarget.h"
+#include "RenderCommandBuffer.h"
+#include "D3D11RenderExecutor.h"
+#include "ConstantUploader.h"
+#include "ThreadPool.h"
 #include <DirectXMath.h>
 
 using namespace DirectX;
@@ -14,24 +35,303 @@ class Renderer
 	ID3D11Device*			device;
 	ID3D11DeviceContext*	context;
 
-	// Wrappers for DirectX shaders to provide simplified functionality
+	// Wrappers for DirectX shaders to provide simplified functionality.
+	// The default pixel shader is the keyword-less variant.
 	SimpleVertexShader* vertexShader;
+	PixelShaderPermutations* pixelShaders;
 	SimplePixelShader* pixelShader;
 
+	// Used in place of the default vertex shader when drawing instance
+	// batches, with the instanced variant of the material's pixel shader
+	SimpleVertexShader* instancedVertexShader;
+
 	ID3D11SamplerState* sampler;
 
 	ID3D11Texture2D* defaultTexture;
 	ID3D11ShaderResourceView* defaultSrv;
 	Material* baseMaterial;
 
+	// Whole buffer writers for the shaders above, valid if
+	// their layouts matched reflection when they were loaded.
+	// The lighting ones are indexed by pixel shader variant.
+	ConstantBlock<ObjectConstants> objectConstants;
+	ConstantBlock<FrameConstants> frameConstants;
+	ConstantBlock<LightConstants> lightConstants[ShaderVariantCount];
+
+	// Visible draws for the current frame, sorted by state
+	RenderQueue renderQueue;
+
+	// World matrices of the queued draws, in queue order, and the
+	// vertex shader constants computed from them for the frame;
+	// the static batches share the one for an identity world
+	std::vector<XMFLOAT4X4> objectWorlds;
+	std::vector<ObjectConstants> objectTransforms;
+	ObjectConstants staticTransform;
+
+	// Runs of the queue sharing a mesh and material, and the
+	// dynamic vertex buffer their instance data is copied to
+	InstanceBatcher instanceBatcher;
+	ID3D11Buffer* instanceBuffer;
+	unsigned int instanceCapacity;
+
+	// A dynamic structured buffer and its view, grown as needed
+	struct ShaderBuffer
+	{
+		ID3D11Buffer* buffer;
+		ID3D11ShaderResourceView* srv;
+		unsigned int capacity;
+	};
+
+	// Every light, as LightManager packed it, uploaded only in
+	// frames where that changed
+	ShaderBuffer lightBuffer;
+	bool lightsChanged;
+	bool lightsUploaded;
+
+	// Point and spot lights binned into clusters each frame, the
+	// buffers the clustered pixel shader variants read them from,
+	// and the viewport size that maps pixels to clusters
+	LightClusters* lightClusters;
+	ShaderBuffer clusterBuffer;
+	ShaderBuffer lightIndexBuffer;
+	ConstantBlock<ClusterConstants> clusterConstants[ShaderVariantCount];
+	XMFLOAT2 viewportSize;
+
+	// The few local lights each queued draw, then each static
+	// batch, is lit by in the object light variants, picked from
+	// spheres around them. Only done when one of those is drawn.
+	ObjectLightSelector* lightSelector;
+	std::vector<XMFLOAT4> objectBounds;
+	ConstantBlock<ObjectLightConstants> objectLightConstants[ShaderVariantCount];
+
+	// Detail levels for the entities about to be drawn, gathered
+	// from them and handed back once picked
+	LodSelector* lodSelector;
+	std::vector<XMFLOAT4> lodBounds;
+	std::vector<LodChain> lodChains;
+	std::vector<unsigned int> lodLevels;
+	std::vector<float> lodFades;
+
+	// Trades detail for staying under the triangle and frame time
+	// budgets, from the triangles SelectLods() let through and the
+	// time the GPU took to draw them
+	TriangleBudget* triangleBudget;
+	GpuTimer* gpuTimer;
+	unsigned int submittedTriangles;
+
+	// Static entities merged into one mesh per material, and the
+	// visible entities left over for the queue each frame
+	StaticBatcher staticBatcher;
+	std::vector<Entity*> dynamicEntities;
+
+	// Groups of static entities drawn as one simplified mesh once far
+	// enough away, and the entities left to pick levels for each frame
+	HlodClusters hlodClusters;
+	std::vector<Entity*> lodEntities;
+
+	// Filters out redundant shader, resource and buffer bindings
+	DeviceContextStateTarget* stateTarget;
+	StateCache* stateCache;
+
+	// The frame is recorded into one list per thread, then
+	// played back by the executor in list order
+	ThreadPool* threadPool;
+	std::vector<RenderCommandBuffer> commandLists;
+	unsigned int commandListCount;
+	IRenderExecutor* executor;
+	float recordSeconds;
+
+	// Startup cost of LoadShaders(), and how many shaders
+	// skipped reflection by reading their sidecar files
+	float shaderLoadSeconds;
+	unsigned int shadersFromSidecar;
+
+	// Recompiles changed shader sources at startup in debug
+	// builds run from the project folder; nullptr otherwise
+	D3DShaderCompiler shaderCompiler;
+	ShaderBuilder* shaderBuilder;
+
+	// Puts each frame's constants in one buffer, when the device
+	// supports binding parts of it; nullptr otherwise
+	ConstantUploader* constantUploader;
+
+	// Overrides one variable in a shader's constants as they're recorded
+	struct ConstantPatch
+	{
+		ShaderVarHandle variable;
+		const void* data;
+		unsigned int size;
+	};
+
+	void UpdateViewportSize();
+	void ComputeTransforms(Camera* camera);
+	void PackLights(LightManager* lights);
+	void AssignLights(LightManager* lights, Camera* camera);
+	void UploadLights(LightManager* lights);
+	void SelectLights(LightManager* lights);
+	bool UsesObjectLights(SimplePixelShader* ps);
+	void BindLightBuffers(SimplePixelShader* ps, RenderCommandBuffer& commands);
+	bool ReserveShaderBuffer(ShaderBuffer& buffer, unsigned int count, unsigned int stride);
+	void UploadShaderBuffer(ShaderBuffer& buffer, const void* data, unsigned int size);
+	void ReleaseShaderBuffer(ShaderBuffer& buffer);
+	void SetFrameConstants(const std::vector<InstanceBatch>& batches, Camera* camera, LightManager* lights);
+	void SetViewConstants(SimpleVertexShader* vs, const XMFLOAT4X4& view, const XMFLOAT4X4& projection);
+	void SetLightConstants(SimplePixelShader* ps, const LightConstants& lighting);
+	void RecordStatic(RenderCommandBuffer& commands);
+	void RecordRange(const std::vector<InstanceBatch>& batches, unsigned int first, unsigned int last, RenderCommandBuffer& commands);
+	bool CanInstance(const InstanceBatch& batch);
+	SimplePixelShader* GetInstancedPixelShader(Material* material);
+	void ReserveInstances(unsigned int count);
+	void UploadInstances();
+	void RecordConstants(ShaderStage stage, ISimpleShader* shader, const ConstantPatch* patches, unsigned int patchCount, RenderCommandBuffer& commands);
+
+	void BuildShaders();
 	void LoadShaders();
 	void CreateSampler();
 	void CreateDefaultMaterial();
 	
 public:
-	Renderer(ID3D11Device* device, ID3D11DeviceContext* context);
+	Renderer(ID3D11Device* device, ID3D11DeviceContext* context, ThreadPool* threadPool);
 	~Renderer();
 
-	void Render(Entity* entity, Camera* camera);
+	// Sorts the entities by GPU state and draws them, lit by the
+	// directional lights and, in clustered and object light
+	// variants, the local ones. Packs the lights first.
+	void Render(const std::vector<Entity*>& entities, Camera* camera, LightManager* lights);
+
+	// Picks each entity's detail level from its size on screen, and
+	// writes the ones that aren't fade culled into drawn, in order.
+	// Entities in clusters far enough away are swapped for the
+	// clusters' proxies, which go at the end. Statically batched
+	// entities always draw their merged full detail geometry, so
+	// they skip selection, go first, and are counted at that.
+	// Less detail is kept the further over budget recent frames were.
+	void SelectLods(const std::vector<Entity*>& entities, Camera* camera, std::vector<Entity*>& drawn);
+
+	// Feeds the frame's triangles and times to the budget, once the
+	// frame is drawn; cpuSeconds covers the whole frame's CPU work
+	void UpdateBudget(float cpuSeconds);
+
+	// Merges the entities flagged static; call again if any of them move
+	void BuildStaticBatches(const std::vector<Entity*>& entities);
+
+	// Clusters the entities flagged static and builds their proxies.
+	// Call before BuildStaticBatches(), which merges the proxies too.
+	void BuildHlodClusters(const std::vector<Entity*>& entities);
+
+	// Records the draws for the entities without touching the device context,
+	// split across the lists in draw order. Returns how many lists were used.
+	// The first list always holds the static batches.
+	unsigned int Record(const std::vector<Entity*>& entities, Camera* camera, LightManager* lights, std::vector<RenderCommandBuffer>& lists);
+
+	SimpleVertexShader* GetVertexShader() {
+		return vertexShader;
+	}
+
+	SimplePixelShader* GetPixelShader() {
+		return pixelShader;
+	}
+
+	// The variant with these keywords, or the nearest one built
+	SimplePixelShader* GetPixelShader(unsigned int keywords) {
+		return pixelShaders->Find(keywords & ~KeywordInstanced);
+	}
+
+	PixelShaderPermutations* GetPixelShaderPermutations() {
+		return pixelShaders;
+	}
+
+	ID3D11SamplerState* GetSampler() {
+		return sampler;
+	}
+
+	ID3D11ShaderResourceView* GetDefaultTexture() {
+		return defaultSrv;
+	}
+
+	Material* GetDefaultMaterial() {
+		return baseMaterial;
+	}
+
+	RenderQueue* GetRenderQueue() {
+		return &renderQueue;
+	}
+
+	InstanceBatcher* GetInstanceBatcher() {
+		return &instanceBatcher;
+	}
+
+	StaticBatcher* GetStaticBatcher() {
+		return &staticBatcher;
+	}
+
+	HlodClusters* GetHlodClusters() {
+		return &hlodClusters;
+	}
+
+	LightClusters* GetLightClusters() {
+		return lightClusters;
+	}
+
+	ObjectLightSelector* GetObjectLightSelector() {
+		return lightSelector;
+	}
+
+	// Whether last frame had to upload the light buffer
+	bool WereLightsUploaded() {
+		return lightsUploaded;
+	}
+
+	LodSelector* GetLodSelector() {
+		return lodSelector;
+	}
+
+	TriangleBudget* GetTriangleBudget() {
+		return triangleBudget;
+	}
+
+	// Triangles in the meshes last picked by SelectLods()
+	unsigned int GetSubmittedTriangleCount() {
+		return submittedTriangles;
+	}
+
+	StateCache* GetStateCache() {
+		return stateCache;
+	}
+
+	const std::vector<RenderCommandBuffer>& GetCommandLists() {
+		return commandLists;
+	}
+
+	unsigned int GetCommandListCount() {
+		return commandListCount;
+	}
+
+	ConstantUploader* GetConstantUploader() {
+		return constantUploader;
+	}
+
+	// Constant data sent to the GPU last frame, whichever way it went
+	size_t GetConstantBytesUploaded();
+
+	// Constant snapshots dropped last frame because the same data
+	// was already bound, and the bytes they would have uploaded
+	unsigned int GetSkippedUploadCount();
+	size_t GetConstantBytesSaved();
+
+	// Recording throughput of the last frame
+	float GetRecordedDrawsPerSecond();
+
+	float GetShaderLoadSeconds() {
+		return shaderLoadSeconds;
+	}
+
+	unsigned int GetShadersLoadedFromSidecar() {
+		return shadersFromSidecar;
+	}
+
+	ShaderBuilder* GetShaderBuilder() {
+		return shaderBuilder;
+	}
 };
 
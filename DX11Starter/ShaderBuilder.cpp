@@ -0,0 +1,146 @@
+#include "ShaderBuilder.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+// 64 bit FNV-1a, continued from hash
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+// Strings are hashed with their terminator, so "ab" + "c"
+// and "a" + "bc" don't produce the same key
+static uint64_t HashString(uint64_t hash, const std::string& value)
+{
+	return HashBytes(hash, value.c_str(), value.size() + 1);
+}
+
+static bool ReadFile(const std::string& path, std::vector<unsigned char>& data)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+static bool WriteFile(const std::string& path, const std::vector<unsigned char>& data)
+{
+	std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file) {
+		return false;
+	}
+
+	if (!data.empty()) {
+		file.write((const char*)&data[0], data.size());
+	}
+	return file.good();
+}
+
+ShaderBuilder::ShaderBuilder(IShaderCompiler* compiler, ThreadPool* threadPool, const std::string& cacheDirectory)
+{
+	this->compiler = compiler;
+	this->threadPool = threadPool;
+	this->cacheDirectory = cacheDirectory;
+
+	compilerVersion = compiler->GetVersion();
+	buildSeconds = 0;
+}
+
+ShaderBuilder::~ShaderBuilder()
+{
+}
+
+bool ShaderBuilder::Build(const std::vector<ShaderBuildJob>& jobs)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	results.assign(jobs.size(), ShaderBuildResult());
+	threadPool->ParallelFor((unsigned int)jobs.size(), [&](unsigned int i) {
+		BuildJob(jobs[i], results[i]);
+	});
+
+	buildSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+	return GetFailedCount() == 0;
+}
+
+uint64_t ShaderBuilder::GetCacheKey(const ShaderBuildJob& job, const std::string& preprocessed, const std::string& compilerVersion)
+{
+	uint64_t hash = 14695981039346656037ull;
+	hash = HashString(hash, compilerVersion);
+	hash = HashString(hash, job.Profile);
+	hash = HashString(hash, job.EntryPoint);
+
+	for (unsigned int i = 0; i < job.Defines.size(); i++) {
+		hash = HashString(hash, job.Defines[i].Name);
+		hash = HashString(hash, job.Defines[i].Value);
+	}
+
+	return HashString(hash, preprocessed);
+}
+
+// --------------------------------------------------------
+// Runs on a pool thread; only touches its own result
+// --------------------------------------------------------
+void ShaderBuilder::BuildJob(const ShaderBuildJob& job, ShaderBuildResult& result)
+{
+	result.Status = ShaderBuildFailed;
+	result.Key = 0;
+
+	std::string preprocessed;
+	if (!compiler->Preprocess(job, preprocessed, result.Errors)) {
+		return;
+	}
+
+	result.Key = GetCacheKey(job, preprocessed, compilerVersion);
+	std::string cachePath = GetCachePath(result.Key);
+
+	std::vector<unsigned char> bytecode;
+	if (ReadFile(cachePath, bytecode)) {
+		// Leave an up to date output alone, so its timestamp
+		// (and anything keyed on it) doesn't change
+		std::vector<unsigned char> existing;
+		if ((ReadFile(job.OutputFile, existing) && existing == bytecode) || WriteFile(job.OutputFile, bytecode)) {
+			result.Status = ShaderBuildCached;
+		}
+		return;
+	}
+
+	if (!compiler->Compile(job, preprocessed, bytecode, result.Errors)) {
+		return;
+	}
+
+	// A failed cache write only costs a compile next time
+	WriteFile(cachePath, bytecode);
+	if (WriteFile(job.OutputFile, bytecode)) {
+		result.Status = ShaderBuildCompiled;
+	}
+}
+
+std::string ShaderBuilder::GetCachePath(uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)key);
+	return cacheDirectory + "/" + name;
+}
+
+unsigned int ShaderBuilder::CountResults(ShaderBuildStatus status)
+{
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < results.size(); i++) {
+		count += results[i].Status == status;
+	}
+
+	return count;
+}
+
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string Name;
+	std::string Value;
+};
+
+// --------------------------------------------------------
+// One .hlsl to compile, with its defines, into one .cso
+// --------------------------------------------------------
+struct ShaderBuildJob
+{
+	std::string SourceFile;
+	std::string EntryPoint;
+	std::string Profile;			// "vs_5_0", "ps_5_0" and so on
+	std::vector<ShaderDefine> Defines;
+	std::string OutputFile;
+};
+
+// --------------------------------------------------------
+// The compiler behind a ShaderBuilder. Both methods are
+// called from several threads at once.
+// --------------------------------------------------------
+class IShaderCompiler
+{
+public:
+	virtual ~IShaderCompiler() {}
+
+	// Expands the job's includes and defines; the result is
+	// what gets hashed, so edits to included files count too
+	virtual bool Preprocess(const ShaderBuildJob& job, std::string& output, std::string& errors) = 0;
+
+	virtual bool Compile(const ShaderBuildJob& job, const std::string& preprocessed, std::vector<unsigned char>& bytecode, std::string& errors) = 0;
+
+	// Part of every cache key, along with anything else that
+	// changes the output (optimization flags and the like)
+	virtual std::string GetVersion() = 0;
+};
+
+enum ShaderBuildStatus
+{
+	ShaderBuildCompiled,
+	ShaderBuildCached,
+	ShaderBuildFailed
+};
+
+struct ShaderBuildResult
+{
+	ShaderBuildStatus Status;
+	uint64_t Key;
+	std::string Errors;
+};
+
+// --------------------------------------------------------
+// Compiles a set of shaders in parallel, caching bytecode
+// under a hash of the preprocessed source, defines, entry
+// point, profile and compiler version.
+//
+// A job whose key is already in the cache directory just has
+// its cached bytecode copied to the output, so only shaders
+// that actually changed are compiled. Entries are never
+// evicted; clear the directory to start over.
+// --------------------------------------------------------
+class ShaderBuilder
+{
+public:
+	// The cache directory has to exist; without it nothing is
+	// cached and every build compiles everything
+	ShaderBuilder(IShaderCompiler* compiler, ThreadPool* threadPool, const std::string& cacheDirectory);
+	~ShaderBuilder();
+
+	// Builds every job; false if any of them failed
+	bool Build(const std::vector<ShaderBuildJob>& jobs);
+
+	// Per job, in the order given to Build()
+	const std::vector<ShaderBuildResult>& GetResults() { return results; }
+
+	unsigned int GetCompiledCount() { return CountResults(ShaderBuildCompiled); }
+	unsigned int GetCachedCount() { return CountResults(ShaderBuildCached); }
+	unsigned int GetFailedCount() { return CountResults(ShaderBuildFailed); }
+	float GetBuildSeconds() { return buildSeconds; }
+
+	static uint64_t GetCacheKey(const ShaderBuildJob& job, const std::string& preprocessed, const std::string& compilerVersion);
+
+private:
+	IShaderCompiler* compiler;
+	ThreadPool* threadPool;
+	std::string cacheDirectory;
+	std::string compilerVersion;
+
+	std::vector<ShaderBuildResult> results;
+	float buildSeconds;
+
+	void BuildJob(const ShaderBuildJob& job, ShaderBuildResult& result);
+	std::string GetCachePath(uint64_t key);
+	unsigned int CountResults(ShaderBuildStatus status);
+};
+
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "AffineMatrix.h"
+#include "ConstantBufferLayout.h"
+#include "ObjectLightSelector.h"
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// C++ mirrors of the engine shaders' constant buffers.
+// Matrices are stored transposed, as the shaders expect.
+// --------------------------------------------------------
+
+// VertexShader.hlsl, cbuffer externalData; filled in for
+// every object by ComputeObjectTransforms()
+struct ObjectConstants
+{
+	DirectX::XMFLOAT4X4 worldViewProj;
+	AffineMatrix normalMatrix;			// Inverse transpose of the world's upper 3x3
+	AffineMatrix objectToWorld;			// For world space positions, which local lights need
+
+	static const ConstantFieldInfo* GetFields(unsigned int& count)
+	{
+		static const ConstantFieldInfo fields[] = {
+			CBUFFER_FIELD(ObjectConstants, worldViewProj),
+			CBUFFER_FIELD(ObjectConstants, normalMatrix),
+			CBUFFER_FIELD(ObjectConstants, objectToWorld)
+		};
+		count = sizeof(fields) / sizeof(fields[0]);
+		return fields;
+	}
+};
+
+CBUFFER_CHECK_FIRST(ObjectConstants, worldViewProj);
+CBUFFER_CHECK_NEXT(ObjectConstants, normalMatrix, worldViewProj);
+CBUFFER_CHECK_NEXT(ObjectConstants, objectToWorld, normalMatrix);
+CBUFFER_CHECK_SIZE(ObjectConstants);
+
+// VertexShaderInstanced.hlsl, cbuffer externalData
+struct FrameConstants
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+
+	static const ConstantFieldInfo* GetFields(unsigned int& count)
+	{
+		static const ConstantFieldInfo fields[] = {
+			CBUFFER_FIELD(FrameConstants, view),
+			CBUFFER_FIELD(FrameConstants, projection)
+		};
+		count = sizeof(fields) / sizeof(fields[0]);
+		return fields;
+	}
+};
+
+CBUFFER_CHECK_FIRST(FrameConstants, view);
+CBUFFER_CHECK_NEXT(FrameConstants, projection, view);
+CBUFFER_CHECK_SIZE(FrameConstants);
+
+// PixelShader.hlsl, cbuffer lightData; where the directional
+// lights start in the light buffer, after the local ones
+struct LightConstants
+{
+	unsigned int directionalLightStart;
+	unsigned int directionalLightCount;
+	unsigned int padding[2];
+
+	static const ConstantFieldInfo* GetFields(unsigned int& count)
+	{
+		static const ConstantFieldInfo fields[] = {
+			CBUFFER_FIELD(LightConstants, directionalLightStart),
+			CBUFFER_FIELD(LightConstants, directionalLightCount)
+		};
+		count = sizeof(fields) / sizeof(fields[0]);
+		return fields;
+	}
+};
+
+CBUFFER_CHECK_FIRST(LightConstants, directionalLightStart);
+CBUFFER_CHECK_NEXT(LightConstants, directionalLightCount, directionalLightStart);
+CBUFFER_CHECK_SIZE(LightConstants);
+
+// PixelShader.hlsl with CLUSTERED, cbuffer clusterData
+struct ClusterConstants
+{
+	DirectX::XMFLOAT4 depthPlane;		// View space depth of a world position, as a plane
+	DirectX::XMFLOAT2 clusterScale;		// Clusters per pixel, across and down
+	float depthScale;					// Slice = log(depth) * depthScale + depthBias
+	float depthBias;
+
+	static const ConstantFieldInfo* GetFields(unsigned int& count)
+	{
+		static const ConstantFieldInfo fields[] = {
+			CBUFFER_FIELD(ClusterConstants, depthPlane),
+			CBUFFER_FIELD(ClusterConstants, clusterScale),
+			CBUFFER_FIELD(ClusterConstants, depthScale),
+			CBUFFER_FIELD(ClusterConstants, depthBias)
+		};
+		count = sizeof(fields) / sizeof(fields[0]);
+		return fields;
+	}
+};
+
+CBUFFER_CHECK_FIRST(ClusterConstants, depthPlane);
+CBUFFER_CHECK_NEXT(ClusterConstants, clusterScale, depthPlane);
+CBUFFER_CHECK_NEXT(ClusterConstants, depthScale, clusterScale);
+CBUFFER_CHECK_NEXT(ClusterConstants, depthBias, depthScale);
+CBUFFER_CHECK_SIZE(ClusterConstants);
+
+// PixelShader.hlsl with OBJECT_LIGHTS, cbuffer objectLightData;
+// patched in for every object from its ObjectLightSet. The
+// indices are into the light buffer.
+struct ObjectLightConstants
+{
+	DirectX::XMUINT4 objectLightIndices;
+	unsigned int objectLightCount;
+	unsigned int padding[3];
+
+	static const ConstantFieldInfo* GetFields(unsigned int& count)
+	{
+		static const ConstantFieldInfo fields[] = {
+			CBUFFER_FIELD(ObjectLightConstants, objectLightIndices),
+			CBUFFER_FIELD(ObjectLightConstants, objectLightCount)
+		};
+		count = sizeof(fields) / sizeof(fields[0]);
+		return fields;
+	}
+};
+
+static_assert(MaxObjectLights == 4, "objectLightIndices holds four lights");
+CBUFFER_CHECK_FIRST(ObjectLightConstants, objectLightIndices);
+CBUFFER_CHECK_NEXT(ObjectLightConstants, objectLightCount, objectLightIndices);
+CBUFFER_CHECK_SIZE(ObjectLightConstants);
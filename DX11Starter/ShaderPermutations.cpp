@@ -0,0 +1,90 @@
+#include "ShaderPermutations.h"
+#include <chrono>
+
+PixelShaderPermutations::PixelShaderPermutations(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+	this->device = device;
+	this->context = context;
+
+	for (unsigned int i = 0; i < ShaderVariantCount; i++) {
+		variants[i] = nullptr;
+	}
+	variantCount = 0;
+	loadSeconds = 0;
+}
+
+PixelShaderPermutations::~PixelShaderPermutations()
+{
+	for (unsigned int i = 0; i < ShaderVariantCount; i++) {
+		delete variants[i];
+	}
+}
+
+void PixelShaderPermutations::Load(const std::wstring& baseName)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	for (unsigned int keywords = 0; keywords < ShaderVariantCount; keywords++) {
+		delete variants[keywords];
+		variants[keywords] = nullptr;
+
+		std::wstring fileName = GetVariantName(baseName, keywords) + L".cso";
+		SimplePixelShader* shader = new SimplePixelShader(device, context);
+		if (!shader->LoadShaderFile((L"Debug/" + fileName).c_str()) && !shader->LoadShaderFile(fileName.c_str())) {
+			delete shader;
+			continue;
+		}
+
+		variants[keywords] = shader;
+	}
+
+	variantCount = 0;
+	for (unsigned int i = 0; i < ShaderVariantCount; i++) {
+		variantCount += variants[i] != nullptr;
+	}
+
+	loadSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Drops keywords, lowest bit first, until a built variant
+// turns up. The instancing keyword is never dropped, since
+// it changes where the shader reads its color from.
+// --------------------------------------------------------
+SimplePixelShader* PixelShaderPermutations::Find(unsigned int keywords)
+{
+	unsigned int fixedKeywords = keywords & KeywordInstanced;
+	unsigned int optionalKeywords = keywords & ~KeywordInstanced;
+
+	while (true) {
+		SimplePixelShader* shader = variants[fixedKeywords | optionalKeywords];
+		if (shader != nullptr || optionalKeywords == 0) {
+			return shader;
+		}
+
+		optionalKeywords &= optionalKeywords - 1;
+	}
+}
+
+int PixelShaderPermutations::GetKeywords(SimplePixelShader* shader)
+{
+	for (unsigned int i = 0; i < ShaderVariantCount; i++) {
+		if (shader != nullptr && variants[i] == shader) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+std::wstring PixelShaderPermutations::GetVariantName(const std::wstring& baseName, unsigned int keywords)
+{
+	std::wstring name = baseName;
+	if (keywords & KeywordOneLight) name += L"OneLight";
+	if (keywords & KeywordUntextured) name += L"Untextured";
+	if (keywords & KeywordClustered) name += L"Clustered";
+	if (keywords & KeywordObjectLights) name += L"ObjectLights";
+	if (keywords & KeywordInstanced) name += L"Instanced";
+	return name;
+}
+
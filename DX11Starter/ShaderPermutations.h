@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SimpleShader.h"
+#include <string>
+
+// --------------------------------------------------------
+// Feature keywords of PixelShader.hlsl. A variant's keyword
+// mask is also its index in the permutation set.
+// --------------------------------------------------------
+enum ShaderKeyword
+{
+	KeywordOneLight = 1 << 0,		// LIGHT_COUNT 1 instead of 2
+	KeywordUntextured = 1 << 1,		// TEXTURED 0, the material color alone
+	KeywordInstanced = 1 << 2,		// INSTANCED 1, the color comes per instance
+	KeywordClustered = 1 << 3,		// CLUSTERED 1, adds the point and spot lights
+	KeywordObjectLights = 1 << 4,	// OBJECT_LIGHTS 1, adds the few picked per object
+	ShaderVariantCount = 1 << 5
+};
+
+// --------------------------------------------------------
+// The compiled variants of one pixel shader, keyed by
+// keyword mask.
+//
+// Each variant is its own .cso, compiled from a small .hlsl
+// that defines its keywords and includes the base source,
+// named after the base plus the keywords it sets:
+// PixelShader, PixelShaderInstanced, PixelShaderOneLight-
+// Untextured and so on. Only the variants some material
+// uses get a file, so the others are never compiled or
+// shipped; Load() picks up whichever exist.
+// --------------------------------------------------------
+class PixelShaderPermutations
+{
+public:
+	PixelShaderPermutations(ID3D11Device* device, ID3D11DeviceContext* context);
+	~PixelShaderPermutations();
+
+	// Loads every variant of the base shader it can find,
+	// from Debug/ or the working directory
+	void Load(const std::wstring& baseName);
+
+	// The variant with exactly these keywords, or nullptr
+	SimplePixelShader* Get(unsigned int keywords) { return variants[keywords]; }
+
+	// The variant, or the closest one built with fewer keywords,
+	// which computes a superset of it (more lights, a texture).
+	// Local lights are dropped last, as they aren't a superset.
+	SimplePixelShader* Find(unsigned int keywords);
+
+	// Keywords of one of the variants, or -1 if it isn't one
+	int GetKeywords(SimplePixelShader* shader);
+
+	// "PixelShader" + "OneLight" + "Untextured" + "Clustered"
+	// + "ObjectLights" + "Instanced"
+	static std::wstring GetVariantName(const std::wstring& baseName, unsigned int keywords);
+
+	unsigned int GetVariantCount() { return variantCount; }
+	float GetLoadSeconds() { return loadSeconds; }
+
+private:
+	ID3D11Device* device;
+	ID3D11DeviceContext* context;
+
+	SimplePixelShader* variants[ShaderVariantCount];
+	unsigned int variantCount;
+	float loadSeconds;
+};
+
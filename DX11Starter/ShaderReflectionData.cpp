@@ -0,0 +1,297 @@
+#include "ShaderReflectionData.h"
+#include <algorithm>
+#include <cstring>
+
+static const uint32_t SidecarMagic = 0x4C465253;	// "SRFL"
+static const uint32_t SidecarVersion = 1;
+
+ShaderReflectionData::ShaderReflectionData()
+{
+}
+
+ShaderReflectionData::~ShaderReflectionData()
+{
+}
+
+void ShaderReflectionData::Clear()
+{
+	buffers.clear();
+	variables.clear();
+	resources.clear();
+
+	bufferLookup.clear();
+	variableLookup.clear();
+	for (unsigned int t = 0; t < ResourceTypeCount; t++) {
+		resourceLookup[t].clear();
+		resourcesByType[t].clear();
+	}
+}
+
+void ShaderReflectionData::AddBuffer(const std::string& name, unsigned int size, unsigned int bindIndex)
+{
+	ReflectedBuffer buffer = { name, size, bindIndex };
+	buffers.push_back(buffer);
+}
+
+void ShaderReflectionData::AddVariable(const std::string& name, unsigned int bufferIndex, unsigned int byteOffset, unsigned int size)
+{
+	ReflectedVariable variable = { name, bufferIndex, byteOffset, size };
+	variables.push_back(variable);
+}
+
+void ShaderReflectionData::AddResource(const std::string& name, ShaderResourceType type, unsigned int bindIndex)
+{
+	ReflectedResource resource = { name, type, bindIndex };
+	resources.push_back(resource);
+}
+
+void ShaderReflectionData::SortLookup(std::vector<LookupEntry>& table)
+{
+	std::sort(table.begin(), table.end(), [](const LookupEntry& a, const LookupEntry& b) {
+		return a.Hash < b.Hash || (a.Hash == b.Hash && a.Index < b.Index);
+	});
+}
+
+void ShaderReflectionData::BuildLookup()
+{
+	bufferLookup.clear();
+	for (unsigned int i = 0; i < buffers.size(); i++) {
+		LookupEntry entry = { HashShaderName(buffers[i].Name.c_str()), i, i };
+		bufferLookup.push_back(entry);
+	}
+	SortLookup(bufferLookup);
+
+	variableLookup.clear();
+	for (unsigned int i = 0; i < variables.size(); i++) {
+		LookupEntry entry = { HashShaderName(variables[i].Name.c_str()), i, i };
+		variableLookup.push_back(entry);
+	}
+	SortLookup(variableLookup);
+
+	for (unsigned int t = 0; t < ResourceTypeCount; t++) {
+		resourceLookup[t].clear();
+		resourcesByType[t].clear();
+	}
+	for (unsigned int i = 0; i < resources.size(); i++) {
+		ShaderResourceType type = resources[i].Type;
+		LookupEntry entry = { HashShaderName(resources[i].Name.c_str()), (unsigned int)resourcesByType[type].size(), i };
+		resourceLookup[type].push_back(entry);
+		resourcesByType[type].push_back(i);
+	}
+	for (unsigned int t = 0; t < ResourceTypeCount; t++) {
+		SortLookup(resourceLookup[t]);
+	}
+}
+
+// --------------------------------------------------------
+// Binary search on the hash. With a name, the entries that
+// share the hash are checked for it; without one, a shared
+// hash is ambiguous and finds nothing.
+// --------------------------------------------------------
+template <typename T>
+int ShaderReflectionData::Find(const std::vector<LookupEntry>& table, const std::vector<T>& items, uint32_t hash, const std::string* name)
+{
+	std::vector<LookupEntry>::const_iterator it = std::lower_bound(table.begin(), table.end(), hash,
+		[](const LookupEntry& entry, uint32_t value) { return entry.Hash < value; });
+
+	if (name == nullptr) {
+		if (it == table.end() || it->Hash != hash) return NotFound;
+		if (it + 1 != table.end() && (it + 1)->Hash == hash) return NotFound;
+		return (int)it->Index;
+	}
+
+	for (; it != table.end() && it->Hash == hash; ++it) {
+		if (items[it->ItemIndex].Name == *name) {
+			return (int)it->Index;
+		}
+	}
+
+	return NotFound;
+}
+
+int ShaderReflectionData::FindBuffer(const std::string& name) const
+{
+	return Find(bufferLookup, buffers, HashShaderName(name.c_str()), &name);
+}
+
+int ShaderReflectionData::FindVariable(const std::string& name) const
+{
+	return Find(variableLookup, variables, HashShaderName(name.c_str()), &name);
+}
+
+int ShaderReflectionData::FindVariable(ShaderNameId name) const
+{
+	return Find(variableLookup, variables, name.Hash, (const std::string*)nullptr);
+}
+
+int ShaderReflectionData::FindResource(ShaderResourceType type, const std::string& name) const
+{
+	return Find(resourceLookup[type], resources, HashShaderName(name.c_str()), &name);
+}
+
+int ShaderReflectionData::FindResource(ShaderResourceType type, ShaderNameId name) const
+{
+	return Find(resourceLookup[type], resources, name.Hash, (const std::string*)nullptr);
+}
+
+uint64_t ShaderReflectionData::HashBytecode(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+// --------------------------------------------------------
+// Little endian helpers for the sidecar format
+// --------------------------------------------------------
+static void WriteUInt(std::vector<unsigned char>& output, uint32_t value)
+{
+	for (unsigned int i = 0; i < 4; i++) {
+		output.push_back((unsigned char)(value >> (i * 8)));
+	}
+}
+
+static void WriteString(std::vector<unsigned char>& output, const std::string& value)
+{
+	WriteUInt(output, (uint32_t)value.size());
+	output.insert(output.end(), value.begin(), value.end());
+}
+
+// Reads from a span, failing once it runs out
+struct SidecarReader
+{
+	const unsigned char* data;
+	size_t size;
+	size_t offset;
+	bool failed;
+
+	uint32_t ReadUInt()
+	{
+		if (size - offset < 4) {
+			failed = true;
+			return 0;
+		}
+
+		uint32_t value = 0;
+		for (unsigned int i = 0; i < 4; i++) {
+			value |= (uint32_t)data[offset + i] << (i * 8);
+		}
+		offset += 4;
+		return value;
+	}
+
+	std::string ReadString()
+	{
+		uint32_t length = ReadUInt();
+		if (failed || size - offset < length) {
+			failed = true;
+			return std::string();
+		}
+
+		std::string value((const char*)data + offset, length);
+		offset += length;
+		return value;
+	}
+};
+
+void ShaderReflectionData::Write(std::vector<unsigned char>& output, uint64_t bytecodeHash) const
+{
+	output.clear();
+	WriteUInt(output, SidecarMagic);
+	WriteUInt(output, SidecarVersion);
+	WriteUInt(output, (uint32_t)bytecodeHash);
+	WriteUInt(output, (uint32_t)(bytecodeHash >> 32));
+	WriteUInt(output, (uint32_t)buffers.size());
+	WriteUInt(output, (uint32_t)variables.size());
+	WriteUInt(output, (uint32_t)resources.size());
+
+	for (unsigned int i = 0; i < buffers.size(); i++) {
+		WriteString(output, buffers[i].Name);
+		WriteUInt(output, buffers[i].Size);
+		WriteUInt(output, buffers[i].BindIndex);
+	}
+
+	for (unsigned int i = 0; i < variables.size(); i++) {
+		WriteString(output, variables[i].Name);
+		WriteUInt(output, variables[i].BufferIndex);
+		WriteUInt(output, variables[i].ByteOffset);
+		WriteUInt(output, variables[i].Size);
+	}
+
+	for (unsigned int i = 0; i < resources.size(); i++) {
+		WriteString(output, resources[i].Name);
+		WriteUInt(output, resources[i].Type);
+		WriteUInt(output, resources[i].BindIndex);
+	}
+}
+
+bool ShaderReflectionData::Read(const unsigned char* data, size_t size, uint64_t bytecodeHash)
+{
+	Clear();
+
+	SidecarReader reader = { data, size, 0, false };
+	if (reader.ReadUInt() != SidecarMagic || reader.ReadUInt() != SidecarVersion) {
+		return false;
+	}
+
+	uint64_t hash = reader.ReadUInt();
+	hash |= (uint64_t)reader.ReadUInt() << 32;
+	if (reader.failed || hash != bytecodeHash) {
+		return false;
+	}
+
+	// Every record takes at least 12 bytes, which bounds the
+	// counts before anything is allocated for them
+	uint32_t bufferCount = reader.ReadUInt();
+	uint32_t variableCount = reader.ReadUInt();
+	uint32_t resourceCount = reader.ReadUInt();
+	if (reader.failed || (uint64_t)bufferCount + variableCount + resourceCount > size / 12) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < bufferCount && !reader.failed; i++) {
+		std::string name = reader.ReadString();
+		unsigned int bufferSize = reader.ReadUInt();
+		unsigned int bindIndex = reader.ReadUInt();
+		AddBuffer(name, bufferSize, bindIndex);
+	}
+
+	for (uint32_t i = 0; i < variableCount && !reader.failed; i++) {
+		std::string name = reader.ReadString();
+		unsigned int bufferIndex = reader.ReadUInt();
+		unsigned int byteOffset = reader.ReadUInt();
+		unsigned int variableSize = reader.ReadUInt();
+
+		// Variables have to fit in the buffer they claim to be in
+		if (bufferIndex >= buffers.size() || byteOffset + (uint64_t)variableSize > buffers[bufferIndex].Size) {
+			reader.failed = true;
+		}
+		AddVariable(name, bufferIndex, byteOffset, variableSize);
+	}
+
+	for (uint32_t i = 0; i < resourceCount && !reader.failed; i++) {
+		std::string name = reader.ReadString();
+		uint32_t type = reader.ReadUInt();
+		unsigned int bindIndex = reader.ReadUInt();
+
+		if (type >= ResourceTypeCount) {
+			reader.failed = true;
+			break;
+		}
+		AddResource(name, (ShaderResourceType)type, bindIndex);
+	}
+
+	if (reader.failed || reader.offset != size) {
+		Clear();
+		return false;
+	}
+
+	BuildLookup();
+	return true;
+}
+
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A shader variable, texture or sampler name hashed ahead
+// of time (32 bit FNV-1a), so looking it up doesn't build
+// or hash a std::string.
+//
+// Use ShaderName("world") to make one; with a string literal
+// the hash is worked out at compile time.
+// --------------------------------------------------------
+struct ShaderNameId
+{
+	uint32_t Hash;
+
+	constexpr explicit ShaderNameId(uint32_t hash) : Hash(hash) {}
+};
+
+// Single expression so it stays constexpr under C++11 rules
+constexpr uint32_t HashShaderName(const char* name, uint32_t hash = 2166136261u)
+{
+	return *name ? HashShaderName(name + 1, (hash ^ (uint8_t)*name) * 16777619u) : hash;
+}
+
+constexpr ShaderNameId ShaderName(const char* name)
+{
+	return ShaderNameId(HashShaderName(name));
+}
+
+enum ShaderResourceType
+{
+	ResourceTexture = 0,
+	ResourceSampler,
+	ResourceUnorderedAccess,
+	ResourceTypeCount
+};
+
+struct ReflectedBuffer
+{
+	std::string Name;
+	unsigned int Size;
+	unsigned int BindIndex;
+};
+
+struct ReflectedVariable
+{
+	std::string Name;
+	unsigned int BufferIndex;
+	unsigned int ByteOffset;
+	unsigned int Size;
+};
+
+struct ReflectedResource
+{
+	std::string Name;
+	ShaderResourceType Type;
+	unsigned int BindIndex;
+};
+
+// --------------------------------------------------------
+// Everything SimpleShader needs to know about a compiled
+// shader's constant buffers, variables and bound resources,
+// in a form that can be saved next to the .cso and loaded
+// without reflecting the bytecode again.
+//
+// Names are looked up through flat tables sorted by name
+// hash. Fill the data with the Add methods, then call
+// BuildLookup() (Read() does this itself).
+//
+// Sidecar format, little endian:
+//   "SRFL", version, bytecode hash (64 bit),
+//   buffer, variable and resource counts,
+//   then each record's fields, names as length + bytes
+// --------------------------------------------------------
+class ShaderReflectionData
+{
+public:
+	static const int NotFound = -1;
+
+	ShaderReflectionData();
+	~ShaderReflectionData();
+
+	void Clear();
+
+	void AddBuffer(const std::string& name, unsigned int size, unsigned int bindIndex);
+	void AddVariable(const std::string& name, unsigned int bufferIndex, unsigned int byteOffset, unsigned int size);
+	void AddResource(const std::string& name, ShaderResourceType type, unsigned int bindIndex);
+	void BuildLookup();
+
+	const std::vector<ReflectedBuffer>& GetBuffers() const { return buffers; }
+	const std::vector<ReflectedVariable>& GetVariables() const { return variables; }
+	const std::vector<ReflectedResource>& GetResources() const { return resources; }
+
+	// Indices into GetBuffers() and GetVariables(), or NotFound.
+	// A hash shared by two names finds neither of them.
+	int FindBuffer(const std::string& name) const;
+	int FindVariable(const std::string& name) const;
+	int FindVariable(ShaderNameId name) const;
+
+	// Index among the resources of that type, in declaration order
+	int FindResource(ShaderResourceType type, const std::string& name) const;
+	int FindResource(ShaderResourceType type, ShaderNameId name) const;
+	unsigned int GetResourceCount(ShaderResourceType type) const { return (unsigned int)resourcesByType[type].size(); }
+	const ReflectedResource& GetResource(ShaderResourceType type, unsigned int index) const { return resources[resourcesByType[type][index]]; }
+
+	// The bytecode hash ties a sidecar to the .cso it came from
+	void Write(std::vector<unsigned char>& output, uint64_t bytecodeHash) const;
+
+	// False if the data is malformed or belongs to other bytecode
+	bool Read(const unsigned char* data, size_t size, uint64_t bytecodeHash);
+
+	// 64 bit FNV-1a
+	static uint64_t HashBytecode(const void* data, size_t size);
+
+private:
+	struct LookupEntry
+	{
+		uint32_t Hash;
+		unsigned int Index;
+		unsigned int ItemIndex;		// Into the full list, to check the name
+	};
+
+	std::vector<ReflectedBuffer> buffers;
+	std::vector<ReflectedVariable> variables;
+	std::vector<ReflectedResource> resources;
+
+	std::vector<LookupEntry> bufferLookup;
+	std::vector<LookupEntry> variableLookup;
+	std::vector<LookupEntry> resourceLookup[ResourceTypeCount];
+	std::vector<unsigned int> resourcesByType[ResourceTypeCount];
+
+	static void SortLookup(std::vector<LookupEntry>& table);
+
+	template <typename T>
+	static int Find(const std::vector<LookupEntry>& table, const std::vector<T>& items, uint32_t hash, const std::string* name);
+};
+
@@ -0,0 +1,387 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Marks a request that has no tile
+static const unsigned int NoNode = 0xFFFFFFFF;
+
+// How far past the halfway point between two sizes, in powers
+// of two, importance has to go before a tile changes size
+static const float SizeHysteresis = 0.25f;
+
+ShadowAtlas::ShadowAtlas(unsigned int size, unsigned int minTileSize)
+{
+	this->size = size;
+
+	levelCount = 1;
+	while ((size >> levelCount) >= minTileSize && (size >> levelCount) > 0) {
+		levelCount++;
+	}
+
+	// 4^0 + 4^1 + ... nodes, all free; a free node's children are
+	// reset whenever it's split, so they needn't be kept up to date
+	unsigned int nodeCount = ((1u << (2 * levelCount)) - 1) / 3;
+	nodes.assign(nodeCount, NodeFree);
+	usedTexels = 0;
+
+	renderedCount = 0;
+	cachedCount = 0;
+	unplacedCount = 0;
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+}
+
+float ShadowAtlas::GetScreenSize(const XMFLOAT3& center, float radius, CXMMATRIX view, CXMMATRIX projection)
+{
+	// From the distance rather than the depth, so turning the camera
+	// doesn't change it, and lights behind it keep their size
+	XMVECTOR cameraPosition = XMMatrixInverse(nullptr, view).r[3];
+	float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&center), cameraPosition)));
+
+	float scale = XMVectorGetY(projection.r[1]);
+	return std::min(1.0f, radius * scale / std::max(distance, radius));
+}
+
+float ShadowAtlas::GetOccupancy()
+{
+	return (float)usedTexels / ((float)size * size);
+}
+
+// --------------------------------------------------------
+// The level a tile of this importance belongs at, staying
+// at the one it asked for last time unless importance is
+// well past it. A tile shrunk to fit still compares against
+// the size it asked for, not the one it got.
+// --------------------------------------------------------
+unsigned int ShadowAtlas::GetLevel(float importance, const CachedTile* current)
+{
+	float maxLevel = (float)(levelCount - 1);
+	float level = importance > 0 ? std::min(std::max(-log2f(importance), 0.0f), maxLevel) : maxLevel;
+
+	if (current != nullptr && current->node != NoNode && fabsf(level - current->requestedLevel) <= 0.5f + SizeHysteresis) {
+		return current->requestedLevel;
+	}
+
+	return (unsigned int)floorf(level + 0.5f);
+}
+
+void ShadowAtlas::Update(const ShadowRequest* requests, unsigned int requestCount, const BoundingBox* changed, unsigned int changedCount)
+{
+	renderedCount = 0;
+	cachedCount = 0;
+	unplacedCount = 0;
+
+	for (auto it = cache.begin(); it != cache.end(); ++it) {
+		it->second.seen = false;
+	}
+
+	// Tiles still asking for the same size stay where they are,
+	// even if they were shrunk to fit, so they aren't redrawn
+	tiles.resize(requestCount);
+	levels.resize(requestCount);
+	pending.clear();
+	for (unsigned int r = 0; r < requestCount; r++) {
+		const ShadowRequest& request = requests[r];
+		auto found = cache.find(request.Key);
+		CachedTile* current = found != cache.end() ? &found->second : nullptr;
+
+		levels[r] = GetLevel(request.Importance, current);
+		if (current == nullptr) {
+			CachedTile tile = {};
+			tile.node = NoNode;
+			current = &cache.insert(std::make_pair(request.Key, tile)).first->second;
+		}
+
+		current->seen = true;
+		current->request = r;
+		current->importance = request.Importance;
+		if (current->node != NoNode && current->requestedLevel == levels[r]) {
+			continue;
+		}
+
+		if (current->node != NoNode) {
+			Free(current->node);
+			current->node = NoNode;
+		}
+		current->valid = false;
+		pending.push_back(r);
+	}
+
+	for (auto it = cache.begin(); it != cache.end();) {
+		if (!it->second.seen) {
+			if (it->second.node != NoNode) {
+				Free(it->second.node);
+			}
+			it = cache.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	// Most important first, making room by evicting less important
+	// tiles, then by shrinking. Evicted requests go to the back of
+	// the queue and take whatever is left.
+	std::stable_sort(pending.begin(), pending.end(), [requests](unsigned int a, unsigned int b) {
+		return requests[a].Importance > requests[b].Importance;
+	});
+
+	unsigned int placingCount = (unsigned int)pending.size();
+	for (unsigned int p = 0; p < pending.size(); p++) {
+		unsigned int r = pending[p];
+		CachedTile& tile = cache[requests[r].Key];
+
+		unsigned int level = levels[r];
+		unsigned int node = NoNode;
+		unsigned int evicted;
+		while (!Allocate(level, node)) {
+			// Evicted requests can't evict in turn
+			if (p < placingCount && Evict(requests[r].Importance, evicted)) {
+				pending.push_back(evicted);
+				continue;
+			}
+			if (level + 1 >= levelCount) {
+				break;
+			}
+			level++;
+		}
+
+		tile.node = node;
+		tile.level = level;
+		tile.requestedLevel = levels[r];
+		tile.valid = false;
+	}
+
+	// Shrunk tiles move up towards the size they asked for once
+	// there's room elsewhere, most important first. They keep their
+	// place until then, without evicting anything.
+	pending.clear();
+	for (unsigned int r = 0; r < requestCount; r++) {
+		const CachedTile& tile = cache[requests[r].Key];
+		if (tile.node != NoNode && tile.level > tile.requestedLevel) {
+			pending.push_back(r);
+		}
+	}
+	std::stable_sort(pending.begin(), pending.end(), [requests](unsigned int a, unsigned int b) {
+		return requests[a].Importance > requests[b].Importance;
+	});
+
+	for (unsigned int p = 0; p < pending.size(); p++) {
+		CachedTile& tile = cache[requests[pending[p]].Key];
+		for (unsigned int level = tile.requestedLevel; level < tile.level; level++) {
+			unsigned int node;
+			if (Allocate(level, node)) {
+				Free(tile.node);
+				tile.node = node;
+				tile.level = level;
+				tile.valid = false;
+				break;
+			}
+		}
+	}
+
+	// What needs drawing, against what was drawn last
+	for (unsigned int r = 0; r < requestCount; r++) {
+		const ShadowRequest& request = requests[r];
+		CachedTile& cached = cache[request.Key];
+		ShadowTile& tile = tiles[r];
+
+		if (cached.node == NoNode) {
+			tile = {};
+			unplacedCount++;
+			continue;
+		}
+
+		GetNodeRect(cached.node, tile.X, tile.Y, tile.Size);
+
+		bool dirty = !cached.valid || memcmp(&cached.viewProjection, &request.ViewProjection, sizeof(XMFLOAT4X4)) != 0;
+		for (unsigned int c = 0; c < changedCount && !dirty; c++) {
+			dirty = Touches(request.ViewProjection, request.Directional, changed[c]);
+		}
+
+		tile.Dirty = dirty;
+		if (dirty) {
+			renderedCount++;
+		}
+		else {
+			cachedCount++;
+		}
+
+		// The caller draws every dirty tile this frame
+		cached.viewProjection = request.ViewProjection;
+		cached.valid = true;
+	}
+}
+
+void ShadowAtlas::InvalidateAll()
+{
+	for (auto it = cache.begin(); it != cache.end(); ++it) {
+		it->second.valid = false;
+	}
+}
+
+// --------------------------------------------------------
+// Frees the least important tile that's less important than
+// the one being placed, giving its request. False if there's
+// no such tile.
+// --------------------------------------------------------
+bool ShadowAtlas::Evict(float importance, unsigned int& request)
+{
+	CachedTile* victim = nullptr;
+	for (auto it = cache.begin(); it != cache.end(); ++it) {
+		CachedTile& tile = it->second;
+		if (tile.node == NoNode || tile.importance >= importance) {
+			continue;
+		}
+
+		if (victim == nullptr || tile.importance < victim->importance) {
+			victim = &tile;
+		}
+	}
+
+	if (victim == nullptr) {
+		return false;
+	}
+
+	Free(victim->node);
+	victim->node = NoNode;
+	victim->valid = false;
+	request = victim->request;
+	return true;
+}
+
+bool ShadowAtlas::Allocate(unsigned int level, unsigned int& node)
+{
+	return AllocateNode(0, 0, level, node);
+}
+
+// --------------------------------------------------------
+// Finds a free node at the level under this one, looking in
+// nodes already split before splitting free ones, which
+// keeps big free areas whole
+// --------------------------------------------------------
+bool ShadowAtlas::AllocateNode(unsigned int node, unsigned int nodeLevel, unsigned int level, unsigned int& result)
+{
+	NodeState state = nodes[node];
+	if (state == NodeUsed) {
+		return false;
+	}
+
+	if (nodeLevel == level) {
+		if (state != NodeFree) {
+			return false;
+		}
+
+		nodes[node] = NodeUsed;
+		unsigned int tileSize = size >> level;
+		usedTexels += tileSize * tileSize;
+		result = node;
+		return true;
+	}
+
+	unsigned int firstChild = 4 * node + 1;
+	if (state == NodeFree) {
+		nodes[node] = NodeSplit;
+		for (unsigned int c = 0; c < 4; c++) {
+			nodes[firstChild + c] = NodeFree;
+		}
+		return AllocateNode(firstChild, nodeLevel + 1, level, result);
+	}
+
+	for (unsigned int pass = 0; pass < 2; pass++) {
+		NodeState wanted = pass == 0 ? NodeSplit : NodeFree;
+		for (unsigned int c = 0; c < 4; c++) {
+			if (nodes[firstChild + c] == wanted && AllocateNode(firstChild + c, nodeLevel + 1, level, result)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+// --------------------------------------------------------
+// Frees a node, merging it with its neighbours all the way
+// up for as long as they're all free too
+// --------------------------------------------------------
+void ShadowAtlas::Free(unsigned int node)
+{
+	unsigned int x, y, tileSize;
+	GetNodeRect(node, x, y, tileSize);
+	usedTexels -= tileSize * tileSize;
+
+	nodes[node] = NodeFree;
+	while (node != 0) {
+		unsigned int parent = (node - 1) / 4;
+		unsigned int firstChild = 4 * parent + 1;
+		for (unsigned int c = 0; c < 4; c++) {
+			if (nodes[firstChild + c] != NodeFree) {
+				return;
+			}
+		}
+
+		nodes[parent] = NodeFree;
+		node = parent;
+	}
+}
+
+// --------------------------------------------------------
+// Each level's nodes follow the last level's, and a node's
+// index within its level holds its path down the tree, two
+// bits (x, then y) per level
+// --------------------------------------------------------
+void ShadowAtlas::GetNodeRect(unsigned int node, unsigned int& x, unsigned int& y, unsigned int& tileSize)
+{
+	unsigned int level = 0;
+	unsigned int levelStart = 0;
+	while (node >= levelStart + (1u << (2 * level))) {
+		levelStart += 1u << (2 * level);
+		level++;
+	}
+
+	unsigned int path = node - levelStart;
+	tileSize = size >> level;
+	x = 0;
+	y = 0;
+	for (unsigned int l = 0; l < level; l++) {
+		unsigned int quadrant = (path >> (2 * (level - 1 - l))) & 3;
+		x += (quadrant & 1) * (size >> (l + 1));
+		y += (quadrant >> 1) * (size >> (l + 1));
+	}
+}
+
+// --------------------------------------------------------
+// Whether the box is inside or crosses all the planes of the
+// view, bar the near plane for directional ones. The matrix
+// is transposed, so its rows give the planes directly.
+// --------------------------------------------------------
+bool ShadowAtlas::Touches(const XMFLOAT4X4& viewProjection, bool directional, const BoundingBox& box)
+{
+	const XMFLOAT4X4& m = viewProjection;
+	XMFLOAT4 planes[6] = {
+		XMFLOAT4(m._41 + m._11, m._42 + m._12, m._43 + m._13, m._44 + m._14),	// Left
+		XMFLOAT4(m._41 - m._11, m._42 - m._12, m._43 - m._13, m._44 - m._14),	// Right
+		XMFLOAT4(m._41 + m._21, m._42 + m._22, m._43 + m._23, m._44 + m._24),	// Bottom
+		XMFLOAT4(m._41 - m._21, m._42 - m._22, m._43 - m._23, m._44 - m._24),	// Top
+		XMFLOAT4(m._41 - m._31, m._42 - m._32, m._43 - m._33, m._44 - m._34),	// Far
+		XMFLOAT4(m._31, m._32, m._33, m._34)									// Near
+	};
+
+	unsigned int planeCount = directional ? 5 : 6;
+	for (unsigned int i = 0; i < planeCount; i++) {
+		const XMFLOAT4& p = planes[i];
+		float distance = p.x * box.Center.x + p.y * box.Center.y + p.z * box.Center.z + p.w;
+		float reach = fabsf(p.x) * box.Extents.x + fabsf(p.y) * box.Extents.y + fabsf(p.z) * box.Extents.z;
+		if (distance + reach < 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
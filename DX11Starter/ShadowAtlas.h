@@ -0,0 +1,141 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// A shadow map wanted this frame: one cascade, spot light,
+// or cube face of a point light
+// --------------------------------------------------------
+struct ShadowRequest
+{
+	unsigned int Key;					// Stable from frame to frame; the caller's choice
+	float Importance;					// Width wanted, as a fraction of the atlas's
+	DirectX::XMFLOAT4X4 ViewProjection;	// World to shadow clip space, transposed for HLSL
+	bool Directional;					// Casters nearer the light than the near plane count too
+};
+
+// --------------------------------------------------------
+// Where a request's map went in the atlas, and whether it
+// has to be drawn again this frame. Requests that didn't
+// fit have a Size of 0.
+// --------------------------------------------------------
+struct ShadowTile
+{
+	unsigned int X;
+	unsigned int Y;
+	unsigned int Size;
+	bool Dirty;
+};
+
+// --------------------------------------------------------
+// Packs shadow maps into one square texture, and keeps them
+// from frame to frame so only the ones whose light or
+// casters moved are drawn again.
+//
+// Space is handed out by a quadtree: every tile is a power
+// of two square, split from a bigger one and merged back
+// when its neighbour is freed. A request's size is its
+// importance rounded to a power of two. Sizes only change
+// once importance has moved a quarter of the way past the
+// next power, so a light hovering near a boundary doesn't
+// flip between two sizes, drawing its map afresh each time.
+//
+// Requests are placed most important first. One that
+// doesn't fit evicts less important ones, then settles for
+// smaller sizes; the evicted ones then take what's left.
+// A tile shrunk to fit keeps its place, and moves up to the
+// size it asked for once there's room for it elsewhere.
+//
+// A tile is drawn again when it's new or moved, when its
+// view changed, or when something that changed this frame
+// (as world boxes, from before and after) touches its view.
+// Directional views reach back to the light without limit,
+// as casters anywhere up there shadow them.
+//
+// Nothing asks it for tiles yet, since the engine has no
+// shadow pass; for now it's only built and tested on its own.
+// --------------------------------------------------------
+class ShadowAtlas
+{
+public:
+	// size and minTileSize are powers of two
+	ShadowAtlas(unsigned int size, unsigned int minTileSize);
+	~ShadowAtlas();
+
+	// Places this frame's requests and works out which need drawing.
+	// changed holds the world bounds of casters that moved, appeared
+	// or disappeared since last frame, before and after.
+	void Update(const ShadowRequest* requests, unsigned int requestCount, const DirectX::BoundingBox* changed, unsigned int changedCount);
+
+	// Marks every tile for drawing next frame, as after a device reset
+	void InvalidateAll();
+
+	// One per request, in the order they were given
+	const std::vector<ShadowTile>& GetTiles() { return tiles; }
+
+	// How wide a sphere looks from the camera, as a fraction of the
+	// screen's height: a measure of how much its shadows matter.
+	// view and projection are the camera's, not transposed.
+	static float GetScreenSize(const DirectX::XMFLOAT3& center, float radius, DirectX::CXMMATRIX view, DirectX::CXMMATRIX projection);
+
+	unsigned int GetSize() { return size; }
+
+	// Last frame's work: tiles drawn, tiles kept from before, and
+	// requests that got no tile at all
+	unsigned int GetRenderedTileCount() { return renderedCount; }
+	unsigned int GetCachedTileCount() { return cachedCount; }
+	unsigned int GetUnplacedCount() { return unplacedCount; }
+
+	// Share of the atlas's texels in use
+	float GetOccupancy();
+
+private:
+	enum NodeState : unsigned char
+	{
+		NodeFree,
+		NodeSplit,
+		NodeUsed
+	};
+
+	// A request's tile, as kept between frames
+	struct CachedTile
+	{
+		unsigned int node;
+		unsigned int level;
+		unsigned int requestedLevel;	// From GetLevel(), before any shrinking to fit
+		DirectX::XMFLOAT4X4 viewProjection;
+		float importance;
+		unsigned int request;	// Index of this frame's request
+		bool valid;				// Drawn since it was placed, and not invalidated since
+		bool seen;				// Requested this frame
+	};
+
+	unsigned int size;
+	unsigned int levelCount;	// Level 0 is the whole atlas
+
+	// The quadtree, level by level: node i's children are 4i + 1 to 4i + 4
+	std::vector<NodeState> nodes;
+	unsigned int usedTexels;
+
+	std::unordered_map<unsigned int, CachedTile> cache;
+	std::vector<ShadowTile> tiles;
+
+	// Scratch for Update()
+	std::vector<unsigned int> pending;
+	std::vector<unsigned int> levels;
+
+	unsigned int renderedCount;
+	unsigned int cachedCount;
+	unsigned int unplacedCount;
+
+	unsigned int GetLevel(float importance, const CachedTile* current);
+	bool Allocate(unsigned int level, unsigned int& node);
+	bool AllocateNode(unsigned int node, unsigned int nodeLevel, unsigned int level, unsigned int& result);
+	void Free(unsigned int node);
+	void GetNodeRect(unsigned int node, unsigned int& x, unsigned int& y, unsigned int& tileSize);
+	bool Evict(float importance, unsigned int& request);
+	static bool Touches(const DirectX::XMFLOAT4X4& viewProjection, bool directional, const DirectX::BoundingBox& box);
+};
@@ -0,0 +1,256 @@
+#include "ShadowCascades.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+// Casters culled by one job on the thread pool; a multiple of four
+static const unsigned int CastersPerJob = 1024;
+
+ShadowCascades::ShadowCascades(ThreadPool* threadPool)
+{
+	this->threadPool = threadPool;
+
+	cascadeCount = MaxCascades;
+	resolution = 1024;
+	splitLambda = 0.75f;
+	shadowDistance = FLT_MAX;
+	cullSeconds = 0;
+
+	XMStoreFloat4x4(&lightView, XMMatrixIdentity());
+	for (unsigned int i = 0; i < MaxCascades; i++) {
+		cascades[i] = {};
+		XMStoreFloat4x4(&cascades[i].viewProjection, XMMatrixIdentity());
+	}
+}
+
+ShadowCascades::~ShadowCascades()
+{
+}
+
+void ShadowCascades::SetCascadeCount(unsigned int count)
+{
+	cascadeCount = std::max(1u, std::min(count, MaxCascades));
+}
+
+void ShadowCascades::ComputeSplits(float nearPlane, float farPlane, unsigned int count, float lambda, float* splits)
+{
+	for (unsigned int i = 0; i <= count; i++) {
+		float t = (float)i / count;
+		float logarithmic = nearPlane * powf(farPlane / nearPlane, t);
+		float even = nearPlane + (farPlane - nearPlane) * t;
+		splits[i] = lambda * logarithmic + (1 - lambda) * even;
+	}
+
+	// Exactly on the planes, whatever the rounding
+	splits[0] = nearPlane;
+	splits[count] = farPlane;
+}
+
+// --------------------------------------------------------
+// Fits a sphere around each slice of the view frustum, then
+// centers a square map on it in light space, in whole texels
+// --------------------------------------------------------
+void ShadowCascades::Update(CXMMATRIX view, CXMMATRIX projection, float nearPlane, float farPlane, const XMFLOAT3& lightDirection)
+{
+	float splits[MaxCascades + 1];
+	ComputeSplits(nearPlane, std::min(farPlane, shadowDistance), cascadeCount, splitLambda, splits);
+
+	// How far the frustum's corners are off its axis, per unit of depth
+	float tanX = 1 / XMVectorGetX(projection.r[0]);
+	float tanY = 1 / XMVectorGetY(projection.r[1]);
+	float cornerSlopeSq = tanX * tanX + tanY * tanY;
+
+	XMMATRIX cameraWorld = XMMatrixInverse(nullptr, view);
+	XMVECTOR cameraPosition = cameraWorld.r[3];
+	XMVECTOR cameraForward = XMVector3Normalize(cameraWorld.r[2]);
+
+	// Only the light's direction matters, so light space has no translation
+	XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&lightDirection));
+	XMVECTOR up = fabsf(XMVectorGetY(direction)) > 0.99f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(0, 1, 0, 0);
+	XMMATRIX lightRotation = XMMatrixLookToLH(XMVectorZero(), direction, up);
+	XMStoreFloat4x4(&lightView, lightRotation);
+
+	for (unsigned int i = 0; i < cascadeCount; i++) {
+		ShadowCascade& cascade = cascades[i];
+		float n = splits[i];
+		float f = splits[i + 1];
+
+		// The center sits on the view axis, as far from the near
+		// corners as the far ones, unless that's past the far plane.
+		// Depends on nothing but the splits and the field of view.
+		float depth = (n + f) * (1 + cornerSlopeSq) / 2;
+		float radius;
+		if (depth >= f) {
+			depth = f;
+			radius = f * sqrtf(cornerSlopeSq);
+		}
+		else {
+			radius = sqrtf((f - depth) * (f - depth) + f * f * cornerSlopeSq);
+		}
+
+		XMVECTOR worldCenter = XMVectorMultiplyAdd(cameraForward, XMVectorReplicate(depth), cameraPosition);
+		XMFLOAT3 center;
+		XMStoreFloat3(&center, XMVector3Transform(worldCenter, lightRotation));
+
+		float texelSize = 2 * radius / resolution;
+		center.x = floorf(center.x / texelSize) * texelSize;
+		center.y = floorf(center.y / texelSize) * texelSize;
+
+		cascade.splitNear = n;
+		cascade.splitFar = f;
+		cascade.center = center;
+		cascade.radius = radius;
+		cascade.texelSize = texelSize;
+		cascade.nearZ = center.z - radius;
+		cascade.farZ = center.z + radius;
+		BuildProjection(cascade);
+	}
+}
+
+void ShadowCascades::BuildProjection(ShadowCascade& cascade)
+{
+	XMMATRIX projection = XMMatrixOrthographicOffCenterLH(
+		cascade.center.x - cascade.radius, cascade.center.x + cascade.radius,
+		cascade.center.y - cascade.radius, cascade.center.y + cascade.radius,
+		cascade.nearZ, cascade.farZ);
+
+	XMMATRIX viewProjection = XMMatrixMultiply(XMLoadFloat4x4(&lightView), projection);
+	XMStoreFloat4x4(&cascade.viewProjection, XMMatrixTranspose(viewProjection));
+}
+
+// --------------------------------------------------------
+// Culls the casters in jobs, then joins the jobs' lists and
+// pulls each cascade's near plane back to its nearest caster
+// --------------------------------------------------------
+void ShadowCascades::CullCasters(const BoundingBox* bounds, unsigned int count)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	unsigned int jobCount = (count + CastersPerJob - 1) / CastersPerJob;
+	if (jobs.size() < jobCount) {
+		jobs.resize(jobCount);
+	}
+
+	threadPool->ParallelFor(jobCount, [this, bounds, count](unsigned int job) {
+		unsigned int last = std::min(count, (job + 1) * CastersPerJob);
+		CullRange(bounds, job * CastersPerJob, last, jobs[job]);
+	});
+
+	XMVECTOR nearZ = XMVectorReplicate(FLT_MAX);
+	for (unsigned int job = 0; job < jobCount; job++) {
+		nearZ = XMVectorMin(nearZ, XMLoadFloat4(&jobs[job].nearZ));
+	}
+
+	XMFLOAT4 casterNearZ;
+	XMStoreFloat4(&casterNearZ, nearZ);
+	const float* nearest = &casterNearZ.x;
+	for (unsigned int i = 0; i < cascadeCount; i++) {
+		ShadowCascade& cascade = cascades[i];
+		cascade.nearZ = std::min(cascade.center.z - cascade.radius, nearest[i]);
+		BuildProjection(cascade);
+
+		casters[i].clear();
+		for (unsigned int job = 0; job < jobCount; job++) {
+			casters[i].insert(casters[i].end(), jobs[job].casters[i].begin(), jobs[job].casters[i].end());
+		}
+	}
+
+	cullSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Tests casters [first, last) four at a time against every
+// cascade, listing the ones each takes and the nearest light
+// space depth among them (FLT_MAX if none)
+// --------------------------------------------------------
+void ShadowCascades::CullRange(const BoundingBox* bounds, unsigned int first, unsigned int last, JobScratch& scratch)
+{
+	// The light's axes, as the weights of each world axis
+	XMVECTOR axisX[3], axisY[3], axisZ[3];
+	XMVECTOR spanX[3], spanY[3], spanZ[3];
+	for (unsigned int r = 0; r < 3; r++) {
+		const float* row = lightView.m[r];
+		axisX[r] = XMVectorReplicate(row[0]);
+		axisY[r] = XMVectorReplicate(row[1]);
+		axisZ[r] = XMVectorReplicate(row[2]);
+		spanX[r] = XMVectorAbs(axisX[r]);
+		spanY[r] = XMVectorAbs(axisY[r]);
+		spanZ[r] = XMVectorAbs(axisZ[r]);
+	}
+
+	XMVECTOR cascadeX[MaxCascades], cascadeY[MaxCascades], cascadeRadius[MaxCascades], cascadeFar[MaxCascades];
+	XMVECTOR nearest[MaxCascades];
+	for (unsigned int i = 0; i < cascadeCount; i++) {
+		cascadeX[i] = XMVectorReplicate(cascades[i].center.x);
+		cascadeY[i] = XMVectorReplicate(cascades[i].center.y);
+		cascadeRadius[i] = XMVectorReplicate(cascades[i].radius);
+		cascadeFar[i] = XMVectorReplicate(cascades[i].farZ);
+		nearest[i] = XMVectorReplicate(FLT_MAX);
+		scratch.casters[i].clear();
+	}
+
+	XMVECTOR farAway = XMVectorReplicate(FLT_MAX);
+	XMVECTOR laneIndex = XMVectorSet(0, 1, 2, 3);
+
+	for (unsigned int c = first; c < last; c += 4) {
+		// The last group repeats its final caster, masked off below
+		const BoundingBox& b0 = bounds[c];
+		const BoundingBox& b1 = bounds[std::min(c + 1, last - 1)];
+		const BoundingBox& b2 = bounds[std::min(c + 2, last - 1)];
+		const BoundingBox& b3 = bounds[std::min(c + 3, last - 1)];
+
+		XMVECTOR centerX = XMVectorSet(b0.Center.x, b1.Center.x, b2.Center.x, b3.Center.x);
+		XMVECTOR centerY = XMVectorSet(b0.Center.y, b1.Center.y, b2.Center.y, b3.Center.y);
+		XMVECTOR centerZ = XMVectorSet(b0.Center.z, b1.Center.z, b2.Center.z, b3.Center.z);
+		XMVECTOR extentX = XMVectorSet(b0.Extents.x, b1.Extents.x, b2.Extents.x, b3.Extents.x);
+		XMVECTOR extentY = XMVectorSet(b0.Extents.y, b1.Extents.y, b2.Extents.y, b3.Extents.y);
+		XMVECTOR extentZ = XMVectorSet(b0.Extents.z, b1.Extents.z, b2.Extents.z, b3.Extents.z);
+
+		// The box's center and half size along the light's axes
+		XMVECTOR lightX = XMVectorMultiplyAdd(centerZ, axisX[2], XMVectorMultiplyAdd(centerY, axisX[1], XMVectorMultiply(centerX, axisX[0])));
+		XMVECTOR lightY = XMVectorMultiplyAdd(centerZ, axisY[2], XMVectorMultiplyAdd(centerY, axisY[1], XMVectorMultiply(centerX, axisY[0])));
+		XMVECTOR lightZ = XMVectorMultiplyAdd(centerZ, axisZ[2], XMVectorMultiplyAdd(centerY, axisZ[1], XMVectorMultiply(centerX, axisZ[0])));
+		XMVECTOR halfX = XMVectorMultiplyAdd(extentZ, spanX[2], XMVectorMultiplyAdd(extentY, spanX[1], XMVectorMultiply(extentX, spanX[0])));
+		XMVECTOR halfY = XMVectorMultiplyAdd(extentZ, spanY[2], XMVectorMultiplyAdd(extentY, spanY[1], XMVectorMultiply(extentX, spanY[0])));
+		XMVECTOR halfZ = XMVectorMultiplyAdd(extentZ, spanZ[2], XMVectorMultiplyAdd(extentY, spanZ[1], XMVectorMultiply(extentX, spanZ[0])));
+		XMVECTOR lowZ = XMVectorSubtract(lightZ, halfZ);
+
+		XMVECTOR valid = XMVectorLess(laneIndex, XMVectorReplicate((float)(last - c)));
+
+		for (unsigned int i = 0; i < cascadeCount; i++) {
+			XMVECTOR inside = XMVectorLessOrEqual(XMVectorAbs(XMVectorSubtract(lightX, cascadeX[i])), XMVectorAdd(halfX, cascadeRadius[i]));
+			inside = XMVectorAndInt(inside, XMVectorLessOrEqual(XMVectorAbs(XMVectorSubtract(lightY, cascadeY[i])), XMVectorAdd(halfY, cascadeRadius[i])));
+			inside = XMVectorAndInt(inside, XMVectorLessOrEqual(lowZ, cascadeFar[i]));
+			inside = XMVectorAndInt(inside, valid);
+
+			uint32_t lanes[4];
+			XMStoreInt4(lanes, inside);
+			if (!(lanes[0] | lanes[1] | lanes[2] | lanes[3])) {
+				continue;
+			}
+
+			nearest[i] = XMVectorMin(nearest[i], XMVectorSelect(farAway, lowZ, inside));
+			for (unsigned int lane = 0; lane < 4; lane++) {
+				if (lanes[lane]) {
+					scratch.casters[i].push_back(c + lane);
+				}
+			}
+		}
+	}
+
+	float* result = &scratch.nearZ.x;
+	for (unsigned int i = 0; i < MaxCascades; i++) {
+		if (i >= cascadeCount) {
+			result[i] = FLT_MAX;
+			continue;
+		}
+
+		XMFLOAT4 lanes;
+		XMStoreFloat4(&lanes, nearest[i]);
+		result[i] = std::min(std::min(lanes.x, lanes.y), std::min(lanes.z, lanes.w));
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+
+// --------------------------------------------------------
+// One slice of the camera frustum and the orthographic
+// shadow map covering it
+// --------------------------------------------------------
+struct ShadowCascade
+{
+	float splitNear;					// View depth range of the slice
+	float splitFar;
+	DirectX::XMFLOAT3 center;			// Light space center of the map, texel snapped
+	float radius;						// Half the map's width, in world units
+	float texelSize;
+	float nearZ;						// Light space depth range, casters included
+	float farZ;
+	DirectX::XMFLOAT4X4 viewProjection;	// World to shadow clip space, transposed for HLSL
+};
+
+// --------------------------------------------------------
+// Splits the camera frustum into cascades for a directional
+// light, and finds the shadow casters each one has to draw.
+//
+// Splits blend logarithmic and even spacing (the "practical"
+// scheme): a lambda of 1 is all logarithmic, 0 all even.
+//
+// Each cascade is fitted to a sphere around its slice rather
+// than the slice itself, so its size doesn't change as the
+// camera turns, and its center is snapped to whole shadow
+// texels in light space, so moving the camera only ever
+// shifts the map by whole texels. Together that keeps
+// shadow edges from shimmering.
+//
+// Casters are culled against all the cascades at once, four
+// casters at a time: each world box is turned into light
+// space once, then tested against every cascade's square,
+// extended back towards the light without limit since a
+// caster anywhere up there shadows the slice. Each cascade's
+// near plane is then pulled back to its nearest caster.
+// Each job lists its own casters, and the lists are joined
+// in order, so casters are in index order whatever the jobs'
+// scheduling.
+// --------------------------------------------------------
+class ShadowCascades
+{
+public:
+	static const unsigned int MaxCascades = 4;
+
+	ShadowCascades(ThreadPool* threadPool);
+	~ShadowCascades();
+
+	// Settings, kept until changed
+	void SetCascadeCount(unsigned int count);
+	void SetResolution(unsigned int texels) { resolution = texels; }
+	void SetSplitLambda(float lambda) { splitLambda = lambda; }
+	void SetShadowDistance(float distance) { shadowDistance = distance; }
+
+	// Splits [nearPlane, farPlane] into count slices, writing the
+	// count + 1 boundaries to splits
+	static void ComputeSplits(float nearPlane, float farPlane, unsigned int count, float lambda, float* splits);
+
+	// Fits the cascades to the camera for a light shining along
+	// lightDirection. view and projection are the camera's, not
+	// transposed. Shadows end at the shadow distance, if it's
+	// nearer than the far plane.
+	void Update(DirectX::CXMMATRIX view, DirectX::CXMMATRIX projection, float nearPlane, float farPlane, const DirectX::XMFLOAT3& lightDirection);
+
+	// Finds the casters shadowing each cascade, from their world
+	// bounds, and fits the near planes to them
+	void CullCasters(const DirectX::BoundingBox* bounds, unsigned int count);
+
+	unsigned int GetCascadeCount() { return cascadeCount; }
+	unsigned int GetResolution() { return resolution; }
+	const ShadowCascade& GetCascade(unsigned int i) { return cascades[i]; }
+
+	// Indices into the bounds given to CullCasters(), ascending
+	const std::vector<unsigned int>& GetCasters(unsigned int cascade) { return casters[cascade]; }
+
+	// World to light space rotation, shared by every cascade
+	const DirectX::XMFLOAT4X4& GetLightView() { return lightView; }
+
+	float GetCullSeconds() { return cullSeconds; }
+
+private:
+	ThreadPool* threadPool;
+
+	unsigned int cascadeCount;
+	unsigned int resolution;
+	float splitLambda;
+	float shadowDistance;
+
+	ShadowCascade cascades[MaxCascades];
+	DirectX::XMFLOAT4X4 lightView;
+
+	// One job's casters for each cascade, and its nearest caster
+	// depth for each, as lanes of nearZ
+	struct JobScratch
+	{
+		std::vector<unsigned int> casters[MaxCascades];
+		DirectX::XMFLOAT4 nearZ;
+	};
+
+	std::vector<JobScratch> jobs;
+	std::vector<unsigned int> casters[MaxCascades];
+	float cullSeconds;
+
+	void CullRange(const DirectX::BoundingBox* bounds, unsigned int first, unsigned int last, JobScratch& scratch);
+	void BuildProjection(ShadowCascade& cascade);
+};
@@ -1,4 +1,5 @@
 #include "SimpleShader.h"
+#include <fstream>
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -17,6 +18,9 @@ ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 	constantBufferCount = 0;
 	constantBuffers = 0;
 	shaderBlob = 0;
+	loadedFromSidecar = false;
+	skippedUploadCount = 0;
+	bytesSaved = 0;
 }
 
 // --------------------------------------------------------
@@ -55,10 +59,10 @@ void ISimpleShader::CleanUp()
 		delete samplerStates[i];
 
 	// Clean up tables
-	varTable.clear();
-	cbTable.clear();
-	samplerTable.clear();
-	textureTable.clear();
+	shaderResourceViews.clear();
+	samplerStates.clear();
+	variables.clear();
+	reflection.Clear();
 }
 
 // --------------------------------------------------------
@@ -66,6 +70,9 @@ void ISimpleShader::CleanUp()
 // reflection.  This must be a separate step from the constructor since
 // we can't invoke derived class overrides in the base class constructor.
 //
+// The reflection results are saved to a .refl file beside the .cso,
+// and read from there on later loads while the bytecode is unchanged.
+//
 // shaderFile - A "wide string" specifying the compiled shader to load
 // 
 // Returns true if shader is loaded properly, false otherwise
@@ -87,23 +94,86 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Reflection data comes from the sidecar next to the .cso,
+	// unless it's missing or was made from other bytecode
+	uint64_t bytecodeHash = ShaderReflectionData::HashBytecode(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize());
+
+	std::wstring sidecarFile(shaderFile);
+	size_t extension = sidecarFile.rfind(L".cso");
+	if (extension != std::wstring::npos && extension == sidecarFile.size() - 4)
+		sidecarFile.erase(extension);
+	sidecarFile += L".refl";
+
+	loadedFromSidecar = ReadSidecar(sidecarFile, bytecodeHash);
+	if (!loadedFromSidecar)
+	{
+		shaderValid = ReflectShader();
+		if (!shaderValid)
+			return false;
+
+		// Save it for next time
+		WriteSidecar(sidecarFile, bytecodeHash);
+	}
+
+	// Set up buffers and wrappers
+	CreateResources();
+	return true;
+}
+
+// --------------------------------------------------------
+// Reads the reflection data saved by an earlier load
+//
+// Returns false if there is no sidecar, or if it doesn't
+// match the shader's bytecode
+// --------------------------------------------------------
+bool ISimpleShader::ReadSidecar(const std::wstring& sidecarFile, uint64_t bytecodeHash)
+{
+	std::ifstream file(sidecarFile.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return reflection.Read(data.empty() ? 0 : &data[0], data.size(), bytecodeHash);
+}
+
+// --------------------------------------------------------
+// Saves the reflection data next to the .cso. Failing to
+// write it (a read only folder, say) just means the next
+// load reflects the shader again.
+// --------------------------------------------------------
+void ISimpleShader::WriteSidecar(const std::wstring& sidecarFile, uint64_t bytecodeHash)
+{
+	std::vector<unsigned char> data;
+	reflection.Write(data, bytecodeHash);
+
+	std::ofstream file(sidecarFile.c_str(), std::ios::binary | std::ios::trunc);
+	if (file)
+		file.write((const char*)&data[0], data.size());
+}
+
+// --------------------------------------------------------
+// Uses shader reflection to fill the reflection data with
+// this shader's buffers, variables and bound resources
+// --------------------------------------------------------
+bool ISimpleShader::ReflectShader()
+{
 	// Set up shader reflection to get information about
 	// this shader and its variables,  buffers, etc.
 	ID3D11ShaderReflection* refl;
-	D3DReflect(
+	HRESULT hr = D3DReflect(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		IID_ID3D11ShaderReflection,
 		(void**)&refl);
+	if (hr != S_OK)
+		return false;
 	
 	// Get the description of the shader
 	D3D11_SHADER_DESC shaderDesc;
 	refl->GetDesc(&shaderDesc);
 
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
-	
 	// Handle bound resources (like shaders and samplers)
 	unsigned int resourceCount = shaderDesc.BoundResources;
 	for (unsigned int r = 0; r < resourceCount; r++)
@@ -116,33 +186,28 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		switch (resourceDesc.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
-		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;	// Shader bind point
-			srv->Index = shaderResourceViews.size();	// Raw index
-
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
-		}
+		case D3D_SIT_STRUCTURED: // Read only buffers are bound the same way
+		case D3D_SIT_BYTEADDRESS:
+			reflection.AddResource(resourceDesc.Name, ResourceTexture, resourceDesc.BindPoint);
 			break;
 
 		case D3D_SIT_SAMPLER: // A sampler resource
-		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;	// Shader bind point
-			samp->Index = samplerStates.size();			// Raw index
+			reflection.AddResource(resourceDesc.Name, ResourceSampler, resourceDesc.BindPoint);
+			break;
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
-		}
+		case D3D_SIT_UAV_APPEND_STRUCTURED: // Any kind of UAV
+		case D3D_SIT_UAV_CONSUME_STRUCTURED:
+		case D3D_SIT_UAV_RWBYTEADDRESS:
+		case D3D_SIT_UAV_RWSTRUCTURED:
+		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+		case D3D_SIT_UAV_RWTYPED:
+			reflection.AddResource(resourceDesc.Name, ResourceUnorderedAccess, resourceDesc.BindPoint);
 			break;
 		}
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
 	{
 		// Get this buffer
 		ID3D11ShaderReflectionConstantBuffer* cb =
@@ -151,31 +216,19 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		// Get the description of this buffer
 		D3D11_SHADER_BUFFER_DESC bufferDesc;
 		cb->GetDesc(&bufferDesc);
+
+		// Structured buffers show up here too, to describe their
+		// elements, but they aren't constant buffers
+		if (bufferDesc.Type != D3D_CT_CBUFFER)
+			continue;
+		unsigned int bufferIndex = (unsigned int)reflection.GetBuffers().size();
 		
 		// Get the description of the resource binding, so
 		// we know exactly how it's bound in the shader
 		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
 		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
 		
-		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
-
-		// Create this constant buffer
-		D3D11_BUFFER_DESC newBuffDesc;
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = bufferDesc.Size;
-		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
-		newBuffDesc.MiscFlags = 0;
-		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
-
-		// Set up the data buffer for this constant buffer
-		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		reflection.AddBuffer(bufferDesc.Name, bufferDesc.Size, bindDesc.BindPoint);
 
 		// Loop through all variables in this buffer
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
@@ -188,26 +241,87 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			D3D11_SHADER_VARIABLE_DESC varDesc;
 			var->GetDesc(&varDesc);
 
-			// Create the variable struct
-			SimpleShaderVariable varStruct;
-			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
-
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
-			constantBuffers[b].Variables.push_back(varStruct);
+			reflection.AddVariable(varDesc.Name, bufferIndex, varDesc.StartOffset, varDesc.Size);
 		}
 	}
 
 	// All set
 	refl->Release();
+	reflection.BuildLookup();
 	return true;
 }
 
+// --------------------------------------------------------
+// Creates the constant buffers, their local data and the
+// SRV and sampler wrappers from the reflection data
+// --------------------------------------------------------
+void ISimpleShader::CreateResources()
+{
+	const std::vector<ReflectedBuffer>& buffers = reflection.GetBuffers();
+	const std::vector<ReflectedVariable>& vars = reflection.GetVariables();
+
+	// Create resource arrays
+	constantBufferCount = buffers.size();
+	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+
+	for (unsigned int b = 0; b < constantBufferCount; b++)
+	{
+		// Set up the buffer
+		constantBuffers[b].BindIndex = buffers[b].BindIndex;
+		constantBuffers[b].Name = buffers[b].Name;
+
+		// Create this constant buffer
+		D3D11_BUFFER_DESC newBuffDesc;
+		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
+		newBuffDesc.ByteWidth = buffers[b].Size;
+		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		newBuffDesc.CPUAccessFlags = 0;
+		newBuffDesc.MiscFlags = 0;
+		newBuffDesc.StructureByteStride = 0;
+		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
+
+		// Set up the data buffer for this constant buffer
+		constantBuffers[b].Size = buffers[b].Size;
+		constantBuffers[b].LocalDataBuffer = new unsigned char[buffers[b].Size];
+		ZeroMemory(constantBuffers[b].LocalDataBuffer, buffers[b].Size);
+
+		// Nothing has been copied to the buffer yet
+		constantBuffers[b].DirtyStart = 0;
+		constantBuffers[b].DirtyEnd = buffers[b].Size;
+	}
+
+	// Variables, in the same order as the reflection data so
+	// its lookups index straight into them
+	for (unsigned int v = 0; v < vars.size(); v++)
+	{
+		SimpleShaderVariable varStruct;
+		varStruct.ConstantBufferIndex = vars[v].BufferIndex;
+		varStruct.ByteOffset = vars[v].ByteOffset;
+		varStruct.Size = vars[v].Size;
+
+		variables.push_back(varStruct);
+		constantBuffers[vars[v].BufferIndex].Variables.push_back(varStruct);
+	}
+
+	// Create the SRV wrappers
+	for (unsigned int r = 0; r < reflection.GetResourceCount(ResourceTexture); r++)
+	{
+		SimpleSRV* srv = new SimpleSRV();
+		srv->BindIndex = reflection.GetResource(ResourceTexture, r).BindIndex;	// Shader bind point
+		srv->Index = r;																// Raw index
+		shaderResourceViews.push_back(srv);
+	}
+
+	// Create the sampler wrappers
+	for (unsigned int r = 0; r < reflection.GetResourceCount(ResourceSampler); r++)
+	{
+		SimpleSampler* samp = new SimpleSampler();
+		samp->BindIndex = reflection.GetResource(ResourceSampler, r).BindIndex;	// Shader bind point
+		samp->Index = r;															// Raw index
+		samplerStates.push_back(samp);
+	}
+}
+
 // --------------------------------------------------------
 // Helper for looking up a variable by name and also
 // verifying that it is the requested size
@@ -218,15 +332,14 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
-		varTable.find(name);
+	int index = reflection.FindVariable(name);
 
 	// Did we find the key?
-	if (result == varTable.end())
+	if (index == ShaderReflectionData::NotFound)
 		return 0;
 
-	// Grab the result from the iterator
-	SimpleShaderVariable* var = &(result->second);
+	// Grab the variable
+	SimpleShaderVariable* var = &variables[index];
 
 	// Is the data size correct ?
 	if (size > 0 && var->Size != size)
@@ -242,15 +355,14 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
-		cbTable.find(name);
+	int index = reflection.FindBuffer(name);
 
 	// Did we find the key?
-	if (result == cbTable.end())
+	if (index == ShaderReflectionData::NotFound)
 		return 0;
 
 	// Success
-	return result->second;
+	return &constantBuffers[index];
 }
 
 // --------------------------------------------------------
@@ -276,13 +388,10 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy any that changed
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer, 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -311,9 +420,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -333,9 +440,49 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
+	UploadBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Copies a buffer's local data to the GPU, unless nothing
+// in it has changed since the last copy.
+//
+// Constant buffers can only be updated as a whole in
+// D3D11.0, so any dirty byte sends the entire buffer.
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	if (cb->DirtyStart == cb->DirtyEnd)
+	{
+		skippedUploadCount++;
+		bytesSaved += cb->Size;
+		return;
+	}
+
 	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
+		cb->ConstantBuffer, 0, 0,
 		cb->LocalDataBuffer, 0, 0);
+
+	cb->DirtyStart = 0;
+	cb->DirtyEnd = 0;
+}
+
+// --------------------------------------------------------
+// Marks every buffer as entirely dirty
+// --------------------------------------------------------
+void ISimpleShader::MarkBuffersDirty()
+{
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		constantBuffers[i].DirtyStart = 0;
+		constantBuffers[i].DirtyEnd = constantBuffers[i].Size;
+	}
+}
+
+void ISimpleShader::ResetUploadStats()
+{
+	skippedUploadCount = 0;
+	bytesSaved = 0;
 }
 
 
@@ -357,15 +504,67 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		return false;
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteBufferData(var->ConstantBufferIndex, var->ByteOffset, data, size);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets a variable through a handle, skipping the lookup
+//
+// Returns false if the handle is invalid or sizes don't match
+// --------------------------------------------------------
+bool ISimpleShader::SetData(const ShaderVarHandle& handle, const void* data, unsigned int size)
+{
+	if (handle.Size != size || handle.ConstantBufferIndex >= constantBufferCount)
+		return false;
+
+	WriteBufferData(handle.ConstantBufferIndex, handle.ByteOffset, data, size);
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a whole block of a buffer's data at once, starting
+// from its first byte (see ConstantBlock for checking that
+// the data's layout matches)
+//
+// Returns false if the buffer doesn't exist or is too small
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferData(unsigned int index, const void* data, unsigned int size)
+{
+	if (index >= constantBufferCount || size > constantBuffers[index].Size)
+		return false;
+
+	WriteBufferData(index, 0, data, size);
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies data into a local data buffer and grows its dirty
+// range. Setting the same value again leaves it clean.
+// --------------------------------------------------------
+void ISimpleShader::WriteBufferData(unsigned int bufferIndex, unsigned int byteOffset, const void* data, unsigned int size)
+{
+	SimpleConstantBuffer* cb = &constantBuffers[bufferIndex];
+	unsigned char* dest = cb->LocalDataBuffer + byteOffset;
+	if (memcmp(dest, data, size) == 0)
+		return;
+
+	memcpy(dest, data, size);
+
+	if (cb->DirtyStart == cb->DirtyEnd)
+	{
+		cb->DirtyStart = byteOffset;
+		cb->DirtyEnd = byteOffset + size;
+	}
+	else
+	{
+		cb->DirtyStart = min(cb->DirtyStart, byteOffset);
+		cb->DirtyEnd = max(cb->DirtyEnd, byteOffset + size);
+	}
+}
+
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
@@ -446,6 +645,39 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Typed setters through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(const ShaderVarHandle& handle, int data)
+{
+	return this->SetData(handle, &data, sizeof(int));
+}
+
+bool ISimpleShader::SetFloat(const ShaderVarHandle& handle, float data)
+{
+	return this->SetData(handle, &data, sizeof(float));
+}
+
+bool ISimpleShader::SetFloat2(const ShaderVarHandle& handle, const DirectX::XMFLOAT2& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 2);
+}
+
+bool ISimpleShader::SetFloat3(const ShaderVarHandle& handle, const DirectX::XMFLOAT3& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 3);
+}
+
+bool ISimpleShader::SetFloat4(const ShaderVarHandle& handle, const DirectX::XMFLOAT4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 4);
+}
+
+bool ISimpleShader::SetMatrix4x4(const ShaderVarHandle& handle, const DirectX::XMFLOAT4X4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 16);
+}
+
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
@@ -454,6 +686,37 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 	return FindVariable(name, -1);
 }
 
+// --------------------------------------------------------
+// Resolves a variable to a handle; check IsValid() on the
+// result in case the shader has no such variable
+// --------------------------------------------------------
+ShaderVarHandle ISimpleShader::GetVariableHandle(const std::string& name)
+{
+	return MakeVariableHandle(reflection.FindVariable(name));
+}
+
+ShaderVarHandle ISimpleShader::GetVariableHandle(ShaderNameId name)
+{
+	return MakeVariableHandle(reflection.FindVariable(name));
+}
+
+// --------------------------------------------------------
+// Fills a handle from a variable's index, or leaves it
+// invalid if the index is NotFound
+// --------------------------------------------------------
+ShaderVarHandle ISimpleShader::MakeVariableHandle(int index)
+{
+	ShaderVarHandle handle = {};
+	if (index != ShaderReflectionData::NotFound)
+	{
+		handle.ConstantBufferIndex = variables[index].ConstantBufferIndex;
+		handle.ByteOffset = variables[index].ByteOffset;
+		handle.Size = variables[index].Size;
+	}
+
+	return handle;
+}
+
 // --------------------------------------------------------
 // Gets info about an SRV in the shader (or null)
 //
@@ -462,15 +725,30 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
-		textureTable.find(name);
+	int index = reflection.FindResource(ResourceTexture, name);
 
 	// Did we find the key?
-	if (result == textureTable.end())
+	if (index == ShaderReflectionData::NotFound)
 		return 0;
 
 	// Success
-	return result->second;
+	return shaderResourceViews[index];
+}
+
+
+// --------------------------------------------------------
+// Gets info about an SRV in the shader (or null)
+//
+// name - the hashed name of the SRV
+// --------------------------------------------------------
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(ShaderNameId name)
+{
+	int index = reflection.FindResource(ResourceTexture, name);
+
+	if (index == ShaderReflectionData::NotFound)
+		return 0;
+
+	return shaderResourceViews[index];
 }
 
 
@@ -497,15 +775,29 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
-		samplerTable.find(name);
+	int index = reflection.FindResource(ResourceSampler, name);
 
 	// Did we find the key?
-	if (result == samplerTable.end())
+	if (index == ShaderReflectionData::NotFound)
 		return 0;
 
 	// Success
-	return result->second;
+	return samplerStates[index];
+}
+
+// --------------------------------------------------------
+// Gets info about a sampler in the shader (or null)
+// 
+// name - the hashed name of the sampler
+// --------------------------------------------------------
+const SimpleSampler* ISimpleShader::GetSamplerInfo(ShaderNameId name)
+{
+	int index = reflection.FindResource(ResourceSampler, name);
+
+	if (index == ShaderReflectionData::NotFound)
+		return 0;
+
+	return samplerStates[index];
 }
 
 // --------------------------------------------------------
@@ -1469,8 +1761,6 @@ void SimpleComputeShader::CleanUp()
 {
 	ISimpleShader::CleanUp();
 	if (shader) { shader->Release(); shader = 0; }
-
-	uavTable.clear();
 }
 
 // --------------------------------------------------------
@@ -1497,7 +1787,8 @@ bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
+	// Set up shader reflection to get the thread group size
+	// (UAVs are in the base class's reflection data)
 	ID3D11ShaderReflection* refl;
 	D3DReflect(
 		shaderBlob->GetBufferPointer(),
@@ -1505,37 +1796,12 @@ bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 		IID_ID3D11ShaderReflection,
 		(void**)&refl);
 
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-	
 	// Grab the thread info
 	threadsTotal = refl->GetThreadGroupSize(
 		&threadsX,
 		&threadsY,
 		&threadsZ);
 
-	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
-	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
-		// Check the type, looking for any kind of UAV
-		switch (resourceDesc.Type)
-		{
-		case D3D_SIT_UAV_APPEND_STRUCTURED:
-		case D3D_SIT_UAV_CONSUME_STRUCTURED:
-		case D3D_SIT_UAV_RWBYTEADDRESS:
-		case D3D_SIT_UAV_RWSTRUCTURED:
-		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
-		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
-		}
-	}
-
 	// All set
 	refl->Release();
 	return true;
@@ -1689,13 +1955,12 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, ID3D11Unorder
 int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
 {
 	// Look for the key
-	std::unordered_map<std::string, unsigned int>::iterator result =
-		uavTable.find(name);
+	int index = reflection.FindResource(ResourceUnorderedAccess, name);
 
 	// Did we find the key?
-	if (result == uavTable.end())
+	if (index == ShaderReflectionData::NotFound)
 		return -1;
 
 	// Success
-	return result->second;
+	return reflection.GetResource(ResourceUnorderedAccess, index).BindIndex;
 }
\ No newline at end of file
@@ -6,10 +6,12 @@
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 
-#include <unordered_map>
+#include <cstdint>
 #include <vector>
 #include <string>
 
+#include "ShaderReflectionData.h"
+
 // --------------------------------------------------------
 // Used by simple shaders to store information about
 // specific variables in constant buffers
@@ -21,6 +23,22 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// A resolved shader variable: where it lives and how big
+// it is. Look one up once with GetVariableHandle(), then
+// setting it is just a size check and a copy.
+//
+// Only good for the shader it came from.
+// --------------------------------------------------------
+struct ShaderVarHandle
+{
+	unsigned int ConstantBufferIndex;
+	unsigned int ByteOffset;
+	unsigned int Size;			// 0 if the variable wasn't found
+
+	bool IsValid() const { return Size > 0; }
+};
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -34,6 +52,11 @@ struct SimpleConstantBuffer
 	ID3D11Buffer* ConstantBuffer;
 	unsigned char* LocalDataBuffer;
 	std::vector<SimpleShaderVariable> Variables;
+
+	// Bytes of the local data changed since the last copy
+	// to the constant buffer; clean when start equals end
+	unsigned int DirtyStart;
+	unsigned int DirtyEnd;
 };
 
 // --------------------------------------------------------
@@ -76,6 +99,10 @@ public:
 	void CopyBufferData(unsigned int index);
 	void CopyBufferData(std::string bufferName);
 
+	// Forces the next copy of every buffer, for when the constant
+	// buffers were written some other way than through this shader
+	void MarkBuffersDirty();
+
 	// Sets arbitrary shader data
 	bool SetData(std::string name, const void* data, unsigned int size);
 
@@ -90,20 +117,37 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Sets shader data through a handle from GetVariableHandle()
+	bool SetData(const ShaderVarHandle& handle, const void* data, unsigned int size);
+
+	bool SetInt(const ShaderVarHandle& handle, int data);
+	bool SetFloat(const ShaderVarHandle& handle, float data);
+	bool SetFloat2(const ShaderVarHandle& handle, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(const ShaderVarHandle& handle, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const ShaderVarHandle& handle, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const ShaderVarHandle& handle, const DirectX::XMFLOAT4X4& data);
+
+	// Overwrites the start of a buffer's local data in one copy
+	bool SetBufferData(unsigned int index, const void* data, unsigned int size);
+
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
 	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
 
 	// Getting data about variables and resources
 	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	ShaderVarHandle GetVariableHandle(const std::string& name);
+	ShaderVarHandle GetVariableHandle(ShaderNameId name);
 	
 	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(ShaderNameId name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
-	unsigned int GetShaderResourceViewCount() { return textureTable.size(); }
+	unsigned int GetShaderResourceViewCount() { return shaderResourceViews.size(); }
 	
 	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(ShaderNameId name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
-	unsigned int GetSamplerCount() { return samplerTable.size(); }
+	unsigned int GetSamplerCount() { return samplerStates.size(); }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
@@ -113,6 +157,15 @@ public:
 	
 	// Misc getters
 	ID3DBlob* GetShaderBlob() { return shaderBlob; }
+	const ShaderReflectionData& GetReflectionData() { return reflection; }
+
+	// Did the last load read the reflection sidecar instead of reflecting the bytecode?
+	bool WasLoadedFromSidecar() { return loadedFromSidecar; }
+
+	// Copies skipped because nothing had changed, and the bytes they would have sent
+	unsigned int GetSkippedUploadCount() { return skippedUploadCount; }
+	unsigned int GetBytesSaved() { return bytesSaved; }
+	void ResetUploadStats();
 
 protected:
 	
@@ -123,15 +176,19 @@ protected:
 
 	// Resource counts
 	unsigned int constantBufferCount;
+
+	// Upload stats
+	unsigned int skippedUploadCount;
+	unsigned int bytesSaved;
 	
-	// Maps for variables and buffers
+	// Buffers, variables and resources, in the same order as the
+	// reflection data, whose sorted tables are used to find them by name
+	ShaderReflectionData		reflection;
+	bool						loadedFromSidecar;
 	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
+	std::vector<SimpleShaderVariable> variables;
 	std::vector<SimpleSRV*>		shaderResourceViews;
 	std::vector<SimpleSampler*>	samplerStates;
-	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
@@ -141,7 +198,23 @@ protected:
 
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
+	ShaderVarHandle MakeVariableHandle(int index);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+
+	// Copies a buffer's local data if any of it is dirty
+	void UploadBuffer(SimpleConstantBuffer* cb);
+
+	// Writes into a buffer's local data, tracking what changed
+	void WriteBufferData(unsigned int bufferIndex, unsigned int byteOffset, const void* data, unsigned int size);
+
+	// Filling the reflection data, from the sidecar file next
+	// to the .cso if it matches the bytecode, or from D3DReflect
+	bool ReadSidecar(const std::wstring& sidecarFile, uint64_t bytecodeHash);
+	void WriteSidecar(const std::wstring& sidecarFile, uint64_t bytecodeHash);
+	bool ReflectShader();
+
+	// Creates the buffers and wrappers described by the reflection data
+	void CreateResources();
 };
 
 // --------------------------------------------------------
@@ -287,7 +360,6 @@ public:
 
 protected:
 	ID3D11ComputeShader* shader;
-	std::unordered_map<std::string, unsigned int> uavTable;
 
 	unsigned int threadsX;
 	unsigned int threadsY;
@@ -0,0 +1,173 @@
+#include "StateCache.h"
+#include <cstdint>
+
+// --------------------------------------------------------
+// Binding nullptr is meaningful (it unbinds a slot), so
+// state the cache knows nothing about is marked with a
+// pointer that can never be a real object instead
+// --------------------------------------------------------
+static StateObject Unknown()
+{
+	return reinterpret_cast<StateObject>(~(uintptr_t)0);
+}
+
+StateCache::StateCache(IStateTarget* target)
+{
+	this->target = target;
+	issuedCount = 0;
+	skippedCount = 0;
+	Invalidate();
+}
+
+StateCache::~StateCache()
+{
+}
+
+void StateCache::BeginFrame()
+{
+	issuedCount = 0;
+	skippedCount = 0;
+}
+
+void StateCache::Invalidate()
+{
+	for (unsigned int s = 0; s < StageCount; s++) {
+		StageState& stage = stages[s];
+		stage.shader = Unknown();
+		for (unsigned int i = 0; i < MaxConstantBuffers; i++) {
+			stage.constantBuffers[i].buffer = Unknown();
+			stage.constantBuffers[i].firstConstant = 0;
+			stage.constantBuffers[i].constantCount = 0;
+		}
+		for (unsigned int i = 0; i < MaxShaderResources; i++) stage.shaderResources[i] = Unknown();
+		for (unsigned int i = 0; i < MaxSamplers; i++) stage.samplers[i] = Unknown();
+	}
+
+	inputLayout = Unknown();
+	for (unsigned int i = 0; i < MaxVertexBuffers; i++) {
+		vertexBuffers[i].buffer = Unknown();
+		vertexBuffers[i].stride = 0;
+		vertexBuffers[i].offset = 0;
+	}
+
+	indexBuffer = Unknown();
+	indexFormat = 0;
+	indexOffset = 0;
+}
+
+void StateCache::SetShader(ShaderStage stage, StateObject shader)
+{
+	if (stages[stage].shader == shader) {
+		skippedCount++;
+		return;
+	}
+
+	stages[stage].shader = shader;
+	target->BindShader(stage, shader);
+	issuedCount++;
+}
+
+void StateCache::SetConstantBuffer(ShaderStage stage, unsigned int slot, StateObject buffer)
+{
+	if (slot < MaxConstantBuffers) {
+		ConstantBufferState& state = stages[stage].constantBuffers[slot];
+		if (state.buffer == buffer && state.constantCount == 0) {
+			skippedCount++;
+			return;
+		}
+		state.buffer = buffer;
+		state.firstConstant = 0;
+		state.constantCount = 0;
+	}
+
+	target->BindConstantBuffer(stage, slot, buffer);
+	issuedCount++;
+}
+
+void StateCache::SetConstantBufferRange(ShaderStage stage, unsigned int slot, StateObject buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (slot < MaxConstantBuffers) {
+		ConstantBufferState& state = stages[stage].constantBuffers[slot];
+		if (state.buffer == buffer && state.firstConstant == firstConstant && state.constantCount == constantCount) {
+			skippedCount++;
+			return;
+		}
+		state.buffer = buffer;
+		state.firstConstant = firstConstant;
+		state.constantCount = constantCount;
+	}
+
+	target->BindConstantBufferRange(stage, slot, buffer, firstConstant, constantCount);
+	issuedCount++;
+}
+
+void StateCache::SetShaderResource(ShaderStage stage, unsigned int slot, StateObject srv)
+{
+	if (slot < MaxShaderResources) {
+		if (stages[stage].shaderResources[slot] == srv) {
+			skippedCount++;
+			return;
+		}
+		stages[stage].shaderResources[slot] = srv;
+	}
+
+	target->BindShaderResource(stage, slot, srv);
+	issuedCount++;
+}
+
+void StateCache::SetSampler(ShaderStage stage, unsigned int slot, StateObject sampler)
+{
+	if (slot < MaxSamplers) {
+		if (stages[stage].samplers[slot] == sampler) {
+			skippedCount++;
+			return;
+		}
+		stages[stage].samplers[slot] = sampler;
+	}
+
+	target->BindSampler(stage, slot, sampler);
+	issuedCount++;
+}
+
+void StateCache::SetInputLayout(StateObject inputLayout)
+{
+	if (this->inputLayout == inputLayout) {
+		skippedCount++;
+		return;
+	}
+
+	this->inputLayout = inputLayout;
+	target->BindInputLayout(inputLayout);
+	issuedCount++;
+}
+
+void StateCache::SetVertexBuffer(unsigned int slot, StateObject buffer, unsigned int stride, unsigned int offset)
+{
+	if (slot < MaxVertexBuffers) {
+		VertexBufferState& state = vertexBuffers[slot];
+		if (state.buffer == buffer && state.stride == stride && state.offset == offset) {
+			skippedCount++;
+			return;
+		}
+		state.buffer = buffer;
+		state.stride = stride;
+		state.offset = offset;
+	}
+
+	target->BindVertexBuffer(slot, buffer, stride, offset);
+	issuedCount++;
+}
+
+void StateCache::SetIndexBuffer(StateObject buffer, unsigned int format, unsigned int offset)
+{
+	if (indexBuffer == buffer && indexFormat == format && indexOffset == offset) {
+		skippedCount++;
+		return;
+	}
+
+	indexBuffer = buffer;
+	indexFormat = format;
+	indexOffset = offset;
+	target->BindIndexBuffer(buffer, format, offset);
+	issuedCount++;
+}
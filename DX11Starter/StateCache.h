@@ -0,0 +1,119 @@
+#pragma once
+
+enum ShaderStage
+{
+	StageVertex = 0,
+	StageHull,
+	StageDomain,
+	StageGeometry,
+	StagePixel,
+	StageCompute,
+	StageCount
+};
+
+// --------------------------------------------------------
+// A bound pipeline object: a shader, buffer, view, sampler
+// or input layout. The cache only ever compares bindings,
+// so it holds them as opaque pointers and never needs the
+// Direct3D headers.
+// --------------------------------------------------------
+typedef void* StateObject;
+
+// --------------------------------------------------------
+// Where the state cache sends the bindings it doesn't skip.
+//
+// DeviceContextStateTarget forwards to a device context; a
+// recording implementation is enough to exercise the cache
+// without a GPU. Index formats are DXGI_FORMAT values.
+// --------------------------------------------------------
+class IStateTarget
+{
+public:
+	virtual ~IStateTarget() {}
+
+	virtual void BindShader(ShaderStage stage, StateObject shader) = 0;
+	virtual void BindConstantBuffer(ShaderStage stage, unsigned int slot, StateObject buffer) = 0;
+	virtual void BindConstantBufferRange(ShaderStage stage, unsigned int slot, StateObject buffer, unsigned int firstConstant, unsigned int constantCount) = 0;
+	virtual void BindShaderResource(ShaderStage stage, unsigned int slot, StateObject srv) = 0;
+	virtual void BindSampler(ShaderStage stage, unsigned int slot, StateObject sampler) = 0;
+	virtual void BindInputLayout(StateObject inputLayout) = 0;
+	virtual void BindVertexBuffer(unsigned int slot, StateObject buffer, unsigned int stride, unsigned int offset) = 0;
+	virtual void BindIndexBuffer(StateObject buffer, unsigned int format, unsigned int offset) = 0;
+};
+
+// --------------------------------------------------------
+// Remembers what is bound to each pipeline stage and drops
+// bindings that wouldn't change anything.
+//
+// Anything bound to the context without going through the
+// cache leaves it out of date; call Invalidate() afterwards.
+// Slots past the tracked range are always passed through.
+// --------------------------------------------------------
+class StateCache
+{
+public:
+	static const unsigned int MaxConstantBuffers = 14;
+	static const unsigned int MaxShaderResources = 16;
+	static const unsigned int MaxSamplers = 16;
+	static const unsigned int MaxVertexBuffers = 4;
+
+	StateCache(IStateTarget* target);
+	~StateCache();
+
+	// Resets the per-frame counters
+	void BeginFrame();
+
+	// Forgets all bound state, so the next binding of anything is issued
+	void Invalidate();
+
+	void SetShader(ShaderStage stage, StateObject shader);
+	void SetConstantBuffer(ShaderStage stage, unsigned int slot, StateObject buffer);
+	// Binds constantCount constants (16 bytes each) of the buffer, starting at firstConstant
+	void SetConstantBufferRange(ShaderStage stage, unsigned int slot, StateObject buffer, unsigned int firstConstant, unsigned int constantCount);
+	void SetShaderResource(ShaderStage stage, unsigned int slot, StateObject srv);
+	void SetSampler(ShaderStage stage, unsigned int slot, StateObject sampler);
+	void SetInputLayout(StateObject inputLayout);
+	void SetVertexBuffer(unsigned int slot, StateObject buffer, unsigned int stride, unsigned int offset);
+	void SetIndexBuffer(StateObject buffer, unsigned int format, unsigned int offset);
+
+	// Bindings sent to the target and bindings dropped since BeginFrame()
+	unsigned int GetIssuedCount() { return issuedCount; }
+	unsigned int GetSkippedCount() { return skippedCount; }
+
+private:
+	// A constantCount of 0 means the whole buffer
+	struct ConstantBufferState
+	{
+		StateObject buffer;
+		unsigned int firstConstant;
+		unsigned int constantCount;
+	};
+
+	struct StageState
+	{
+		StateObject shader;
+		ConstantBufferState constantBuffers[MaxConstantBuffers];
+		StateObject shaderResources[MaxShaderResources];
+		StateObject samplers[MaxSamplers];
+	};
+
+	struct VertexBufferState
+	{
+		StateObject buffer;
+		unsigned int stride;
+		unsigned int offset;
+	};
+
+	IStateTarget* target;
+
+	StageState stages[StageCount];
+	StateObject inputLayout;
+	VertexBufferState vertexBuffers[MaxVertexBuffers];
+	StateObject indexBuffer;
+	unsigned int indexFormat;
+	unsigned int indexOffset;
+
+	unsigned int issuedCount;
+	unsigned int skippedCount;
+};
+
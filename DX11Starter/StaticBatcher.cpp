@@ -0,0 +1,134 @@
+#include "StaticBatcher.h"
+#include "WorldGeometry.h"
+#include <unordered_set>
+
+// For the DirectX Math library
+using namespace DirectX;
+
+StaticBatcher::StaticBatcher()
+{
+	mergedBytes = 0;
+	sourceBytes = 0;
+}
+
+StaticBatcher::~StaticBatcher()
+{
+	Clear();
+}
+
+void StaticBatcher::Clear()
+{
+	for (unsigned int i = 0; i < batches.size(); i++) {
+		delete batches[i].mesh;
+	}
+
+	batches.clear();
+	locations.clear();
+	mergedBytes = 0;
+	sourceBytes = 0;
+}
+
+// --------------------------------------------------------
+// Groups the static entities by material, in the order the
+// materials are first seen, and merges each group
+// --------------------------------------------------------
+void StaticBatcher::Build(const std::vector<Entity*>& entities, ID3D11Device* device)
+{
+	Clear();
+
+	std::unordered_map<Material*, unsigned int> batchIndices;
+	std::unordered_set<Mesh*> sourceMeshes;
+
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		Entity* entity = entities[i];
+		Material* material = entity->GetMaterial();
+		Mesh* mesh = entity->GetMesh();
+		if (!entity->IsStatic() || !mesh->HasGeometry() || material->GetColor().w < 1.0f) {
+			continue;
+		}
+
+		std::unordered_map<Material*, unsigned int>::iterator it = batchIndices.find(material);
+		if (it == batchIndices.end()) {
+			it = batchIndices.insert(std::make_pair(material, (unsigned int)batches.size())).first;
+			StaticBatch batch;
+			batch.material = material;
+			batch.mesh = nullptr;
+			batches.push_back(batch);
+		}
+
+		StaticRange range = {};
+		range.entity = entity;
+		batches[it->second].ranges.push_back(range);
+
+		Location location;
+		location.batch = it->second;
+		location.range = (unsigned int)batches[it->second].ranges.size() - 1;
+		locations[entity] = location;
+
+		if (sourceMeshes.insert(mesh).second) {
+			sourceBytes += mesh->GetVertexCount() * sizeof(Vertex) + mesh->GetIndexCount() * sizeof(UINT);
+		}
+	}
+
+	for (unsigned int i = 0; i < batches.size(); i++) {
+		MergeBatch(batches[i], device);
+	}
+}
+
+// --------------------------------------------------------
+// Appends every entity's geometry to one world space
+// vertex/index list and records where its indices landed
+// --------------------------------------------------------
+void StaticBatcher::MergeBatch(StaticBatch& batch, ID3D11Device* device)
+{
+	std::vector<Vertex> vertices;
+	std::vector<UINT> indices;
+
+	for (unsigned int r = 0; r < batch.ranges.size(); r++) {
+		StaticRange& range = batch.ranges[r];
+		Mesh* mesh = range.entity->GetMesh();
+
+		range.startIndex = (unsigned int)indices.size();
+		range.indexCount = (unsigned int)mesh->GetIndices().size();
+		AppendWorldGeometry(mesh->GetVertices(), mesh->GetIndices(), range.entity->GetTransform()->GetMatrix(), vertices, indices);
+	}
+
+	// The source meshes keep their own copies for picking and culling
+	batch.mesh = new Mesh(&indices[0], &vertices[0], (int)indices.size(), (int)vertices.size(), device, false);
+	mergedBytes += vertices.size() * sizeof(Vertex) + indices.size() * sizeof(UINT);
+}
+
+bool StaticBatcher::IsBatched(Entity* entity)
+{
+	return locations.find(entity) != locations.end();
+}
+
+unsigned int StaticBatcher::GetTriangleCount(Entity* entity)
+{
+	std::unordered_map<Entity*, Location>::iterator it = locations.find(entity);
+	if (it == locations.end()) {
+		return 0;
+	}
+
+	return batches[it->second.batch].ranges[it->second.range].indexCount / 3;
+}
+
+void StaticBatcher::BeginFrame()
+{
+	for (unsigned int b = 0; b < batches.size(); b++) {
+		for (unsigned int r = 0; r < batches[b].ranges.size(); r++) {
+			batches[b].ranges[r].visible = false;
+		}
+	}
+}
+
+bool StaticBatcher::MarkVisible(Entity* entity)
+{
+	std::unordered_map<Entity*, Location>::iterator it = locations.find(entity);
+	if (it == locations.end()) {
+		return false;
+	}
+
+	batches[it->second.batch].ranges[it->second.range].visible = true;
+	return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Entity.h"
+#include <DirectXMath.h>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// The indices one static entity occupies in a merged mesh
+// --------------------------------------------------------
+struct StaticRange
+{
+	Entity* entity;
+	unsigned int startIndex;
+	unsigned int indexCount;
+	bool visible;				// Set by MarkVisible() for the current frame
+};
+
+// --------------------------------------------------------
+// All static entities sharing one material, pre-transformed
+// into a single world space mesh
+// --------------------------------------------------------
+struct StaticBatch
+{
+	Material* material;
+	Mesh* mesh;
+	std::vector<StaticRange> ranges;
+};
+
+// --------------------------------------------------------
+// Merges entities flagged static into one mesh per material
+// at load time.
+//
+// Each entity keeps its own index range in the merged mesh,
+// so culling still works per entity: visible neighbours are
+// drawn with one call, hidden ones are skipped.
+//
+// Only opaque entities whose mesh kept its CPU geometry are
+// merged; the rest are left to be drawn normally.
+// --------------------------------------------------------
+class StaticBatcher
+{
+public:
+	StaticBatcher();
+	~StaticBatcher();
+
+	void Build(const std::vector<Entity*>& entities, ID3D11Device* device);
+	void Clear();
+
+	// Was the entity merged into one of the batches?
+	bool IsBatched(Entity* entity);
+
+	// Triangles the entity's range in its merged mesh draws; 0 if it isn't batched
+	unsigned int GetTriangleCount(Entity* entity);
+
+	// Clears every range's visibility
+	void BeginFrame();
+
+	// Flags the entity's range as visible; false if it isn't batched
+	bool MarkVisible(Entity* entity);
+
+	std::vector<StaticBatch>& GetBatches() { return batches; }
+
+	// Entities merged, and the draws they'd cost without merging
+	unsigned int GetEntityCount() { return (unsigned int)locations.size(); }
+	unsigned int GetBatchCount() { return (unsigned int)batches.size(); }
+
+	// GPU memory of the merged meshes, which duplicate the geometry
+	// of every entity instead of sharing their source meshes
+	size_t GetMergedBytes() { return mergedBytes; }
+	size_t GetSourceBytes() { return sourceBytes; }
+
+private:
+	struct Location
+	{
+		unsigned int batch;
+		unsigned int range;
+	};
+
+	std::vector<StaticBatch> batches;
+	std::unordered_map<Entity*, Location> locations;
+
+	size_t mergedBytes;
+	size_t sourceBytes;
+
+	void MergeBatch(StaticBatch& batch, ID3D11Device* device);
+};
+
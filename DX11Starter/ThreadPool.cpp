@@ -0,0 +1,98 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	job = nullptr;
+	jobCount = 0;
+	nextIndex = 0;
+	generation = 0;
+	finishedWorkers = 0;
+	shuttingDown = false;
+
+	// The calling thread also runs jobs, so leave a core for it
+	if (threadCount == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++) {
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shuttingDown = true;
+	}
+	wakeCondition.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unsigned int seenGeneration = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&] { return shuttingDown || generation != seenGeneration; });
+			if (shuttingDown) {
+				return;
+			}
+			seenGeneration = generation;
+		}
+
+		RunJobs();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finishedWorkers++;
+		}
+		doneCondition.notify_one();
+	}
+}
+
+//Pull indices off the shared counter until they run out
+void ThreadPool::RunJobs()
+{
+	unsigned int index;
+	while ((index = nextIndex.fetch_add(1)) < jobCount) {
+		(*job)(index);
+	}
+}
+
+void ThreadPool::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& job)
+{
+	if (count == 0) {
+		return;
+	}
+
+	//Not worth waking anybody up
+	if (workers.empty() || count == 1) {
+		for (unsigned int i = 0; i < count; i++) {
+			job(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->job = &job;
+		jobCount = count;
+		nextIndex = 0;
+		finishedWorkers = 0;
+		generation++;
+	}
+	wakeCondition.notify_all();
+
+	RunJobs();
+
+	// Every worker has to check in before the job can go out of scope
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [&] { return finishedWorkers == workers.size(); });
+	this->job = nullptr;
+}
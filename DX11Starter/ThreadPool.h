@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A small fixed-size pool of worker threads used to split
+// CPU-side frame work (culling, recording, etc.) into jobs.
+//
+// ParallelFor blocks until every index has been processed;
+// the calling thread helps out instead of idling.
+// --------------------------------------------------------
+class ThreadPool
+{
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+
+	// The job currently being processed
+	const std::function<void(unsigned int)>* job;
+	unsigned int jobCount;
+	std::atomic<unsigned int> nextIndex;
+
+	unsigned int generation;
+	unsigned int finishedWorkers;
+	bool shuttingDown;
+
+	void WorkerLoop();
+	void RunJobs();
+
+public:
+	// threadCount - number of worker threads, or 0 to match the hardware
+	ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	// Calls job(i) for every i in [0, count), spread across the pool
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& job);
+
+	// Number of threads that execute jobs, including the caller
+	unsigned int GetThreadCount() {
+		return (unsigned int)workers.size() + 1;
+	}
+};
+
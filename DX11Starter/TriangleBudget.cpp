@@ -0,0 +1,94 @@
+#include "TriangleBudget.h"
+#include <algorithm>
+
+// Pressure at which each output is fully used; bias comes first
+static const float MaxPressure = 2.0f;
+
+// Furthest over target a frame counts as. Past it, the jumps in
+// the error between frames kick the proportional and derivative
+// terms from one end of the pressure to the other, and the loop
+// swings between full detail and none instead of settling.
+static const float MaxError = 1.0f;
+
+TriangleBudget::TriangleBudget()
+{
+	triangleBudget = 1000000;
+	frameTimeBudget = 0;
+	headroom = 0.1f;
+
+	proportionalGain = 0.3f;
+	integralGain = 0.1f;
+	derivativeGain = 0.05f;
+	smoothing = 0.5f;
+
+	maxLodBias = 3.0f;
+	maxCullSize = 4.0f;
+
+	Reset();
+}
+
+TriangleBudget::~TriangleBudget()
+{
+}
+
+void TriangleBudget::SetGains(float proportional, float integral, float derivative)
+{
+	proportionalGain = proportional;
+	integralGain = integral;
+	derivativeGain = derivative;
+}
+
+void TriangleBudget::Reset()
+{
+	pressure = 0;
+	smoothedError = 0;
+	lastError = 0;
+	errorBeforeLast = 0;
+	frameCount = 0;
+	overBudgetFrames = 0;
+}
+
+// --------------------------------------------------------
+// Velocity form PID: each frame adds the change the three
+// terms call for, against the last two errors. The first
+// frame seeds the history, so it doesn't kick the
+// proportional and derivative terms.
+// --------------------------------------------------------
+void TriangleBudget::Update(unsigned int triangles, float cpuSeconds, float gpuSeconds)
+{
+	if (triangles > triangleBudget) {
+		overBudgetFrames++;
+	}
+
+	float error = (float)triangles / std::max(1.0f, triangleBudget * (1 - headroom)) - 1;
+	if (frameTimeBudget > 0) {
+		float frameTime = std::max(cpuSeconds, gpuSeconds);
+		error = std::max(error, frameTime / (frameTimeBudget * (1 - headroom)) - 1);
+	}
+	error = std::min(error, MaxError);
+
+	smoothedError = frameCount == 0 ? error : smoothedError + smoothing * (error - smoothedError);
+	if (frameCount == 0) {
+		lastError = smoothedError;
+		errorBeforeLast = smoothedError;
+	}
+
+	float change = proportionalGain * (smoothedError - lastError)
+		+ integralGain * smoothedError
+		+ derivativeGain * (smoothedError - 2 * lastError + errorBeforeLast);
+	pressure = std::min(std::max(pressure + change, 0.0f), MaxPressure);
+
+	errorBeforeLast = lastError;
+	lastError = smoothedError;
+	frameCount++;
+}
+
+float TriangleBudget::GetLodBias()
+{
+	return std::min(pressure, 1.0f) * maxLodBias;
+}
+
+float TriangleBudget::GetCullSize()
+{
+	return std::max(pressure - 1, 0.0f) * maxCullSize;
+}
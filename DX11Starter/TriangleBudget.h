@@ -0,0 +1,87 @@
+#pragma once
+
+// --------------------------------------------------------
+// Keeps the triangles drawn each frame, and the frame time,
+// under budget by trading away detail.
+//
+// Each frame's measurements become one error: how far the
+// triangle count or the slower of the CPU and GPU times is
+// over its target, as a share of it, whichever is further.
+// Targets sit a little under the budgets, so the count
+// hovers below the budget rather than around it. Errors are
+// capped at twice the target, so a frame far over budget
+// can't swing the pressure from one end to the other, and
+// smoothed to ride out single slow frames.
+//
+// A PID loop turns the error into pressure, from 0 to 2.
+// It works in velocity form, nudging the pressure each frame
+// rather than computing it outright, so it can't wind up
+// while the pressure is pinned at either end. The first unit
+// of pressure raises the LOD bias, which scales the pixel
+// error every level is allowed; the second raises the size
+// under which objects are faded out entirely, once coarser
+// levels alone aren't enough.
+//
+// Everything goes by frames and the measurements given, and
+// nothing reads a clock, so a recorded trace always plays
+// back the same way.
+// --------------------------------------------------------
+class TriangleBudget
+{
+public:
+	TriangleBudget();
+	~TriangleBudget();
+
+	// Budgets; a frame time of 0 leaves time out of it
+	void SetTriangleBudget(unsigned int triangles) { triangleBudget = triangles; }
+	void SetFrameTimeBudget(float seconds) { frameTimeBudget = seconds; }
+
+	// Share of each budget kept spare
+	void SetHeadroom(float headroom) { this->headroom = headroom; }
+
+	// Loop gains, per frame, and how much of each new error the
+	// smoothed error takes in
+	void SetGains(float proportional, float integral, float derivative);
+	void SetSmoothing(float smoothing) { this->smoothing = smoothing; }
+
+	// How far the outputs go at full pressure: the bias in powers
+	// of two of the pixel error, the cull size in pixels
+	void SetMaxLodBias(float bias) { maxLodBias = bias; }
+	void SetMaxCullSize(float pixels) { maxCullSize = pixels; }
+
+	// Feeds in a frame that drew this many triangles, taking this
+	// long on each side. A GPU time of 0 means it isn't known.
+	void Update(unsigned int triangles, float cpuSeconds, float gpuSeconds);
+
+	// Back to full detail, forgetting past frames
+	void Reset();
+
+	float GetLodBias();
+	float GetCullSize();
+	float GetPressure() { return pressure; }
+	float GetError() { return smoothedError; }
+
+	// Frames since the last Reset() drawn over the triangle budget
+	unsigned int GetOverBudgetFrames() { return overBudgetFrames; }
+
+private:
+	unsigned int triangleBudget;
+	float frameTimeBudget;
+	float headroom;
+
+	float proportionalGain;
+	float integralGain;
+	float derivativeGain;
+	float smoothing;
+
+	float maxLodBias;
+	float maxCullSize;
+
+	// Loop state: the pressure, and the last two smoothed errors
+	float pressure;
+	float smoothedError;
+	float lastError;
+	float errorBeforeLast;
+	unsigned int frameCount;
+	unsigned int overBudgetFrames;
+};
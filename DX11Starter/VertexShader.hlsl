@@ -7,9 +7,9 @@
 // - The name of the cbuffer itself is unimportant
 cbuffer externalData : register(b0)
 {
-	matrix world;
-	matrix view;
-	matrix projection;
+	matrix worldViewProj;	// Combined on the CPU, once per object
+	float4x3 normalMatrix;	// Inverse transpose of world, so scaling doesn't skew normals
+	float4x3 objectToWorld;	// World matrix, for the world space position
 };
 
 // Struct representing a single vertex worth of data
@@ -44,6 +44,7 @@ struct VertexToPixel
 	float4 position		: SV_POSITION;	// XYZW position (System Value Position)
 	float3 normal		: NORMAL;       // RGBA color
 	float2 uv			: TEXCOORD;		// UV texture coord
+	float3 worldPosition	: POSITION;		// For lights that have a position
 };
 
 // --------------------------------------------------------
@@ -60,22 +61,20 @@ VertexToPixel main( VertexShaderInput input )
 
 	// The vertex's position (input.position) must be converted to world space,
 	// then camera space (relative to our 3D camera), then to proper homogenous 
-	// screen-space coordinates.  This is taken care of by our world, view and
-	// projection matrices.  
+	// screen-space coordinates.  The world, view and projection matrices that
+	// do this are multiplied together ahead of time into worldViewProj.
 	//
-	// First we multiply them together to get a single matrix which represents
-	// all of those transformations (world to view to projection space)
-	matrix worldViewProj = mul(mul(world, view), projection);
-
-	// Then we convert our 3-component position vector to a 4-component vector
-	// and multiply it by our final 4x4 matrix.
+	// We convert our 3-component position vector to a 4-component vector
+	// and multiply it by that single 4x4 matrix.
 	//
 	// The result is essentially the position (XY) of the vertex on our 2D 
 	// screen and the distance (Z) from the camera (the "depth" of the pixel)
 	output.position = mul(float4(input.position, 1.0f), worldViewProj);
 
-	output.normal = mul(input.normal, (float3x3)world);
+	// The world matrix itself would shear normals under non-uniform scale
+	output.normal = normalize(mul(input.normal, (float3x3)normalMatrix));
 	output.uv = input.uv;
+	output.worldPosition = mul(float4(input.position, 1.0f), objectToWorld);
 
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
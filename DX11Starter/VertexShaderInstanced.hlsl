@@ -0,0 +1,47 @@
+// Instanced variant of VertexShader.hlsl
+// - The world and normal matrices and color come from a second
+//    vertex buffer, one element per instance instead of per vertex
+// - The "_PER_INSTANCE" suffix is what tells SimpleShader to
+//    read these from input slot 1 when building the input layout
+cbuffer externalData : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+struct VertexShaderInput
+{
+	float3 position		: POSITION;				// XYZ position
+	float3 normal		: NORMAL;				// XYZ normal
+	float2 uv			: TEXCOORD;				// UV texture coord
+	float3x4 world		: WORLD_PER_INSTANCE;	// AffineMatrix, one row per element
+	float3x4 normalMatrix	: NORMALMATRIX_PER_INSTANCE;	// Inverse transpose of world, packed the same way
+	float4 color		: COLOR_PER_INSTANCE;	// Material color of this instance
+};
+
+// Matches VertexShader.hlsl, plus the instance's color
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;	// XYZW position (System Value Position)
+	float3 normal		: NORMAL;       // XYZ normal
+	float2 uv			: TEXCOORD;		// UV texture coord
+	float3 worldPosition	: POSITION;		// For lights that have a position
+	float4 color		: COLOR;		// Instance color
+};
+
+VertexToPixel main( VertexShaderInput input )
+{
+	VertexToPixel output;
+
+	// The rows are the world's columns, so the matrix goes first
+	float3 worldPosition = mul(input.world, float4(input.position, 1.0f));
+	output.position = mul(mul(float4(worldPosition, 1.0f), view), projection);
+
+	// The world matrix itself would shear normals under non-uniform scale
+	output.normal = normalize(mul((float3x3)input.normalMatrix, input.normal));
+	output.uv = input.uv;
+	output.worldPosition = worldPosition;
+	output.color = input.color;
+
+	return output;
+}
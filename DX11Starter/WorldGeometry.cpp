@@ -0,0 +1,37 @@
+#include "WorldGeometry.h"
+
+// For the DirectX Math library
+using namespace DirectX;
+
+void AppendWorldGeometry(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	const XMFLOAT4X4& world, std::vector<Vertex>& mergedVertices, std::vector<unsigned int>& mergedIndices)
+{
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+
+	// The cofactors of the upper 3x3 are its inverse transpose scaled by the
+	// determinant; only the determinant's sign matters once normals are
+	// renormalized, and this way a singular world still gives usable normals
+	XMVECTOR cofactor0 = XMVector3Cross(worldMatrix.r[1], worldMatrix.r[2]);
+	XMVECTOR cofactor1 = XMVector3Cross(worldMatrix.r[2], worldMatrix.r[0]);
+	XMVECTOR cofactor2 = XMVector3Cross(worldMatrix.r[0], worldMatrix.r[1]);
+	if (XMVectorGetX(XMVector3Dot(worldMatrix.r[0], cofactor0)) < 0) {
+		cofactor0 = XMVectorNegate(cofactor0);
+		cofactor1 = XMVectorNegate(cofactor1);
+		cofactor2 = XMVectorNegate(cofactor2);
+	}
+	XMMATRIX normalMatrix(cofactor0, cofactor1, cofactor2, XMVectorSet(0, 0, 0, 1));
+
+	unsigned int baseVertex = (unsigned int)mergedVertices.size();
+	mergedVertices.reserve(mergedVertices.size() + vertices.size());
+	for (unsigned int v = 0; v < vertices.size(); v++) {
+		Vertex vertex = vertices[v];
+		XMStoreFloat3(&vertex.Position, XMVector3TransformCoord(XMLoadFloat3(&vertex.Position), worldMatrix));
+		XMStoreFloat3(&vertex.Normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.Normal), normalMatrix)));
+		mergedVertices.push_back(vertex);
+	}
+
+	mergedIndices.reserve(mergedIndices.size() + indices.size());
+	for (unsigned int i = 0; i < indices.size(); i++) {
+		mergedIndices.push_back(indices[i] + baseVertex);
+	}
+}
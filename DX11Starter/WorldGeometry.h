@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Appends a mesh's geometry to merged vertex and index lists,
+// moved into world space the same way VertexShader.hlsl moves
+// it: positions by the world matrix, normals by the inverse
+// transpose of its upper 3x3, renormalized. Indices are
+// offset to point at the appended vertices.
+//
+// Used to build meshes drawn with an identity world matrix,
+// like static batches and HLOD proxies.
+// --------------------------------------------------------
+void AppendWorldGeometry(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	const DirectX::XMFLOAT4X4& world, std::vector<Vertex>& mergedVertices, std::vector<unsigned int>& mergedIndices);
@@ -0,0 +1,98 @@
+#include "AffineMatrix.h"
+#include "InstancePacker.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// The instance layout before the matrices were packed 3x4
+struct FullInstanceData
+{
+	XMFLOAT4X4 World;
+	XMFLOAT4X4 NormalMatrix;
+	XMFLOAT4 Color;
+};
+
+// Stores the transposed 4x4s, as the instanced shader used to read them
+static void FillFull(const XMFLOAT4X4* worlds, const XMFLOAT4X4* normals, unsigned int count, FullInstanceData* instances)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		XMStoreFloat4x4(&instances[i].World, XMMatrixTranspose(XMLoadFloat4x4(&worlds[i])));
+		XMStoreFloat4x4(&instances[i].NormalMatrix, XMMatrixTranspose(XMLoadFloat4x4(&normals[i])));
+		instances[i].Color = XMFLOAT4(1, 1, 1, 1);
+	}
+}
+
+static void FillPacked(const XMFLOAT4X4* worlds, const XMFLOAT4X4* normals, unsigned int count, InstanceData* instances)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		StoreAffineMatrix(&instances[i].World, XMLoadFloat4x4(&worlds[i]));
+		StoreAffineMatrix(&instances[i].NormalMatrix, XMLoadFloat4x4(&normals[i]));
+		instances[i].Color = XMFLOAT4(1, 1, 1, 1);
+	}
+}
+
+template <typename Function>
+static double Time(unsigned int runs, Function function)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (unsigned int run = 0; run < runs; run++) {
+		function();
+	}
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / runs;
+}
+
+// --------------------------------------------------------
+// Fills 100,000 instances from random affine worlds, with
+// 4x4 matrices and with the 3x4 AffineMatrix, and reports
+// the bytes each sends to the GPU and how fast they fill
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int count = 100000;
+	const unsigned int runs = 50;
+
+	std::mt19937 random(13);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<XMFLOAT4X4> worlds(count);
+	std::vector<XMFLOAT4X4> normals(count);
+	for (unsigned int i = 0; i < count; i++) {
+		XMMATRIX world = XMMatrixMultiply(
+			XMMatrixMultiply(
+				XMMatrixScaling(1.5f + unit(random), 1.5f + unit(random), 1.5f + unit(random)),
+				XMMatrixRotationRollPitchYaw(3 * unit(random), 3 * unit(random), 3 * unit(random))),
+			XMMatrixTranslation(100 * unit(random), 100 * unit(random), 100 * unit(random)));
+		XMStoreFloat4x4(&worlds[i], world);
+		XMStoreFloat4x4(&normals[i], XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+	}
+
+	std::vector<FullInstanceData> full(count);
+	std::vector<InstanceData> packed(count);
+	FillFull(&worlds[0], &normals[0], count, &full[0]);
+	FillPacked(&worlds[0], &normals[0], count, &packed[0]);
+
+	double fullSeconds = Time(runs, [&]() { FillFull(&worlds[0], &normals[0], count, &full[0]); });
+	double packedSeconds = Time(runs, [&]() { FillPacked(&worlds[0], &normals[0], count, &packed[0]); });
+
+	// Both hold the same matrices, element for element
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		XMFLOAT4X4 unpacked;
+		XMStoreFloat4x4(&unpacked, LoadAffineMatrix(&packed[i].World));
+		for (unsigned int r = 0; r < 4; r++) {
+			for (unsigned int c = 0; c < 4; c++) {
+				mismatches += unpacked.m[r][c] != full[i].World.m[c][r];
+			}
+		}
+	}
+
+	printf("%u instances (%u mismatched elements)\n", count, mismatches);
+	printf("4x4: %3u bytes each, %5.2f MB, %.2f ms to fill, %5.1fM instances/s\n", (unsigned int)sizeof(FullInstanceData),
+		count * sizeof(FullInstanceData) / 1e6, fullSeconds * 1000, count / fullSeconds / 1e6);
+	printf("3x4: %3u bytes each, %5.2f MB, %.2f ms to fill, %5.1fM instances/s\n", (unsigned int)sizeof(InstanceData),
+		count * sizeof(InstanceData) / 1e6, packedSeconds * 1000, count / packedSeconds / 1e6);
+	printf("(average of %u runs)\n", runs);
+	return 0;
+}
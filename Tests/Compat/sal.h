@@ -0,0 +1,50 @@
+#pragma once
+
+// --------------------------------------------------------
+// DirectXMath's headers are annotated with Microsoft's SAL
+// macros, which only exist on Windows. They're only hints
+// for the code analyzer, so elsewhere they expand to nothing.
+// --------------------------------------------------------
+
+#define _Analysis_assume_(expression)
+#define _Use_decl_annotations_
+#define _Success_(expression)
+#define _Check_return_
+#define _Must_inspect_result_
+
+#define _In_
+#define _In_opt_
+#define _In_z_
+#define _In_reads_(size)
+#define _In_reads_opt_(size)
+#define _In_reads_bytes_(size)
+#define _In_reads_bytes_opt_(size)
+#define _In_range_(low, high)
+
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(size)
+#define _Out_writes_opt_(size)
+#define _Out_writes_bytes_(size)
+#define _Out_writes_bytes_opt_(size)
+#define _Out_writes_all_(size)
+#define _Out_writes_to_(size, count)
+#define _Outptr_
+#define _Outptr_opt_
+
+#define _Inout_
+#define _Inout_opt_
+#define _Inout_updates_(size)
+#define _Inout_updates_bytes_(size)
+
+#define _Ret_maybenull_
+#define _Ret_notnull_
+#define _Ret_z_
+
+#define _Field_size_(size)
+#define _Field_size_bytes_(size)
+#define _Field_range_(low, high)
+#define _Printf_format_string_
+#define _Null_terminated_
+#define _Pre_
+#define _Post_
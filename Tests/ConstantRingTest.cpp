@@ -0,0 +1,128 @@
+#include "ConstantRing.h"
+#include "TestCheck.h"
+#include <deque>
+#include <random>
+#include <vector>
+
+struct LiveAllocation
+{
+	uint64_t fence;
+	size_t offset;
+	size_t size;
+};
+
+static bool Overlaps(size_t offset, size_t size, const LiveAllocation& other)
+{
+	return offset < other.offset + other.size && other.offset < offset + size;
+}
+
+int main()
+{
+	// Sizes round up to the alignment, and the capacity down to it
+	{
+		ConstantRing ring(1000, 256);
+		CHECK(ring.GetCapacity() == 768);
+		CHECK(ring.Allocate(1) == 0);
+		CHECK(ring.Allocate(256) == 256);
+		CHECK(ring.GetUsedBytes() == 512);
+		CHECK(ring.Allocate(0) == ConstantRing::InvalidOffset);
+		CHECK(ring.Allocate(257) == ConstantRing::InvalidOffset);
+		CHECK(ring.Allocate(256) == 512);
+		CHECK(ring.Allocate(1) == ConstantRing::InvalidOffset);
+	}
+
+	// Space in flight isn't handed out again until its fence retires
+	{
+		ConstantRing ring(1024, 256);
+		CHECK(ring.Allocate(512) == 0);
+		ring.EndFrame(1);
+		CHECK(ring.Allocate(256) == 512);
+		ring.EndFrame(2);
+		CHECK(ring.GetPendingFrameCount() == 2);
+
+		// Doesn't fit before the end, and the start is still in use
+		CHECK(ring.Allocate(512) == ConstantRing::InvalidOffset);
+
+		ring.Retire(1);
+		CHECK(ring.GetPendingFrameCount() == 1);
+		CHECK(ring.GetUsedBytes() == 256);
+
+		// The 256 bytes left at the end are skipped and charged to this frame
+		CHECK(ring.Allocate(512) == 0);
+		CHECK(ring.GetWrapCount() == 1);
+		CHECK(ring.GetFrameBytes() == 768);
+		CHECK(ring.GetUsedBytes() == 1024);
+		ring.EndFrame(3);
+
+		ring.Retire(3);
+		CHECK(ring.GetUsedBytes() == 0);
+		CHECK(ring.GetPendingFrameCount() == 0);
+	}
+
+	// Empty frames leave nothing to retire
+	{
+		ConstantRing ring(1024, 256);
+		ring.EndFrame(1);
+		CHECK(ring.GetPendingFrameCount() == 0);
+	}
+
+	// Many frames of random sizes with the GPU a few frames behind:
+	// no allocation may overlap one whose fence hasn't retired
+	{
+		const size_t capacity = 64 * 1024;
+		const size_t alignment = 256;
+		const uint64_t framesInFlight = 3;
+
+		ConstantRing ring(capacity, alignment);
+		std::deque<LiveAllocation> live;
+		std::mt19937 random(7);
+		std::uniform_int_distribution<int> sizes(1, 2048);
+		std::uniform_int_distribution<int> counts(0, 8);
+
+		unsigned int failed = 0;
+		unsigned int refused = 0;
+		for (uint64_t fence = 1; fence <= 20000; fence++) {
+			if (fence > framesInFlight) {
+				ring.Retire(fence - framesInFlight);
+				while (!live.empty() && live.front().fence <= fence - framesInFlight) {
+					live.pop_front();
+				}
+			}
+
+			int count = counts(random);
+			for (int i = 0; i < count; i++) {
+				size_t size = (size_t)sizes(random);
+				size_t offset = ring.Allocate(size);
+				if (offset == ConstantRing::InvalidOffset) {
+					refused++;
+					continue;
+				}
+
+				bool valid = offset % alignment == 0 && offset + size <= capacity;
+				for (size_t a = 0; a < live.size() && valid; a++) {
+					valid = !Overlaps(offset, size, live[a]);
+				}
+				if (!valid) {
+					failed++;
+				}
+
+				LiveAllocation allocation = { fence, offset, size };
+				live.push_back(allocation);
+			}
+
+			ring.EndFrame(fence);
+			CHECK(ring.GetUsedBytes() <= capacity);
+		}
+
+		CHECK(failed == 0);
+		CHECK(ring.GetWrapCount() > 100);
+
+		// Three frames of at most 8 * 2 KB, plus what a wrap skips, always fit
+		CHECK(refused == 0);
+
+		ring.Retire(20000);
+		CHECK(ring.GetUsedBytes() == 0);
+	}
+
+	return TestResult();
+}
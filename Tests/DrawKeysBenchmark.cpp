@@ -0,0 +1,46 @@
+#include "DrawKeys.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DrawKeys;
+
+// --------------------------------------------------------
+// Times sorting a million draw keys, spread over a realistic
+// number of shaders, materials and meshes, with the radix
+// sort and with std::sort for comparison
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int count = 1000000;
+	const unsigned int runs = 10;
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0, 1);
+	std::vector<DrawItem> source(count);
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned int pass = unit(random) < 0.1f ? PassTransparent : PassOpaque;
+		source[i].key = MakeKey(pass, random() % 16, random() % 500, random() % 2000, unit(random));
+		source[i].entity = nullptr;
+	}
+
+	std::vector<DrawItem> items(count), scratch(count);
+	double radixSeconds = 0, stdSeconds = 0;
+	for (unsigned int run = 0; run < runs; run++) {
+		items = source;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		RadixSort(&items[0], &scratch[0], count);
+		radixSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		items = source;
+		start = std::chrono::high_resolution_clock::now();
+		std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+		stdSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	printf("%u keys, average of %u runs: radix sort %.2f ms, std::sort %.2f ms\n",
+		count, runs, radixSeconds * 1000 / runs, stdSeconds * 1000 / runs);
+	return 0;
+}
@@ -0,0 +1,97 @@
+#include "DrawKeys.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace DrawKeys;
+
+static std::vector<DrawItem> Sorted(const std::vector<uint64_t>& keys)
+{
+	std::vector<DrawItem> items(keys.size()), scratch(keys.size());
+	for (size_t i = 0; i < keys.size(); i++) {
+		items[i].key = keys[i];
+		items[i].entity = (Entity*)(uintptr_t)(i + 1);
+	}
+	RadixSort(&items[0], &scratch[0], items.size());
+	return items;
+}
+
+int main()
+{
+	// Fields come back out of either layout
+	uint64_t opaque = MakeKey(PassOpaque, 1023, 40000, 12345, 0.5f);
+	uint64_t transparent = MakeKey(PassTransparent, 7, 65535, 1, 0.25f);
+	CHECK(GetPass(opaque) == PassOpaque);
+	CHECK(GetShader(opaque) == 1023 && GetMaterial(opaque) == 40000 && GetMesh(opaque) == 12345);
+	CHECK(GetPass(transparent) == PassTransparent);
+	CHECK(GetShader(transparent) == 7 && GetMaterial(transparent) == 65535 && GetMesh(transparent) == 1);
+
+	// Opaque draws before transparent ones, whatever the rest of the key
+	CHECK(MakeKey(PassOpaque, 1023, 65535, 65535, 1) < MakeKey(PassTransparent, 0, 0, 0, 0));
+
+	// Opaque: grouped by state, front to back within it
+	{
+		std::vector<uint64_t> keys;
+		keys.push_back(MakeKey(PassOpaque, 1, 0, 0, 0.1f));	// 0
+		keys.push_back(MakeKey(PassOpaque, 0, 0, 0, 0.9f));	// 1
+		keys.push_back(MakeKey(PassOpaque, 0, 1, 0, 0.0f));	// 2
+		keys.push_back(MakeKey(PassOpaque, 0, 0, 0, 0.2f));	// 3
+		std::vector<DrawItem> items = Sorted(keys);
+		CHECK(items[0].entity == (Entity*)4);
+		CHECK(items[1].entity == (Entity*)2);
+		CHECK(items[2].entity == (Entity*)3);
+		CHECK(items[3].entity == (Entity*)1);
+	}
+
+	// Transparent: depth (passed inverted, 1 - depth) wins over state, so
+	// draws go back to front across shaders, materials and meshes
+	{
+		float depths[] = { 0.3f, 0.9f, 0.1f, 0.6f, 0.95f, 0.5f };
+		std::vector<uint64_t> keys;
+		for (unsigned int i = 0; i < 6; i++) {
+			keys.push_back(MakeKey(PassTransparent, i % 3, 5 - i, i * 7, 1 - depths[i]));
+		}
+		std::vector<DrawItem> items = Sorted(keys);
+		for (unsigned int i = 1; i < items.size(); i++) {
+			float previous = depths[(uintptr_t)items[i - 1].entity - 1];
+			float current = depths[(uintptr_t)items[i].entity - 1];
+			CHECK(previous > current);
+		}
+
+		// Equal depths fall back to grouping by state
+		uint64_t a = MakeKey(PassTransparent, 2, 0, 0, 0.5f);
+		uint64_t b = MakeKey(PassTransparent, 1, 9, 9, 0.5f);
+		CHECK(b < a);
+	}
+
+	// The radix sort matches a stable sort on random keys, including
+	// ones that only differ in some bytes
+	{
+		std::mt19937_64 random(3);
+		std::vector<uint64_t> keys;
+		for (unsigned int i = 0; i < 20000; i++) {
+			uint64_t key = random();
+			if (i % 3 == 0) {
+				key &= 0xFF00FF00000000FFull;
+			}
+			keys.push_back(key);
+		}
+
+		std::vector<DrawItem> items = Sorted(keys);
+		std::vector<DrawItem> expected(keys.size());
+		for (size_t i = 0; i < keys.size(); i++) {
+			expected[i].key = keys[i];
+			expected[i].entity = (Entity*)(uintptr_t)(i + 1);
+		}
+		std::stable_sort(expected.begin(), expected.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+
+		bool same = true;
+		for (size_t i = 0; i < items.size(); i++) {
+			same = same && items[i].key == expected[i].key && items[i].entity == expected[i].entity;
+		}
+		CHECK(same);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,167 @@
+#include "HlodGrouping.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+int main()
+{
+	HlodGrouping grouping;
+	grouping.SetMaxMembers(8);
+	grouping.SetHysteresis(0.25f);
+
+	// Two materials' worth of unit boxes scattered over a field, and
+	// one box alone on its key
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const unsigned int count = 101;
+	std::vector<BoundingBox> bounds(count);
+	std::vector<unsigned int> keys(count);
+	for (unsigned int i = 0; i < count; i++) {
+		bounds[i] = BoundingBox(XMFLOAT3(200 * unit(random) - 100, 0, 200 * unit(random) - 100), XMFLOAT3(0.5f, 0.5f, 0.5f));
+		keys[i] = i == count - 1 ? 7 : i % 2;
+	}
+	grouping.Build(&bounds[0], &keys[0], count);
+
+	std::vector<HlodGroup>& groups = grouping.GetGroups();
+	const std::vector<unsigned int>& members = grouping.GetMembers();
+
+	// Every object lands in exactly one cluster, apart from the one
+	// alone on its key; clusters hold one key, between two and the
+	// most members, and are laid end to end through the members
+	{
+		std::vector<unsigned int> seen(count);
+		unsigned int first = 0;
+		bool oneKey = true;
+		bool sized = true;
+		bool contiguous = true;
+		for (unsigned int g = 0; g < groups.size(); g++) {
+			contiguous = contiguous && groups[g].first == first;
+			sized = sized && groups[g].count >= 2 && groups[g].count <= 8;
+			for (unsigned int i = groups[g].first; i < groups[g].first + groups[g].count; i++) {
+				seen[members[i]]++;
+				oneKey = oneKey && keys[members[i]] == keys[members[groups[g].first]];
+			}
+			first += groups[g].count;
+		}
+		CHECK(oneKey && sized && contiguous && first == members.size());
+
+		// Halving 50 objects until runs fit in 8 leaves no run of one
+		bool once = true;
+		for (unsigned int i = 0; i + 1 < count; i++) {
+			once = once && seen[i] == 1;
+		}
+		CHECK(once && seen[count - 1] == 0);
+
+		// Keys keep the order they're first seen in
+		CHECK(keys[members[0]] == 0 && keys[members.back()] == 1);
+	}
+
+	// Clusters are split by position: each one's sphere holds all of
+	// its members' boxes, and is well under half the field's
+	{
+		bool inside = true;
+		float largest = 0;
+		for (unsigned int g = 0; g < groups.size(); g++) {
+			XMVECTOR center = XMLoadFloat4(&groups[g].bounds);
+			for (unsigned int i = groups[g].first; i < groups[g].first + groups[g].count; i++) {
+				XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+				bounds[members[i]].GetCorners(corners);
+				for (unsigned int c = 0; c < BoundingBox::CORNER_COUNT; c++) {
+					float reach = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&corners[c]), center)));
+					inside = inside && reach <= groups[g].bounds.w * 1.0001f;
+				}
+			}
+			largest = std::max(largest, groups[g].bounds.w);
+		}
+		CHECK(inside && largest < 70);
+	}
+
+	// Partition alone: runs never go over the limit, and split along
+	// the longest axis, so points spread along x are cut on x
+	{
+		std::vector<XMFLOAT3> points(16);
+		for (unsigned int i = 0; i < points.size(); i++) {
+			points[i] = XMFLOAT3((float)((i * 7) % 16), 0.01f * i, 0);
+		}
+		std::vector<unsigned int> order;
+		std::vector<unsigned int> starts;
+		HlodGrouping::Partition(&points[0], (unsigned int)points.size(), 4, order, starts);
+		CHECK(starts.size() == 5 && starts.back() == 16);
+		bool banded = true;
+		for (unsigned int run = 0; run + 1 < starts.size(); run++) {
+			for (unsigned int i = starts[run]; i < starts[run + 1]; i++) {
+				banded = banded && (unsigned int)points[order[i]].x / 4 == (unsigned int)points[order[starts[run]]].x / 4;
+			}
+		}
+		CHECK(banded);
+	}
+
+	// A cluster with no proxy error has no proxy, and is never drawn as one
+	grouping.Select(XMVectorSet(1000, 0, 0, 1), 600, 1);
+	{
+		bool none = true;
+		for (unsigned int g = 0; g < groups.size(); g++) {
+			none = none && !groups[g].active;
+		}
+		CHECK(none);
+	}
+
+	// Switch distances: error times pixel scale over the threshold,
+	// measured from the nearest point of the sphere
+	{
+		HlodGroup& group = groups[0];
+		grouping.SetProxyError(0, 0.05f);
+
+		const float pixelScale = 600;
+		const float threshold = 2;
+		const float switchDistance = 0.05f * pixelScale / threshold;
+		XMVECTOR center = XMVectorSet(group.bounds.x, group.bounds.y, group.bounds.z, 1);
+		XMVECTOR out = XMVectorSet(0, 0, 1, 0);
+
+		grouping.Select(center, pixelScale, threshold);
+		CHECK(fabsf(group.switchDistance - switchDistance) < 1e-4f && !group.active);
+
+		// Walking away, the proxy only takes over a band past the distance
+		float outward = 0;
+		for (int step = 0; step <= 400; step++) {
+			float nearest = step * 0.1f;
+			grouping.Select(XMVectorAdd(center, XMVectorScale(out, group.bounds.w + nearest)), pixelScale, threshold);
+			if (group.active && outward == 0) {
+				outward = nearest;
+			}
+		}
+		CHECK(fabsf(outward - switchDistance * 1.25f) < 0.11f);
+
+		// And coming back, it holds on until a band short of it
+		float inward = 0;
+		for (int step = 400; step >= 0; step--) {
+			float nearest = step * 0.1f;
+			grouping.Select(XMVectorAdd(center, XMVectorScale(out, group.bounds.w + nearest)), pixelScale, threshold);
+			if (!group.active && inward == 0) {
+				inward = nearest;
+			}
+		}
+		CHECK(fabsf(inward - switchDistance * 0.75f) < 0.11f);
+
+		// The other clusters still have no proxy
+		bool others = true;
+		for (unsigned int g = 1; g < groups.size(); g++) {
+			others = others && !groups[g].active;
+		}
+		CHECK(others);
+
+		// A coarser threshold brings the switch in
+		grouping.Select(center, pixelScale, threshold * 2);
+		CHECK(fabsf(group.switchDistance - switchDistance * 0.5f) < 1e-4f);
+	}
+
+	// Rebuilding starts over, down to nothing
+	grouping.Build(nullptr, nullptr, 0);
+	CHECK(grouping.GetGroups().empty() && grouping.GetMembers().empty());
+
+	return TestResult();
+}
@@ -0,0 +1,89 @@
+#include "ConstantBufferLayout.h"
+#include "TestCheck.h"
+
+using namespace HlslPacking;
+
+static const unsigned int MaxFields = 8;
+
+// --------------------------------------------------------
+// A cbuffer declaration and the offsets fxc gives it
+// --------------------------------------------------------
+struct LayoutCase
+{
+	const char* Declaration;
+	unsigned int FieldCount;
+	FieldDesc Fields[MaxFields];
+	unsigned int Offsets[MaxFields];
+	unsigned int Size;
+};
+
+static const LayoutCase Cases[] =
+{
+	{ "(empty)", 0, {}, {}, 0 },
+
+	// Scalars and vectors share a register while they fit
+	{ "float a; float3 b;", 2,
+		{ { 4, 0, false }, { 12, 0, false } },
+		{ 0, 4 }, 16 },
+	{ "float a; float2 b; float2 c;", 3,
+		{ { 4, 0, false }, { 8, 0, false }, { 8, 0, false } },
+		{ 0, 4, 16 }, 32 },
+	{ "float3 a; float b; float3 c; float d;", 4,
+		{ { 12, 0, false }, { 4, 0, false }, { 12, 0, false }, { 4, 0, false } },
+		{ 0, 12, 16, 28 }, 32 },
+
+	// ...and move to the next one when they'd straddle it
+	{ "float3 a; float2 b;", 2,
+		{ { 12, 0, false }, { 8, 0, false } },
+		{ 0, 16 }, 32 },
+	{ "float a; float4x4 m; float b;", 3,
+		{ { 4, 0, false }, { 64, 0, false }, { 4, 0, false } },
+		{ 0, 16, 80 }, 96 },
+
+	// Arrays start a register, pad every element but the last,
+	// and let what follows fill the last element's register
+	{ "float a; float b[2]; float c;", 3,
+		{ { 4, 0, false }, { 4, 2, false }, { 4, 0, false } },
+		{ 0, 16, 36 }, 48 },
+	{ "float3 a[2]; float b;", 2,
+		{ { 12, 2, false }, { 4, 0, false } },
+		{ 0, 28 }, 32 },
+	{ "float4 a[3]; float b;", 2,
+		{ { 16, 3, false }, { 4, 0, false } },
+		{ 0, 48 }, 64 },
+
+	// Structs start a register too, and aren't padded after
+	{ "float2 a; struct { float3 x; } s; float b;", 3,
+		{ { 8, 0, false }, { 12, 0, true }, { 4, 0, false } },
+		{ 0, 16, 28 }, 32 },
+	{ "float a; struct { float4 x; float y; } s[2]; float2 b;", 3,
+		{ { 4, 0, false }, { 20, 2, true }, { 8, 0, false } },
+		{ 0, 16, 68 }, 80 },
+};
+
+int main()
+{
+	for (unsigned int c = 0; c < sizeof(Cases) / sizeof(Cases[0]); c++) {
+		const LayoutCase& layoutCase = Cases[c];
+		unsigned int offsets[MaxFields] = {};
+		unsigned int size = Layout(layoutCase.Fields, layoutCase.FieldCount, offsets);
+
+		bool matches = size == layoutCase.Size;
+		for (unsigned int i = 0; i < layoutCase.FieldCount; i++) {
+			matches = matches && offsets[i] == layoutCase.Offsets[i];
+		}
+
+		if (!matches) {
+			printf("Layout of \"%s\" is wrong\n", layoutCase.Declaration);
+		}
+		CHECK(matches);
+	}
+
+	// The constexpr helpers behind the static_assert checks
+	static_assert(AlignToRegister(17) == 32, "");
+	static_assert(PlaceField(12, 4) == 12 && PlaceField(12, 8) == 16, "");
+	static_assert(PlaceAggregate(4) == 16 && PlaceAggregate(32) == 32, "");
+	static_assert(ArraySize(4, 3) == 36 && ArraySize(16, 0) == 0, "");
+
+	return TestResult();
+}
@@ -0,0 +1,80 @@
+#include "InstancePacker.h"
+#include "TestCheck.h"
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+using namespace DrawKeys;
+
+// Every float of every item's transforms different
+static std::vector<ObjectConstants> MakeTransforms(unsigned int count)
+{
+	std::vector<ObjectConstants> transforms(count);
+	for (unsigned int i = 0; i < count; i++) {
+		float* values = (float*)&transforms[i];
+		for (unsigned int f = 0; f < sizeof(ObjectConstants) / sizeof(float); f++) {
+			values[f] = (float)(i * 100 + f);
+		}
+	}
+	return transforms;
+}
+
+int main()
+{
+	// The layout the instanced vertex shader reads from slot 1
+	CHECK(sizeof(InstanceData) == 112);
+	CHECK(offsetof(InstanceData, World) == 0 && offsetof(InstanceData, NormalMatrix) == 48 && offsetof(InstanceData, Color) == 96);
+
+	InstancePacker packer;
+
+	// Runs break wherever the material or the mesh changes, but not
+	// on depth or the pass a key's fields are placed by
+	{
+		const unsigned int materials[] = { 1, 1, 1, 2, 2, 2, 1, 3, 3 };
+		const unsigned int meshes[] = { 1, 1, 2, 2, 2, 2, 1, 4, 4 };
+		const unsigned int count = 9;
+		std::vector<DrawItem> items(count);
+		for (unsigned int i = 0; i < count; i++) {
+			unsigned int pass = materials[i] == 3 ? PassTransparent : PassOpaque;
+			items[i].key = MakeKey(pass, 0, materials[i], meshes[i], i * 0.1f);
+			items[i].entity = nullptr;
+		}
+		std::vector<ObjectConstants> transforms = MakeTransforms(count);
+		packer.Build(&items[0], &transforms[0], count);
+
+		const std::vector<InstanceRun>& runs = packer.GetRuns();
+		const unsigned int firsts[] = { 0, 2, 3, 6, 7 };
+		const unsigned int counts[] = { 2, 1, 3, 1, 2 };
+		CHECK(runs.size() == 5);
+		for (unsigned int r = 0; r < runs.size() && r < 5; r++) {
+			CHECK(runs[r].first == firsts[r] && runs[r].instanceCount == counts[r]);
+		}
+
+		// Each instance holds its own draw's matrices, in draw order
+		const std::vector<InstanceData>& instances = packer.GetInstances();
+		CHECK(instances.size() == count);
+		bool packed = true;
+		for (unsigned int i = 0; i < count; i++) {
+			packed = packed && memcmp(&instances[i].World, &transforms[i].objectToWorld, sizeof(AffineMatrix)) == 0;
+			packed = packed && memcmp(&instances[i].NormalMatrix, &transforms[i].normalMatrix, sizeof(AffineMatrix)) == 0;
+		}
+		CHECK(packed);
+
+		// A run's color reaches all of its instances and no others
+		for (unsigned int r = 0; r < runs.size(); r++) {
+			packer.SetRunColor(r, XMFLOAT4(0, 0, 0, 0));
+		}
+		packer.SetRunColor(2, XMFLOAT4(1, 0.5f, 0.25f, 1));
+		for (unsigned int i = 0; i < count; i++) {
+			bool inRun = i >= 3 && i < 6;
+			CHECK(instances[i].Color.x == (inRun ? 1 : 0) && instances[i].Color.w == (inRun ? 1 : 0));
+		}
+	}
+
+	// Rebuilding starts over, down to nothing
+	packer.Build(nullptr, nullptr, 0);
+	CHECK(packer.GetRuns().empty() && packer.GetInstances().empty());
+
+	return TestResult();
+}
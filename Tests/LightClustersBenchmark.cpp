@@ -0,0 +1,57 @@
+#include "LightClusters.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times assigning 1,000 to 10,000 point and spot lights,
+// spread through a street sized volume in front of the
+// camera, to the cluster grid
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int lightCounts[] = { 1000, 2000, 5000, 10000 };
+	const unsigned int runs = 20;
+	const float nearPlane = 0.1f;
+	const float farPlane = 200.0f;
+
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 2, -10, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0f, 16.0f / 9.0f, nearPlane, farPlane);
+
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<Light> lights(lightCounts[3]);
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		Light& light = lights[i];
+		light.Position = XMFLOAT3(200 * unit(random) - 100, 20 * unit(random), 200 * unit(random));
+		light.Range = 1 + 7 * unit(random);
+		light.Color = XMFLOAT3(1, 1, 1);
+		light.Type = i % 4 == 0 ? LightSpot : LightPoint;
+		light.SpotCosAngle = light.Type == LightSpot ? cosf(0.3f + unit(random)) : -1;
+		light.Direction = XMFLOAT3(0, -1, 0);
+	}
+
+	ThreadPool threadPool;
+	LightClusters clusters(&threadPool);
+	printf("%u clusters, %u threads, average of %u runs\n", LightClusters::ClusterCount, threadPool.GetThreadCount(), runs);
+
+	for (unsigned int c = 0; c < 4; c++) {
+		unsigned int count = lightCounts[c];
+		clusters.Build(&lights[0], count, view, projection, nearPlane, farPlane);
+
+		double seconds = 0;
+		for (unsigned int run = 0; run < runs; run++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			clusters.Build(&lights[0], count, view, projection, nearPlane, farPlane);
+			seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		printf("%5u lights: %.3f ms, %u light indices\n",
+			count, seconds * 1000 / runs, (unsigned int)clusters.GetLightIndices().size());
+	}
+	return 0;
+}
@@ -0,0 +1,195 @@
+#include "LightClusters.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+static const float NearPlane = 0.1f;
+static const float FarPlane = 200.0f;
+
+// Point and spot lights scattered around and in front of the camera
+static std::vector<Light> MakeLights(unsigned int count, unsigned int seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<Light> lights(count);
+	for (unsigned int i = 0; i < count; i++) {
+		Light& light = lights[i];
+		light.Position = XMFLOAT3(120 * unit(random) - 60, 40 * unit(random) - 20, 150 * unit(random) - 20);
+		light.Range = 0.5f + 12 * unit(random);
+		light.Color = XMFLOAT3(1, 1, 1);
+		light.Type = i % 3 == 0 ? LightSpot : LightPoint;
+		light.SpotCosAngle = -1;
+		light.Direction = XMFLOAT3(0, 0, 1);
+		if (light.Type == LightSpot) {
+			XMStoreFloat3(&light.Direction, XMVector3Normalize(XMVectorSet(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f, 0)));
+			light.SpotCosAngle = cosf(0.1f + 1.4f * unit(random));
+		}
+	}
+	return lights;
+}
+
+// --------------------------------------------------------
+// Whether a light reaches a cluster, worked out one pair at
+// a time in double precision from the cluster's corners.
+// Returns 1 for a clear hit, 0 for a clear miss, and -1 when
+// it's too close to call.
+// --------------------------------------------------------
+static int Reaches(const double position[3], const double direction[3], double range, double cosAngle,
+	double projectionX, double projectionY, unsigned int x, unsigned int y, unsigned int z)
+{
+	const double margin = 1e-3;
+
+	double depthRatio = (double)FarPlane / NearPlane;
+	double depths[2] = {
+		NearPlane * pow(depthRatio, (double)z / LightClusters::CountZ),
+		NearPlane * pow(depthRatio, (double)(z + 1) / LightClusters::CountZ)
+	};
+	double ndcX[2] = { -1 + 2.0 * x / LightClusters::CountX, -1 + 2.0 * (x + 1) / LightClusters::CountX };
+	double ndcY[2] = { 1 - 2.0 * (y + 1) / LightClusters::CountY, 1 - 2.0 * y / LightClusters::CountY };
+
+	double min[3] = { 1e30, 1e30, 1e30 };
+	double max[3] = { -1e30, -1e30, -1e30 };
+	for (int corner = 0; corner < 8; corner++) {
+		double depth = depths[corner >> 2 & 1];
+		double point[3] = { ndcX[corner & 1] * depth / projectionX, ndcY[corner >> 1 & 1] * depth / projectionY, depth };
+		for (int a = 0; a < 3; a++) {
+			min[a] = std::min(min[a], point[a]);
+			max[a] = std::max(max[a], point[a]);
+		}
+	}
+
+	// The sphere against the box
+	double distanceSq = 0;
+	double center[3];
+	double boundingRadiusSq = 0;
+	for (int a = 0; a < 3; a++) {
+		double d = std::max(std::max(min[a] - position[a], position[a] - max[a]), 0.0);
+		distanceSq += d * d;
+		center[a] = (min[a] + max[a]) * 0.5;
+		boundingRadiusSq += (max[a] - center[a]) * (max[a] - center[a]);
+	}
+	double distance = sqrt(distanceSq);
+	if (distance > range + margin) {
+		return 0;
+	}
+	bool sureInside = distance < range - margin;
+
+	// The cone against the box's bounding sphere
+	if (cosAngle > 0) {
+		double boundingRadius = sqrt(boundingRadiusSq);
+		double to[3] = { center[0] - position[0], center[1] - position[1], center[2] - position[2] };
+		double along = to[0] * direction[0] + to[1] * direction[1] + to[2] * direction[2];
+		double across = sqrt(std::max(to[0] * to[0] + to[1] * to[1] + to[2] * to[2] - along * along, 0.0));
+		double coneDistance = across * cosAngle - along * sqrt(1 - cosAngle * cosAngle);
+		if (coneDistance > boundingRadius + margin || along < -boundingRadius - margin) {
+			return 0;
+		}
+		sureInside = sureInside && coneDistance < boundingRadius - margin && along > -boundingRadius + margin;
+	}
+
+	return sureInside ? 1 : -1;
+}
+
+int main()
+{
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(2, 1, -5, 1), XMVectorSet(0.2f, -0.1f, 1, 0), XMVectorSet(0, 1, 0, 0));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0f, 16.0f / 9.0f, NearPlane, FarPlane);
+	double projectionX = XMVectorGetX(projection.r[0]);
+	double projectionY = XMVectorGetY(projection.r[1]);
+
+	std::vector<Light> lights = MakeLights(1000, 7);
+
+	ThreadPool threadPool(4);
+	LightClusters clusters(&threadPool);
+	clusters.Build(&lights[0], (unsigned int)lights.size(), view, projection, NearPlane, FarPlane);
+	const std::vector<LightCluster>& result = clusters.GetClusters();
+	const std::vector<unsigned int>& indices = clusters.GetLightIndices();
+
+	// Clusters are laid end to end through the index list, each one's
+	// lights in index order
+	{
+		CHECK(result.size() == LightClusters::ClusterCount);
+		unsigned int offset = 0;
+		bool contiguous = true;
+		bool ordered = true;
+		for (unsigned int c = 0; c < result.size(); c++) {
+			contiguous = contiguous && result[c].Offset == offset;
+			for (unsigned int i = 1; i < result[c].Count; i++) {
+				ordered = ordered && indices[offset + i - 1] < indices[offset + i];
+			}
+			offset += result[c].Count;
+		}
+		CHECK(contiguous && ordered && offset == indices.size());
+	}
+
+	// Against every light and cluster pair worked out on its own:
+	// every clear hit is listed and no clear miss is
+	{
+		unsigned int sureHits = 0;
+		unsigned int missing = 0;
+		unsigned int extra = 0;
+		unsigned int unsure = 0;
+		std::vector<unsigned char> listed(lights.size());
+		for (unsigned int z = 0; z < LightClusters::CountZ; z++) {
+			for (unsigned int y = 0; y < LightClusters::CountY; y++) {
+				for (unsigned int x = 0; x < LightClusters::CountX; x++) {
+					const LightCluster& cluster = result[x + (y + z * LightClusters::CountY) * LightClusters::CountX];
+					std::fill(listed.begin(), listed.end(), 0);
+					for (unsigned int i = 0; i < cluster.Count; i++) {
+						listed[indices[cluster.Offset + i]] = 1;
+					}
+
+					for (unsigned int l = 0; l < lights.size(); l++) {
+						XMFLOAT3 p, d;
+						XMStoreFloat3(&p, XMVector3TransformCoord(XMLoadFloat3(&lights[l].Position), view));
+						XMStoreFloat3(&d, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&lights[l].Direction), view)));
+						double position[3] = { p.x, p.y, p.z };
+						double direction[3] = { d.x, d.y, d.z };
+
+						int reaches = Reaches(position, direction, lights[l].Range, lights[l].SpotCosAngle, projectionX, projectionY, x, y, z);
+						sureHits += reaches == 1;
+						unsure += reaches == -1;
+						missing += reaches == 1 && !listed[l];
+						extra += reaches == 0 && listed[l];
+					}
+				}
+			}
+		}
+		CHECK(missing == 0 && extra == 0);
+
+		// Enough hits to mean something, and few too close to call
+		CHECK(sureHits > 10000 && unsure < sureHits / 100);
+	}
+
+	// A depth in the middle of a slice maps to that slice through
+	// the depth scale and bias the shader uses
+	for (unsigned int z = 0; z < LightClusters::CountZ; z++) {
+		float depth = NearPlane * powf(FarPlane / NearPlane, (z + 0.5f) / LightClusters::CountZ);
+		CHECK((unsigned int)floorf(logf(depth) * clusters.GetDepthScale() + clusters.GetDepthBias()) == z);
+	}
+
+	// The same lights give the same lists on any number of threads
+	{
+		ThreadPool oneThread(1);
+		LightClusters serial(&oneThread);
+		serial.Build(&lights[0], (unsigned int)lights.size(), view, projection, NearPlane, FarPlane);
+		CHECK(serial.GetLightIndices() == indices);
+
+		bool same = true;
+		for (unsigned int c = 0; c < LightClusters::ClusterCount; c++) {
+			same = same && serial.GetClusters()[c].Offset == result[c].Offset && serial.GetClusters()[c].Count == result[c].Count;
+		}
+		CHECK(same);
+	}
+
+	// No lights, no indices
+	clusters.Build(nullptr, 0, view, projection, NearPlane, FarPlane);
+	CHECK(clusters.GetLightIndices().empty() && clusters.GetClusters()[0].Count == 0);
+
+	return TestResult();
+}
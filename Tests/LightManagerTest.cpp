@@ -0,0 +1,208 @@
+#include "LightManager.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <map>
+#include <random>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// What the test expects of each light, kept by id
+// --------------------------------------------------------
+struct ExpectedLight
+{
+	LightType Type;
+	XMFLOAT3 Position;
+	XMFLOAT3 Direction;
+	XMFLOAT3 Color;
+	XMFLOAT3 Ambient;
+	float Range;
+	float SpotCosAngle;
+};
+
+static bool Near(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return fabsf(a.x - b.x) < 1e-6f && fabsf(a.y - b.y) < 1e-6f && fabsf(a.z - b.z) < 1e-6f;
+}
+
+static XMFLOAT3 Normalized(const XMFLOAT3& v)
+{
+	float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+	return length > 0 ? XMFLOAT3(v.x / length, v.y / length, v.z / length) : XMFLOAT3(0, 0, 1);
+}
+
+// Every light is packed where the manager says, as the shader reads it,
+// with the local lights first
+static bool MatchesExpected(LightManager& manager, const std::map<LightId, ExpectedLight>& expected)
+{
+	const std::vector<Light>& packed = manager.GetPackedLights();
+	if (packed.size() != expected.size()) {
+		return false;
+	}
+
+	unsigned int localCount = 0;
+	for (std::map<LightId, ExpectedLight>::const_iterator it = expected.begin(); it != expected.end(); ++it) {
+		localCount += it->second.Type != LightDirectional;
+	}
+	if (manager.GetLocalLightCount() != localCount || manager.GetDirectionalLightCount() != expected.size() - localCount) {
+		return false;
+	}
+
+	for (std::map<LightId, ExpectedLight>::const_iterator it = expected.begin(); it != expected.end(); ++it) {
+		const ExpectedLight& light = it->second;
+		unsigned int packedIndex = manager.GetPackedIndex(it->first);
+		if (packedIndex >= packed.size() || manager.GetPackedId(packedIndex) != it->first) {
+			return false;
+		}
+		if ((packedIndex < localCount) != (light.Type != LightDirectional)) {
+			return false;
+		}
+
+		const Light& actual = packed[packedIndex];
+		bool directional = light.Type == LightDirectional;
+		XMFLOAT3 direction = light.Type == LightPoint ? XMFLOAT3(0, 0, 1) : Normalized(light.Direction);
+		if (actual.Type != (unsigned int)light.Type
+			|| !Near(actual.Position, directional ? light.Ambient : light.Position)
+			|| actual.Range != (directional ? 0 : light.Range)
+			|| !Near(actual.Color, light.Color)
+			|| actual.SpotCosAngle != (light.Type == LightSpot ? light.SpotCosAngle : -1)
+			|| !Near(actual.Direction, direction)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main()
+{
+	LightManager manager;
+	std::map<LightId, ExpectedLight> expected;
+
+	// Nothing to pack, then one of each type
+	CHECK(!manager.Pack());
+
+	LightId sun = manager.AddDirectional(XMFLOAT3(0, -2, 0), XMFLOAT3(1, 1, 1), XMFLOAT3(0.1f, 0.1f, 0.1f));
+	LightId lamp = manager.AddPoint(XMFLOAT3(1, 2, 3), 5, XMFLOAT3(1, 0, 0));
+	LightId torch = manager.AddSpot(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0), 10, 0.8f, XMFLOAT3(0, 1, 0));
+	expected[sun] = { LightDirectional, XMFLOAT3(0, 0, 0), XMFLOAT3(0, -2, 0), XMFLOAT3(1, 1, 1), XMFLOAT3(0.1f, 0.1f, 0.1f), 0, -1 };
+	expected[lamp] = { LightPoint, XMFLOAT3(1, 2, 3), XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 0), 5, -1 };
+	expected[torch] = { LightSpot, XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, 0, 0), 10, 0.8f };
+
+	CHECK(manager.Pack());
+	CHECK(manager.WasLastPackFull() && manager.GetLastPackCount() == 3);
+	CHECK(MatchesExpected(manager, expected));
+
+	// The directional light was added first but is packed last
+	CHECK(manager.GetPackedIndex(sun) == 2);
+
+	// Setting what a light already has changes nothing
+	manager.SetPosition(lamp, XMFLOAT3(1, 2, 3));
+	manager.SetRange(lamp, 5);
+	CHECK(!manager.Pack());
+	CHECK(manager.GetLastPackCount() == 0);
+
+	// Changes are packed in place, each light once
+	manager.SetPosition(lamp, XMFLOAT3(4, 5, 6));
+	manager.SetColor(lamp, XMFLOAT3(0, 0, 1));
+	manager.SetDirection(torch, XMFLOAT3(0, 3, 4));
+	expected[lamp].Position = XMFLOAT3(4, 5, 6);
+	expected[lamp].Color = XMFLOAT3(0, 0, 1);
+	expected[torch].Direction = XMFLOAT3(0, 3, 4);
+	CHECK(manager.Pack());
+	CHECK(!manager.WasLastPackFull() && manager.GetLastPackCount() == 2);
+	CHECK(MatchesExpected(manager, expected));
+
+	// Random adds, removes and changes, checked after every pack
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+	std::vector<LightId> live;
+	live.push_back(sun);
+	live.push_back(lamp);
+	live.push_back(torch);
+
+	unsigned int mismatches = 0;
+	unsigned int incrementalPacks = 0;
+	for (unsigned int frame = 0; frame < 2000; frame++) {
+		unsigned int operations = random() % 6;
+		for (unsigned int o = 0; o < operations; o++) {
+			unsigned int operation = random() % 10;
+
+			if (operation == 0 || live.empty()) {
+				ExpectedLight light = {};
+				light.Type = (LightType)(random() % 3);
+				light.Position = XMFLOAT3(value(random), value(random), value(random));
+				light.Direction = XMFLOAT3(value(random), value(random), value(random));
+				light.Color = XMFLOAT3(fabsf(value(random)), 0, 1);
+				light.Ambient = light.Type == LightDirectional ? XMFLOAT3(0.2f, 0.3f, 0.4f) : XMFLOAT3(0, 0, 0);
+				light.Range = fabsf(value(random)) + 1;
+				light.SpotCosAngle = light.Type == LightSpot ? 0.5f : -1;
+
+				LightId id;
+				if (light.Type == LightDirectional) {
+					id = manager.AddDirectional(light.Direction, light.Color, light.Ambient);
+					light.Position = XMFLOAT3(0, 0, 0);
+					light.Range = 0;
+				}
+				else if (light.Type == LightPoint) {
+					id = manager.AddPoint(light.Position, light.Range, light.Color);
+				}
+				else {
+					id = manager.AddSpot(light.Position, light.Direction, light.Range, light.SpotCosAngle, light.Color);
+				}
+
+				expected[id] = light;
+				live.push_back(id);
+			}
+			else if (operation == 1) {
+				unsigned int which = random() % live.size();
+				manager.Remove(live[which]);
+				expected.erase(live[which]);
+				live[which] = live.back();
+				live.pop_back();
+			}
+			else {
+				LightId id = live[random() % live.size()];
+				ExpectedLight& light = expected[id];
+				switch (operation % 4) {
+				case 0:
+					light.Position = XMFLOAT3(value(random), value(random), value(random));
+					manager.SetPosition(id, light.Position);
+					break;
+				case 1:
+					light.Direction = XMFLOAT3(value(random), 0, value(random));
+					manager.SetDirection(id, light.Direction);
+					break;
+				case 2:
+					light.Color = XMFLOAT3(1, fabsf(value(random)), 0);
+					manager.SetColor(id, light.Color);
+					break;
+				default:
+					light.Range = fabsf(value(random)) + 1;
+					manager.SetRange(id, light.Range);
+					if (light.Type == LightDirectional) {
+						light.Range = 0;
+					}
+					break;
+				}
+			}
+		}
+
+		manager.Pack();
+		incrementalPacks += !manager.WasLastPackFull() && manager.GetLastPackCount() > 0;
+		mismatches += !MatchesExpected(manager, expected);
+		CHECK(manager.GetLightCount() == live.size());
+	}
+
+	CHECK(mismatches == 0);
+	CHECK(incrementalPacks > 100);
+
+	// Removing everything leaves nothing packed
+	for (unsigned int i = 0; i < live.size(); i++) {
+		manager.Remove(live[i]);
+	}
+	CHECK(manager.Pack());
+	CHECK(manager.GetPackedLights().empty() && manager.GetLocalLightCount() == 0);
+
+	return TestResult();
+}
@@ -0,0 +1,69 @@
+#include "LodSelector.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times picking levels for a million objects scattered over
+// a 2 km field, with fade culling on, as the camera walks
+// forward a little each frame
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int count = 1000000;
+	const unsigned int frames = 20;
+	const float screenHeight = 1080;
+
+	std::mt19937 random(23);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<XMFLOAT4> bounds(count);
+	std::vector<LodChain> chains(count);
+	for (unsigned int i = 0; i < count; i++) {
+		bounds[i] = XMFLOAT4(2000 * unit(random) - 1000, 20 * unit(random), 2000 * unit(random) - 1000, 0.2f + 5 * unit(random));
+
+		// Each level strays about twice as far as the last
+		chains[i].Count = 1 + i % MaxLods;
+		chains[i].Errors[0] = 0;
+		for (unsigned int level = 1; level < MaxLods; level++) {
+			chains[i].Errors[level] = 0.01f * (float)(1 << level) * (0.5f + unit(random));
+		}
+	}
+	std::vector<unsigned int> lods(count);
+	std::vector<float> fades(count);
+
+	ThreadPool threadPool;
+	LodSelector selector(&threadPool);
+	selector.SetErrorThreshold(1.0f);
+	selector.SetHysteresis(0.25f);
+	selector.SetFadeCull(1.0f, 2.0f);
+
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0f, 16.0f / 9.0f, 0.1f, 2000.0f);
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 2, 0, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+	selector.Select(view, projection, screenHeight, &bounds[0], &chains[0], &lods[0], &fades[0], count);
+
+	double seconds = 0;
+	unsigned int switches = 0;
+	for (unsigned int frame = 0; frame < frames; frame++) {
+		view = XMMatrixLookToLH(XMVectorSet(0, 2, frame * 0.5f, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		selector.Select(view, projection, screenHeight, &bounds[0], &chains[0], &lods[0], &fades[0], count);
+		seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		switches += selector.GetSwitchCount();
+	}
+
+	unsigned int perLevel[MaxLods] = {};
+	for (unsigned int i = 0; i < count; i++) {
+		perLevel[lods[i]]++;
+	}
+
+	printf("%u objects, %u threads\n", count, threadPool.GetThreadCount());
+	printf("levels: %u / %u / %u / %u, %u culled, %.0f switches per frame\n",
+		perLevel[0], perLevel[1], perLevel[2], perLevel[3], selector.GetCulledCount(), (double)switches / frames);
+	printf("select: %.2f ms, %.1fM objects/s (average of %u frames)\n",
+		seconds * 1000 / frames, count * frames / seconds / 1e6, frames);
+	return 0;
+}
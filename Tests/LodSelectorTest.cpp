@@ -0,0 +1,187 @@
+#include "LodSelector.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+static const float ScreenHeight = 720;
+static const float FieldOfView = 1.0f;
+
+// Errors of a chain whose levels each stray twice as far as the last
+static LodChain MakeChain(unsigned int count)
+{
+	LodChain chain = {};
+	chain.Count = count;
+	for (unsigned int i = 1; i < count; i++) {
+		chain.Errors[i] = 0.01f * (float)(1 << i);
+	}
+	return chain;
+}
+
+// The coarsest level whose error on screen stays under the limit,
+// worked out one object at a time in double precision
+static unsigned int CoarsestUnder(const XMFLOAT4& sphere, const LodChain& chain, const XMFLOAT3& eye, double limit)
+{
+	double dx = sphere.x - eye.x;
+	double dy = sphere.y - eye.y;
+	double dz = sphere.z - eye.z;
+	double nearest = std::max(sqrt(dx * dx + dy * dy + dz * dz) - sphere.w, 1e-4);
+	double pixelScale = ScreenHeight * 0.5 / tan(FieldOfView * 0.5);
+
+	unsigned int level = 0;
+	for (unsigned int i = 1; i < chain.Count; i++) {
+		if (chain.Errors[i] * sphere.w * pixelScale / nearest <= limit) {
+			level = i;
+		}
+	}
+	return level;
+}
+
+int main()
+{
+	ThreadPool threadPool;
+	LodSelector selector(&threadPool);
+	selector.SetErrorThreshold(1.0f);
+	selector.SetHysteresis(0.25f);
+
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(FieldOfView, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+	// One object walked away from the camera and back: levels only
+	// get coarser going out and finer coming in, and each switch
+	// happens further out going away than coming back
+	{
+		XMFLOAT4 sphere(0, 0, 0, 1);
+		LodChain chain = MakeChain(4);
+		unsigned int lod = 0;
+		float fade;
+
+		float outward[MaxLods] = {};
+		float inward[MaxLods] = {};
+		for (int step = 0; step <= 2000; step++) {
+			float distance = 2 + step * 0.1f;
+			XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, -distance, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+			unsigned int previous = lod;
+			selector.Select(view, projection, ScreenHeight, &sphere, &chain, &lod, &fade, 1);
+			CHECK(lod >= previous && lod <= previous + 1);
+			if (lod != previous) {
+				outward[lod] = distance;
+			}
+		}
+		CHECK(lod == 3);
+
+		for (int step = 2000; step >= 0; step--) {
+			float distance = 2 + step * 0.1f;
+			XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, -distance, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+			unsigned int previous = lod;
+			selector.Select(view, projection, ScreenHeight, &sphere, &chain, &lod, &fade, 1);
+			CHECK(lod <= previous && lod + 1 >= previous);
+			if (lod != previous) {
+				inward[previous] = distance;
+			}
+		}
+		CHECK(lod == 0);
+
+		for (unsigned int level = 1; level < MaxLods; level++) {
+			CHECK(outward[level] > 0 && inward[level] > 0);
+			CHECK(outward[level] > inward[level] * 1.5f);
+		}
+
+		// Hovering just either side of a switch distance doesn't flicker
+		float hover = outward[2];
+		lod = 1;
+		selector.Select(XMMatrixLookToLH(XMVectorSet(0, 0, -hover, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)),
+			projection, ScreenHeight, &sphere, &chain, &lod, &fade, 1);
+		CHECK(lod == 2);
+
+		unsigned int switches = 0;
+		for (int frame = 0; frame < 200; frame++) {
+			float distance = hover * (1 + 0.05f * sinf(frame * 0.7f));
+			XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, -distance, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+			selector.Select(view, projection, ScreenHeight, &sphere, &chain, &lod, &fade, 1);
+			switches += selector.GetSwitchCount();
+		}
+		CHECK(switches == 0 && lod == 2);
+
+		// Turning the camera in place changes nothing
+		for (int frame = 0; frame < 16; frame++) {
+			XMVECTOR forward = XMVectorSet(sinf(frame * 0.4f), 0, cosf(frame * 0.4f), 0);
+			XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, -hover, 1), forward, XMVectorSet(0, 1, 0, 0));
+			selector.Select(view, projection, ScreenHeight, &sphere, &chain, &lod, &fade, 1);
+			CHECK(lod == 2 && selector.GetSwitchCount() == 0);
+		}
+	}
+
+	// Random objects, enough to span several jobs and a padded group
+	// at the end, against the band worked out one at a time
+	{
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		const unsigned int count = 9000 + 3;
+		std::vector<XMFLOAT4> spheres(count);
+		std::vector<LodChain> chains(count);
+		std::vector<unsigned int> lods(count);
+		std::vector<unsigned int> before(count);
+		std::vector<float> fades(count);
+		for (unsigned int i = 0; i < count; i++) {
+			spheres[i] = XMFLOAT4(400 * unit(random) - 200, 20 * unit(random), 400 * unit(random) - 200, 0.2f + 5 * unit(random));
+			chains[i] = MakeChain(1 + (unsigned int)(unit(random) * MaxLods) % MaxLods);
+			lods[i] = (unsigned int)(unit(random) * MaxLods) % MaxLods;
+		}
+
+		XMFLOAT3 eye(3, 2, -7);
+		XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&eye), XMVectorSet(0.3f, -0.1f, 1, 0), XMVectorSet(0, 1, 0, 0));
+
+		unsigned int outside = 0;
+		unsigned int moved = 0;
+		unsigned int switches = 0;
+		for (unsigned int frame = 0; frame < 2; frame++) {
+			before = lods;
+			selector.Select(view, projection, ScreenHeight, &spheres[0], &chains[0], &lods[0], &fades[0], count);
+
+			for (unsigned int i = 0; i < count; i++) {
+				unsigned int lowest = CoarsestUnder(spheres[i], chains[i], eye, 0.75);
+				unsigned int highest = CoarsestUnder(spheres[i], chains[i], eye, 1.25);
+				unsigned int current = std::min(before[i], chains[i].Count - 1);
+				unsigned int expected = std::min(std::max(current, lowest), highest);
+
+				outside += lods[i] != expected;
+				moved += lods[i] != before[i];
+				CHECK(fades[i] == 1);
+			}
+
+			// Once settled, the same view switches nothing
+			switches = selector.GetSwitchCount();
+			CHECK(switches == (frame == 0 ? moved : 0));
+			moved = 0;
+		}
+
+		CHECK(outside == 0);
+	}
+
+	// Fading with size on screen, down to culled
+	{
+		XMFLOAT4 spheres[3] = { XMFLOAT4(0, 0, 10, 1), XMFLOAT4(0, 0, 300, 1), XMFLOAT4(0, 0, 3000, 1) };
+		LodChain chains[3] = { MakeChain(1), MakeChain(1), MakeChain(1) };
+		unsigned int lods[3] = {};
+		float fades[3];
+		XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, 0, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+
+		// About 146, 4.4 and 0.44 pixels across
+		selector.SetFadeCull(2, 4);
+		selector.Select(view, projection, ScreenHeight, spheres, chains, lods, fades, 3);
+		CHECK(fades[0] == 1);
+		CHECK(fades[1] > 0.5f && fades[1] < 0.7f);
+		CHECK(fades[2] == 0);
+		CHECK(selector.GetCulledCount() == 1);
+
+		selector.SetFadeCull(0, 0);
+		selector.Select(view, projection, ScreenHeight, spheres, chains, lods, fades, 3);
+		CHECK(fades[2] == 1 && selector.GetCulledCount() == 0);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,71 @@
+#include "MeshBVH.h"
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times building a BVH over a 256x256 quad heightfield and
+// casting picking rays into it from a camera above, the way
+// Picker casts one per entity the scene BVH lets through
+// --------------------------------------------------------
+int main()
+{
+	const int size = 256;
+	const unsigned int rayCount = 1000000;
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	for (int z = 0; z <= size; z++) {
+		for (int x = 0; x <= size; x++) {
+			Vertex vertex = {};
+			vertex.Position = XMFLOAT3((float)x, sinf(x * 0.1f) * cosf(z * 0.07f) * 8, (float)z);
+			vertices.push_back(vertex);
+		}
+	}
+	for (int z = 0; z < size; z++) {
+		for (int x = 0; x < size; x++) {
+			unsigned int corner = z * (size + 1) + x;
+			indices.push_back(corner);
+			indices.push_back(corner + size + 1);
+			indices.push_back(corner + 1);
+			indices.push_back(corner + 1);
+			indices.push_back(corner + size + 1);
+			indices.push_back(corner + size + 2);
+		}
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	MeshBVH bvh(vertices, indices);
+	double buildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0, 1);
+	std::vector<XMFLOAT3> origins(rayCount), directions(rayCount);
+	for (unsigned int r = 0; r < rayCount; r++) {
+		origins[r] = XMFLOAT3(size * 0.5f, 60, -40);
+		XMFLOAT3 target(unit(random) * size, 0, unit(random) * size);
+		XMStoreFloat3(&directions[r], XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&target), XMLoadFloat3(&origins[r]))));
+	}
+
+	unsigned int hits = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int r = 0; r < rayCount; r++) {
+		float distance;
+		unsigned int triangle;
+		XMFLOAT2 barycentrics;
+		if (bvh.Intersect(origins[r], directions[r], FLT_MAX, distance, triangle, barycentrics)) {
+			hits++;
+		}
+	}
+	double castSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	printf("%u triangles, %u nodes, depth %u, built in %.2f ms\n",
+		bvh.GetTriangleCount(), bvh.GetNodeCount(), bvh.GetDepth(), buildSeconds * 1000);
+	printf("%u rays (%u hits) in %.1f ms: %.0f ns per ray\n",
+		rayCount, hits, castSeconds * 1000, castSeconds * 1e9 / rayCount);
+	return 0;
+}
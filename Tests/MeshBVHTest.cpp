@@ -0,0 +1,174 @@
+#include "MeshBVH.h"
+#include "TestCheck.h"
+#include <cfloat>
+#include <random>
+
+using namespace DirectX;
+
+static void AddTriangle(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, XMFLOAT3 a, XMFLOAT3 b, XMFLOAT3 c)
+{
+	Vertex vertex = {};
+	unsigned int first = (unsigned int)vertices.size();
+	vertex.Position = a;
+	vertices.push_back(vertex);
+	vertex.Position = b;
+	vertices.push_back(vertex);
+	vertex.Position = c;
+	vertices.push_back(vertex);
+	indices.push_back(first);
+	indices.push_back(first + 1);
+	indices.push_back(first + 2);
+}
+
+// --------------------------------------------------------
+// Closest hit by testing every triangle, in double precision
+// --------------------------------------------------------
+static bool IntersectAll(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	XMFLOAT3 origin, XMFLOAT3 direction, double& closest, unsigned int& closestTriangle)
+{
+	closest = DBL_MAX;
+	for (unsigned int t = 0; t < indices.size() / 3; t++) {
+		const XMFLOAT3& a = vertices[indices[t * 3]].Position;
+		const XMFLOAT3& b = vertices[indices[t * 3 + 1]].Position;
+		const XMFLOAT3& c = vertices[indices[t * 3 + 2]].Position;
+		double e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+		double e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+		double d[3] = { direction.x, direction.y, direction.z };
+		double s[3] = { origin.x - a.x, origin.y - a.y, origin.z - a.z };
+
+		double p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+		double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+		if (std::fabs(det) < 1e-12) {
+			continue;
+		}
+
+		double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / det;
+		double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+		double v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) / det;
+		double distance = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / det;
+		if (u >= 0 && v >= 0 && u + v <= 1 && distance > 0 && distance < closest) {
+			closest = distance;
+			closestTriangle = t;
+		}
+	}
+
+	return closest != DBL_MAX;
+}
+
+// --------------------------------------------------------
+// Casts rays at random points on random triangles, from a
+// few triangle lengths away, and compares
+// the BVH's closest hit with the brute force one. Rays that
+// graze an edge can land on either triangle, so only ones
+// with a clear winner count as mismatches on the index.
+// --------------------------------------------------------
+static void CompareWithBruteForce(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	unsigned int rayCount, unsigned int seed)
+{
+	MeshBVH bvh(vertices, indices);
+	CHECK(bvh.GetTriangleCount() == indices.size() / 3);
+
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0, 1);
+	unsigned int hits = 0, missedHits = 0, extraHits = 0, wrongDistances = 0;
+
+	for (unsigned int r = 0; r < rayCount; r++) {
+		unsigned int aimed = (unsigned int)(unit(random) * (indices.size() / 3 - 1));
+		const XMFLOAT3& a = vertices[indices[aimed * 3]].Position;
+		const XMFLOAT3& b = vertices[indices[aimed * 3 + 1]].Position;
+		const XMFLOAT3& c = vertices[indices[aimed * 3 + 2]].Position;
+		float u = unit(random), v = unit(random) * (1 - u);
+		XMFLOAT3 target(
+			a.x + (b.x - a.x) * u + (c.x - a.x) * v,
+			a.y + (b.y - a.y) * u + (c.y - a.y) * v,
+			a.z + (b.z - a.z) * u + (c.z - a.z) * v);
+		float length = 4 * sqrtf((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y) + (b.z - a.z) * (b.z - a.z));
+		XMFLOAT3 origin(
+			target.x + length * (unit(random) * 2 - 1),
+			target.y + length * (unit(random) + 0.1f),
+			target.z + length * (unit(random) * 2 - 1));
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&target), XMLoadFloat3(&origin))));
+
+		double expectedDistance = 0;
+		unsigned int expectedTriangle = 0;
+		bool expectedHit = IntersectAll(vertices, indices, origin, direction, expectedDistance, expectedTriangle);
+
+		float distance = 0;
+		unsigned int triangle = 0;
+		XMFLOAT2 barycentrics;
+		bool hit = bvh.Intersect(origin, direction, FLT_MAX, distance, triangle, barycentrics);
+
+		if (expectedHit && !hit) {
+			missedHits++;
+		} else if (hit && !expectedHit) {
+			extraHits++;
+		} else if (hit) {
+			hits++;
+			if (std::fabs(distance - expectedDistance) > 1e-4 * expectedDistance + 1e-6) {
+				wrongDistances++;
+			}
+		}
+	}
+
+	printf("%u triangles, depth %u: %u of %u rays hit, %u missed, %u extra, %u at the wrong distance\n",
+		bvh.GetTriangleCount(), bvh.GetDepth(), hits, rayCount, missedHits, extraHits, wrongDistances);
+
+	// A handful of rays through shared edges can go either way in float
+	CHECK(hits > rayCount * 9 / 10);
+	CHECK(missedHits + extraHits <= rayCount / 1000);
+	CHECK(wrongDistances == 0);
+}
+
+int main()
+{
+	// A bumpy 64x64 quad heightfield
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		const int size = 64;
+		for (int z = 0; z < size; z++) {
+			for (int x = 0; x < size; x++) {
+				float h00 = sinf(x * 0.3f) * cosf(z * 0.2f) * 2, h10 = sinf((x + 1) * 0.3f) * cosf(z * 0.2f) * 2;
+				float h01 = sinf(x * 0.3f) * cosf((z + 1) * 0.2f) * 2, h11 = sinf((x + 1) * 0.3f) * cosf((z + 1) * 0.2f) * 2;
+				AddTriangle(vertices, indices, XMFLOAT3((float)x, h00, (float)z), XMFLOAT3((float)x, h01, (float)z + 1), XMFLOAT3((float)x + 1, h10, (float)z));
+				AddTriangle(vertices, indices, XMFLOAT3((float)x + 1, h10, (float)z), XMFLOAT3((float)x, h01, (float)z + 1), XMFLOAT3((float)x + 1, h11, (float)z + 1));
+			}
+		}
+		CompareWithBruteForce(vertices, indices, 4000, 1);
+	}
+
+	// Triangles shrinking geometrically along each axis, which the
+	// surface area heuristic peels off a few at a time into a deep,
+	// lopsided tree
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		for (int axis = 0; axis < 3; axis++) {
+			for (int i = -9; i < 20; i++) {
+				float c = ldexpf(1 + axis * 0.5f, i);
+				float p[3] = { 0, 0, 0 };
+				p[axis] = c;
+				float s = c * 0.05f;
+				AddTriangle(vertices, indices, XMFLOAT3(p[0], p[1], p[2]), XMFLOAT3(p[0] + s, p[1], p[2]), XMFLOAT3(p[0], p[1] + s, p[2] + s));
+			}
+		}
+
+		MeshBVH bvh(vertices, indices);
+		CHECK(bvh.GetDepth() > 16);
+		CompareWithBruteForce(vertices, indices, 4000, 2);
+	}
+
+	// No triangles at all
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		MeshBVH bvh(vertices, indices);
+		float distance = 0;
+		unsigned int triangle = 0;
+		XMFLOAT2 barycentrics;
+		CHECK(!bvh.Intersect(XMFLOAT3(0, 1, 0), XMFLOAT3(0, -1, 0), FLT_MAX, distance, triangle, barycentrics));
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,69 @@
+#include "ObjectLightSelector.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times picking the lights for 10,000 objects out of 1,000
+// point and spot lights, a quarter of them spots, spread
+// over a large and a small world. The smaller the world, the
+// more lights reach each object.
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int objectCount = 10000;
+	const unsigned int lightCount = 1000;
+	const unsigned int runs = 20;
+	const float sizes[] = { 200.0f, 60.0f };
+
+	ThreadPool threadPool;
+	ObjectLightSelector selector(&threadPool);
+	printf("%u objects, %u lights, %u threads\n", objectCount, lightCount, threadPool.GetThreadCount());
+
+	for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		float size = sizes[s];
+		std::mt19937 random(17);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<Light> lights(lightCount);
+		for (unsigned int i = 0; i < lightCount; i++) {
+			Light& light = lights[i];
+			light = Light();
+			light.Position = XMFLOAT3(size * unit(random), 10 * unit(random), size * unit(random));
+			light.Range = 1 + 15 * unit(random);
+			light.Color = XMFLOAT3(0.1f + unit(random), 0.1f + unit(random), 0.1f + unit(random));
+			light.Type = i % 4 == 0 ? LightSpot : LightPoint;
+			light.SpotCosAngle = -1;
+			if (light.Type == LightSpot) {
+				XMStoreFloat3(&light.Direction, XMVector3Normalize(XMVectorSet(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f, 0)));
+				light.SpotCosAngle = 0.2f + 0.75f * unit(random);
+			}
+		}
+
+		std::vector<XMFLOAT4> bounds(objectCount);
+		for (unsigned int i = 0; i < objectCount; i++) {
+			bounds[i] = XMFLOAT4(size * unit(random), 10 * unit(random), size * unit(random), 0.1f + 3 * unit(random));
+		}
+
+		selector.Select(&lights[0], lightCount, &bounds[0], objectCount);
+
+		double seconds = 0;
+		for (unsigned int run = 0; run < runs; run++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			selector.Select(&lights[0], lightCount, &bounds[0], objectCount);
+			seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		unsigned int picked = 0;
+		for (unsigned int i = 0; i < objectCount; i++) {
+			picked += selector.GetSelections()[i].Count;
+		}
+
+		printf("%3.0f m world: %.2f lights picked per object, %6.2f ms per select (average of %u runs)\n",
+			size, (double)picked / objectCount, seconds * 1000 / runs, runs);
+	}
+	return 0;
+}
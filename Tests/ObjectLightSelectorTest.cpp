@@ -0,0 +1,183 @@
+#include "ObjectLightSelector.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// The score the selector should give a light, worked out
+// for one light and one sphere at a time in double: the
+// shader's falloff at the sphere's nearest point, weighted
+// by brightness, and nothing outside a spot's cone
+// --------------------------------------------------------
+static double ReferenceScore(const Light& light, const XMFLOAT4& bounds)
+{
+	if (light.Type == LightDirectional || light.Range <= 0) {
+		return 0;
+	}
+
+	double to[3] = { bounds.x - light.Position.x, bounds.y - light.Position.y, bounds.z - light.Position.z };
+	double distance = sqrt(to[0] * to[0] + to[1] * to[1] + to[2] * to[2]);
+	double gap = std::max(distance - bounds.w, 0.0);
+	double falloff = std::max(1 - gap / light.Range, 0.0);
+	double brightness = 0.2126 * light.Color.x + 0.7152 * light.Color.y + 0.0722 * light.Color.z;
+	if (falloff <= 0 || brightness <= 0) {
+		return 0;
+	}
+
+	if (light.SpotCosAngle > 0) {
+		const XMFLOAT3& d = light.Direction;
+		double length = sqrt((double)d.x * d.x + (double)d.y * d.y + (double)d.z * d.z);
+		double along = (to[0] * d.x + to[1] * d.y + to[2] * d.z) / length;
+		double across = sqrt(std::max(distance * distance - along * along, 0.0));
+		double cosine = light.SpotCosAngle;
+		double sine = sqrt(1 - cosine * cosine);
+
+		// Distance from the center to the side of the cone
+		if (across * cosine - along * sine > bounds.w || along < -bounds.w) {
+			return 0;
+		}
+	}
+
+	return brightness * falloff * falloff;
+}
+
+static Light MakePoint(float x, float y, float z, float range, float brightness)
+{
+	Light light = {};
+	light.Position = XMFLOAT3(x, y, z);
+	light.Range = range;
+	light.Color = XMFLOAT3(brightness, brightness, brightness);
+	light.SpotCosAngle = -1;
+	light.Type = LightPoint;
+	return light;
+}
+
+static Light MakeSpot(float x, float y, float z, float range, XMFLOAT3 direction, float cosAngle)
+{
+	Light light = MakePoint(x, y, z, range, 1);
+	light.Direction = direction;
+	light.SpotCosAngle = cosAngle;
+	light.Type = LightSpot;
+	return light;
+}
+
+int main()
+{
+	ThreadPool threadPool(2);
+	ObjectLightSelector selector(&threadPool);
+
+	// Hand made cases around one unit sphere at the origin
+	{
+		std::vector<Light> lights;
+		lights.push_back(MakePoint(0, 0, 0, 0, 1));								// 0: no range
+		lights.push_back(MakePoint(3, 0, 0, 1.5f, 1));							// 1: falls short
+		lights.push_back(MakePoint(2, 0, 0, 4, 1));								// 2: 0.75^2
+		lights.push_back(MakePoint(-2, 0, 0, 4, 1));							// 3: ties with 2
+		lights.push_back(MakeSpot(0, 5, 0, 10, XMFLOAT3(0, 1, 0), 0.9f));		// 4: points away
+		lights.push_back(MakeSpot(0, -5, 0, 10, XMFLOAT3(0, 1, 0), 0.9f));		// 5: points at it
+		lights.push_back(MakePoint(0, 0, 1, 2, 0));								// 6: black
+
+		Light sun = MakePoint(0, 0, 0, 0, 5);
+		sun.Type = LightDirectional;
+		lights.push_back(sun);													// 7: directional
+
+		XMFLOAT4 sphere(0, 0, 0, 1);
+		selector.Select(&lights[0], (unsigned int)lights.size(), &sphere, 1);
+		const ObjectLightSet& set = selector.GetSelections()[0];
+
+		// 5 scores 0.6^2, below the tied pair, which keep index order
+		CHECK(set.Count == 3);
+		CHECK(set.Indices[0] == 2 && set.Indices[1] == 3 && set.Indices[2] == 5);
+	}
+
+	// No lights at all, and no objects
+	{
+		XMFLOAT4 sphere(0, 0, 0, 1);
+		selector.Select(nullptr, 0, &sphere, 1);
+		CHECK(selector.GetSelections()[0].Count == 0);
+		selector.Select(nullptr, 0, nullptr, 0);
+		CHECK(selector.GetSelections().empty());
+	}
+
+	// Random scenes against scoring every light for every object.
+	// Float and double can disagree on lights that score about the
+	// same, so those may be swapped, but nothing that clearly
+	// beats a picked light may be left out.
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	unsigned int wrong = 0;
+	unsigned int checkedObjects = 0;
+	unsigned int fullSets = 0;
+
+	for (unsigned int scene = 0; scene < 20; scene++) {
+		float size = 20.0f + 200.0f * unit(random);
+		unsigned int lightCount = 1 + random() % 300;
+
+		std::vector<Light> lights(lightCount);
+		for (unsigned int i = 0; i < lightCount; i++) {
+			float x = size * unit(random), y = 10.0f * unit(random), z = size * unit(random);
+			float range = 1.0f + 15.0f * unit(random);
+			if (random() % 3 == 0) {
+				XMFLOAT3 direction(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f);
+				lights[i] = MakeSpot(x, y, z, range, direction, 0.2f + 0.75f * unit(random));
+			}
+			else {
+				lights[i] = MakePoint(x, y, z, range, 0.1f + unit(random));
+			}
+			lights[i].Color.z *= unit(random);
+		}
+
+		unsigned int objectCount = 1 + random() % 1000;
+		std::vector<XMFLOAT4> bounds(objectCount);
+		for (unsigned int i = 0; i < objectCount; i++) {
+			bounds[i] = XMFLOAT4(size * unit(random), 10.0f * unit(random), size * unit(random), 0.1f + 3.0f * unit(random));
+		}
+
+		selector.Select(&lights[0], lightCount, &bounds[0], objectCount);
+		const std::vector<ObjectLightSet>& selections = selector.GetSelections();
+		CHECK(selections.size() == objectCount);
+
+		const double tolerance = 1e-5;
+		for (unsigned int o = 0; o < objectCount; o++) {
+			const ObjectLightSet& set = selections[o];
+			bool valid = set.Count <= MaxObjectLights;
+
+			std::vector<bool> picked(lightCount, false);
+			double lowest = 1e30;
+			for (unsigned int s = 0; s < set.Count && valid; s++) {
+				unsigned int light = set.Indices[s];
+				valid = light < lightCount && !picked[light];
+				if (!valid) break;
+				picked[light] = true;
+
+				// Picked lights reach the object, most influential first
+				double score = ReferenceScore(lights[light], bounds[o]);
+				valid = score > -tolerance && score <= lowest + tolerance;
+				lowest = std::min(lowest, score);
+			}
+
+			// Nothing left out scores clearly higher than what was picked,
+			// or scores at all if there was room for it
+			double bar = set.Count == MaxObjectLights ? lowest : 0;
+			for (unsigned int l = 0; l < lightCount && valid; l++) {
+				if (!picked[l]) {
+					valid = ReferenceScore(lights[l], bounds[o]) <= bar + tolerance;
+				}
+			}
+
+			wrong += !valid;
+			fullSets += set.Count == MaxObjectLights;
+			checkedObjects++;
+		}
+	}
+
+	printf("%u of %u objects checked had a full set of lights\n", fullSets, checkedObjects);
+	CHECK(wrong == 0);
+	CHECK(fullSets > 0 && fullSets < checkedObjects);
+
+	return TestResult();
+}
@@ -0,0 +1,70 @@
+#include "ObjectTransforms.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// What each draw did before ComputeObjectTransforms(): one
+// object at a time through XMMatrixMultiply and a full 4x4
+// XMMatrixInverse
+// --------------------------------------------------------
+static void ComputeOneByOne(const XMFLOAT4X4* worlds, unsigned int count, FXMMATRIX viewProjection, ObjectConstants* transforms)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+		XMStoreFloat4x4(&transforms[i].worldViewProj, XMMatrixTranspose(XMMatrixMultiply(world, viewProjection)));
+		StoreAffineMatrix(&transforms[i].normalMatrix, XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+		StoreAffineMatrix(&transforms[i].objectToWorld, world);
+	}
+}
+
+template <typename Function>
+static double Time(unsigned int runs, Function function)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (unsigned int run = 0; run < runs; run++) {
+		function();
+	}
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / runs;
+}
+
+// --------------------------------------------------------
+// Times filling in the transforms of 16 to 100,000 random
+// objects, four at a time and one by one, on one thread
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int counts[] = { 16, 1000, 10000, 100000 };
+
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<XMFLOAT4X4> worlds(100000);
+	for (unsigned int i = 0; i < worlds.size(); i++) {
+		XMMATRIX world = XMMatrixMultiply(
+			XMMatrixMultiply(
+				XMMatrixScaling(1.5f + unit(random), 1.5f + unit(random), 1.5f + unit(random)),
+				XMMatrixRotationRollPitchYaw(3 * unit(random), 3 * unit(random), 3 * unit(random))),
+			XMMatrixTranslation(100 * unit(random), 100 * unit(random), 100 * unit(random)));
+		XMStoreFloat4x4(&worlds[i], world);
+	}
+
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 5, -20, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+	XMMATRIX viewProjection = XMMatrixMultiply(view, projection);
+	std::vector<ObjectConstants> transforms(worlds.size());
+
+	for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		unsigned int count = counts[c];
+		unsigned int runs = 2000000 / count;
+
+		double batched = Time(runs, [&]() { ComputeObjectTransforms(&worlds[0], count, viewProjection, &transforms[0]); });
+		double scalar = Time(runs, [&]() { ComputeOneByOne(&worlds[0], count, viewProjection, &transforms[0]); });
+
+		printf("%6u objects: %6.1f ns/object batched, %6.1f ns/object one by one (%.1fx, average of %u runs)\n",
+			count, batched * 1e9 / count, scalar * 1e9 / count, scalar / batched, runs);
+	}
+	return 0;
+}
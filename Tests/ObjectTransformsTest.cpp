@@ -0,0 +1,204 @@
+#include "ObjectTransforms.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Everything is compared against the same float inputs
+// worked through in double, so only the packing and the
+// SIMD math are being measured.
+// --------------------------------------------------------
+struct Matrix3
+{
+	double m[3][3];
+};
+
+static double Length(const double v[3])
+{
+	return sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+// Inverse transpose of the world's upper 3x3
+static Matrix3 NormalMatrix(const XMFLOAT4X4& world)
+{
+	double a[3][3];
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 3; c++) {
+			a[r][c] = world.m[r][c];
+		}
+	}
+
+	Matrix3 cofactors;
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 3; c++) {
+			int r1 = (r + 1) % 3, r2 = (r + 2) % 3;
+			int c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+			cofactors.m[r][c] = a[r1][c1] * a[r2][c2] - a[r1][c2] * a[r2][c1];
+		}
+	}
+
+	double determinant = a[0][0] * cofactors.m[0][0] + a[0][1] * cofactors.m[0][1] + a[0][2] * cofactors.m[0][2];
+	for (int r = 0; r < 3; r++) {
+		for (int c = 0; c < 3; c++) {
+			cofactors.m[r][c] /= determinant;
+		}
+	}
+	return cofactors;
+}
+
+// A random rotation, non-uniform scale (mirrored sometimes) and translation
+static XMFLOAT4X4 RandomWorld(std::mt19937& random, float translationRange)
+{
+	std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+	std::uniform_real_distribution<float> exponent(-8.0f, 8.0f);
+	std::uniform_real_distribution<float> translation(-translationRange, translationRange);
+
+	XMVECTOR scale = XMVectorSet(exp2f(exponent(random)), exp2f(exponent(random)), exp2f(exponent(random)), 1);
+	if (random() % 4 == 0) {
+		scale = XMVectorMultiply(scale, XMVectorSet(-1, 1, 1, 1));
+	}
+
+	XMMATRIX world = XMMatrixMultiply(
+		XMMatrixMultiply(
+			XMMatrixScaling(XMVectorGetX(scale), XMVectorGetY(scale), XMVectorGetZ(scale)),
+			XMMatrixRotationRollPitchYaw(angle(random), angle(random), angle(random))),
+		XMMatrixTranslation(translation(random), translation(random), translation(random)));
+
+	XMFLOAT4X4 stored;
+	XMStoreFloat4x4(&stored, world);
+	return stored;
+}
+
+int main()
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	// Packing an affine matrix and unpacking it again is exact
+	{
+		unsigned int mismatches = 0;
+		for (unsigned int i = 0; i < 1000; i++) {
+			XMFLOAT4X4 world = RandomWorld(random, 1e5f);
+			AffineMatrix packed;
+			StoreAffineMatrix(&packed, XMLoadFloat4x4(&world));
+
+			XMFLOAT4X4 unpacked;
+			XMStoreFloat4x4(&unpacked, LoadAffineMatrix(&packed));
+			for (int r = 0; r < 4; r++) {
+				for (int c = 0; c < 4; c++) {
+					mismatches += unpacked.m[r][c] != world.m[r][c];
+				}
+			}
+		}
+		CHECK(mismatches == 0);
+	}
+
+	XMFLOAT4X4 viewFloat;
+	XMStoreFloat4x4(&viewFloat, XMMatrixMultiply(
+		XMMatrixLookToLH(XMVectorSet(3, 5, -20, 1), XMVectorSet(0.1f, -0.2f, 1, 0), XMVectorSet(0, 1, 0, 0)),
+		XMMatrixPerspectiveFovLH(0.8f, 16.0f / 9.0f, 0.1f, 1000.0f)));
+	XMMATRIX viewProjection = XMLoadFloat4x4(&viewFloat);
+
+	// Every group size, so the padded remainder is covered too
+	double worstPosition = 0;
+	double worstNormal = 0;
+	double worstClip = 0;
+	unsigned int overwritten = 0;
+
+	for (unsigned int count = 1; count <= 9; count++) {
+		for (unsigned int round = 0; round < 50; round++) {
+			std::vector<XMFLOAT4X4> worlds(count);
+			for (unsigned int i = 0; i < count; i++) {
+				worlds[i] = RandomWorld(random, 1e4f);
+			}
+
+			// One extra, which must be left alone
+			std::vector<ObjectConstants> transforms(count + 1);
+			memset(&transforms[count], 0x5A, sizeof(ObjectConstants));
+			ComputeObjectTransforms(&worlds[0], count, viewProjection, &transforms[0]);
+
+			const unsigned char* sentinel = (const unsigned char*)&transforms[count];
+			for (size_t b = 0; b < sizeof(ObjectConstants); b++) {
+				overwritten += sentinel[b] != 0x5A;
+			}
+
+			for (unsigned int i = 0; i < count; i++) {
+				const XMFLOAT4X4& world = worlds[i];
+				const ObjectConstants& transform = transforms[i];
+				Matrix3 normalMatrix = NormalMatrix(world);
+
+				for (unsigned int p = 0; p < 8; p++) {
+					double point[4] = { unit(random) * 10.0, unit(random) * 10.0, unit(random) * 10.0, 1 };
+
+					// Positions the way the shader reads objectToWorld:
+					// mul(float4(p, 1), m), one packed row per column
+					for (int c = 0; c < 3; c++) {
+						const float* packed = &transform.objectToWorld.r[c].x;
+						double expected = 0, magnitude = 0;
+						double actual = 0;
+						for (int k = 0; k < 4; k++) {
+							expected += point[k] * world.m[k][c];
+							magnitude += fabs(point[k] * world.m[k][c]);
+							actual += point[k] * packed[k];
+						}
+						worstPosition = std::max(worstPosition, fabs(actual - expected) / magnitude);
+					}
+
+					// Clip space, worldViewProj being stored transposed
+					for (int c = 0; c < 4; c++) {
+						double expected = 0, magnitude = 0;
+						double actual = 0;
+						for (int k = 0; k < 4; k++) {
+							double worldPoint = 0;
+							for (int j = 0; j < 4; j++) {
+								worldPoint += point[j] * world.m[j][k];
+							}
+							expected += worldPoint * viewFloat.m[k][c];
+							magnitude += fabs(worldPoint * viewFloat.m[k][c]);
+							actual += point[k] * transform.worldViewProj.m[c][k];
+						}
+						worstClip = std::max(worstClip, fabs(actual - expected) / magnitude);
+					}
+
+					// Normals: mul(n, (float3x3)normalMatrix), then normalized.
+					// The angle to the exact direction is what shading sees.
+					double normal[3] = { point[0], point[1], point[2] };
+					double expected[3] = {}, actual[3] = {};
+					for (int c = 0; c < 3; c++) {
+						const float* packed = &transform.normalMatrix.r[c].x;
+						for (int k = 0; k < 3; k++) {
+							expected[c] += normal[k] * normalMatrix.m[k][c];
+							actual[c] += normal[k] * packed[k];
+						}
+					}
+					double cosine = (expected[0] * actual[0] + expected[1] * actual[1] + expected[2] * actual[2]) / (Length(expected) * Length(actual));
+					worstNormal = std::max(worstNormal, acos(std::min(1.0, cosine)));
+				}
+			}
+		}
+	}
+
+	printf("Worst relative position error %g, clip space error %g, normal angle %g radians\n", worstPosition, worstClip, worstNormal);
+	CHECK(overwritten == 0);
+	CHECK(worstPosition < 1e-6);
+	CHECK(worstClip < 1e-6);
+	CHECK(worstNormal < 1e-5);
+
+	// Flattened along z: normals facing along z survive, pointing the same way
+	{
+		XMFLOAT4X4 flattened;
+		XMStoreFloat4x4(&flattened, XMMatrixScaling(2, 3, 0));
+		ObjectConstants transform;
+		ComputeObjectTransforms(&flattened, 1, viewProjection, &transform);
+
+		CHECK(transform.normalMatrix.r[2].z > 0);
+		CHECK(transform.normalMatrix.r[0].z == 0 && transform.normalMatrix.r[1].z == 0);
+	}
+
+	return TestResult();
+}
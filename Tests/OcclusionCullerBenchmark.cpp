@@ -0,0 +1,74 @@
+#include "OcclusionCuller.h"
+#include "Vertex.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times culling a city block: 100,000 small boxes scattered
+// over a field with a few dozen building sized boxes as the
+// occluders, seen from street level
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int count = 100000;
+	const unsigned int buildings = 32;
+	const unsigned int runs = 20;
+
+	// A unit cube, [-1, 1] on every axis
+	std::vector<Vertex> vertices(8);
+	for (int i = 0; i < 8; i++) {
+		vertices[i].Position = XMFLOAT3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+	}
+	const unsigned int indices[36] = {
+		0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4,
+		2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5
+	};
+	OccluderMesh cube = { &vertices[0].Position, sizeof(Vertex), 8, indices, 36 };
+	OccluderMesh none = {};
+
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> unit(0, 1);
+	std::vector<BoundingBox> bounds(count);
+	std::vector<XMFLOAT4X4> worlds(count);
+	std::vector<OccluderMesh> meshes(count);
+	for (unsigned int i = 0; i < count; i++) {
+		bool building = i < buildings;
+		XMFLOAT3 extents = building ? XMFLOAT3(4 + 4 * unit(random), 10, 4 + 4 * unit(random)) : XMFLOAT3(0.5f, 0.5f, 0.5f);
+		XMFLOAT3 center(400 * unit(random) - 200, extents.y, 400 * unit(random) - 200);
+		if (building) {
+			center.z = 20 + 60 * unit(random);
+		}
+
+		bounds[i] = BoundingBox(center, extents);
+		XMStoreFloat4x4(&worlds[i], XMMatrixMultiply(XMMatrixScaling(extents.x, extents.y, extents.z), XMMatrixTranslation(center.x, center.y, center.z)));
+		meshes[i] = building ? cube : none;
+	}
+
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 2, -10, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+
+	ThreadPool threadPool;
+	OcclusionCuller culler(&threadPool);
+	culler.SetMaxOccluders(buildings);
+	std::vector<unsigned int> visible;
+	culler.Cull(view, projection, &bounds[0], &worlds[0], &meshes[0], count, visible);
+
+	double seconds = 0;
+	for (unsigned int run = 0; run < runs; run++) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		culler.Cull(view, projection, &bounds[0], &worlds[0], &meshes[0], count, visible);
+		seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	printf("%u objects, %u occluders (%u triangles), %u threads, %s loops\n", count, culler.GetOccluderCount(),
+		culler.GetOccluderTriangleCount(), threadPool.GetThreadCount(), culler.IsUsingAvx2() ? "AVX2" : "scalar");
+	printf("%u frustum culled, %u occlusion culled, %u visible\n",
+		culler.GetFrustumCulledCount(), culler.GetOcclusionCulledCount(), (unsigned int)visible.size());
+	printf("cull: %.2f ms, %.1fM objects/s (average of %u runs)\n",
+		seconds * 1000 / runs, count * runs / seconds / 1e6, runs);
+	return 0;
+}
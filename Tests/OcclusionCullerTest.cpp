@@ -0,0 +1,140 @@
+#include "OcclusionCuller.h"
+#include "Vertex.h"
+#include "TestCheck.h"
+#include <vector>
+
+using namespace DirectX;
+
+// A unit cube, [-1, 1] on every axis, in the engine's vertex layout
+static std::vector<Vertex> cubeVertices;
+static std::vector<unsigned int> cubeIndices;
+
+static void MakeCube()
+{
+	for (int i = 0; i < 8; i++) {
+		Vertex vertex = {};
+		vertex.Position = XMFLOAT3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+		cubeVertices.push_back(vertex);
+	}
+
+	const unsigned int faces[6][4] = {
+		{ 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 }
+	};
+	for (int f = 0; f < 6; f++) {
+		const unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+		for (int i = 0; i < 6; i++) {
+			cubeIndices.push_back(faces[f][quad[i]]);
+		}
+	}
+}
+
+// Boxes made of the cube, each with its bounds and transform
+struct Scene
+{
+	std::vector<BoundingBox> bounds;
+	std::vector<XMFLOAT4X4> worlds;
+	std::vector<OccluderMesh> meshes;
+
+	void Add(XMFLOAT3 center, XMFLOAT3 extents, bool solid = true)
+	{
+		bounds.push_back(BoundingBox(center, extents));
+
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixMultiply(XMMatrixScaling(extents.x, extents.y, extents.z), XMMatrixTranslation(center.x, center.y, center.z)));
+		worlds.push_back(world);
+
+		OccluderMesh mesh = {};
+		if (solid) {
+			mesh.positions = &cubeVertices[0].Position;
+			mesh.positionStride = sizeof(Vertex);
+			mesh.vertexCount = (unsigned int)cubeVertices.size();
+			mesh.indices = &cubeIndices[0];
+			mesh.indexCount = (unsigned int)cubeIndices.size();
+		}
+		meshes.push_back(mesh);
+	}
+
+	void Cull(OcclusionCuller& culler, std::vector<unsigned int>& visible)
+	{
+		XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, 0, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0f, 2.0f, 0.1f, 100.0f);
+		culler.Cull(view, projection, &bounds[0], &worlds[0], &meshes[0], (unsigned int)bounds.size(), visible);
+	}
+};
+
+int main()
+{
+	MakeCube();
+
+	ThreadPool threadPool;
+	OcclusionCuller culler(&threadPool);
+	std::vector<unsigned int> visible;
+
+	// A wall ten units out covering the middle of the view, the only
+	// occluder: boxes behind it are culled, ones in front of it, past
+	// its side or peeking over its top are not, nor is the wall itself
+	{
+		Scene scene;
+		scene.Add(XMFLOAT3(0, 0, 10), XMFLOAT3(10, 3, 0.25f));
+		scene.Add(XMFLOAT3(0, 0, 30), XMFLOAT3(1, 1, 1), false);
+		scene.Add(XMFLOAT3(0, 0, 5), XMFLOAT3(0.5f, 0.5f, 0.5f), false);
+		scene.Add(XMFLOAT3(0, 0, -10), XMFLOAT3(1, 1, 1), false);
+		scene.Add(XMFLOAT3(21.5f, 0, 20), XMFLOAT3(0.5f, 0.5f, 0.5f), false);
+		scene.Add(XMFLOAT3(0, 9.5f, 30), XMFLOAT3(1, 1, 1), false);
+		scene.Cull(culler, visible);
+
+		const unsigned int expected[] = { 0, 2, 4, 5 };
+		CHECK(visible == std::vector<unsigned int>(expected, expected + 4));
+		CHECK(culler.GetFrustumCulledCount() == 1 && culler.GetOcclusionCulledCount() == 1);
+		CHECK(culler.GetOccluderCount() == 1);
+		CHECK(culler.GetOccluderTriangleCount() > 0 && culler.GetOccluderTriangleCount() <= 12);
+
+		// The wall's nearest face is in the depth buffer, and the
+		// corners of the buffer are left clear
+		const float* depth = culler.GetDepthBuffer();
+		CHECK(depth[(OcclusionCuller::BufferHeight / 2) * OcclusionCuller::BufferWidth + OcclusionCuller::BufferWidth / 2] < 1);
+		CHECK(depth[0] == 1 && depth[OcclusionCuller::BufferWidth * OcclusionCuller::BufferHeight - 1] == 1);
+
+		// A wall without geometry can't occlude
+		scene.meshes[0].indexCount = 0;
+		scene.Cull(culler, visible);
+		CHECK(visible.size() == 5 && culler.GetOccluderCount() == 0 && culler.GetOcclusionCulledCount() == 0);
+		scene.meshes[0].indexCount = (unsigned int)cubeIndices.size();
+
+		// Nor one past the limits
+		culler.SetMaxOccluderTriangles(11);
+		scene.Cull(culler, visible);
+		CHECK(visible.size() == 5 && culler.GetOccluderCount() == 0);
+		culler.SetMaxOccluderTriangles(4096);
+
+		culler.SetMaxOccluders(0);
+		scene.Cull(culler, visible);
+		CHECK(visible.size() == 5 && culler.GetOccluderCount() == 0);
+		culler.SetMaxOccluders(16);
+	}
+
+	// Enough boxes for many test batches, half hidden behind the wall
+	// and half in front of it, come back in order
+	{
+		Scene scene;
+		scene.Add(XMFLOAT3(0, 0, 10), XMFLOAT3(10, 3, 0.25f));
+		for (unsigned int i = 0; i < 1000; i++) {
+			float x = (float)(i % 40) * 0.4f - 8;
+			float y = (float)(i / 40 % 5) * 0.4f - 1;
+			bool behind = i % 2 == 0;
+			scene.Add(XMFLOAT3(x * (behind ? 2 : 0.5f), y * (behind ? 2 : 0.5f), behind ? 20.0f : 5.0f), XMFLOAT3(0.1f, 0.1f, 0.1f), false);
+		}
+		scene.Cull(culler, visible);
+
+		bool inOrder = true;
+		bool onlyInFront = true;
+		for (unsigned int i = 0; i < visible.size(); i++) {
+			inOrder = inOrder && (i == 0 || visible[i] > visible[i - 1]);
+			onlyInFront = onlyInFront && (visible[i] == 0 || (visible[i] - 1) % 2 == 1);
+		}
+		CHECK(visible.size() == 501 && inOrder && onlyInFront);
+		CHECK(culler.GetOcclusionCulledCount() == 500 && culler.GetFrustumCulledCount() == 0);
+	}
+
+	return TestResult();
+}
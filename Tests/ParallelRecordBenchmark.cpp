@@ -0,0 +1,109 @@
+#include "RenderCommandBuffer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Runs under this many draws stay on one list, as in the renderer
+static const unsigned int MinDrawsPerList = 64;
+
+// Stand-ins for D3D objects and shaders; nothing here dereferences them
+static StateObject Object(uintptr_t id)
+{
+	return reinterpret_cast<StateObject>(id * 16);
+}
+
+// --------------------------------------------------------
+// Records draws [first, last) the way Renderer::RecordRange
+// does: each list binds its own pipeline, geometry changes
+// every 10 draws, and every draw patches its transforms into
+// a copy of a 224 byte vertex constant buffer
+// --------------------------------------------------------
+static void RecordRange(unsigned int first, unsigned int last, RenderCommandBuffer& commands)
+{
+	unsigned char constants[224] = {};
+
+	commands.Reset();
+	commands.BindPipeline(reinterpret_cast<SimpleVertexShader*>(Object(1)), reinterpret_cast<SimplePixelShader*>(Object(2)));
+	commands.BindSampler(StagePixel, 0, Object(3));
+	for (unsigned int i = first; i < last; i++) {
+		if (i == first || i % 10 == 0) {
+			commands.BindGeometry(Object(100 + i / 10), Object(200 + i / 10), 32, 42);
+		}
+
+		unsigned char* data = (unsigned char*)commands.SetConstants(StageVertex, 0, Object(4), constants, sizeof(constants));
+		memcpy(data, &i, sizeof(i));
+		commands.DropRepeatedConstants();
+		commands.DrawIndexed(36, 0, 0);
+	}
+}
+
+// Splits the draws into one list per thread, as Renderer::Record does.
+// Without a pool everything goes on one list on the calling thread.
+static unsigned int Record(ThreadPool* threadPool, unsigned int drawCount, std::vector<RenderCommandBuffer>& lists)
+{
+	if (threadPool == nullptr) {
+		RecordRange(0, drawCount, lists[0]);
+		return 1;
+	}
+
+	unsigned int listCount = (drawCount + MinDrawsPerList - 1) / MinDrawsPerList;
+	listCount = std::max(1u, std::min(listCount, threadPool->GetThreadCount()));
+
+	threadPool->ParallelFor(listCount, [&](unsigned int list) {
+		unsigned int first = (unsigned int)((uint64_t)drawCount * list / listCount);
+		unsigned int last = (unsigned int)((uint64_t)drawCount * (list + 1) / listCount);
+		RecordRange(first, last, lists[list]);
+	});
+	return listCount;
+}
+
+// --------------------------------------------------------
+// Times recording a million draws on pools of 1 to 8
+// threads, with the lists already grown to size. Each list
+// rebinds the pipeline, so more lists cost a few commands.
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int drawCount = 1000000;
+	const unsigned int runs = 10;
+	const unsigned int threadCounts[] = { 1, 2, 4, 8 };
+
+	printf("%u draws, %u hardware threads\n", drawCount, std::thread::hardware_concurrency());
+
+	double baseline = 0;
+	for (unsigned int t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++) {
+		// A pool asked for no workers matches the hardware instead
+		ThreadPool* threadPool = threadCounts[t] > 1 ? new ThreadPool(threadCounts[t] - 1) : nullptr;
+		std::vector<RenderCommandBuffer> lists(threadCounts[t]);
+		Record(threadPool, drawCount, lists);
+
+		double seconds = 0;
+		unsigned int listCount = 0;
+		for (unsigned int run = 0; run < runs; run++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			listCount = Record(threadPool, drawCount, lists);
+			seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		unsigned int recorded = 0;
+		size_t bytes = 0;
+		for (unsigned int i = 0; i < listCount; i++) {
+			recorded += lists[i].GetDrawCount();
+			bytes += lists[i].GetSize();
+		}
+
+		if (t == 0) {
+			baseline = seconds;
+		}
+		printf("%u threads, %u lists: %7.2f ms, %6.1fM draws/s, %.2fx (%u draws, %.1f MB)\n",
+			threadCounts[t], listCount, seconds * 1000 / runs, drawCount * runs / seconds / 1e6,
+			baseline / seconds, recorded, bytes / (1024.0 * 1024.0));
+		delete threadPool;
+	}
+	return 0;
+}
@@ -0,0 +1,73 @@
+#include "RenderCommandBuffer.h"
+#include "RenderExecutor.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Stand-ins for D3D objects and shaders; nothing here dereferences them
+static StateObject Object(uintptr_t id)
+{
+	return reinterpret_cast<StateObject>(id * 16);
+}
+
+// --------------------------------------------------------
+// Records a frame shaped like the renderer's: a pipeline
+// change every 1000 draws, new geometry every 10, and each
+// draw's transforms patched into its own copy of a 224 byte
+// vertex constant buffer
+// --------------------------------------------------------
+static void RecordFrame(RenderCommandBuffer& commands, unsigned int drawCount)
+{
+	unsigned char constants[224] = {};
+
+	commands.Reset();
+	for (unsigned int i = 0; i < drawCount; i++) {
+		if (i % 1000 == 0) {
+			commands.BindPipeline(reinterpret_cast<SimpleVertexShader*>(Object(1 + i / 1000)), reinterpret_cast<SimplePixelShader*>(Object(2)));
+			commands.BindSampler(StagePixel, 0, Object(3));
+		}
+		if (i % 10 == 0) {
+			commands.BindGeometry(Object(100 + i / 10), Object(200 + i / 10), 32, 42);
+		}
+
+		unsigned char* data = (unsigned char*)commands.SetConstants(StageVertex, 0, Object(4), constants, sizeof(constants));
+		memcpy(data, &i, sizeof(i));
+		commands.DropRepeatedConstants();
+		commands.DrawIndexed(36, 0, 0);
+	}
+}
+
+// --------------------------------------------------------
+// Times recording a million draws into a command buffer that
+// has already grown to size, and serializing them with the
+// recording executor
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int drawCount = 1000000;
+	const unsigned int runs = 10;
+
+	RenderCommandBuffer commands;
+	RecordFrame(commands, drawCount);
+
+	double recordSeconds = 0;
+	for (unsigned int run = 0; run < runs; run++) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		RecordFrame(commands, drawCount);
+		recordSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	RecordingRenderExecutor recorder;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	recorder.Execute(commands);
+	unsigned long long hash = recorder.GetHash();
+	double serializeSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	printf("%u draws, %.1f MB of commands\n", drawCount, commands.GetSize() / (1024.0 * 1024.0));
+	printf("record: %.2f ms, %.1fM draws/s (average of %u runs)\n",
+		recordSeconds * 1000 / runs, drawCount * runs / recordSeconds / 1e6, runs);
+	printf("serialize and hash: %.2f ms, %.1fM draws/s (hash %016llx)\n",
+		serializeSeconds * 1000, drawCount / serializeSeconds / 1e6, hash);
+	return 0;
+}
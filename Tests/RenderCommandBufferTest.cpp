@@ -0,0 +1,222 @@
+#include "RenderCommandBuffer.h"
+#include "RenderExecutor.h"
+#include "TestCheck.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Stand-ins for D3D objects and shaders; nothing here dereferences them
+static StateObject Object(uintptr_t id)
+{
+	return reinterpret_cast<StateObject>(id * 16);
+}
+
+template <typename T>
+static T* Shader(uintptr_t id)
+{
+	return reinterpret_cast<T*>(id * 16);
+}
+
+// --------------------------------------------------------
+// A small frame: one textured draw, then an instanced run
+// with a second pipeline. base offsets every pointer, so
+// frames recorded at different addresses can be compared.
+// --------------------------------------------------------
+static void RecordFrame(RenderCommandBuffer& commands, uintptr_t base)
+{
+	float color[4] = { 1, 0.5f, 0.25f, 1 };
+	float transform[16] = {};
+	for (unsigned int i = 0; i < 16; i++) {
+		transform[i] = (float)i;
+	}
+
+	commands.Reset();
+	commands.BindPipeline(Shader<SimpleVertexShader>(base + 1), Shader<SimplePixelShader>(base + 2));
+	commands.SetConstants(StagePixel, 0, Object(base + 3), color, sizeof(color));
+	commands.SetConstants(StageVertex, 0, Object(base + 4), transform, sizeof(transform));
+	commands.BindSampler(StagePixel, 0, Object(base + 5));
+	commands.BindTexture(StagePixel, 0, Object(base + 6));
+	commands.BindGeometry(Object(base + 7), Object(base + 8), 32, 42);
+	commands.DrawIndexed(36, 0, 0);
+
+	commands.BindPipeline(Shader<SimpleVertexShader>(base + 9), Shader<SimplePixelShader>(base + 2));
+	commands.BindGeometry(Object(base + 7), Object(base + 8), 32, 42);
+	commands.BindInstances(Object(base + 10), 112);
+	commands.DrawIndexedInstanced(36, 50, 0, 0, 4);
+}
+
+int main()
+{
+	// FNV-1a test vectors
+	CHECK(RecordingRenderExecutor::Hash("", 0) == 0xcbf29ce484222325ull);
+	CHECK(RecordingRenderExecutor::Hash("a", 1) == 0xaf63dc4c8601ec8cull);
+	CHECK(RecordingRenderExecutor::Hash("foobar", 6) == 0x85944171f73967e8ull);
+
+	// Recording: counts, and walking the commands back in order
+	RenderCommandBuffer commands;
+	RecordFrame(commands, 100);
+	CHECK(commands.GetCommandCount() == 11);
+	CHECK(commands.GetDrawCount() == 2);
+	CHECK(commands.GetConstantBytes() == 16 + 64);
+	{
+		const unsigned int expected[] = {
+			CommandBindPipeline, CommandSetConstants, CommandSetConstants, CommandBindSampler,
+			CommandBindTexture, CommandBindGeometry, CommandDrawIndexed,
+			CommandBindPipeline, CommandBindGeometry, CommandBindInstances, CommandDrawIndexedInstanced
+		};
+		unsigned int count = 0;
+		bool inOrder = true;
+		bool aligned = true;
+		for (size_t offset = 0; offset < commands.GetSize(); offset += commands.GetCommand(offset)->size) {
+			inOrder = inOrder && count < 11 && commands.GetCommand(offset)->type == expected[count];
+			aligned = aligned && offset % sizeof(void*) == 0;
+			count++;
+		}
+		CHECK(count == 11 && inOrder && aligned);
+	}
+
+	// The constants are copied in, so changing the source afterwards
+	// doesn't change the recording
+	{
+		RenderCommandBuffer copy;
+		float data[4] = { 1, 2, 3, 4 };
+		float* recorded = (float*)copy.SetConstants(StageVertex, 1, Object(1), data, sizeof(data));
+		data[0] = 5;
+		const SetConstantsCommand* command = (const SetConstantsCommand*)copy.GetCommand(0);
+		CHECK(recorded[0] == 1 && command->GetData() == recorded);
+		CHECK(command->ringBuffer == nullptr && command->dataSize == sizeof(data));
+	}
+
+	// The serialized frame, with handles in the order each pointer
+	// is first seen and constant data reduced to its hash
+	RecordingRenderExecutor recorder;
+	recorder.Execute(commands);
+	const std::string golden =
+		"BindPipeline vs=1 ps=2\n"
+		"SetConstants stage=4 slot=0 buffer=3 size=16 data=a8461ab6802ebe2\n"
+		"SetConstants stage=0 slot=0 buffer=4 size=64 data=13fdf84d829c1708\n"
+		"BindSampler stage=4 slot=0 sampler=5\n"
+		"BindTexture stage=4 slot=0 srv=6\n"
+		"BindGeometry vb=7 ib=8 stride=32 format=42\n"
+		"DrawIndexed count=36 start=0 base=0\n"
+		"BindPipeline vs=9 ps=2\n"
+		"BindGeometry vb=7 ib=8 stride=32 format=42\n"
+		"BindInstances buffer=10 stride=112\n"
+		"DrawIndexedInstanced count=36 instances=50 start=0 base=0 startInstance=4\n";
+	CHECK(recorder.GetLog() == golden);
+	CHECK(recorder.GetHash() == 0x4d4668f64c387851ull);
+	CHECK(recorder.GetHash() == RecordingRenderExecutor::Hash(golden.data(), golden.size()));
+
+	// The same frame at other addresses hashes the same
+	{
+		RenderCommandBuffer moved;
+		RecordFrame(moved, 5000);
+		RecordingRenderExecutor other;
+		other.Execute(moved);
+		CHECK(other.GetHash() == recorder.GetHash());
+	}
+
+	// Lists played back in order read as one; Reset() starts over
+	{
+		RecordingRenderExecutor lists;
+		RenderCommandBuffer frames[2];
+		RecordFrame(frames[0], 100);
+		RecordFrame(frames[1], 100);
+		lists.ExecuteLists(frames, 2);
+		CHECK(lists.GetLog() == golden + golden);
+
+		lists.Reset();
+		lists.Execute(frames[1]);
+		CHECK(lists.GetLog() == golden);
+	}
+
+	// Any change to the frame changes the hash
+	{
+		RenderCommandBuffer changed;
+		RecordFrame(changed, 100);
+		DrawIndexedInstancedCommand* draw = nullptr;
+		for (size_t offset = 0; offset < changed.GetSize(); offset += changed.GetCommand(offset)->size) {
+			if (changed.GetCommand(offset)->type == CommandDrawIndexedInstanced) {
+				draw = (DrawIndexedInstancedCommand*)changed.GetCommand(offset);
+			}
+		}
+		draw->instanceCount = 49;
+
+		RecordingRenderExecutor other;
+		other.Execute(changed);
+		CHECK(other.GetHash() != recorder.GetHash());
+	}
+
+	// Repeated constants are dropped while they're still bound
+	{
+		RenderCommandBuffer repeats;
+		float data[4] = { 1, 2, 3, 4 };
+		repeats.BindPipeline(Shader<SimpleVertexShader>(1), Shader<SimplePixelShader>(2));
+		repeats.SetConstants(StageVertex, 0, Object(3), data, sizeof(data));
+		CHECK(!repeats.DropRepeatedConstants());
+		repeats.DrawIndexed(3, 0, 0);
+
+		repeats.SetConstants(StageVertex, 0, Object(3), data, sizeof(data));
+		CHECK(repeats.DropRepeatedConstants());
+
+		// Another stage, slot, buffer or bytes isn't a repeat
+		repeats.SetConstants(StagePixel, 0, Object(3), data, sizeof(data));
+		CHECK(!repeats.DropRepeatedConstants());
+		repeats.SetConstants(StageVertex, 1, Object(3), data, sizeof(data));
+		CHECK(!repeats.DropRepeatedConstants());
+		repeats.SetConstants(StageVertex, 0, Object(4), data, sizeof(data));
+		CHECK(!repeats.DropRepeatedConstants());
+		data[3] = 5;
+		repeats.SetConstants(StageVertex, 0, Object(4), data, sizeof(data));
+		CHECK(!repeats.DropRepeatedConstants());
+
+		CHECK(repeats.GetSkippedUploadCount() == 1 && repeats.GetBytesSaved() == sizeof(data));
+		CHECK(repeats.GetCommandCount() == 7 && repeats.GetConstantBytes() == 5 * sizeof(data));
+	}
+
+	// Playing a pipeline back rebinds the shaders' own buffers, so
+	// constants identical to ones bound before it, like the same
+	// transform for two static batches with different materials,
+	// are recorded again and get their own range of the ring
+	{
+		RenderCommandBuffer batches;
+		float transform[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+		for (unsigned int b = 0; b < 2; b++) {
+			batches.BindPipeline(Shader<SimpleVertexShader>(1), Shader<SimplePixelShader>(2 + b));
+			batches.SetConstants(StageVertex, 0, Object(4), transform, sizeof(transform));
+			CHECK(!batches.DropRepeatedConstants());
+			batches.DrawIndexed(36, 0, 0);
+		}
+		CHECK(batches.GetSkippedUploadCount() == 0);
+
+		// Ranges given out the way ConstantUploader does
+		unsigned int firstConstant = 0;
+		for (size_t offset = 0; offset < batches.GetSize(); offset += batches.GetCommand(offset)->size) {
+			RenderCommand* command = batches.GetCommand(offset);
+			if (command->type == CommandSetConstants) {
+				SetConstantsCommand* constants = (SetConstantsCommand*)command;
+				constants->ringBuffer = Object(9);
+				constants->firstConstant = firstConstant;
+				constants->constantCount = 16;
+				firstConstant += 16;
+			}
+		}
+
+		RecordingRenderExecutor ring;
+		ring.Execute(batches);
+		const char* expected =
+			"BindPipeline vs=1 ps=2\n"
+			"SetConstants stage=0 slot=0 buffer=3 size=64 data=1b0c97ae01a7ec05 ring=4 first=0 count=16\n"
+			"DrawIndexed count=36 start=0 base=0\n"
+			"BindPipeline vs=1 ps=5\n"
+			"SetConstants stage=0 slot=0 buffer=3 size=64 data=1b0c97ae01a7ec05 ring=4 first=16 count=16\n"
+			"DrawIndexed count=36 start=0 base=0\n";
+		CHECK(ring.GetLog() == expected);
+	}
+
+	// Reset keeps the memory but empties the buffer
+	commands.Reset();
+	CHECK(commands.GetSize() == 0 && commands.GetCommandCount() == 0 && commands.GetDrawCount() == 0 && commands.GetConstantBytes() == 0);
+
+	return TestResult();
+}
@@ -0,0 +1,109 @@
+#include "ShaderBuilder.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// --------------------------------------------------------
+// Stands in for FXC: preprocessing hands back the source,
+// and every compile takes a fixed 40 ms. Each run gets its
+// own version, so nothing cached by an earlier run is hit.
+// --------------------------------------------------------
+class TimedCompiler : public IShaderCompiler
+{
+public:
+	std::string source;
+	std::string version;
+
+	TimedCompiler()
+	{
+		version = "timed " + std::to_string(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+
+		// About the size of the engine's preprocessed pixel shader
+		for (unsigned int line = 0; line < 400; line++) {
+			source += "float4 value" + std::to_string(line) + " = mul(float4(input.position, 1), world);\n";
+		}
+	}
+
+	bool Preprocess(const ShaderBuildJob& job, std::string& output, std::string& errors)
+	{
+		output = job.SourceFile + "\n" + source;
+		return true;
+	}
+
+	bool Compile(const ShaderBuildJob& job, const std::string& preprocessed, std::vector<unsigned char>& bytecode, std::string& errors)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(40));
+		bytecode.assign(preprocessed.begin(), preprocessed.begin() + 4096);
+		return true;
+	}
+
+	std::string GetVersion() { return version; }
+};
+
+static double TimeBuild(ShaderBuilder& builder, const std::vector<ShaderBuildJob>& jobs)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	builder.Build(jobs);
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Times building the engine's ten shaders, two vertex and
+// all eight pixel shader keyword combinations, with nothing
+// cached, with everything cached, and with one define changed
+// --------------------------------------------------------
+int main()
+{
+	const char* keywords[3] = { "UNTEXTURED", "CLUSTERED", "INSTANCED" };
+
+	std::vector<ShaderBuildJob> jobs;
+	for (unsigned int i = 0; i < 10; i++) {
+		ShaderBuildJob job;
+		job.SourceFile = i < 2 ? "VertexShader.hlsl" : "PixelShader.hlsl";
+		job.EntryPoint = "main";
+		job.Profile = i < 2 ? "vs_5_0" : "ps_5_0";
+		job.OutputFile = "ShaderBuilderBenchmark" + std::to_string(i) + ".cso";
+
+		// The second vertex shader is the instanced one
+		unsigned int mask = i < 2 ? (i == 1 ? 4 : 0) : i - 2;
+		for (unsigned int k = 0; k < 3; k++) {
+			if (mask & (1 << k)) {
+				ShaderDefine define = { keywords[k], "1" };
+				job.Defines.push_back(define);
+			}
+		}
+		jobs.push_back(job);
+	}
+
+	ThreadPool threadPool;
+	TimedCompiler compiler;
+	ShaderBuilder builder(&compiler, &threadPool, ".");
+
+	std::vector<uint64_t> keys;
+	double cold = TimeBuild(builder, jobs);
+	printf("%u threads, 40 ms per compile (%u ms one after another)\n", threadPool.GetThreadCount(), (unsigned int)jobs.size() * 40);
+	printf("cold:  %2u compiled, %2u cached  %7.1f ms\n", builder.GetCompiledCount(), builder.GetCachedCount(), cold * 1000);
+	for (unsigned int i = 0; i < jobs.size(); i++) {
+		keys.push_back(builder.GetResults()[i].Key);
+	}
+
+	double warm = TimeBuild(builder, jobs);
+	printf("warm:  %2u compiled, %2u cached  %7.1f ms\n", builder.GetCompiledCount(), builder.GetCachedCount(), warm * 1000);
+
+	jobs[9].Defines[0].Value = "2";
+	double changed = TimeBuild(builder, jobs);
+	printf("one define changed:  %2u compiled, %2u cached  %7.1f ms\n", builder.GetCompiledCount(), builder.GetCachedCount(), changed * 1000);
+	keys.push_back(builder.GetResults()[9].Key);
+
+	// Leave nothing behind
+	for (unsigned int i = 0; i < keys.size(); i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)keys[i]);
+		remove(name);
+	}
+	for (unsigned int i = 0; i < jobs.size(); i++) {
+		remove(jobs[i].OutputFile.c_str());
+	}
+	return 0;
+}
@@ -0,0 +1,218 @@
+#include "ShaderBuilder.h"
+#include "TestCheck.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <set>
+
+// --------------------------------------------------------
+// A compiler working on sources held in memory. "#include x"
+// lines are replaced by x's source, and a source containing
+// "error" fails to compile. The bytecode is the preprocessed
+// text with the defines and entry point after it.
+//
+// Every run gets its own version, so cache entries left in
+// the directory by earlier runs are never hit.
+// --------------------------------------------------------
+class FakeCompiler : public IShaderCompiler
+{
+public:
+	std::map<std::string, std::string> sources;
+	std::atomic<unsigned int> compileCount;
+	std::string version;
+
+	FakeCompiler(const std::string& suffix)
+	{
+		compileCount = 0;
+		version = "fake " + std::to_string(std::chrono::high_resolution_clock::now().time_since_epoch().count()) + suffix;
+	}
+
+	bool Preprocess(const ShaderBuildJob& job, std::string& output, std::string& errors)
+	{
+		std::lock_guard<std::mutex> lock(sourcesMutex);
+		if (sources.find(job.SourceFile) == sources.end()) {
+			errors = job.SourceFile + ": not found";
+			return false;
+		}
+
+		output = sources[job.SourceFile];
+		size_t include;
+		while ((include = output.find("#include ")) != std::string::npos) {
+			size_t end = output.find('\n', include);
+			std::string name = output.substr(include + 9, end - include - 9);
+			output.replace(include, end + 1 - include, sources[name]);
+		}
+		return true;
+	}
+
+	bool Compile(const ShaderBuildJob& job, const std::string& preprocessed, std::vector<unsigned char>& bytecode, std::string& errors)
+	{
+		compileCount++;
+		if (preprocessed.find("error") != std::string::npos) {
+			errors = job.SourceFile + ": error";
+			return false;
+		}
+
+		std::string output = preprocessed + "|" + job.EntryPoint;
+		for (unsigned int i = 0; i < job.Defines.size(); i++) {
+			output += "|" + job.Defines[i].Name + "=" + job.Defines[i].Value;
+		}
+		bytecode.assign(output.begin(), output.end());
+		return true;
+	}
+
+	std::string GetVersion() { return version; }
+
+private:
+	std::mutex sourcesMutex;
+};
+
+static std::string ReadText(const std::string& path)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static ShaderBuildJob MakeJob(const std::string& source, const std::string& output, const std::string& define)
+{
+	ShaderBuildJob job;
+	job.SourceFile = source;
+	job.EntryPoint = "main";
+	job.Profile = "ps_5_0";
+	job.OutputFile = output;
+	if (!define.empty()) {
+		ShaderDefine value = { define, "1" };
+		job.Defines.push_back(value);
+	}
+	return job;
+}
+
+// Every key built, so the cache entries can be removed at the end
+static std::set<uint64_t> keys;
+
+static bool Build(ShaderBuilder& builder, const std::vector<ShaderBuildJob>& jobs)
+{
+	bool built = builder.Build(jobs);
+	for (unsigned int i = 0; i < jobs.size(); i++) {
+		keys.insert(builder.GetResults()[i].Key);
+	}
+	return built;
+}
+
+static void RemoveFiles()
+{
+	for (std::set<uint64_t>::iterator it = keys.begin(); it != keys.end(); it++) {
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)*it);
+		remove(name);
+	}
+	for (int i = 0; i < 5; i++) {
+		remove(("ShaderBuilderTest" + std::to_string(i) + ".cso").c_str());
+	}
+}
+
+int main()
+{
+	ThreadPool threadPool(2);
+
+	FakeCompiler compiler("");
+	compiler.sources["Lighting.hlsli"] = "float3 Light();\n";
+	compiler.sources["Vertex.hlsl"] = "vertex\n";
+	compiler.sources["Pixel.hlsl"] = "#include Lighting.hlsli\npixel\n";
+
+	std::vector<ShaderBuildJob> jobs;
+	jobs.push_back(MakeJob("Vertex.hlsl", "ShaderBuilderTest0.cso", ""));
+	jobs.push_back(MakeJob("Pixel.hlsl", "ShaderBuilderTest1.cso", ""));
+	jobs.push_back(MakeJob("Pixel.hlsl", "ShaderBuilderTest2.cso", "TEXTURED"));
+
+	// The cache is in the working directory
+	ShaderBuilder builder(&compiler, &threadPool, ".");
+
+	// Cold: every job misses and compiles
+	CHECK(Build(builder, jobs));
+	CHECK(builder.GetCompiledCount() == 3 && builder.GetCachedCount() == 0 && compiler.compileCount == 3);
+	CHECK(ReadText("ShaderBuilderTest2.cso") == "float3 Light();\npixel\n|main|TEXTURED=1");
+	CHECK(builder.GetResults()[1].Key != builder.GetResults()[2].Key);
+
+	// Warm: every job hits, and nothing compiles
+	CHECK(Build(builder, jobs));
+	CHECK(builder.GetCachedCount() == 3 && compiler.compileCount == 3);
+
+	// A hit puts back a missing output
+	remove("ShaderBuilderTest0.cso");
+	CHECK(Build(builder, jobs));
+	CHECK(builder.GetCachedCount() == 3 && ReadText("ShaderBuilderTest0.cso") == "vertex\n|main");
+
+	// Editing an included file invalidates only what includes it
+	compiler.sources["Lighting.hlsli"] = "float3 Light(float3 n);\n";
+	CHECK(Build(builder, jobs));
+	CHECK(builder.GetResults()[0].Status == ShaderBuildCached);
+	CHECK(builder.GetResults()[1].Status == ShaderBuildCompiled && builder.GetResults()[2].Status == ShaderBuildCompiled);
+	CHECK(compiler.compileCount == 5);
+	CHECK(ReadText("ShaderBuilderTest1.cso") == "float3 Light(float3 n);\npixel\n|main");
+
+	// So does changing a define, the entry point or the profile
+	jobs[2].Defines[0].Value = "2";
+	jobs[1].EntryPoint = "mainUnlit";
+	jobs[0].Profile = "vs_4_0";
+	CHECK(Build(builder, jobs));
+	CHECK(builder.GetCompiledCount() == 3 && compiler.compileCount == 8);
+
+	// Going back hits the entries the earlier builds left
+	jobs[2].Defines[0].Value = "1";
+	jobs[1].EntryPoint = "main";
+	jobs[0].Profile = "ps_5_0";
+	CHECK(Build(builder, jobs));
+	CHECK(builder.GetCachedCount() == 3 && compiler.compileCount == 8);
+
+	// Another compiler version misses everything
+	{
+		FakeCompiler other("b");
+		other.sources = compiler.sources;
+		ShaderBuilder otherBuilder(&other, &threadPool, ".");
+		CHECK(Build(otherBuilder, jobs));
+		CHECK(otherBuilder.GetCompiledCount() == 3);
+	}
+
+	// Failures are reported per job and never cached
+	{
+		compiler.sources["Broken.hlsl"] = "error\n";
+		std::vector<ShaderBuildJob> broken(jobs);
+		broken.push_back(MakeJob("Broken.hlsl", "ShaderBuilderTest3.cso", ""));
+		broken.push_back(MakeJob("Missing.hlsl", "ShaderBuilderTest4.cso", ""));
+		unsigned int before = compiler.compileCount;
+		CHECK(!Build(builder, broken));
+		CHECK(builder.GetFailedCount() == 2 && builder.GetCachedCount() == 3);
+		CHECK(builder.GetResults()[3].Errors == "Broken.hlsl: error" && builder.GetResults()[4].Errors == "Missing.hlsl: not found");
+
+		CHECK(!Build(builder, broken));
+		CHECK(compiler.compileCount == before + 2);
+	}
+
+	// Without a cache directory everything compiles every time
+	{
+		ShaderBuilder uncached(&compiler, &threadPool, "./ShaderBuilderTestMissing");
+		unsigned int before = compiler.compileCount;
+		CHECK(Build(uncached, jobs) && Build(uncached, jobs));
+		CHECK(uncached.GetCompiledCount() == 3 && compiler.compileCount == before + 6);
+	}
+
+	// Strings are kept apart in the key
+	{
+		ShaderBuildJob a = MakeJob("A.hlsl", "", "");
+		ShaderBuildJob b = a;
+		a.EntryPoint = "ab";
+		a.Profile = "c";
+		b.EntryPoint = "a";
+		b.Profile = "bc";
+		CHECK(ShaderBuilder::GetCacheKey(a, "x", "v") != ShaderBuilder::GetCacheKey(b, "x", "v"));
+		CHECK(ShaderBuilder::GetCacheKey(a, "x", "v") == ShaderBuilder::GetCacheKey(a, "x", "v"));
+	}
+
+	RemoveFiles();
+	return TestResult();
+}
@@ -0,0 +1,116 @@
+#include "ShaderReflectionData.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// The names the renderer sets every draw, and where a handle would point
+static const char* const Names[] = { "world", "normalMatrix", "worldViewProj", "color", "view", "projection" };
+static const ShaderNameId NameIds[] = {
+	ShaderName("world"), ShaderName("normalMatrix"), ShaderName("worldViewProj"),
+	ShaderName("color"), ShaderName("view"), ShaderName("projection")
+};
+static const unsigned int NameCount = sizeof(Names) / sizeof(Names[0]);
+
+// --------------------------------------------------------
+// A shader about the size of the engine's pixel shader: the
+// names above plus enough other variables to fill out the
+// tables, spread over four buffers
+// --------------------------------------------------------
+static void Fill(ShaderReflectionData& data)
+{
+	for (unsigned int b = 0; b < 4; b++) {
+		data.AddBuffer("buffer" + std::to_string(b), 1024, b);
+	}
+	for (unsigned int i = 0; i < NameCount; i++) {
+		data.AddVariable(Names[i], i % 4, i * 64, 64);
+	}
+	for (unsigned int i = 0; i < 40; i++) {
+		data.AddVariable("light" + std::to_string(i), i % 4, 384 + (i / 4) * 16, 16);
+	}
+	data.BuildLookup();
+}
+
+// Writes 64 bytes where the variable lives, as SetMatrix4x4 does
+static void Write(std::vector<unsigned char>* buffers, const ReflectedVariable& variable, const float* matrix)
+{
+	memcpy(&buffers[variable.BufferIndex][variable.ByteOffset], matrix, 64);
+}
+
+template <typename Function>
+static double Time(unsigned int count, Function function)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < count; i++) {
+		function(i);
+	}
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Times setting a matrix ten million times three ways: by
+// name, building a std::string from a literal as the string
+// SetData overloads do; by a name hashed at compile time;
+// and through a handle resolved once, with no lookup at all
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int count = 10000000;
+
+	ShaderReflectionData data;
+	Fill(data);
+	const std::vector<ReflectedVariable>& variables = data.GetVariables();
+
+	std::vector<unsigned char> buffers[4];
+	for (unsigned int b = 0; b < 4; b++) {
+		buffers[b].resize(1024);
+	}
+	float matrix[16] = {};
+
+	unsigned int missing = 0;
+	double byString = Time(count, [&](unsigned int i) {
+		matrix[0] = (float)i;
+		int index = data.FindVariable(std::string(Names[i % NameCount]));
+		if (index == ShaderReflectionData::NotFound) {
+			missing++;
+			return;
+		}
+		Write(buffers, variables[index], matrix);
+	});
+
+	double byNameId = Time(count, [&](unsigned int i) {
+		matrix[0] = (float)i;
+		int index = data.FindVariable(NameIds[i % NameCount]);
+		if (index == ShaderReflectionData::NotFound) {
+			missing++;
+			return;
+		}
+		Write(buffers, variables[index], matrix);
+	});
+
+	std::vector<ReflectedVariable> handles;
+	for (unsigned int i = 0; i < NameCount; i++) {
+		handles.push_back(variables[data.FindVariable(NameIds[i])]);
+	}
+	double byHandle = Time(count, [&](unsigned int i) {
+		matrix[0] = (float)i;
+		Write(buffers, handles[i % NameCount], matrix);
+	});
+
+	// Reading the buffers back keeps the writes from being optimized away
+	float check = 0;
+	for (unsigned int b = 0; b < 4; b++) {
+		for (unsigned int offset = 0; offset < 1024; offset += 64) {
+			float value;
+			memcpy(&value, &buffers[b][offset], sizeof(value));
+			check += value;
+		}
+	}
+
+	printf("%u sets over %u variables (%u not found, check %.0f)\n", count, (unsigned int)variables.size(), missing, check);
+	printf("by string:  %6.2f ns per set\n", byString * 1e9 / count);
+	printf("by name id: %6.2f ns per set (%.1fx)\n", byNameId * 1e9 / count, byString / byNameId);
+	printf("by handle:  %6.2f ns per set (%.1fx)\n", byHandle * 1e9 / count, byString / byHandle);
+	return 0;
+}
@@ -0,0 +1,132 @@
+#include "ShaderReflectionData.h"
+#include "TestCheck.h"
+#include <random>
+#include <vector>
+
+static const uint64_t BytecodeHash = 0x0123456789ABCDEFull;
+
+static void Fill(ShaderReflectionData& data)
+{
+	data.AddBuffer("perFrame", 128, 0);
+	data.AddBuffer("perObject", 64, 1);
+	data.AddVariable("view", 0, 0, 64);
+	data.AddVariable("projection", 0, 64, 64);
+	data.AddVariable("world", 1, 0, 64);
+	data.AddResource("diffuseTexture", ResourceTexture, 0);
+	data.AddResource("basicSampler", ResourceSampler, 0);
+	data.AddResource("shadowMap", ResourceTexture, 3);
+	data.BuildLookup();
+}
+
+static void PutUInt(std::vector<unsigned char>& bytes, size_t offset, uint32_t value)
+{
+	for (unsigned int i = 0; i < 4; i++) {
+		bytes[offset + i] = (unsigned char)(value >> (i * 8));
+	}
+}
+
+int main()
+{
+	ShaderReflectionData original;
+	Fill(original);
+
+	std::vector<unsigned char> sidecar;
+	original.Write(sidecar, BytecodeHash);
+
+	// Everything written comes back, in order, and can be looked up
+	ShaderReflectionData data;
+	CHECK(data.Read(&sidecar[0], sidecar.size(), BytecodeHash));
+	CHECK(data.GetBuffers().size() == 2 && data.GetVariables().size() == 3 && data.GetResources().size() == 3);
+	CHECK(data.GetBuffers()[1].Name == "perObject" && data.GetBuffers()[1].Size == 64 && data.GetBuffers()[1].BindIndex == 1);
+	CHECK(data.GetVariables()[1].Name == "projection" && data.GetVariables()[1].ByteOffset == 64);
+
+	CHECK(data.FindBuffer("perObject") == 1);
+	CHECK(data.FindVariable("world") == 2);
+	CHECK(data.FindVariable(ShaderName("view")) == 0);
+	CHECK(data.FindVariable("missing") == ShaderReflectionData::NotFound);
+	CHECK(data.FindVariable(ShaderName("missing")) == ShaderReflectionData::NotFound);
+
+	// Resources are indexed by type
+	CHECK(data.GetResourceCount(ResourceTexture) == 2);
+	CHECK(data.GetResourceCount(ResourceSampler) == 1);
+	CHECK(data.FindResource(ResourceTexture, "shadowMap") == 1);
+	CHECK(data.FindResource(ResourceTexture, ShaderName("diffuseTexture")) == 0);
+	CHECK(data.FindResource(ResourceSampler, "basicSampler") == 0);
+	CHECK(data.FindResource(ResourceSampler, "shadowMap") == ShaderReflectionData::NotFound);
+	CHECK(data.GetResource(ResourceTexture, 1).BindIndex == 3);
+
+	// Writing what was read gives the same bytes
+	std::vector<unsigned char> rewritten;
+	data.Write(rewritten, BytecodeHash);
+	CHECK(rewritten == sidecar);
+
+	// A sidecar for other bytecode is refused
+	CHECK(!data.Read(&sidecar[0], sidecar.size(), BytecodeHash + 1));
+	CHECK(data.GetBuffers().empty());
+
+	// So is every truncation, and trailing bytes
+	bool anyTruncationRead = false;
+	for (size_t size = 0; size < sidecar.size(); size++) {
+		anyTruncationRead = anyTruncationRead || data.Read(&sidecar[0], size, BytecodeHash);
+	}
+	CHECK(!anyTruncationRead);
+
+	std::vector<unsigned char> padded = sidecar;
+	padded.push_back(0);
+	CHECK(!data.Read(&padded[0], padded.size(), BytecodeHash));
+
+	// Header: magic, version, hash (8 bytes), then the three counts
+	std::vector<unsigned char> bad = sidecar;
+	bad[0] ^= 1;
+	CHECK(!data.Read(&bad[0], bad.size(), BytecodeHash));
+
+	bad = sidecar;
+	PutUInt(bad, 4, 2);
+	CHECK(!data.Read(&bad[0], bad.size(), BytecodeHash));
+
+	// Counts far beyond what the data could hold
+	bad = sidecar;
+	PutUInt(bad, 20, 0xFFFFFFFF);
+	CHECK(!data.Read(&bad[0], bad.size(), BytecodeHash));
+
+	// A variable past the end of its buffer: "view" is the first
+	// variable, after both buffers ("perFrame", "perObject")
+	size_t firstVariable = 28 + (4 + 8 + 8) + (4 + 9 + 8);
+	bad = sidecar;
+	PutUInt(bad, firstVariable + 4 + 4 + 4, 128);
+	CHECK(!data.Read(&bad[0], bad.size(), BytecodeHash));
+
+	bad = sidecar;
+	PutUInt(bad, firstVariable + 4 + 4, 2);
+	CHECK(!data.Read(&bad[0], bad.size(), BytecodeHash));
+
+	// An unknown resource type, in the last record
+	bad = sidecar;
+	PutUInt(bad, bad.size() - 8, ResourceTypeCount);
+	CHECK(!data.Read(&bad[0], bad.size(), BytecodeHash));
+
+	// Random damage must never crash, and whatever is read
+	// has to be consistent
+	std::mt19937 random(11);
+	unsigned int inconsistent = 0;
+	for (unsigned int i = 0; i < 20000; i++) {
+		bad = sidecar;
+		unsigned int flips = 1 + random() % 4;
+		for (unsigned int f = 0; f < flips; f++) {
+			bad[random() % bad.size()] ^= (unsigned char)(1 << (random() % 8));
+		}
+
+		if (data.Read(&bad[0], bad.size(), BytecodeHash)) {
+			const std::vector<ReflectedVariable>& variables = data.GetVariables();
+			for (unsigned int v = 0; v < variables.size(); v++) {
+				if (variables[v].BufferIndex >= data.GetBuffers().size()
+					|| variables[v].ByteOffset + variables[v].Size > data.GetBuffers()[variables[v].BufferIndex].Size) {
+					inconsistent++;
+				}
+			}
+		}
+	}
+	CHECK(inconsistent == 0);
+
+	return TestResult();
+}
@@ -0,0 +1,189 @@
+#include "ShadowAtlas.h"
+#include "TestCheck.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+static ShadowRequest MakeRequest(unsigned int key, float importance)
+{
+	ShadowRequest request = {};
+	request.Key = key;
+	request.Importance = importance;
+	request.ViewProjection = XMFLOAT4X4(
+		1, 0, 0, (float)key,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1);
+	request.Directional = false;
+	return request;
+}
+
+// Placed tiles are inside the atlas, never overlap, and add up
+// to the occupancy the atlas reports
+static bool TilesValid(ShadowAtlas& atlas)
+{
+	const std::vector<ShadowTile>& tiles = atlas.GetTiles();
+	unsigned int size = atlas.GetSize();
+	double texels = 0;
+
+	for (unsigned int a = 0; a < tiles.size(); a++) {
+		const ShadowTile& tile = tiles[a];
+		if (tile.Size == 0) {
+			continue;
+		}
+		if ((tile.Size & (tile.Size - 1)) != 0 || tile.X % tile.Size != 0 || tile.Y % tile.Size != 0
+			|| tile.X + tile.Size > size || tile.Y + tile.Size > size) {
+			return false;
+		}
+
+		for (unsigned int b = a + 1; b < tiles.size(); b++) {
+			const ShadowTile& other = tiles[b];
+			if (other.Size > 0
+				&& tile.X < other.X + other.Size && other.X < tile.X + tile.Size
+				&& tile.Y < other.Y + other.Size && other.Y < tile.Y + tile.Size) {
+				return false;
+			}
+		}
+		texels += (double)tile.Size * tile.Size;
+	}
+
+	return fabs(texels / ((double)size * size) - atlas.GetOccupancy()) < 1e-6;
+}
+
+int main()
+{
+	// Sizes follow importance, with hysteresis around each boundary
+	{
+		ShadowAtlas atlas(1024, 64);
+		ShadowRequest request = MakeRequest(1, 0.5f);
+		atlas.Update(&request, 1, nullptr, 0);
+		CHECK(atlas.GetTiles()[0].Size == 512 && atlas.GetTiles()[0].Dirty);
+
+		atlas.Update(&request, 1, nullptr, 0);
+		CHECK(!atlas.GetTiles()[0].Dirty && atlas.GetCachedTileCount() == 1);
+
+		// 1.7 levels down is within a quarter past the halfway point
+		request.Importance = exp2f(-1.7f);
+		atlas.Update(&request, 1, nullptr, 0);
+		CHECK(atlas.GetTiles()[0].Size == 512 && !atlas.GetTiles()[0].Dirty);
+
+		request.Importance = exp2f(-1.8f);
+		atlas.Update(&request, 1, nullptr, 0);
+		CHECK(atlas.GetTiles()[0].Size == 256 && atlas.GetTiles()[0].Dirty);
+
+		// And the same on the way back up
+		request.Importance = exp2f(-1.3f);
+		atlas.Update(&request, 1, nullptr, 0);
+		CHECK(atlas.GetTiles()[0].Size == 256);
+
+		request.Importance = exp2f(-1.2f);
+		atlas.Update(&request, 1, nullptr, 0);
+		CHECK(atlas.GetTiles()[0].Size == 512);
+	}
+
+	// A tile shrunk to fit isn't placed and drawn afresh every frame,
+	// and grows back once there's room. Three halves and three
+	// quarters of the last leave one quarter free; the tiles in the
+	// last half are held at a quarter by hysteresis, and are more
+	// important than the new one, which can't evict them.
+	{
+		ShadowAtlas atlas(1024, 64);
+		ShadowRequest requests[7] = {
+			MakeRequest(4, 0.4f),
+			MakeRequest(5, 0.3f), MakeRequest(6, 0.3f), MakeRequest(7, 0.3f),
+			MakeRequest(2, 0.5f), MakeRequest(3, 0.5f), MakeRequest(1, 0.5f)
+		};
+
+		atlas.Update(requests + 1, 6, nullptr, 0);
+		CHECK(atlas.GetTiles()[0].Size == 256 && atlas.GetTiles()[5].Size == 512);
+
+		requests[1].Importance = requests[2].Importance = requests[3].Importance = 0.41f;
+		atlas.Update(requests, 7, nullptr, 0);
+		CHECK(atlas.GetTiles()[0].Size == 256 && atlas.GetTiles()[1].Size == 256);
+		CHECK(atlas.GetRenderedTileCount() == 1);
+		CHECK(TilesValid(atlas));
+
+		for (unsigned int frame = 0; frame < 3; frame++) {
+			atlas.Update(requests, 7, nullptr, 0);
+			CHECK(atlas.GetTiles()[0].Size == 256 && !atlas.GetTiles()[0].Dirty);
+			CHECK(atlas.GetRenderedTileCount() == 0);
+		}
+
+		// Dropping a light frees a half, and the tile still wants one
+		atlas.Update(requests, 6, nullptr, 0);
+		CHECK(atlas.GetTiles()[0].Size == 512 && atlas.GetTiles()[0].Dirty);
+		CHECK(atlas.GetRenderedTileCount() == 1);
+		CHECK(TilesValid(atlas));
+
+		atlas.Update(requests, 6, nullptr, 0);
+		CHECK(atlas.GetRenderedTileCount() == 0);
+	}
+
+	// Only the tiles a changed caster touches are drawn again
+	{
+		ShadowAtlas atlas(1024, 64);
+		ShadowRequest requests[2] = { MakeRequest(1, 0.25f), MakeRequest(2, 0.25f) };
+		XMStoreFloat4x4(&requests[0].ViewProjection, XMMatrixIdentity());
+		XMStoreFloat4x4(&requests[1].ViewProjection, XMMatrixTranspose(XMMatrixTranslation(100, 0, 0)));
+		atlas.Update(requests, 2, nullptr, 0);
+
+		// Inside the first view's unit cube, and far outside the second's
+		BoundingBox moved(XMFLOAT3(0, 0, 0.5f), XMFLOAT3(0.1f, 0.1f, 0.1f));
+		atlas.Update(requests, 2, &moved, 1);
+		CHECK(atlas.GetTiles()[0].Dirty && !atlas.GetTiles()[1].Dirty);
+
+		// Behind the near plane only counts for directional views
+		BoundingBox behind(XMFLOAT3(0, 0, -5), XMFLOAT3(0.1f, 0.1f, 0.1f));
+		atlas.Update(requests, 2, &behind, 1);
+		CHECK(!atlas.GetTiles()[0].Dirty);
+		requests[0].Directional = true;
+		atlas.Update(requests, 2, &behind, 1);
+		CHECK(atlas.GetTiles()[0].Dirty);
+
+		atlas.InvalidateAll();
+		atlas.Update(requests, 2, nullptr, 0);
+		CHECK(atlas.GetRenderedTileCount() == 2);
+	}
+
+	// Random frames of lights coming, going and changing importance
+	{
+		ShadowAtlas atlas(2048, 32);
+		std::mt19937 random(17);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<ShadowRequest> requests;
+		for (unsigned int key = 0; key < 40; key++) {
+			requests.push_back(MakeRequest(key, exp2f(-1 - 5 * unit(random))));
+		}
+
+		unsigned int invalid = 0;
+		unsigned int unplaced = 0;
+		unsigned int nextKey = 40;
+		for (unsigned int frame = 0; frame < 1000; frame++) {
+			for (unsigned int i = 0; i < requests.size(); i++) {
+				float roll = unit(random);
+				if (roll < 0.01f) {
+					requests[i] = MakeRequest(nextKey++, exp2f(-1 - 5 * unit(random)));
+				}
+				else if (roll < 0.2f) {
+					requests[i].Importance *= exp2f(0.4f * (unit(random) - 0.5f));
+				}
+			}
+
+			atlas.Update(&requests[0], (unsigned int)requests.size(), nullptr, 0);
+			invalid += !TilesValid(atlas);
+			unplaced += atlas.GetUnplacedCount();
+			CHECK(atlas.GetRenderedTileCount() + atlas.GetCachedTileCount() + atlas.GetUnplacedCount() == requests.size());
+		}
+
+		CHECK(invalid == 0);
+
+		// With nothing changing, nothing is drawn again
+		atlas.Update(&requests[0], (unsigned int)requests.size(), nullptr, 0);
+		CHECK(atlas.GetRenderedTileCount() == 0);
+	}
+
+	return TestResult();
+}
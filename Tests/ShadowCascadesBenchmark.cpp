@@ -0,0 +1,63 @@
+#include "ShadowCascades.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Times fitting four cascades to a camera and culling
+// 100,000 boxes scattered over a 2 km field against them,
+// with the sun low and off to one side
+// --------------------------------------------------------
+int main()
+{
+	const unsigned int count = 100000;
+	const unsigned int runs = 20;
+	const float nearPlane = 0.1f;
+	const float farPlane = 1000.0f;
+
+	std::mt19937 random(19);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<BoundingBox> bounds(count);
+	for (unsigned int i = 0; i < count; i++) {
+		XMFLOAT3 extents(0.5f + 4 * unit(random), 0.5f + 10 * unit(random), 0.5f + 4 * unit(random));
+		bounds[i] = BoundingBox(XMFLOAT3(2000 * unit(random) - 1000, extents.y, 2000 * unit(random) - 1000), extents);
+	}
+
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 5, 0, 1), XMVectorSet(0.3f, -0.1f, 1, 0), XMVectorSet(0, 1, 0, 0));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0f, 16.0f / 9.0f, nearPlane, farPlane);
+	XMFLOAT3 lightDirection;
+	XMStoreFloat3(&lightDirection, XMVector3Normalize(XMVectorSet(0.6f, -0.4f, 0.3f, 0)));
+
+	ThreadPool threadPool;
+	ShadowCascades cascades(&threadPool);
+	cascades.SetCascadeCount(4);
+	cascades.SetResolution(2048);
+	cascades.SetShadowDistance(300);
+	cascades.Update(view, projection, nearPlane, farPlane, lightDirection);
+	cascades.CullCasters(&bounds[0], count);
+
+	double updateSeconds = 0;
+	double cullSeconds = 0;
+	for (unsigned int run = 0; run < runs; run++) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		cascades.Update(view, projection, nearPlane, farPlane, lightDirection);
+		std::chrono::high_resolution_clock::time_point updated = std::chrono::high_resolution_clock::now();
+		cascades.CullCasters(&bounds[0], count);
+		std::chrono::high_resolution_clock::time_point culled = std::chrono::high_resolution_clock::now();
+
+		updateSeconds += std::chrono::duration<double>(updated - start).count();
+		cullSeconds += std::chrono::duration<double>(culled - updated).count();
+	}
+
+	printf("%u casters, %u cascades, %u threads\n", count, cascades.GetCascadeCount(), threadPool.GetThreadCount());
+	for (unsigned int i = 0; i < cascades.GetCascadeCount(); i++) {
+		const ShadowCascade& cascade = cascades.GetCascade(i);
+		printf("cascade %u: %6.1f to %6.1f m, %6u casters\n", i, cascade.splitNear, cascade.splitFar, (unsigned int)cascades.GetCasters(i).size());
+	}
+	printf("update: %.3f ms, cull: %.2f ms, %.1fM casters/s (average of %u runs)\n",
+		updateSeconds * 1000 / runs, cullSeconds * 1000 / runs, count * runs / cullSeconds / 1e6, runs);
+	return 0;
+}
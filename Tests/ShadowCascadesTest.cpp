@@ -0,0 +1,198 @@
+#include "ShadowCascades.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+static const float NearPlane = 0.1f;
+static const float FarPlane = 200.0f;
+static const float FieldOfView = 1.0f;
+static const float AspectRatio = 16.0f / 9.0f;
+
+static XMMATRIX CameraView(XMFLOAT3 position, float yaw, float pitch)
+{
+	XMVECTOR forward = XMVectorSet(sinf(yaw) * cosf(pitch), sinf(pitch), cosf(yaw) * cosf(pitch), 0);
+	return XMMatrixLookToLH(XMLoadFloat3(&position), forward, XMVectorSet(0, 1, 0, 0));
+}
+
+// Where a world point lands in a cascade's map, in texels. The
+// matrix is transposed, so its rows give clip x and y.
+static void ToTexels(const ShadowCascade& cascade, unsigned int resolution, const XMFLOAT3& point, double& u, double& v)
+{
+	const XMFLOAT4X4& m = cascade.viewProjection;
+	double x = (double)m._11 * point.x + (double)m._12 * point.y + (double)m._13 * point.z + m._14;
+	double y = (double)m._21 * point.x + (double)m._22 * point.y + (double)m._23 * point.z + m._24;
+	u = (x * 0.5 + 0.5) * resolution;
+	v = (y * 0.5 + 0.5) * resolution;
+}
+
+// How far apart two texel offsets are, wrapping round whole texels
+static double FractionDistance(double a, double b)
+{
+	double d = fabs((a - floor(a)) - (b - floor(b)));
+	return std::min(d, 1 - d);
+}
+
+int main()
+{
+	// Splits start and end exactly on the planes and only ever grow
+	{
+		float splits[ShadowCascades::MaxCascades + 1];
+		ShadowCascades::ComputeSplits(0.5f, 500.0f, 4, 0.75f, splits);
+		CHECK(splits[0] == 0.5f && splits[4] == 500.0f);
+		for (unsigned int i = 0; i < 4; i++) {
+			CHECK(splits[i] < splits[i + 1]);
+		}
+
+		// All even, and all logarithmic
+		ShadowCascades::ComputeSplits(0.5f, 500.0f, 4, 0, splits);
+		CHECK_NEAR(splits[1], 125.375, 1e-3);
+		CHECK_NEAR(splits[2], 250.25, 1e-3);
+		ShadowCascades::ComputeSplits(1, 10000, 4, 1, splits);
+		CHECK_NEAR(splits[1], 10, 1e-3);
+		CHECK_NEAR(splits[3], 1000, 1e-1);
+	}
+
+	ThreadPool threadPool(2);
+	ShadowCascades cascades(&threadPool);
+	cascades.SetResolution(2048);
+	cascades.SetShadowDistance(150.0f);
+
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(FieldOfView, AspectRatio, NearPlane, FarPlane);
+	XMFLOAT3 lightDirection(0.3f, -1.0f, 0.45f);
+	unsigned int count = cascades.GetCascadeCount();
+	unsigned int resolution = cascades.GetResolution();
+
+	// Turning the camera in place never changes a cascade's size
+	float radii[ShadowCascades::MaxCascades];
+	cascades.Update(CameraView(XMFLOAT3(0, 5, 0), 0, 0), projection, NearPlane, FarPlane, lightDirection);
+	for (unsigned int i = 0; i < count; i++) {
+		radii[i] = cascades.GetCascade(i).radius;
+	}
+
+	bool sameSize = true;
+	for (unsigned int step = 0; step < 100; step++) {
+		cascades.Update(CameraView(XMFLOAT3(0, 5, 0), step * 0.071f, sinf(step * 0.3f) * 0.5f), projection, NearPlane, FarPlane, lightDirection);
+		for (unsigned int i = 0; i < count; i++) {
+			sameSize = sameSize && cascades.GetCascade(i).radius == radii[i];
+		}
+	}
+	CHECK(sameSize);
+
+	// Moving the camera only ever moves a fixed point on the map by
+	// whole texels, while every cascade still covers its slice
+	XMFLOAT3 fixedPoint(3.7f, 0.25f, 21.3f);
+	double firstU[ShadowCascades::MaxCascades], firstV[ShadowCascades::MaxCascades];
+	double worstDrift = 0;
+	unsigned int uncovered = 0;
+	float tanY = tanf(FieldOfView / 2);
+	float tanX = tanY * AspectRatio;
+
+	for (unsigned int step = 0; step < 500; step++) {
+		XMFLOAT3 position(-20.0f + step * 0.0913f, 5.0f + step * 0.0071f, -10.0f + step * 0.0537f);
+		float yaw = 0.4f;
+		float pitch = -0.2f;
+		XMMATRIX view = CameraView(position, yaw, pitch);
+		cascades.Update(view, projection, NearPlane, FarPlane, lightDirection);
+
+		XMVECTOR forward = XMVectorSet(sinf(yaw) * cosf(pitch), sinf(pitch), cosf(yaw) * cosf(pitch), 0);
+		XMVECTOR right = XMVector3Normalize(XMVector3Cross(XMVectorSet(0, 1, 0, 0), forward));
+		XMVECTOR up = XMVector3Cross(forward, right);
+
+		for (unsigned int i = 0; i < count; i++) {
+			const ShadowCascade& cascade = cascades.GetCascade(i);
+
+			double u, v;
+			ToTexels(cascade, resolution, fixedPoint, u, v);
+			if (step == 0) {
+				firstU[i] = u;
+				firstV[i] = v;
+			}
+			worstDrift = std::max(worstDrift, std::max(FractionDistance(u, firstU[i]), FractionDistance(v, firstV[i])));
+
+			// The slice's corners, on both of its planes
+			for (unsigned int corner = 0; corner < 8; corner++) {
+				float depth = corner < 4 ? cascade.splitNear : cascade.splitFar;
+				float x = (corner & 1 ? 1 : -1) * tanX * depth;
+				float y = (corner & 2 ? 1 : -1) * tanY * depth;
+				XMFLOAT3 point;
+				XMStoreFloat3(&point, XMVectorAdd(XMLoadFloat3(&position),
+					XMVectorAdd(XMVectorScale(forward, depth), XMVectorAdd(XMVectorScale(right, x), XMVectorScale(up, y)))));
+
+				double cu, cv;
+				ToTexels(cascade, resolution, point, cu, cv);
+				uncovered += cu < 0 || cu > resolution || cv < 0 || cv > resolution;
+			}
+		}
+	}
+
+	printf("Worst sub-texel drift of a fixed point: %g texels\n", worstDrift);
+	CHECK(worstDrift < 0.01);
+	CHECK(uncovered == 0);
+
+	// Casters against light space boxes worked out in double
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<BoundingBox> boxes(3001);
+	for (unsigned int i = 0; i < boxes.size(); i++) {
+		boxes[i].Center = XMFLOAT3(-150 + 300 * unit(random), -20 + 60 * unit(random), -150 + 300 * unit(random));
+		boxes[i].Extents = XMFLOAT3(0.1f + 4 * unit(random), 0.1f + 4 * unit(random), 0.1f + 4 * unit(random));
+	}
+
+	cascades.Update(CameraView(XMFLOAT3(0, 5, 0), 0.3f, -0.1f), projection, NearPlane, FarPlane, lightDirection);
+	float farZ[ShadowCascades::MaxCascades];
+	for (unsigned int i = 0; i < count; i++) {
+		farZ[i] = cascades.GetCascade(i).farZ;
+	}
+	cascades.CullCasters(&boxes[0], (unsigned int)boxes.size());
+
+	const XMFLOAT4X4& lightView = cascades.GetLightView();
+	unsigned int disagreements = 0;
+	unsigned int total = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		const ShadowCascade& cascade = cascades.GetCascade(i);
+		const std::vector<unsigned int>& casters = cascades.GetCasters(i);
+		CHECK(std::is_sorted(casters.begin(), casters.end()));
+		total += (unsigned int)casters.size();
+
+		double nearest = cascade.center.z - cascade.radius;
+		for (unsigned int b = 0; b < boxes.size(); b++) {
+			XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+			boxes[b].GetCorners(corners);
+
+			double low[3] = { 1e30, 1e30, 1e30 }, high[3] = { -1e30, -1e30, -1e30 };
+			for (unsigned int c = 0; c < BoundingBox::CORNER_COUNT; c++) {
+				for (int axis = 0; axis < 3; axis++) {
+					double value = (double)corners[c].x * lightView.m[0][axis] + (double)corners[c].y * lightView.m[1][axis] + (double)corners[c].z * lightView.m[2][axis];
+					low[axis] = std::min(low[axis], value);
+					high[axis] = std::max(high[axis], value);
+				}
+			}
+
+			// How far inside (positive) or outside the cascade's reach the box is
+			double margin = std::min(
+				std::min(high[0] - (cascade.center.x - cascade.radius), cascade.center.x + cascade.radius - low[0]),
+				std::min(std::min(high[1] - (cascade.center.y - cascade.radius), cascade.center.y + cascade.radius - low[1]),
+					farZ[i] - low[2]));
+
+			bool expected = margin >= 0;
+			bool actual = std::binary_search(casters.begin(), casters.end(), b);
+			if (expected != actual && fabs(margin) > 1e-3) {
+				disagreements++;
+			}
+			if (expected) {
+				nearest = std::min(nearest, low[2]);
+			}
+		}
+
+		CHECK_NEAR(cascade.nearZ, nearest, 1e-3);
+	}
+
+	CHECK(disagreements == 0);
+	CHECK(total > 0);
+
+	return TestResult();
+}
@@ -0,0 +1,113 @@
+#include "StateCache.h"
+#include "TestCheck.h"
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Records every binding the cache lets through
+// --------------------------------------------------------
+class RecordingTarget : public IStateTarget
+{
+public:
+	struct Call
+	{
+		const char* what;
+		unsigned int stageOrSlot;
+		StateObject object;
+	};
+
+	std::vector<Call> calls;
+
+	void BindShader(ShaderStage stage, StateObject shader) { Record("shader", stage, shader); }
+	void BindConstantBuffer(ShaderStage stage, unsigned int slot, StateObject buffer) { Record("cbuffer", stage * 100 + slot, buffer); }
+	void BindConstantBufferRange(ShaderStage stage, unsigned int slot, StateObject buffer, unsigned int, unsigned int) { Record("cbuffer range", stage * 100 + slot, buffer); }
+	void BindShaderResource(ShaderStage stage, unsigned int slot, StateObject srv) { Record("srv", stage * 100 + slot, srv); }
+	void BindSampler(ShaderStage stage, unsigned int slot, StateObject sampler) { Record("sampler", stage * 100 + slot, sampler); }
+	void BindInputLayout(StateObject inputLayout) { Record("input layout", 0, inputLayout); }
+	void BindVertexBuffer(unsigned int slot, StateObject buffer, unsigned int, unsigned int) { Record("vertex buffer", slot, buffer); }
+	void BindIndexBuffer(StateObject buffer, unsigned int, unsigned int) { Record("index buffer", 0, buffer); }
+
+private:
+	void Record(const char* what, unsigned int stageOrSlot, StateObject object)
+	{
+		Call call = { what, stageOrSlot, object };
+		calls.push_back(call);
+	}
+};
+
+// Stand-ins for D3D objects; the cache only compares them
+static StateObject Object(uintptr_t id)
+{
+	return reinterpret_cast<StateObject>(id * 16);
+}
+
+int main()
+{
+	RecordingTarget target;
+	StateCache cache(&target);
+
+	// The first binding of anything goes through, repeats don't
+	cache.SetShader(StageVertex, Object(1));
+	cache.SetShader(StageVertex, Object(1));
+	cache.SetShader(StagePixel, Object(1));
+	CHECK(target.calls.size() == 2);
+
+	cache.SetInputLayout(Object(2));
+	cache.SetInputLayout(Object(2));
+	cache.SetVertexBuffer(0, Object(3), 32, 0);
+	cache.SetVertexBuffer(0, Object(3), 32, 0);
+	cache.SetIndexBuffer(Object(4), 42, 0);
+	cache.SetIndexBuffer(Object(4), 42, 0);
+	CHECK(target.calls.size() == 5);
+
+	// A different stride, offset or format is a different binding
+	cache.SetVertexBuffer(0, Object(3), 48, 0);
+	cache.SetVertexBuffer(0, Object(3), 48, 16);
+	cache.SetIndexBuffer(Object(4), 57, 0);
+	CHECK(target.calls.size() == 8);
+
+	// Slots are tracked separately, per stage
+	cache.SetShaderResource(StagePixel, 0, Object(5));
+	cache.SetShaderResource(StagePixel, 1, Object(5));
+	cache.SetShaderResource(StageVertex, 0, Object(5));
+	cache.SetShaderResource(StagePixel, 0, Object(5));
+	cache.SetSampler(StagePixel, 0, Object(6));
+	cache.SetSampler(StagePixel, 0, Object(6));
+	CHECK(target.calls.size() == 12);
+
+	// Unbinding is a real binding, and only needed once
+	cache.SetShaderResource(StagePixel, 0, nullptr);
+	cache.SetShaderResource(StagePixel, 0, nullptr);
+	CHECK(target.calls.size() == 13);
+	CHECK(target.calls.back().object == nullptr);
+
+	// Whole buffers and ranges of the same buffer don't match each other
+	cache.SetConstantBuffer(StageVertex, 0, Object(7));
+	cache.SetConstantBuffer(StageVertex, 0, Object(7));
+	cache.SetConstantBufferRange(StageVertex, 0, Object(7), 0, 16);
+	cache.SetConstantBufferRange(StageVertex, 0, Object(7), 0, 16);
+	cache.SetConstantBufferRange(StageVertex, 0, Object(7), 16, 16);
+	cache.SetConstantBuffer(StageVertex, 0, Object(7));
+	CHECK(target.calls.size() == 17);
+
+	// Slots past the tracked range always go through
+	cache.SetSampler(StagePixel, StateCache::MaxSamplers, Object(6));
+	cache.SetSampler(StagePixel, StateCache::MaxSamplers, Object(6));
+	CHECK(target.calls.size() == 19);
+
+	CHECK(cache.GetIssuedCount() == 19);
+	CHECK(cache.GetSkippedCount() == 9);
+
+	// After something else touched the context, everything is sent again
+	cache.BeginFrame();
+	cache.Invalidate();
+	target.calls.clear();
+	cache.SetShader(StageVertex, Object(1));
+	cache.SetInputLayout(Object(2));
+	cache.SetShaderResource(StagePixel, 0, nullptr);
+	CHECK(target.calls.size() == 3);
+	CHECK(cache.GetIssuedCount() == 3);
+	CHECK(cache.GetSkippedCount() == 0);
+
+	return TestResult();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+// --------------------------------------------------------
+// Just enough of a test framework for the engine's tests.
+//
+// Each test is its own executable; a failed check prints
+// its file and line and carries on, and TestResult() turns
+// the failure count into main()'s exit code for CTest.
+// --------------------------------------------------------
+
+static int testFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			testFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { \
+		double checkActual = (actual); \
+		double checkExpected = (expected); \
+		if (!(std::fabs(checkActual - checkExpected) <= (tolerance))) { \
+			printf("%s(%d): CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #actual, #expected, checkActual, checkExpected); \
+			testFailures++; \
+		} \
+	} while (0)
+
+inline int TestResult()
+{
+	if (testFailures > 0) {
+		printf("%d check(s) failed\n", testFailures);
+		return 1;
+	}
+
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,182 @@
+#include "TriangleBudget.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// A scene whose triangle count halves for every 1.25 steps of LOD
+// bias, and loses a tenth of what's left per pixel of cull size,
+// reacting a frame late like the renderer does
+struct Scene
+{
+	float fullDetail;
+	unsigned int drawn;
+
+	Scene(float triangles) : fullDetail(triangles), drawn((unsigned int)triangles) {}
+
+	void Frame(TriangleBudget& budget, float cpuSeconds = 0, float gpuSeconds = 0)
+	{
+		budget.Update(drawn, cpuSeconds, gpuSeconds);
+		drawn = (unsigned int)(fullDetail * exp2f(-0.8f * budget.GetLodBias()) * std::max(0.0f, 1 - 0.1f * budget.GetCullSize()));
+	}
+};
+
+int main()
+{
+	// Under budget, nothing is given up
+	{
+		TriangleBudget budget;
+		budget.SetTriangleBudget(1000000);
+		Scene scene(500000);
+		for (int frame = 0; frame < 200; frame++) {
+			scene.Frame(budget);
+		}
+		CHECK(budget.GetPressure() == 0 && budget.GetLodBias() == 0 && budget.GetCullSize() == 0);
+		CHECK(budget.GetOverBudgetFrames() == 0);
+	}
+
+	// Twice the budget: bias alone brings it down to the target, a
+	// tenth under the budget, and it stays there without ringing
+	{
+		TriangleBudget budget;
+		budget.SetTriangleBudget(1000000);
+		Scene scene(2000000);
+
+		unsigned int settledAt = 0;
+		for (int frame = 0; frame < 300; frame++) {
+			scene.Frame(budget);
+			if (settledAt == 0 && scene.drawn <= 1000000) {
+				settledAt = frame;
+			}
+		}
+		CHECK(settledAt > 0 && settledAt < 40);
+		CHECK(budget.GetOverBudgetFrames() < 40);
+		CHECK(fabsf(scene.drawn / 900000.0f - 1) < 0.01f);
+		CHECK(budget.GetLodBias() > 0 && budget.GetCullSize() == 0);
+
+		// Settled: the count stays under the budget and barely moves
+		unsigned int lowest = scene.drawn;
+		unsigned int highest = scene.drawn;
+		for (int frame = 0; frame < 200; frame++) {
+			scene.Frame(budget);
+			lowest = std::min(lowest, scene.drawn);
+			highest = std::max(highest, scene.drawn);
+		}
+		CHECK(highest < 1000000 && highest - lowest < 10000);
+	}
+
+	// More than bias can take out: culling makes up the rest
+	{
+		TriangleBudget budget;
+		budget.SetTriangleBudget(1000000);
+		Scene scene(6000000);
+		for (int frame = 0; frame < 400; frame++) {
+			scene.Frame(budget);
+		}
+		CHECK(budget.GetLodBias() == 3 && budget.GetCullSize() > 0);
+		CHECK(fabsf(scene.drawn / 900000.0f - 1) < 0.01f);
+	}
+
+	// Pinned at full pressure for a long time doesn't wind up: once
+	// the scene gets light again, detail comes back as quickly as it
+	// would after a short overload
+	{
+		unsigned int recovery[2];
+		const int overloadFrames[2] = { 30, 3000 };
+		for (int run = 0; run < 2; run++) {
+			TriangleBudget budget;
+			budget.SetTriangleBudget(1000000);
+			Scene scene(100000000);
+			for (int frame = 0; frame < overloadFrames[run]; frame++) {
+				scene.Frame(budget);
+			}
+			CHECK(budget.GetPressure() == 2);
+
+			scene.fullDetail = 500000;
+			recovery[run] = 0;
+			while (budget.GetPressure() > 0 && recovery[run] < 10000) {
+				scene.Frame(budget);
+				recovery[run]++;
+			}
+		}
+		CHECK(recovery[0] < 100 && recovery[1] == recovery[0]);
+	}
+
+	// A single heavy frame only nudges it, and it settles back
+	{
+		TriangleBudget budget;
+		budget.SetTriangleBudget(1000000);
+		Scene scene(2000000);
+		for (int frame = 0; frame < 300; frame++) {
+			scene.Frame(budget);
+		}
+
+		float settled = budget.GetLodBias();
+		budget.Update(1500000, 0, 0);
+		CHECK(budget.GetLodBias() - settled < 0.5f);
+		for (int frame = 0; frame < 100; frame++) {
+			scene.Frame(budget);
+		}
+		CHECK(fabsf(budget.GetLodBias() - settled) < 0.01f);
+	}
+
+	// Frame time counts when it's the further over, on whichever
+	// side is slower; a GPU time of 0 is left out
+	{
+		TriangleBudget budget;
+		budget.SetTriangleBudget(1000000);
+		budget.SetFrameTimeBudget(1 / 60.0f);
+
+		budget.Update(100000, 0.005f, 0);
+		CHECK(budget.GetPressure() == 0);
+
+		budget.Reset();
+		budget.Update(100000, 0.005f, 0.03f);
+		CHECK(budget.GetPressure() > 0);
+
+		budget.Reset();
+		budget.Update(100000, 0.03f, 0);
+		CHECK(budget.GetPressure() > 0);
+
+		// Triangles further over than time wins
+		TriangleBudget triangles;
+		triangles.SetTriangleBudget(1000000);
+		triangles.Update(3000000, 0, 0);
+		budget.Reset();
+		budget.Update(3000000, 0.005f, 0.005f);
+		CHECK(budget.GetError() == triangles.GetError());
+	}
+
+	// The first frame only moves the integral term, and Reset()
+	// goes back to full detail
+	{
+		TriangleBudget budget;
+		budget.SetTriangleBudget(1000000);
+		budget.SetHeadroom(0);
+		budget.SetGains(0.3f, 0.1f, 0.05f);
+		budget.Update(2000000, 0, 0);
+		CHECK_NEAR(budget.GetPressure(), 0.1f, 1e-6f);
+
+		budget.Reset();
+		CHECK(budget.GetPressure() == 0 && budget.GetLodBias() == 0 && budget.GetOverBudgetFrames() == 0);
+	}
+
+	// The same trace always plays back the same way
+	{
+		std::vector<float> pressures[2];
+		for (int run = 0; run < 2; run++) {
+			TriangleBudget budget;
+			budget.SetTriangleBudget(1000000);
+			budget.SetFrameTimeBudget(1 / 60.0f);
+			Scene scene(1500000);
+			for (int frame = 0; frame < 500; frame++) {
+				scene.fullDetail = 1500000 + 1000000 * sinf(frame * 0.05f);
+				scene.Frame(budget, 0.012f + 0.008f * sinf(frame * 0.13f), 0.01f);
+				pressures[run].push_back(budget.GetPressure());
+			}
+		}
+		CHECK(pressures[0] == pressures[1]);
+	}
+
+	return TestResult();
+}
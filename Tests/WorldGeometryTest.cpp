@@ -0,0 +1,95 @@
+#include "TestCheck.h"
+#include "WorldGeometry.h"
+
+using namespace DirectX;
+
+static Vertex MakeVertex(float px, float py, float pz, float nx, float ny, float nz, float u, float v)
+{
+	Vertex vertex;
+	vertex.Position = XMFLOAT3(px, py, pz);
+	vertex.Normal = XMFLOAT3(nx, ny, nz);
+	vertex.UV = XMFLOAT2(u, v);
+	return vertex;
+}
+
+static void CheckFloat3(const XMFLOAT3& actual, float x, float y, float z)
+{
+	CHECK_NEAR(actual.x, x, 1e-5);
+	CHECK_NEAR(actual.y, y, 1e-5);
+	CHECK_NEAR(actual.z, z, 1e-5);
+}
+
+int main()
+{
+	std::vector<Vertex> mergedVertices;
+	std::vector<unsigned int> mergedIndices;
+
+	// Scaled 2x along x, turned 90 degrees about y (x to -z), then moved
+	// 10 along x. Normals go through the inverse scale before the turn.
+	std::vector<Vertex> triangle;
+	triangle.push_back(MakeVertex(1, 0, 0, 0.70710678f, 0.70710678f, 0, 0.25f, 0.75f));
+	triangle.push_back(MakeVertex(0, 1, 0, 0, 0, 1, 1, 0));
+	triangle.push_back(MakeVertex(0, 0, 1, 1, 0, 0, 0, 1));
+	std::vector<unsigned int> triangleIndices = { 0, 1, 2 };
+
+	XMFLOAT4X4 scaledAndTurned(
+		0, 0, -2, 0,
+		0, 1, 0, 0,
+		1, 0, 0, 0,
+		10, 0, 0, 1);
+	AppendWorldGeometry(triangle, triangleIndices, scaledAndTurned, mergedVertices, mergedIndices);
+
+	CHECK(mergedVertices.size() == 3);
+	CHECK(mergedIndices.size() == 3);
+	CheckFloat3(mergedVertices[0].Position, 10, 0, -2);
+	CheckFloat3(mergedVertices[1].Position, 10, 1, 0);
+	CheckFloat3(mergedVertices[2].Position, 11, 0, 0);
+	CheckFloat3(mergedVertices[0].Normal, 0, 0.89442719f, -0.44721360f);
+	CheckFloat3(mergedVertices[1].Normal, 1, 0, 0);
+	CheckFloat3(mergedVertices[2].Normal, 0, 0, -1);
+	CHECK(mergedVertices[0].UV.x == 0.25f && mergedVertices[0].UV.y == 0.75f);
+	CHECK(mergedVertices[1].UV.x == 1 && mergedVertices[1].UV.y == 0);
+
+	// Mirrored in x and moved up 5: the normal mirrors with it rather
+	// than flipping inside out, and the indices land after the first mesh
+	std::vector<Vertex> mirrored;
+	mirrored.push_back(MakeVertex(1, 2, 3, 1, 0, 0, 0, 0));
+	mirrored.push_back(MakeVertex(0, 0, 0, 0, 1, 0, 0, 0));
+	mirrored.push_back(MakeVertex(0, 0, 1, 0, 0, 1, 0, 0));
+	std::vector<unsigned int> mirroredIndices = { 0, 2, 1 };
+
+	XMFLOAT4X4 mirror(
+		-1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 5, 0, 1);
+	AppendWorldGeometry(mirrored, mirroredIndices, mirror, mergedVertices, mergedIndices);
+
+	CHECK(mergedVertices.size() == 6);
+	CHECK(mergedIndices.size() == 6);
+	CHECK(mergedIndices[0] == 0 && mergedIndices[1] == 1 && mergedIndices[2] == 2);
+	CHECK(mergedIndices[3] == 3 && mergedIndices[4] == 5 && mergedIndices[5] == 4);
+	CheckFloat3(mergedVertices[3].Position, -1, 7, 3);
+	CheckFloat3(mergedVertices[3].Normal, -1, 0, 0);
+	CheckFloat3(mergedVertices[4].Normal, 0, 1, 0);
+	CheckFloat3(mergedVertices[5].Normal, 0, 0, 1);
+
+	// Flattened to nothing in y: the upward normal survives instead of
+	// collapsing to zero or NaN
+	std::vector<Vertex> flattened;
+	flattened.push_back(MakeVertex(1, 1, 1, 0, 1, 0, 0, 0));
+	std::vector<unsigned int> flattenedIndices = { 0 };
+
+	XMFLOAT4X4 flatten(
+		2, 0, 0, 0,
+		0, 0, 0, 0,
+		0, 0, 2, 0,
+		0, 0, 0, 1);
+	AppendWorldGeometry(flattened, flattenedIndices, flatten, mergedVertices, mergedIndices);
+
+	CHECK(mergedIndices[6] == 6);
+	CheckFloat3(mergedVertices[6].Position, 2, 0, 2);
+	CheckFloat3(mergedVertices[6].Normal, 0, 1, 0);
+
+	return TestResult();
+}